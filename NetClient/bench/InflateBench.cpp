@@ -0,0 +1,54 @@
+// Measures Inflater throughput on a gzip or zlib/deflate file:
+//   InflateBench <file> [repeats]
+// Input is fed in 16 KB pieces, as it arrives from a socket.
+
+#include "Inflate.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using NetClient::detail::Inflater;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <file.gz|file.zlib> [repeats]\n", argv[0]);
+        return 2;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    std::string input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (input.empty()) {
+        std::fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 20;
+    Inflater::Format format = (unsigned char)input[0] == 0x1F ? Inflater::Format::Gzip : Inflater::Format::Deflate;
+
+    Inflater inflater;
+    uint64_t output = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        inflater.reset(format, UINT64_MAX);
+        for (size_t pos = 0; pos < input.size(); pos += 16 * 1024) {
+            size_t len = input.size() - pos < 16 * 1024 ? input.size() - pos : 16 * 1024;
+            inflater.feed(input.data() + pos, len, [&](const char*, size_t n) {
+                output += n;
+                return true;
+            });
+        }
+        if (!inflater.done()) {
+            std::fprintf(stderr, "corrupt or truncated stream\n");
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double per_run = (double)output / repeats;
+    std::printf("%s: %.0f -> %.0f bytes (%.1fx), %.0f MB/s decoded, %.0f MB/s compressed\n",
+                argv[1], (double)input.size(), per_run, per_run / input.size(),
+                output / seconds / 1e6, (double)input.size() * repeats / seconds / 1e6);
+    return 0;
+}
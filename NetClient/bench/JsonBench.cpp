@@ -0,0 +1,95 @@
+// Measures JSON parsing throughput:
+//   JsonBench [file.json] [repeats]
+// Without a file, a synthetic update manifest of about 32 MB is used.
+
+#include "NetClientJson.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using NetClient::json::Document;
+using NetClient::json::Value;
+
+static std::string make_manifest(size_t target) {
+    std::string out = "{\"version\": \"2026.10.1\", \"channel\": \"stable\", \"packs\": [\n";
+    char entry[512];
+    for (int i = 0; out.size() < target; ++i) {
+        std::snprintf(entry, sizeof(entry),
+                      "%s  {\"name\": \"Layouts/pack-%05d.xml\", \"size\": %d, \"ratio\": %.4f, \"compressed\": %s,\n"
+                      "   \"url\": \"http:\\/\\/updates.example.com\\/packs\\/%05d.pack\",\n"
+                      "   \"sha256\": \"%08x%08x%08x%08x%08x%08x%08x%08x\", \"tags\": [\"bangla\", \"unicode\", null]}",
+                      i ? ",\n" : "", i, 1000 + i * 37, (i % 997) / 997.0, i % 2 ? "true" : "false", i,
+                      i * 2654435761u, i ^ 0x5bd1e995, i * 40503u, ~i, i * 7u, i * 11u, i * 13u, i * 17u);
+        out += entry;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+template <typename Fn>
+static double seconds(int repeats, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::string input;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        input.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (input.empty()) {
+            std::fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        input = make_manifest(32u << 20);
+    }
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 10;
+    double gigabytes = (double)input.size() * repeats / 1e9;
+
+    Document doc;
+    bool valid = true;
+    double validate = seconds(repeats, [&] {
+        doc.reset(input);
+        valid = doc.validate() && valid;
+    });
+    if (!valid) {
+        std::fprintf(stderr, "invalid JSON: %s\n", doc.error().c_str());
+        return 1;
+    }
+
+    // Index only: skipping the root counts brackets without reading values.
+    size_t skipped = 0;
+    double index = seconds(repeats, [&] {
+        doc.reset(input);
+        skipped += doc.root().raw().size();
+    });
+
+    size_t hashes = 0;
+    double walk = seconds(repeats, [&] {
+        doc.reset(input);
+        doc.root()["packs"].for_each([&](Value pack) {
+            hashes += pack["sha256"].as_string().size();
+            return true;
+        });
+    });
+
+    // Early stop: only the first chunk is indexed.
+    std::string version;
+    double early = seconds(repeats, [&] {
+        doc.reset(input);
+        doc.root()["version"].get(version);
+    });
+
+    std::printf("%.1f MB x %d\n", input.size() / 1048576.0, repeats);
+    std::printf("  index    %7.3f GB/s\n", gigabytes / index);
+    std::printf("  validate %7.3f GB/s\n", gigabytes / validate);
+    std::printf("  walk     %7.3f GB/s  (every pack's sha256)\n", gigabytes / walk);
+    std::printf("  version  %7.3f us per lookup (\"%s\")\n", early * 1e6 / repeats, version.c_str());
+    return skipped && hashes ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// Compares Session::batch() modes against a loopback server:
+//   PipelineBench [requests] [body_bytes] [latency_ms]
+// The server holds each response for latency_ms after its request arrives,
+// standing in for the round trip of a real link, and answers the requests
+// of a connection in order, as HTTP/1.1 requires.
+
+#include "NetClient.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Server {
+    int listener = -1;
+    int port = 0;
+    std::string response;
+    std::chrono::milliseconds latency{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<int> connections{0};
+};
+
+static void serve_connection(Server& server, int fd) {
+    std::string input;
+    std::deque<Clock::time_point> due;
+    char buffer[16 * 1024];
+    for (;;) {
+        int wait_ms = -1;
+        if (!due.empty()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due.front() - Clock::now()).count();
+            wait_ms = left > 0 ? (int)left : 0;
+        }
+        pollfd pfd = {fd, POLLIN, 0};
+        if (::poll(&pfd, 1, wait_ms) > 0) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            input.append(buffer, (size_t)n);
+            // Requests carry no body, so each ends at its blank line.
+            size_t end;
+            while ((end = input.find("\r\n\r\n")) != std::string::npos) {
+                input.erase(0, end + 4);
+                due.push_back(Clock::now() + server.latency);
+            }
+        }
+        while (!due.empty() && due.front() <= Clock::now()) {
+            due.pop_front();
+            if (::send(fd, server.response.data(), server.response.size(), MSG_NOSIGNAL) < 0) {
+                ::close(fd);
+                return;
+            }
+        }
+    }
+    ::close(fd);
+}
+
+static bool start_server(Server& server, size_t body_bytes) {
+    server.listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (server.listener < 0 || ::bind(server.listener, (sockaddr*)&addr, len) != 0 ||
+        ::listen(server.listener, 64) != 0 || ::getsockname(server.listener, (sockaddr*)&addr, &len) != 0) {
+        return false;
+    }
+    server.port = ntohs(addr.sin_port);
+    server.response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " +
+                      std::to_string(body_bytes) + "\r\n\r\n" + std::string(body_bytes, 'x');
+    return true;
+}
+
+static void accept_loop(Server& server) {
+    while (!server.stopping) {
+        int fd = ::accept(server.listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        if (server.stopping) {
+            ::close(fd);
+            break;
+        }
+        server.connections++;
+        std::thread(serve_connection, std::ref(server), fd).detach();
+    }
+}
+
+int main(int argc, char** argv) {
+    int requests = argc > 1 ? std::atoi(argv[1]) : 200;
+    size_t body_bytes = argc > 2 ? (size_t)std::atoi(argv[2]) : 1024;
+    int latency_ms = argc > 3 ? std::atoi(argv[3]) : 2;
+
+    Server server;
+    server.latency = std::chrono::milliseconds(latency_ms);
+    if (!start_server(server, body_bytes)) {
+        std::fprintf(stderr, "cannot listen on the loopback interface\n");
+        return 1;
+    }
+    std::thread acceptor(accept_loop, std::ref(server));
+
+    std::vector<NetClient::BatchRequest> batch(requests);
+    for (int i = 0; i < requests; ++i) {
+        batch[i].url = "http://127.0.0.1:" + std::to_string(server.port) + "/item/" + std::to_string(i);
+    }
+
+    std::printf("%d requests, %zu byte bodies, %d ms latency\n", requests, body_bytes, latency_ms);
+    const struct {
+        const char* name;
+        NetClient::BatchMode mode;
+    } modes[] = {
+        {"serial", NetClient::BatchMode::Serial},
+        {"pooled", NetClient::BatchMode::Pooled},
+        {"pipelined", NetClient::BatchMode::Pipelined},
+    };
+    int status = 0;
+    for (const auto& mode : modes) {
+        // A fresh session per mode, so none inherits warm connections.
+        NetClient::Session session;
+        int before = server.connections;
+        auto start = Clock::now();
+        std::vector<NetClient::Response> responses = session.batch(batch, mode.mode);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        int failed = 0;
+        for (const NetClient::Response& resp : responses) {
+            if (!resp.ok() || resp.text.size() != body_bytes) failed++;
+        }
+        std::printf("  %-10s %8.1f ms  %9.0f req/s  %3d connections", mode.name, seconds * 1e3,
+                    requests / seconds, server.connections - before);
+        if (failed) {
+            std::printf("  %d failed", failed);
+            status = 1;
+        }
+        std::printf("\n");
+    }
+
+    server.stopping = true;
+    ::shutdown(server.listener, SHUT_RDWR);
+    ::close(server.listener);
+    acceptor.join();
+    return status;
+}
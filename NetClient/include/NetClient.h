@@ -1,8 +1,16 @@
 #ifndef NETCLIENT_H
 #define NETCLIENT_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <map>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -17,18 +25,458 @@
 
 namespace NetClient {
 
+    // Where the time of a request went, in milliseconds. Steps a request did
+    // not take, such as DNS and connect on a reused connection, stay 0.
+    struct Timing {
+        double queued = 0;      // waiting for a free connection to the host
+        double dns = 0;
+        double connect = 0;
+        double tls = 0;
+        double ttfb = 0;        // request sent until the first response byte
+        double transfer = 0;    // first response byte until the end of the body
+        double total = 0;
+    };
+
+    // Response headers in one buffer, laid out as the "Name: value" lines of
+    // a header block, with an index of where each name and value sits. Names
+    // are hashed case-insensitively when stored, so get() costs one hash of
+    // the query and no allocation. Headers keep the order they arrived in,
+    // and a repeated header such as Set-Cookie keeps every value.
+    // Iterating yields (name, value) pairs of views into the buffer; views
+    // stay valid until the headers change.
+    class Headers {
+    public:
+        typedef std::pair<std::string_view, std::string_view> value_type;
+
+        class const_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Headers::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef void pointer;
+            typedef value_type reference;
+
+            value_type operator*() const { return owner_->at(index_); }
+            const_iterator& operator++() {
+                ++index_;
+                return *this;
+            }
+            bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+            bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+        private:
+            friend class Headers;
+            const_iterator(const Headers* owner, size_t index) : owner_(owner), index_(index) {}
+
+            const Headers* owner_;
+            size_t index_;
+        };
+
+        // The first value of name, or an empty view when it is absent.
+        NETCLIENT_API std::string_view get(std::string_view name) const;
+        NETCLIENT_API bool has(std::string_view name) const;
+        // Every value of name, in order.
+        NETCLIENT_API std::vector<std::string_view> values(std::string_view name) const;
+        // Every value of name joined by ", ", the way a list header may be
+        // split over several lines.
+        NETCLIENT_API std::string combined(std::string_view name) const;
+
+        NETCLIENT_API void add(std::string_view name, std::string_view value);
+        // Replaces every value of name.
+        NETCLIENT_API void set(std::string_view name, std::string_view value);
+        NETCLIENT_API void remove(std::string_view name);
+        NETCLIENT_API void clear();
+
+        // Replaces the headers with the lines of a raw header block, copied
+        // once and indexed in place. Values are trimmed; lines without a
+        // colon are skipped.
+        NETCLIENT_API void parse(const char* block, size_t len);
+
+        // The header block, one "Name: value" line per header.
+        std::string_view raw() const { return buffer_; }
+
+        size_t size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, entries_.size()); }
+        value_type at(size_t i) const {
+            const Entry& e = entries_[i];
+            return value_type(std::string_view(buffer_).substr(e.name, e.name_len),
+                              std::string_view(buffer_).substr(e.value, e.value_len));
+        }
+
+    private:
+        static const uint32_t kNone = 0xFFFFFFFF;
+
+        struct Entry {
+            uint32_t name, name_len;
+            uint32_t value, value_len;
+            uint32_t hash;          // of the lowercase name
+            uint32_t next;          // next entry with the same name, or kNone
+            uint32_t last;          // in the first entry of a name: its last entry
+        };
+
+        uint32_t find(std::string_view name, uint32_t hash) const;
+        void index(uint32_t entry);
+        void rehash(size_t slots);
+
+        std::string buffer_;
+        std::vector<Entry> entries_;
+        // Open addressing over the first entry of each name, stored plus
+        // one; 0 marks a free slot.
+        std::vector<uint32_t> slots_;
+        size_t names_ = 0;
+    };
+
+    // A response body, read like a const std::string. A response served from
+    // the cache shares the cached buffer instead of holding a copy; changing
+    // the body first takes a private copy.
+    class Body {
+    public:
+        Body() = default;
+        Body(std::string text) : owned_(std::move(text)) {}
+        explicit Body(std::shared_ptr<const std::string> shared) : shared_(std::move(shared)) {}
+
+        const std::string& str() const { return shared_ ? *shared_ : owned_; }
+        operator const std::string&() const { return str(); }
+        operator std::string_view() const { return str(); }
+
+        const char* c_str() const { return str().c_str(); }
+        const char* data() const { return str().data(); }
+        size_t size() const { return str().size(); }
+        bool empty() const { return str().empty(); }
+
+        // The buffer as a shared, immutable string, converting it in place
+        // on first use so later calls and copies of the body share it too.
+        std::shared_ptr<const std::string> share() {
+            if (!shared_) shared_ = std::make_shared<const std::string>(std::move(owned_));
+            owned_.clear();
+            return shared_;
+        }
+
+        std::string& mutable_str() {
+            if (shared_) {
+                owned_ = *shared_;
+                shared_.reset();
+            }
+            return owned_;
+        }
+        void append(const char* data, size_t len) { mutable_str().append(data, len); }
+        void reserve(size_t len) { mutable_str().reserve(len); }
+        void clear() {
+            shared_.reset();
+            owned_.clear();
+        }
+
+    private:
+        std::string owned_;
+        std::shared_ptr<const std::string> shared_;
+    };
+
+    inline bool operator==(const Body& body, std::string_view text) { return std::string_view(body) == text; }
+    inline bool operator!=(const Body& body, std::string_view text) { return std::string_view(body) != text; }
+
     struct Response {
         int status_code;
-        std::string text;
+        Body text;
         std::string url;
-        std::map<std::string, std::string> headers;
+        Headers headers;
+        std::string error;      // why status_code is 0: "cancelled", "timeout", ...
+        Timing timing;
+        uint64_t bytes_sent = 0;        // request head and body
+        uint64_t bytes_received = 0;    // response head and body as transferred, before decoding
+        bool reused_connection = false;
         
         bool ok() const { return status_code >= 200 && status_code < 300; }
         
+        // Every value of the header joined by ", "; headers.get() avoids the copy.
         NETCLIENT_API std::string header(const std::string& name) const;
         NETCLIENT_API bool is_json() const;
     };
 
+    // Identifies an in-flight asynchronous request.
+    typedef uint64_t RequestId;
+
+    // Receives the finished response of an asynchronous request.
+    typedef std::function<void(Response)> Completion;
+
+    struct AsyncResponse {
+        RequestId id;
+        std::future<Response> response;
+    };
+
+    // One request of Session::batch().
+    struct BatchRequest {
+        std::string method = "GET";
+        std::string url;
+        std::string data;
+        std::map<std::string, std::string> headers;
+    };
+
+    // How Session::batch() spreads its requests over connections.
+    enum class BatchMode {
+        Pipelined,  // back to back on one connection per host where possible
+        Pooled,     // in parallel, one request per pooled connection at a time
+        Serial,     // one after another through request()
+    };
+
+    // Receives a response body piece by piece as it arrives. head already
+    // holds the status and headers; its text stays empty. Returning false
+    // aborts the request.
+    typedef std::function<bool(const Response& head, const char* data, size_t size)> BodySink;
+
+    // A request body read while it is sent instead of held in memory: a
+    // sequence of bytes, files and readers. When every part's size is known
+    // the request carries Content-Length; otherwise it goes out with
+    // chunked transfer coding.
+    class RequestBody {
+    public:
+        // Writes up to size bytes of the body into buffer and returns how
+        // many; 0 ends the part, a negative value aborts the request.
+        typedef std::function<long long(char* buffer, size_t size)> Reader;
+
+        static const uint64_t kUnknownSize = UINT64_MAX;
+
+        struct Part {
+            enum class Kind { Bytes, File, Reader } kind = Kind::Bytes;
+            std::string data;       // Bytes: the bytes; File: the path
+            uint64_t size = 0;      // File: its size when added; Reader: as promised
+            Reader reader;
+        };
+
+        // Sent as the Content-Type unless the request names its own.
+        std::string content_type;
+
+        NETCLIENT_API void add_bytes(std::string_view bytes);
+        // Sends the whole file, which must keep the size it has now. False
+        // when it cannot be opened.
+        NETCLIENT_API bool add_file(const std::string& path);
+        // A reader is called on the sending thread. One with a known size
+        // must produce exactly that many bytes.
+        NETCLIENT_API void add_reader(Reader reader, uint64_t size = kUnknownSize);
+
+        // The sum of the parts, or kUnknownSize when a reader's is unknown.
+        NETCLIENT_API uint64_t size() const;
+        const std::vector<Part>& parts() const { return parts_; }
+
+    private:
+        friend class MultipartForm;
+
+        std::vector<Part> parts_;
+    };
+
+    // A multipart/form-data body (RFC 7578) whose files are streamed from
+    // disk as it is sent.
+    class MultipartForm {
+    public:
+        // Picks a random boundary.
+        NETCLIENT_API MultipartForm();
+
+        NETCLIENT_API void add_field(const std::string& name, std::string_view value);
+        // filename defaults to the last component of path. False when the
+        // file cannot be opened.
+        NETCLIENT_API bool add_file(const std::string& name,
+                                    const std::string& path,
+                                    const std::string& filename = "",
+                                    const std::string& content_type = "application/octet-stream");
+        NETCLIENT_API void add_reader(const std::string& name,
+                                      const std::string& filename,
+                                      const std::string& content_type,
+                                      RequestBody::Reader reader,
+                                      uint64_t size = RequestBody::kUnknownSize);
+
+        // The finished form, with its Content-Type set.
+        NETCLIENT_API RequestBody body() const;
+
+    private:
+        void begin_part(const std::string& name, const std::string* filename, const std::string& content_type);
+
+        std::string boundary_;
+        RequestBody body_;
+    };
+
+    struct DownloadOptions {
+        std::map<std::string, std::string> headers;
+        bool resume = true;             // continue an earlier "<path>.part" with a Range request
+        int max_attempts = 3;           // an interrupted transfer resumes until this many attempts
+        std::string expected_sha256;    // lowercase hex; on mismatch the file is discarded
+
+        // Called as the body arrives, with the bytes this call has received
+        // and the size the server announced for them (0 when unknown); a
+        // resumed download counts only what it fetches. Returning false
+        // stops the download with error "aborted", leaving the part behind.
+        std::function<bool(uint64_t received, uint64_t total)> on_progress;
+    };
+
+    struct DownloadResult {
+        Response response;              // status, headers and error; text stays empty
+        uint64_t size = 0;              // bytes in the finished file
+        std::string sha256;             // lowercase hex digest of the whole file
+        bool resumed = false;           // part of the file came from an earlier attempt
+
+        bool ok() const { return response.ok() && response.error.empty(); }
+    };
+
+    // How request() and the verb helpers cope with failures. Transport
+    // errors and the listed statuses are retried after an exponential
+    // backoff with full jitter, or after the server's Retry-After. Methods
+    // that are not idempotent, such as POST, are retried only when the
+    // request never reached the server, unless retry_non_idempotent is set.
+    struct RetryPolicy {
+        int max_attempts = 1;               // 1 disables retries
+        int base_delay_ms = 100;            // retry n waits up to base_delay_ms * 2^(n-1) ...
+        int max_delay_ms = 5000;            // ... capped here; a longer Retry-After ends retrying
+        int deadline_ms = 0;                // bounds all attempts and waits together; 0 for none
+        std::vector<int> retry_statuses = {429, 502, 503, 504};
+        bool retry_non_idempotent = false;
+
+        // After breaker_threshold consecutive failures (transport errors or
+        // 5xx) a host's requests fail at once with "circuit open" for
+        // breaker_cooldown_ms. Then one trial request decides whether the
+        // breaker closes again. 0 disables.
+        int breaker_threshold = 0;
+        int breaker_cooldown_ms = 30000;
+
+        // A GET still unanswered after hedge_after_ms is sent again on
+        // another connection; the first usable response wins and the other
+        // is cancelled. Trims tail latency at the cost of extra requests.
+        // 0 disables.
+        int hedge_after_ms = 0;
+    };
+
+    struct SessionOptions {
+        int max_connections_per_host = 6;
+        int idle_timeout_ms = 60000;        // idle keep-alive connections are closed after this
+        int request_timeout_ms = 30000;
+        bool decompress = true;             // request gzip/deflate and decode it transparently
+        uint64_t max_decompressed_bytes = 256ull << 20;     // guards against decompression bombs
+        bool cache = false;                 // HTTP cache for request() and get(); see below
+        size_t cache_memory_bytes = 8u << 20;
+        std::string cache_directory;        // persists the cache; its parent must exist
+        RetryPolicy retry;
+    };
+
+    // Keeps connections to each host alive between requests, so repeated
+    // requests skip the TCP (and TLS) handshake. Safe to use from several
+    // threads at once; a request waits when its host already has
+    // max_connections_per_host connections busy.
+    //
+    // With SessionOptions::cache, GET requests made through request() and
+    // get() are answered from a private cache while fresh by Cache-Control
+    // or Expires, and revalidated with If-None-Match / If-Modified-Since
+    // once stale; a 304 is returned to the caller as the stored 200.
+    class NETCLIENT_API Session {
+    public:
+        explicit Session(const SessionOptions& config = SessionOptions());
+        ~Session();
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        Response request(const std::string& method,
+                         const std::string& url,
+                         const std::string& data = "",
+                         const std::map<std::string, std::string>& headers = {});
+
+        Response get(const std::string& url,
+                     const std::map<std::string, std::string>& params = {},
+                     const std::map<std::string, std::string>& headers = {});
+
+        Response post(const std::string& url,
+                      const std::string& data = "",
+                      const std::map<std::string, std::string>& headers = {});
+
+        Response put(const std::string& url,
+                     const std::string& data = "",
+                     const std::map<std::string, std::string>& headers = {});
+
+        Response del(const std::string& url,
+                     const std::map<std::string, std::string>& headers = {});
+
+        Response options(const std::string& url,
+                         const std::map<std::string, std::string>& headers = {});
+
+        // Like request(), but hands the body to sink through one reusable
+        // buffer instead of collecting it, so memory use does not grow with
+        // the payload.
+        Response request_stream(const std::string& method,
+                                const std::string& url,
+                                const std::string& data,
+                                const std::map<std::string, std::string>& headers,
+                                const BodySink& sink);
+
+        // Sends body as it is read: files go straight from the page cache to
+        // the socket with sendfile() on Linux, so memory use stays flat
+        // whatever their size. The timeout bounds each wait rather than the
+        // whole transfer. Uploads bypass the cache and retry policy.
+        Response upload(const std::string& method,
+                        const std::string& url,
+                        const RequestBody& body,
+                        const std::map<std::string, std::string>& headers = {});
+
+        // Streams url into path. Bytes go to "<path>.part", which is hashed
+        // on the fly and renamed over path once complete. A part left by an
+        // interrupted download is continued with an HTTP Range request.
+        DownloadResult download(const std::string& url,
+                                const std::string& path,
+                                const DownloadOptions& options = DownloadOptions());
+
+        // Rebuilds path from base_path and the delta at url (see
+        // make_delta). The delta is applied as it arrives into
+        // "<path>.part", which is checked against the target hash the delta
+        // carries and renamed over path; base_path may be path itself. Fails
+        // with error "base mismatch" when the delta was made for another
+        // base. An interrupted transfer starts over, up to max_attempts.
+        DownloadResult download_delta(const std::string& url,
+                                      const std::string& base_path,
+                                      const std::string& path,
+                                      const DownloadOptions& options = DownloadOptions());
+
+        // Sends requests together and returns their responses in the same
+        // order. Pipelined, the GET and HEAD requests to one host are written
+        // back to back on a single keep-alive connection and their responses
+        // read off it in order (HTTP/1.1 pipelining). What the connection
+        // leaves unanswered, because the server closed it, answered
+        // HTTP/1.0 or stalled, is sent again through the Pooled path, and
+        // the host is not pipelined to again by this session. Other methods
+        // and, on Windows, where WinHTTP cannot pipeline, all requests take
+        // the Pooled path: send_async() with up to max_connections_per_host
+        // connections per host. Only Serial applies the cache and retry
+        // policy.
+        std::vector<Response> batch(const std::vector<BatchRequest>& requests,
+                                    BatchMode mode = BatchMode::Pipelined);
+
+        // Starts a request without blocking. All of a session's asynchronous
+        // requests share one I/O thread (epoll on Linux, WinHTTP's async
+        // mode on Windows); on_complete runs there and must return quickly.
+        // timeout_ms bounds the whole request, 0 meaning request_timeout_ms.
+        // Cancelled and timed-out requests complete with status_code 0.
+        RequestId send_async(const std::string& method,
+                             const std::string& url,
+                             const std::string& data,
+                             const std::map<std::string, std::string>& headers,
+                             Completion on_complete,
+                             int timeout_ms = 0);
+
+        AsyncResponse request_async(const std::string& method,
+                                    const std::string& url,
+                                    const std::string& data = "",
+                                    const std::map<std::string, std::string>& headers = {},
+                                    int timeout_ms = 0);
+
+        // Completes the request with error "cancelled" unless it already
+        // finished.
+        void cancel(RequestId id);
+
+        struct Impl;
+
+    private:
+        Impl* impl_;
+    };
+
+    // Process-wide session used by the free functions below.
+    NETCLIENT_API Session& default_session();
+
     NETCLIENT_API Response get(const std::string& url, 
                                const std::map<std::string, std::string>& params = {},
                                const std::map<std::string, std::string>& headers = {});
@@ -46,6 +494,194 @@ namespace NetClient {
 
     NETCLIENT_API Response options(const std::string& url, 
                                    const std::map<std::string, std::string>& headers = {});
+
+    NETCLIENT_API Response upload(const std::string& method,
+                                  const std::string& url,
+                                  const RequestBody& body,
+                                  const std::map<std::string, std::string>& headers = {});
+
+    NETCLIENT_API DownloadResult download(const std::string& url,
+                                          const std::string& path,
+                                          const DownloadOptions& options = DownloadOptions());
+
+    NETCLIENT_API DownloadResult download_delta(const std::string& url,
+                                                const std::string& base_path,
+                                                const std::string& path,
+                                                const DownloadOptions& options = DownloadOptions());
+
+    // Lowercase hex SHA-256 of a file, as DownloadResult::sha256 reports
+    // it; empty when the file cannot be read.
+    NETCLIENT_API std::string file_sha256(const std::string& path);
+
+    // Writes a delta that download_delta() applies to base_path to rebuild
+    // target_path. Its size follows the size of the change: unchanged runs
+    // of the base cost a few bytes each. Both files are read into memory.
+    NETCLIENT_API bool make_delta(const std::string& base_path,
+                                  const std::string& target_path,
+                                  const std::string& delta_path);
+
+    struct SchedulerOptions {
+        int max_active = 4;                 // downloads in flight at once
+        int max_per_host = 2;               // of those, to any one host
+        uint64_t max_bytes_per_second = 0;  // shared by all downloads; 0 is unlimited
+        uint64_t burst_bytes = 256 * 1024;  // may pass at once after an idle spell
+    };
+
+    struct ScheduledDownload {
+        std::string url;
+        std::string path;
+        int priority = 0;               // higher starts first
+        DownloadOptions options;        // on_progress is wrapped by the scheduler
+        // With both set, download_delta(delta_url, base_path, path) is tried
+        // first and url is the fallback.
+        std::string delta_url;
+        std::string base_path;
+    };
+
+    enum class DownloadState { Queued, Active, Done, Failed, Cancelled };
+
+    struct DownloadEvent {
+        uint64_t id = 0;
+        DownloadState state = DownloadState::Queued;
+        uint64_t received = 0;          // as DownloadOptions::on_progress reports it
+        uint64_t total = 0;
+        const ScheduledDownload* download = nullptr;
+        const DownloadResult* result = nullptr;     // for Done and Failed
+    };
+
+    // Runs many downloads through one session, so they share its pooled
+    // connections, and streams each to disk with Session::download.
+    //
+    // At most max_active run at once and at most max_per_host against one
+    // host. The queued download with the highest priority starts next; among
+    // equals, the host that has waited longest goes first, so one large
+    // batch cannot starve another host. All transfers draw from one token
+    // bucket of max_bytes_per_second: a worker that runs ahead of the rate
+    // pauses between reads, and TCP flow control slows the sender.
+    class NETCLIENT_API DownloadScheduler {
+    public:
+        // Called on the worker threads, and on the caller's thread for
+        // Queued and for cancelling queued downloads. Keep it short; it may
+        // call cancel() and cancel_all().
+        typedef std::function<void(const DownloadEvent& event)> EventCallback;
+
+        explicit DownloadScheduler(Session& session,
+                                   const SchedulerOptions& options = SchedulerOptions(),
+                                   EventCallback on_event = EventCallback());
+        // Cancels whatever is left and waits for the workers.
+        ~DownloadScheduler();
+
+        DownloadScheduler(const DownloadScheduler&) = delete;
+        DownloadScheduler& operator=(const DownloadScheduler&) = delete;
+
+        uint64_t add(const ScheduledDownload& download);
+
+        // Only reorders downloads that have not started.
+        bool set_priority(uint64_t id, int priority);
+
+        // Drops a queued download or stops a running one; a stopped
+        // download's part file stays for a later resume. False when id has
+        // already finished or is unknown.
+        bool cancel(uint64_t id);
+        void cancel_all();
+
+        void set_rate_limit(uint64_t bytes_per_second);
+
+        // Blocks until nothing is queued or running.
+        void wait();
+
+        // The result of a finished download.
+        bool result(uint64_t id, DownloadResult& out) const;
+
+        struct Impl;
+
+    private:
+        Impl* impl_;
+    };
+
+    struct WebSocketOptions {
+        std::map<std::string, std::string> headers;     // added to the upgrade request
+        std::vector<std::string> protocols;             // offered in Sec-WebSocket-Protocol
+        bool compress = true;               // accept permessage-deflate messages from the server
+        int timeout_ms = 30000;             // bounds the connect, the handshake and each send
+        int ping_interval_ms = 30000;       // a quiet connection is pinged after this; 0 never
+        int pong_timeout_ms = 10000;        // and dropped when nothing arrives within this
+        uint64_t max_message_bytes = 16ull << 20;   // a larger message closes with 1009
+    };
+
+    // A WebSocket (RFC 6455) client for servers that push. One thread per
+    // connection waits for incoming data and otherwise sleeps, waking only
+    // to ping a quiet connection, so an idle socket costs next to nothing.
+    // Pings from the server are answered, fragmented messages are joined,
+    // and compressed messages (permessage-deflate) are inflated; messages
+    // are always sent uncompressed, which the extension allows.
+    class NETCLIENT_API WebSocket {
+    public:
+        // Called on the connection's thread; they may send() and close()
+        // but must not destroy the WebSocket.
+        typedef std::function<void(const std::string& message, bool binary)> MessageHandler;
+        // Called once when an open connection ends. code is the server's
+        // close code, 1005 when it sent none, or 1006 when the connection
+        // dropped without a closing handshake.
+        typedef std::function<void(int code, const std::string& reason)> CloseHandler;
+
+        explicit WebSocket(MessageHandler on_message, CloseHandler on_close = CloseHandler());
+        // Closes with 1001 ("going away") and waits for the thread.
+        ~WebSocket();
+
+        WebSocket(const WebSocket&) = delete;
+        WebSocket& operator=(const WebSocket&) = delete;
+
+        // Connects to a ws:// or wss:// URL and completes the opening
+        // handshake. False, with error() set, on failure. Call it once.
+        bool connect(const std::string& url, const WebSocketOptions& options = WebSocketOptions());
+
+        // Safe from any thread. False when the connection is not open or
+        // the send failed.
+        bool send_text(const std::string& message);
+        bool send_binary(const std::string& message);
+
+        // Starts the closing handshake and, unless called from a handler,
+        // waits up to timeout_ms for the server to answer.
+        void close(int code = 1000, const std::string& reason = "");
+
+        bool is_open() const;
+        std::string error() const;
+        std::string protocol() const;   // the subprotocol the server chose
+        bool compressed() const;        // permessage-deflate was negotiated
+
+        struct Impl;
+
+    private:
+        Impl* impl_;
+    };
+
+    // Counters for one "host:port" since start or reset_metrics(). Latency
+    // buckets are powers of two: bucket 0 counts requests under 1 ms,
+    // bucket i those under 2^i ms, and the last bucket everything slower.
+    struct HostMetrics {
+        static const int kBuckets = 18;
+
+        uint64_t requests = 0;              // requests that went to the network
+        uint64_t failures = 0;              // ended with status_code 0
+        uint64_t timeouts = 0;
+        uint64_t cache_hits = 0;            // answered by the cache without a request
+        uint64_t connections_opened = 0;
+        uint64_t connections_reused = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        double total_ms = 0;                // summed Timing::total, for the mean
+        uint64_t latency_ms[kBuckets] = {};
+        uint64_t ttfb_ms[kBuckets] = {};
+    };
+
+    // Process-wide, across every session.
+    NETCLIENT_API std::map<std::string, HostMetrics> metrics();
+    NETCLIENT_API void reset_metrics();
+
+    // Human-readable dump of metrics() with latency percentiles, connection
+    // reuse rates and the state of every session's connection pool.
+    NETCLIENT_API std::string metrics_report();
 }
 
 #endif // NETCLIENT_H
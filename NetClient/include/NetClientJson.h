@@ -0,0 +1,118 @@
+#ifndef NETCLIENT_JSON_H
+#define NETCLIENT_JSON_H
+
+#include "NetClient.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace NetClient {
+namespace json {
+
+    enum class Type { Invalid, Null, Bool, Number, String, Array, Object };
+
+    class Document;
+
+    // A value inside a Document, found on demand. Copying one is cheap; it
+    // stays usable while its Document and the parsed text live.
+    //
+    // Looking up a missing key, an index past the end or malformed input
+    // gives an invalid Value, and every accessor of an invalid Value fails,
+    // so a chain like doc.root()["packs"][0]["sha256"] needs a single check
+    // at the end. Document::error() then says what went wrong.
+    class NETCLIENT_API Value {
+    public:
+        Value() = default;
+
+        // Judged by the value's first byte; get() checks the rest.
+        Type type() const;
+        bool valid() const { return type() != Type::Invalid; }
+
+        // Member of an object, or element of an array.
+        Value operator[](std::string_view key) const;
+        Value operator[](size_t index) const;
+
+        // Elements of an array or members of an object; 0 for anything
+        // else. Walks the whole container.
+        size_t size() const;
+
+        // Calls fn for each element in order until it returns false, which
+        // stops the walk without reading the rest. False when this is not
+        // an array or the input is malformed.
+        bool for_each(const std::function<bool(Value)>& fn) const;
+        bool for_each_member(const std::function<bool(std::string_view key, Value value)>& fn) const;
+
+        // False when the value is missing or of another type. Numbers must
+        // fit; an integer getter rejects fractions and exponents.
+        bool get(bool& out) const;
+        bool get(int64_t& out) const;
+        bool get(uint64_t& out) const;
+        bool get(double& out) const;
+        bool get(std::string& out) const;
+
+        // Points into the parsed text, or into the Document for strings
+        // that contain escapes.
+        bool get(std::string_view& out) const;
+
+        std::string_view as_string(std::string_view fallback = {}) const;
+        int64_t as_int(int64_t fallback = 0) const;
+        double as_double(double fallback = 0) const;
+        bool as_bool(bool fallback = false) const;
+        bool is_null() const;
+
+        // The value's source text, quotes and brackets included.
+        std::string_view raw() const;
+
+    private:
+        friend class Document;
+        Value(const Document* doc, size_t index) : doc_(doc), index_(index) {}
+
+        const Document* doc_ = nullptr;
+        size_t index_ = 0;      // position in the structural index
+    };
+
+    // Parses JSON without copying it. A vectorized pass indexes the text a
+    // chunk at a time, and only as far as lookups need: reading a version
+    // field at the top of a large manifest never looks at the rest.
+    // Strings are views into the text, which must outlive the Document;
+    // parse resp.text of a Response that is kept, not a temporary.
+    //
+    // Only what is visited is checked; call validate() to check it all.
+    // A Document is not safe to use from several threads at once, even for
+    // reading, because lookups extend the index.
+    class NETCLIENT_API Document {
+    public:
+        Document();
+        explicit Document(std::string_view text);
+        ~Document();
+
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        // Starts over on new text, keeping allocated memory.
+        void reset(std::string_view text);
+
+        Value root() const;
+
+        // Reads the whole text and checks it against the JSON grammar:
+        // escapes, numbers, nesting up to 1024 levels and nothing after the
+        // root value.
+        bool validate() const;
+
+        // The first problem found so far, with its byte offset.
+        const std::string& error() const;
+
+        struct Impl;
+
+    private:
+        friend class Value;
+        Impl* impl_;
+    };
+
+} // namespace json
+} // namespace NetClient
+
+#endif // NETCLIENT_JSON_H
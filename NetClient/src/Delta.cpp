@@ -0,0 +1,256 @@
+#include "Delta.h"
+#include "PartialFile.h"
+#include "Sha256.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace NetClient {
+namespace detail {
+
+    static const char kMagic[8] = {'N', 'C', 'D', 'E', 'L', 'T', 'A', '1'};
+
+    enum : uint8_t { kOpEnd = 0x00, kOpCopy = 0x01, kOpAdd = 0x02 };
+
+    // Long enough that a match is rarely a coincidence, short enough that
+    // small edits leave most blocks intact.
+    static const size_t kBlock = 32;
+    static const uint32_t kPrime = 0x01000193;
+
+    static std::string hex_to_raw(const std::string& hex) {
+        std::string raw;
+        for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+            raw.push_back((char)std::stoi(hex.substr(i, 2), nullptr, 16));
+        }
+        return raw;
+    }
+
+    static std::string raw_to_hex(const char* raw, size_t len) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (size_t i = 0; i < len; ++i) {
+            hex.push_back(digits[(uint8_t)raw[i] >> 4]);
+            hex.push_back(digits[(uint8_t)raw[i] & 15]);
+        }
+        return hex;
+    }
+
+    static std::string sha256_hex(const std::string& data) {
+        Sha256 sha;
+        sha.update(data.data(), data.size());
+        return sha.finish_hex();
+    }
+
+    static void put_u64(std::string& out, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out.push_back((char)(v >> (8 * i)));
+    }
+
+    static void put_varint(std::string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    // Returns the bytes used, 0 when data ends first, -1 when too long.
+    static int get_varint(const char* data, size_t len, uint64_t& v) {
+        v = 0;
+        for (size_t i = 0; i < len; ++i) {
+            if (i == 10) return -1;
+            v |= (uint64_t)((uint8_t)data[i] & 0x7f) << (7 * i);
+            if (((uint8_t)data[i] & 0x80) == 0) return (int)i + 1;
+        }
+        return 0;
+    }
+
+    static uint32_t block_hash(const char* data) {
+        uint32_t h = 0;
+        for (size_t i = 0; i < kBlock; ++i) h = h * kPrime + (uint8_t)data[i];
+        return h;
+    }
+
+    void encode_delta(const std::string& base, const std::string& target, std::string& out) {
+        out.assign(kMagic, sizeof(kMagic));
+        out += hex_to_raw(sha256_hex(base));
+        put_u64(out, target.size());
+        out += hex_to_raw(sha256_hex(target));
+
+        // First offset of each block hash; later duplicates add nothing.
+        std::unordered_map<uint32_t, uint64_t> blocks;
+        blocks.reserve(base.size() / kBlock + 1);
+        for (uint64_t at = 0; at + kBlock <= base.size(); at += kBlock) {
+            blocks.emplace(block_hash(base.data() + at), at);
+        }
+
+        uint32_t drop = 1;      // kPrime^kBlock, the weight of the byte leaving the window
+        for (size_t i = 0; i < kBlock; ++i) drop *= kPrime;
+
+        const char* t = target.data();
+        const size_t size = target.size();
+        size_t literal = 0;
+        auto flush_literal = [&](size_t end) {
+            if (end == literal) return;
+            out.push_back((char)kOpAdd);
+            put_varint(out, end - literal);
+            out.append(t + literal, end - literal);
+        };
+
+        size_t i = 0;
+        uint32_t h = size >= kBlock ? block_hash(t) : 0;
+        while (i + kBlock <= size) {
+            auto found = blocks.find(h);
+            if (found != blocks.end() && std::memcmp(base.data() + found->second, t + i, kBlock) == 0) {
+                uint64_t from = found->second;
+                size_t start = i;
+                while (start > literal && from > 0 && base[from - 1] == t[start - 1]) {
+                    --start;
+                    --from;
+                }
+                size_t end = i + kBlock;
+                uint64_t from_end = found->second + kBlock;
+                while (end < size && from_end < base.size() && base[from_end] == t[end]) {
+                    ++end;
+                    ++from_end;
+                }
+
+                flush_literal(start);
+                out.push_back((char)kOpCopy);
+                put_varint(out, from);
+                put_varint(out, end - start);
+
+                i = literal = end;
+                if (i + kBlock <= size) h = block_hash(t + i);
+                continue;
+            }
+            if (i + kBlock < size) h = h * kPrime + (uint8_t)t[i + kBlock] - drop * (uint8_t)t[i];
+            ++i;
+        }
+        flush_literal(size);
+        out.push_back((char)kOpEnd);
+    }
+
+    void DeltaPatcher::reset(PartialFile* base, const std::string& base_sha256) {
+        base_ = base;
+        base_sha256_ = base_sha256;
+        state_ = State::Header;
+        pending_.clear();
+        target_size_ = 0;
+        target_sha256_.clear();
+        written_ = 0;
+        add_left_ = 0;
+        base_mismatch_ = false;
+    }
+
+    bool DeltaPatcher::fail() {
+        state_ = State::Error;
+        return false;
+    }
+
+    bool DeltaPatcher::parse_header() {
+        const char* p = pending_.data();
+        if (std::memcmp(p, kMagic, sizeof(kMagic)) != 0) return false;
+        if (raw_to_hex(p + 8, 32) != base_sha256_) {
+            base_mismatch_ = true;
+            return false;
+        }
+        target_size_ = 0;
+        for (int i = 0; i < 8; ++i) target_size_ |= (uint64_t)(uint8_t)p[40 + i] << (8 * i);
+        target_sha256_ = raw_to_hex(p + 48, 32);
+        return true;
+    }
+
+    bool DeltaPatcher::copy(uint64_t offset, uint64_t length, const Output& out) {
+        char buffer[64 * 1024];
+        while (length > 0) {
+            size_t want = (size_t)(length < sizeof(buffer) ? length : sizeof(buffer));
+            size_t got = 0;
+            if (!base_->read_at(offset, buffer, want, got) || got == 0) return false;
+            if (!out(buffer, got)) return false;
+            offset += got;
+            length -= got;
+            written_ += got;
+        }
+        return true;
+    }
+
+    int DeltaPatcher::parse_op(const Output& out) {
+        const char* p = pending_.data() + 1;
+        size_t len = pending_.size() - 1;
+        switch ((uint8_t)pending_[0]) {
+            case kOpEnd:
+                if (written_ != target_size_) return -1;
+                state_ = State::Done;
+                return 1;
+            case kOpCopy: {
+                uint64_t offset = 0, length = 0;
+                int used = get_varint(p, len, offset);
+                if (used <= 0) return used;
+                int used_length = get_varint(p + used, len - used, length);
+                if (used_length <= 0) return used_length;
+                if (length == 0 || offset > base_->size() || length > base_->size() - offset ||
+                    length > target_size_ - written_) {
+                    return -1;
+                }
+                return copy(offset, length, out) ? 1 : -1;
+            }
+            case kOpAdd: {
+                uint64_t length = 0;
+                int used = get_varint(p, len, length);
+                if (used <= 0) return used;
+                if (length == 0 || length > target_size_ - written_) return -1;
+                add_left_ = length;
+                state_ = State::Add;
+                return 1;
+            }
+            default:
+                return -1;
+        }
+    }
+
+    bool DeltaPatcher::feed(const char* data, size_t len, const Output& out) {
+        while (len > 0) {
+            switch (state_) {
+                case State::Header: {
+                    size_t take = kDeltaHeaderSize - pending_.size();
+                    if (take > len) take = len;
+                    pending_.append(data, take);
+                    data += take;
+                    len -= take;
+                    if (pending_.size() == kDeltaHeaderSize) {
+                        if (!parse_header()) return fail();
+                        pending_.clear();
+                        state_ = State::Op;
+                    }
+                    break;
+                }
+                case State::Op: {
+                    // Op headers are at most 21 bytes, so gathering them a
+                    // byte at a time costs little next to the data they move.
+                    pending_.push_back(*data++);
+                    --len;
+                    int complete = parse_op(out);
+                    if (complete < 0) return fail();
+                    if (complete > 0) pending_.clear();
+                    break;
+                }
+                case State::Add: {
+                    size_t take = (size_t)(add_left_ < len ? add_left_ : len);
+                    if (!out(data, take)) return fail();
+                    data += take;
+                    len -= take;
+                    written_ += take;
+                    add_left_ -= take;
+                    if (add_left_ == 0) state_ = State::Op;
+                    break;
+                }
+                case State::Done:       // bytes after END
+                case State::Error:
+                    return fail();
+            }
+        }
+        return true;
+    }
+
+} // namespace detail
+} // namespace NetClient
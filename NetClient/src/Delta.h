@@ -0,0 +1,80 @@
+#ifndef NETCLIENT_DELTA_H
+#define NETCLIENT_DELTA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace NetClient {
+namespace detail {
+
+    class PartialFile;
+
+    // Binary delta format, all integers little-endian:
+    //
+    //   "NCDELTA1"        magic
+    //   base sha256       32 bytes, the file the delta applies to
+    //   target size       uint64
+    //   target sha256     32 bytes, the file it rebuilds
+    //   ops               0x01 COPY <offset> <length>   bytes from the base
+    //                     0x02 ADD <length> <bytes>     literal bytes
+    //                     0x00 END
+    //
+    // Offsets and lengths are LEB128 varints. The target is written front to
+    // back, so a delta can be applied while it downloads.
+    const size_t kDeltaHeaderSize = 8 + 32 + 8 + 32;
+
+    // Builds a delta turning base into target. Blocks of the base are
+    // indexed by a rolling hash; every match found while scanning the target
+    // is extended both ways, so an edit costs about one block of literal
+    // bytes plus the edit itself.
+    void encode_delta(const std::string& base, const std::string& target, std::string& out);
+
+    // Applies a delta as it arrives. Input may be split at any byte; output
+    // is handed over in order, copies from the base in pieces of up to 64 KB.
+    class DeltaPatcher {
+    public:
+        typedef std::function<bool(const char* data, size_t len)> Output;
+
+        // base stays open while the delta is fed; base_sha256 is its
+        // lowercase hex digest, checked against the header.
+        void reset(PartialFile* base, const std::string& base_sha256);
+
+        // Returns false on a malformed delta, a base mismatch, or when out
+        // returns false.
+        bool feed(const char* data, size_t len, const Output& out);
+
+        // True once END was read and the whole target was written.
+        bool done() const { return state_ == State::Done; }
+        bool failed() const { return state_ == State::Error; }
+        bool base_mismatch() const { return base_mismatch_; }
+
+        uint64_t target_size() const { return target_size_; }
+        const std::string& target_sha256() const { return target_sha256_; }
+
+    private:
+        enum class State { Header, Op, Add, Done, Error };
+
+        bool parse_header();
+        // 1 when the op in pending_ is complete and applied, 0 when it needs
+        // more bytes, -1 on error.
+        int parse_op(const Output& out);
+        bool copy(uint64_t offset, uint64_t length, const Output& out);
+        bool fail();
+
+        PartialFile* base_ = nullptr;
+        std::string base_sha256_;
+        State state_ = State::Error;
+        std::string pending_;
+        uint64_t target_size_ = 0;
+        std::string target_sha256_;
+        uint64_t written_ = 0;
+        uint64_t add_left_ = 0;
+        bool base_mismatch_ = false;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_DELTA_H
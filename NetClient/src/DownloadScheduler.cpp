@@ -0,0 +1,313 @@
+#include "NetClient.h"
+#include "HttpParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace NetClient {
+
+    namespace {
+
+        typedef std::chrono::steady_clock Clock;
+
+        // Token bucket that lets callers run into debt: a chunk larger than
+        // the bucket still passes, and its cost is paid by waiting after it.
+        class TokenBucket {
+        public:
+            void configure(uint64_t rate, uint64_t burst) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                rate_ = (double)rate;
+                burst_ = (double)std::max<uint64_t>(burst, 1);
+                tokens_ = std::min(tokens_, burst_);
+                last_ = Clock::now();
+            }
+
+            // Takes n tokens; returns how long the caller should pause.
+            Clock::duration take(uint64_t n) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (rate_ <= 0) return Clock::duration::zero();
+                Clock::time_point now = Clock::now();
+                tokens_ = std::min(burst_, tokens_ + rate_ * std::chrono::duration<double>(now - last_).count());
+                last_ = now;
+                tokens_ -= (double)n;
+                if (tokens_ >= 0) return Clock::duration::zero();
+                return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens_ / rate_));
+            }
+
+        private:
+            std::mutex mutex_;
+            double rate_ = 0;
+            double burst_ = 1;
+            double tokens_ = 0;
+            Clock::time_point last_ = Clock::now();
+        };
+
+        std::string host_of(const std::string& url) {
+            detail::Url parsed;
+            if (!detail::parse_url(url, parsed)) return url;
+            return parsed.host + ":" + std::to_string(parsed.port);
+        }
+
+    } // namespace
+
+    struct DownloadScheduler::Impl {
+        struct Job {
+            uint64_t id = 0;
+            ScheduledDownload download;
+            std::string host;
+            DownloadState state = DownloadState::Queued;
+            DownloadResult result;
+            std::atomic<bool> cancelled{false};
+        };
+
+        struct Host {
+            int active = 0;
+            uint64_t last_start = 0;    // start sequence; 0 before the first
+        };
+
+        Session& session;
+        SchedulerOptions options;
+        EventCallback on_event;
+        TokenBucket bucket;
+
+        mutable std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<std::shared_ptr<Job>> queue;
+        std::map<uint64_t, std::shared_ptr<Job>> jobs;
+        std::map<std::string, Host> hosts;
+        uint64_t next_id = 1;
+        uint64_t starts = 0;
+        int active = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+
+        Impl(Session& s, const SchedulerOptions& o, EventCallback cb)
+            : session(s), options(o), on_event(std::move(cb)) {
+            options.max_active = std::max(1, options.max_active);
+            options.max_per_host = std::max(1, options.max_per_host);
+            bucket.configure(options.max_bytes_per_second, options.burst_bytes);
+        }
+
+        void emit(const Job& job, uint64_t received = 0, uint64_t total = 0) {
+            if (!on_event) return;
+            DownloadEvent event;
+            event.id = job.id;
+            event.state = job.state;
+            event.received = received;
+            event.total = total;
+            event.download = &job.download;
+            if (job.state == DownloadState::Done || job.state == DownloadState::Failed) event.result = &job.result;
+            on_event(event);
+        }
+
+        // The next job to start, or null; called with mutex held.
+        std::shared_ptr<Job> pick() {
+            auto best = queue.end();
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                const Host& host = hosts[(*it)->host];
+                if (host.active >= options.max_per_host) continue;
+                if (best == queue.end()) {
+                    best = it;
+                    continue;
+                }
+                const Job& a = **it;
+                const Job& b = **best;
+                if (a.download.priority != b.download.priority) {
+                    if (a.download.priority > b.download.priority) best = it;
+                    continue;
+                }
+                uint64_t a_start = host.last_start;
+                uint64_t b_start = hosts[b.host].last_start;
+                if (a_start != b_start ? a_start < b_start : a.id < b.id) best = it;
+            }
+            if (best == queue.end()) return nullptr;
+
+            std::shared_ptr<Job> job = *best;
+            queue.erase(best);
+            Host& host = hosts[job->host];
+            host.active++;
+            host.last_start = ++starts;
+            active++;
+            job->state = DownloadState::Active;
+            return job;
+        }
+
+        // Sleeps for pause unless the job is cancelled first.
+        void pause(const Job& job, Clock::duration pause) {
+            Clock::time_point until = Clock::now() + pause;
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait_until(lock, until, [&] { return job.cancelled.load(); });
+        }
+
+        void run(Job& job) {
+            DownloadOptions options = job.download.options;
+            std::function<bool(uint64_t, uint64_t)> caller = options.on_progress;
+            uint64_t last = 0;
+            options.on_progress = [&](uint64_t received, uint64_t total) {
+                if (received < last) last = 0;      // a new attempt counts from zero
+                Clock::duration wait = bucket.take(received - last);
+                last = received;
+                emit(job, received, total);
+                if (wait > Clock::duration::zero()) pause(job, wait);
+                if (caller && !caller(received, total)) return false;
+                return !job.cancelled;
+            };
+
+            const ScheduledDownload& d = job.download;
+            if (!d.delta_url.empty() && !d.base_path.empty()) {
+                job.result = session.download_delta(d.delta_url, d.base_path, d.path, options);
+                if (job.result.ok() || job.cancelled) return;
+                last = 0;
+            }
+            job.result = session.download(d.url, d.path, options);
+        }
+
+        void work() {
+            for (;;) {
+                std::shared_ptr<Job> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return stopping || (job = pick()) != nullptr; });
+                    if (!job) return;
+                }
+                emit(*job);
+                run(*job);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job->state = job->result.ok() ? DownloadState::Done
+                               : job->cancelled ? DownloadState::Cancelled : DownloadState::Failed;
+                }
+                // The slot is released after the event, so wait() returns
+                // only once every final event was delivered.
+                emit(*job);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    hosts[job->host].active--;
+                    active--;
+                }
+                changed.notify_all();
+            }
+        }
+
+        // Takes the queued jobs matching id (or all, with id 0) off the
+        // queue and flags running ones; called with mutex held.
+        std::vector<std::shared_ptr<Job>> cancel_locked(uint64_t id, bool& found) {
+            std::vector<std::shared_ptr<Job>> dropped;
+            found = false;
+            for (auto& entry : jobs) {
+                Job& job = *entry.second;
+                if (id != 0 && job.id != id) continue;
+                if (job.state == DownloadState::Queued) {
+                    job.state = DownloadState::Cancelled;
+                    job.cancelled = true;
+                    dropped.push_back(entry.second);
+                    found = true;
+                } else if (job.state == DownloadState::Active) {
+                    job.cancelled = true;
+                    found = true;
+                }
+            }
+            queue.erase(std::remove_if(queue.begin(), queue.end(),
+                                       [](const std::shared_ptr<Job>& job) { return job->cancelled.load(); }),
+                        queue.end());
+            return dropped;
+        }
+
+        bool cancel(uint64_t id) {
+            std::vector<std::shared_ptr<Job>> dropped;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                dropped = cancel_locked(id, found);
+            }
+            changed.notify_all();
+            for (const auto& job : dropped) emit(*job);
+            return found;
+        }
+    };
+
+    DownloadScheduler::DownloadScheduler(Session& session, const SchedulerOptions& options, EventCallback on_event)
+        : impl_(new Impl(session, options, std::move(on_event))) {
+        for (int i = 0; i < impl_->options.max_active; ++i) {
+            impl_->workers.emplace_back([this] { impl_->work(); });
+        }
+    }
+
+    DownloadScheduler::~DownloadScheduler() {
+        impl_->cancel(0);
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            impl_->stopping = true;
+        }
+        impl_->changed.notify_all();
+        for (auto& worker : impl_->workers) worker.join();
+        delete impl_;
+    }
+
+    uint64_t DownloadScheduler::add(const ScheduledDownload& download) {
+        auto job = std::make_shared<Impl::Job>();
+        job->download = download;
+        job->host = host_of(download.url);
+        job->result.response.url = download.url;
+        job->result.response.status_code = 0;
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            job->id = impl_->next_id++;
+            impl_->jobs[job->id] = job;
+        }
+        impl_->emit(*job);
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            if (job->state == DownloadState::Queued) impl_->queue.push_back(job);
+        }
+        impl_->changed.notify_all();
+        return job->id;
+    }
+
+    bool DownloadScheduler::set_priority(uint64_t id, int priority) {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        auto it = impl_->jobs.find(id);
+        if (it == impl_->jobs.end() || it->second->state != DownloadState::Queued) return false;
+        it->second->download.priority = priority;
+        return true;
+    }
+
+    bool DownloadScheduler::cancel(uint64_t id) {
+        return id != 0 && impl_->cancel(id);
+    }
+
+    void DownloadScheduler::cancel_all() {
+        impl_->cancel(0);
+    }
+
+    void DownloadScheduler::set_rate_limit(uint64_t bytes_per_second) {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->options.max_bytes_per_second = bytes_per_second;
+        impl_->bucket.configure(bytes_per_second, impl_->options.burst_bytes);
+    }
+
+    void DownloadScheduler::wait() {
+        std::unique_lock<std::mutex> lock(impl_->mutex);
+        impl_->changed.wait(lock, [&] { return impl_->queue.empty() && impl_->active == 0; });
+    }
+
+    bool DownloadScheduler::result(uint64_t id, DownloadResult& out) const {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        auto it = impl_->jobs.find(id);
+        if (it == impl_->jobs.end()) return false;
+        const Impl::Job& job = *it->second;
+        if (job.state != DownloadState::Done && job.state != DownloadState::Failed &&
+            job.state != DownloadState::Cancelled) {
+            return false;
+        }
+        out = job.result;
+        return true;
+    }
+
+} // namespace NetClient
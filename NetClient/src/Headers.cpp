@@ -0,0 +1,182 @@
+#include "NetClient.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace NetClient {
+
+    static inline char fold(char c) {
+        return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+
+    // FNV-1a over the lowercase name.
+    static uint32_t fold_hash(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash ^= (uint8_t)fold(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool same_name(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (fold(a[i]) != fold(b[i])) return false;
+        }
+        return true;
+    }
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    uint32_t Headers::find(std::string_view name, uint32_t hash) const {
+        if (slots_.empty()) return kNone;
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t slot = slots_[i];
+            if (slot == 0) return kNone;
+            const Entry& e = entries_[slot - 1];
+            if (e.hash == hash && same_name(std::string_view(buffer_).substr(e.name, e.name_len), name)) {
+                return slot - 1;
+            }
+        }
+    }
+
+    void Headers::rehash(size_t slots) {
+        slots_.assign(slots, 0);
+        size_t mask = slots - 1;
+        for (uint32_t i = 0; i < entries_.size(); ++i) {
+            const Entry& e = entries_[i];
+            if (e.last == kNone) continue;      // not the first of its name
+            size_t at = e.hash & mask;
+            while (slots_[at] != 0) at = (at + 1) & mask;
+            slots_[at] = i + 1;
+        }
+    }
+
+    // Links a freshly appended entry to the earlier ones of its name.
+    void Headers::index(uint32_t entry) {
+        Entry& e = entries_[entry];
+        uint32_t first = find(std::string_view(buffer_).substr(e.name, e.name_len), e.hash);
+        if (first != kNone) {
+            e.last = kNone;
+            entries_[entries_[first].last].next = entry;
+            entries_[first].last = entry;
+            return;
+        }
+        e.last = entry;
+        // At most half full, so probes stay short.
+        if (++names_ * 2 > slots_.size()) {
+            rehash(std::max<size_t>(16, slots_.size() * 2));
+            return;
+        }
+        size_t mask = slots_.size() - 1;
+        size_t at = e.hash & mask;
+        while (slots_[at] != 0) at = (at + 1) & mask;
+        slots_[at] = entry + 1;
+    }
+
+    std::string_view Headers::get(std::string_view name) const {
+        uint32_t i = find(name, fold_hash(name));
+        if (i == kNone) return std::string_view();
+        return std::string_view(buffer_).substr(entries_[i].value, entries_[i].value_len);
+    }
+
+    bool Headers::has(std::string_view name) const {
+        return find(name, fold_hash(name)) != kNone;
+    }
+
+    std::vector<std::string_view> Headers::values(std::string_view name) const {
+        std::vector<std::string_view> out;
+        for (uint32_t i = find(name, fold_hash(name)); i != kNone; i = entries_[i].next) {
+            out.push_back(std::string_view(buffer_).substr(entries_[i].value, entries_[i].value_len));
+        }
+        return out;
+    }
+
+    std::string Headers::combined(std::string_view name) const {
+        std::string out;
+        for (uint32_t i = find(name, fold_hash(name)); i != kNone; i = entries_[i].next) {
+            if (!out.empty()) out += ", ";
+            out.append(buffer_, entries_[i].value, entries_[i].value_len);
+        }
+        return out;
+    }
+
+    void Headers::add(std::string_view name, std::string_view value) {
+        Entry e;
+        e.name = (uint32_t)buffer_.size();
+        e.name_len = (uint32_t)name.size();
+        buffer_.append(name.data(), name.size());
+        buffer_ += ": ";
+        e.value = (uint32_t)buffer_.size();
+        e.value_len = (uint32_t)value.size();
+        buffer_.append(value.data(), value.size());
+        buffer_ += "\r\n";
+        e.hash = fold_hash(name);
+        e.next = kNone;
+        e.last = kNone;
+        entries_.push_back(e);
+        index((uint32_t)entries_.size() - 1);
+    }
+
+    void Headers::set(std::string_view name, std::string_view value) {
+        // name may point into the buffer that remove() rebuilds.
+        std::string kept_name(name);
+        std::string kept_value(value);
+        remove(kept_name);
+        add(kept_name, kept_value);
+    }
+
+    void Headers::remove(std::string_view name) {
+        if (!has(name)) return;
+        Headers kept;
+        kept.buffer_.reserve(buffer_.size());
+        for (const value_type& header : *this) {
+            if (!same_name(header.first, name)) kept.add(header.first, header.second);
+        }
+        *this = std::move(kept);
+    }
+
+    void Headers::clear() {
+        buffer_.clear();
+        entries_.clear();
+        slots_.clear();
+        names_ = 0;
+    }
+
+    void Headers::parse(const char* block, size_t len) {
+        clear();
+        buffer_.assign(block, len);
+        const char* base = buffer_.data();
+        const char* end = base + len;
+        for (const char* p = base; p < end;) {
+            const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!line_end) line_end = end;
+            const char* colon = static_cast<const char*>(std::memchr(p, ':', line_end - p));
+            if (colon && colon > p) {
+                const char* value = colon + 1;
+                const char* value_end = line_end;
+                while (value < value_end && is_space(*value)) ++value;
+                while (value_end > value && is_space(value_end[-1])) --value_end;
+                const char* name_end = colon;
+                while (name_end > p && is_space(name_end[-1])) --name_end;
+
+                Entry e;
+                e.name = (uint32_t)(p - base);
+                e.name_len = (uint32_t)(name_end - p);
+                e.value = (uint32_t)(value - base);
+                e.value_len = (uint32_t)(value_end - value);
+                e.hash = fold_hash(std::string_view(p, name_end - p));
+                e.next = kNone;
+                e.last = kNone;
+                entries_.push_back(e);
+                index((uint32_t)entries_.size() - 1);
+            }
+            p = line_end + 1;
+        }
+    }
+
+} // namespace NetClient
@@ -0,0 +1,359 @@
+#include "HttpCache.h"
+#include "HttpParser.h"
+#include "PartialFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace NetClient {
+namespace detail {
+
+    // Heuristic freshness (a tenth of the time since Last-Modified) is
+    // capped, so a resource that changed long ago is still rechecked daily.
+    static const int64_t kMaxHeuristicSeconds = 24 * 60 * 60;
+
+    static const char* const kMetaMagic = "NetClient-Cache 1";
+
+    struct CacheControl {
+        bool no_store = false;
+        bool no_cache = false;
+        int64_t max_age = -1;
+    };
+
+    static std::string lowercase(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+        return s;
+    }
+
+    static std::string trim(const std::string& s) {
+        size_t begin = s.find_first_not_of(" \t");
+        if (begin == std::string::npos) return std::string();
+        size_t end = s.find_last_not_of(" \t");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    static std::vector<std::string> split_list(const std::string& value) {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t comma = value.find(',', start);
+            if (comma == std::string::npos) comma = value.size();
+            std::string item = trim(value.substr(start, comma - start));
+            if (!item.empty()) items.push_back(item);
+            start = comma + 1;
+        }
+        return items;
+    }
+
+    static CacheControl parse_cache_control(const Headers& headers) {
+        CacheControl cc;
+        std::string value = header_value(headers, "Cache-Control");
+        if (value.empty()) {
+            // HTTP/1.0 caches only knew Pragma.
+            cc.no_cache = lowercase(header_value(headers, "Pragma")).find("no-cache") != std::string::npos;
+            return cc;
+        }
+        for (const std::string& item : split_list(value)) {
+            std::string directive = lowercase(item);
+            if (directive == "no-store") cc.no_store = true;
+            // no-cache="field" restricts only some fields; treating it as plain
+            // no-cache revalidates more often but is never wrong.
+            else if (directive.compare(0, 8, "no-cache") == 0) cc.no_cache = true;
+            else if (directive.compare(0, 8, "max-age=") == 0) {
+                const char* digits = directive.c_str() + 8;
+                if (*digits == '"') ++digits;
+                cc.max_age = std::strtoll(digits, nullptr, 10);
+                if (cc.max_age < 0) cc.max_age = 0;
+            }
+        }
+        return cc;
+    }
+
+    static int64_t freshness_lifetime(const CachedResponse& entry, const CacheControl& cc) {
+        if (cc.no_cache) return 0;
+        if (cc.max_age >= 0) return cc.max_age;
+
+        int64_t date = entry.response_time;
+        parse_http_date(header_value(entry.headers, "Date"), date);
+
+        std::string expires = header_value(entry.headers, "Expires");
+        if (!expires.empty()) {
+            // An unparsable Expires, such as "0", means already expired.
+            int64_t expires_at = 0;
+            if (!parse_http_date(expires, expires_at)) return 0;
+            return expires_at > date ? expires_at - date : 0;
+        }
+
+        int64_t last_modified = 0;
+        if (parse_http_date(header_value(entry.headers, "Last-Modified"), last_modified) && last_modified < date) {
+            return std::min((date - last_modified) / 10, kMaxHeuristicSeconds);
+        }
+        return 0;
+    }
+
+    static int64_t current_age(const CachedResponse& entry, int64_t now) {
+        int64_t age = 0;
+        int64_t date = 0;
+        if (parse_http_date(header_value(entry.headers, "Date"), date) && entry.response_time > date) {
+            age = entry.response_time - date;
+        }
+        std::string age_header = header_value(entry.headers, "Age");
+        if (!age_header.empty()) age = std::max<int64_t>(age, std::strtoll(age_header.c_str(), nullptr, 10));
+        if (now > entry.response_time) age += now - entry.response_time;
+        return age;
+    }
+
+    // Worth keeping: a complete 200 that may be stored and can either be
+    // served fresh or revalidated later.
+    static bool storable(const Response& resp, const CacheControl& cc) {
+        if (resp.status_code != 200 || !resp.error.empty() || cc.no_store) return false;
+        if (trim(resp.header("Vary")) == "*") return false;
+        return cc.max_age > 0 ||
+               !resp.header("Expires").empty() ||
+               !resp.header("ETag").empty() ||
+               !resp.header("Last-Modified").empty();
+    }
+
+    static size_t entry_cost(const CachedResponse& entry) {
+        size_t cost = sizeof(CachedResponse) + entry.url.size() + entry.body->size();
+        for (const auto& h : entry.headers) cost += h.first.size() + h.second.size() + 64;
+        for (const auto& v : entry.vary) cost += v.first.size() + v.second.size() + 64;
+        return cost;
+    }
+
+    // Headers that describe one transfer rather than the stored response.
+    static bool per_transfer_header(std::string_view name) {
+        static const char* const names[] = {"connection", "keep-alive", "transfer-encoding",
+                                            "content-length", "content-encoding"};
+        std::string lower = lowercase(std::string(name));
+        for (const char* n : names) {
+            if (lower == n) return true;
+        }
+        return false;
+    }
+
+    HttpCache::HttpCache(size_t memory_bytes, const std::string& directory)
+        : memory_bytes_(memory_bytes), directory_(directory) {
+        while (!directory_.empty() && (directory_.back() == '/' || directory_.back() == '\\')) directory_.pop_back();
+        if (!directory_.empty()) PartialFile::create_directory(directory_);
+    }
+
+    int64_t HttpCache::now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool HttpCache::is_fresh(const CachedResponse& entry, int64_t now) {
+        CacheControl cc = parse_cache_control(entry.headers);
+        return freshness_lifetime(entry, cc) > current_age(entry, now);
+    }
+
+    CacheEntry HttpCache::lookup(const std::string& url, const std::map<std::string, std::string>& request_headers) {
+        CacheEntry entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(url);
+            if (it != index_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                entry = *it->second;
+            }
+        }
+        if (!entry && !directory_.empty()) {
+            entry = load(url);
+            if (entry) remember(entry);
+        }
+        if (!entry) return nullptr;
+
+        for (const auto& v : entry->vary) {
+            if (header_value(request_headers, v.first.c_str()) != v.second) return nullptr;
+        }
+        return entry;
+    }
+
+    bool HttpCache::store(const std::string& url,
+                          const std::map<std::string, std::string>& request_headers,
+                          Response& resp) {
+        CacheControl cc = parse_cache_control(resp.headers);
+        if (!storable(resp, cc)) return false;
+
+        std::shared_ptr<CachedResponse> entry = std::make_shared<CachedResponse>();
+        entry->url = url;
+        entry->status_code = resp.status_code;
+        entry->headers = resp.headers;
+        for (const std::string& name : split_list(resp.header("Vary"))) {
+            std::string lower = lowercase(name);
+            entry->vary.emplace_back(lower, header_value(request_headers, lower.c_str()));
+        }
+        entry->body = resp.text.share();
+        entry->response_time = now();
+
+        remember(entry);
+        if (!directory_.empty()) save(*entry, true);
+        return true;
+    }
+
+    CacheEntry HttpCache::refresh(const CacheEntry& entry, const Response& not_modified) {
+        std::shared_ptr<CachedResponse> fresh = std::make_shared<CachedResponse>(*entry);
+        // A header in the 304 replaces every stored value of its name; a
+        // repeated one keeps all of its own values.
+        for (const auto& h : not_modified.headers) {
+            if (!per_transfer_header(h.first)) fresh->headers.remove(h.first);
+        }
+        for (const auto& h : not_modified.headers) {
+            if (!per_transfer_header(h.first)) fresh->headers.add(h.first, h.second);
+        }
+        fresh->response_time = now();
+
+        remember(fresh);
+        if (!directory_.empty()) save(*fresh, false);
+        return fresh;
+    }
+
+    void HttpCache::remove(const std::string& url) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            forget_locked(url);
+        }
+        if (!directory_.empty()) {
+            std::lock_guard<std::mutex> lock(disk_mutex_);
+            std::string path = path_for(url);
+            PartialFile::remove(path + ".meta");
+            PartialFile::remove(path + ".body");
+        }
+    }
+
+    void HttpCache::remember(const CacheEntry& entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        forget_locked(entry->url);
+
+        size_t cost = entry_cost(*entry);
+        if (cost > memory_bytes_) return;
+
+        lru_.push_front(entry);
+        index_[entry->url] = lru_.begin();
+        used_bytes_ += cost;
+        while (used_bytes_ > memory_bytes_) {
+            const CacheEntry& victim = lru_.back();
+            used_bytes_ -= entry_cost(*victim);
+            index_.erase(victim->url);
+            lru_.pop_back();
+        }
+    }
+
+    void HttpCache::forget_locked(const std::string& url) {
+        auto it = index_.find(url);
+        if (it == index_.end()) return;
+        used_bytes_ -= entry_cost(**it->second);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    std::string HttpCache::path_for(const std::string& url) const {
+        // FNV-1a; the URL is stored in the metadata to catch collisions.
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : url) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return directory_ + "/" + name;
+    }
+
+    // Metadata is line based: magic, URL, "status response_time body_size",
+    // then a count followed by name and value lines, once for the Vary'd
+    // request headers and once for the response headers.
+    void HttpCache::save(const CachedResponse& entry, bool with_body) {
+        std::lock_guard<std::mutex> lock(disk_mutex_);
+        std::string path = path_for(entry.url);
+
+        if (with_body) {
+            PartialFile body;
+            bool written = body.open(path + ".body.tmp", true) &&
+                           body.write(entry.body->data(), entry.body->size());
+            body.close();
+            if (!written || !PartialFile::commit(path + ".body.tmp", path + ".body")) {
+                PartialFile::remove(path + ".body.tmp");
+                PartialFile::remove(path + ".meta");
+                return;
+            }
+        }
+
+        std::string meta = kMetaMagic;
+        meta += "\n" + entry.url + "\n";
+        meta += std::to_string(entry.status_code) + " " + std::to_string(entry.response_time) + " " +
+                std::to_string(entry.body->size()) + "\n";
+        meta += std::to_string(entry.vary.size()) + "\n";
+        for (const auto& v : entry.vary) meta += v.first + "\n" + v.second + "\n";
+        meta += std::to_string(entry.headers.size()) + "\n";
+        for (const auto& h : entry.headers) {
+            meta.append(h.first.data(), h.first.size()) += '\n';
+            meta.append(h.second.data(), h.second.size()) += '\n';
+        }
+
+        PartialFile file;
+        bool written = file.open(path + ".meta.tmp", true) && file.write(meta.data(), meta.size());
+        file.close();
+        if (!written || !PartialFile::commit(path + ".meta.tmp", path + ".meta")) {
+            PartialFile::remove(path + ".meta.tmp");
+        }
+    }
+
+    CacheEntry HttpCache::load(const std::string& url) {
+        std::lock_guard<std::mutex> lock(disk_mutex_);
+        std::string path = path_for(url);
+
+        std::string meta;
+        PartialFile file;
+        if (!file.open_existing(path + ".meta")) return nullptr;
+        if (!file.read_all([&](const char* data, size_t len) { meta.append(data, len); })) return nullptr;
+        file.close();
+
+        size_t pos = 0;
+        auto next_line = [&](std::string& line) {
+            size_t end = meta.find('\n', pos);
+            if (end == std::string::npos) return false;
+            line.assign(meta, pos, end - pos);
+            pos = end + 1;
+            return true;
+        };
+
+        std::string line;
+        if (!next_line(line) || line != kMetaMagic) return nullptr;
+        if (!next_line(line) || line != url) return nullptr;
+
+        std::shared_ptr<CachedResponse> entry = std::make_shared<CachedResponse>();
+        entry->url = url;
+        long long response_time = 0;
+        unsigned long long body_size = 0;
+        if (!next_line(line) ||
+            std::sscanf(line.c_str(), "%d %lld %llu", &entry->status_code, &response_time, &body_size) != 3) {
+            return nullptr;
+        }
+        entry->response_time = response_time;
+
+        std::string name, value;
+        if (!next_line(line)) return nullptr;
+        for (long n = std::strtol(line.c_str(), nullptr, 10); n > 0; --n) {
+            if (!next_line(name) || !next_line(value)) return nullptr;
+            entry->vary.emplace_back(name, value);
+        }
+        if (!next_line(line)) return nullptr;
+        for (long n = std::strtol(line.c_str(), nullptr, 10); n > 0; --n) {
+            if (!next_line(name) || !next_line(value)) return nullptr;
+            entry->headers.add(name, value);
+        }
+
+        if (!file.open_existing(path + ".body") || file.size() != body_size) return nullptr;
+        std::string body;
+        body.reserve((size_t)body_size);
+        if (!file.read_all([&](const char* data, size_t len) { body.append(data, len); })) return nullptr;
+        entry->body = std::make_shared<const std::string>(std::move(body));
+        return entry;
+    }
+
+} // namespace detail
+} // namespace NetClient
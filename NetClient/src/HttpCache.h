@@ -0,0 +1,81 @@
+#ifndef NETCLIENT_HTTP_CACHE_H
+#define NETCLIENT_HTTP_CACHE_H
+
+#include "NetClient.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace NetClient {
+namespace detail {
+
+    // A stored GET response. Entries are immutable and shared, so handing
+    // one out or refreshing it after a 304 never copies the body.
+    struct CachedResponse {
+        std::string url;
+        int status_code = 0;
+        Headers headers;
+        // Request headers named by Vary, lowercase name and value as sent.
+        std::vector<std::pair<std::string, std::string>> vary;
+        std::shared_ptr<const std::string> body;
+        int64_t response_time = 0;      // unix seconds when stored or last revalidated
+    };
+
+    typedef std::shared_ptr<const CachedResponse> CacheEntry;
+
+    // Private HTTP cache after RFC 9111: an in-memory LRU bounded by bytes in
+    // front of an optional directory holding one variant per URL, as a
+    // "<hash>.meta" and a "<hash>.body" file.
+    class HttpCache {
+    public:
+        HttpCache(size_t memory_bytes, const std::string& directory);
+
+        // The entry for url if the request headers it varies on match.
+        CacheEntry lookup(const std::string& url, const std::map<std::string, std::string>& request_headers);
+
+        // Keeps resp if its status and Cache-Control allow it and it can be
+        // served fresh or revalidated later. The body is shared with resp,
+        // not copied.
+        bool store(const std::string& url,
+                   const std::map<std::string, std::string>& request_headers,
+                   Response& resp);
+
+        // Applies the headers of a 304 to entry and restarts its age. Only
+        // the metadata file is rewritten.
+        CacheEntry refresh(const CacheEntry& entry, const Response& not_modified);
+
+        void remove(const std::string& url);
+
+        static bool is_fresh(const CachedResponse& entry, int64_t now);
+        static int64_t now();
+
+    private:
+        void remember(const CacheEntry& entry);
+        void forget_locked(const std::string& url);
+        CacheEntry load(const std::string& url);
+        void save(const CachedResponse& entry, bool with_body);
+        std::string path_for(const std::string& url) const;
+
+        size_t memory_bytes_;
+        std::string directory_;
+
+        std::mutex mutex_;
+        std::list<CacheEntry> lru_;     // most recently used first
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> index_;
+        size_t used_bytes_ = 0;
+
+        std::mutex disk_mutex_;         // serialises the ".tmp" files
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_HTTP_CACHE_H
@@ -0,0 +1,385 @@
+#include "HttpParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace NetClient {
+namespace detail {
+
+    static bool iequals(const std::string& a, const char* b) {
+        size_t n = std::strlen(b);
+        if (a.size() != n) return false;
+        for (size_t i = 0; i < n; ++i) {
+            if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+        }
+        return true;
+    }
+
+    static bool icontains(const std::string& haystack, const char* needle) {
+        std::string lower = haystack;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        return lower.find(needle) != std::string::npos;
+    }
+
+    bool has_header(const std::map<std::string, std::string>& headers, const char* name) {
+        for (const auto& h : headers) {
+            if (iequals(h.first, name)) return true;
+        }
+        return false;
+    }
+
+    std::string header_value(const std::map<std::string, std::string>& headers, const char* name) {
+        for (const auto& h : headers) {
+            if (iequals(h.first, name)) return h.second;
+        }
+        return std::string();
+    }
+
+    std::string header_value(const Headers& headers, const char* name) {
+        return headers.combined(name);
+    }
+
+    // Days since 1970-01-01 of a proleptic Gregorian date.
+    static int64_t days_from_civil(int64_t y, int m, int d) {
+        y -= m <= 2;
+        int64_t era = (y >= 0 ? y : y - 399) / 400;
+        int64_t yoe = y - era * 400;
+        int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    bool parse_http_date(const std::string& value, int64_t& out) {
+        static const char* const months[] = {"jan", "feb", "mar", "apr", "may", "jun",
+                                             "jul", "aug", "sep", "oct", "nov", "dec"};
+        int day = 0, year = 0, hour = 0, minute = 0, second = 0;
+        char month_name[4] = {};
+        if (std::sscanf(value.c_str(), "%*[^,], %d %3s %d %d:%d:%d",
+                        &day, month_name, &year, &hour, &minute, &second) != 6) {
+            return false;
+        }
+        int month = 0;
+        for (int i = 0; i < 12; ++i) {
+            if (iequals(month_name, months[i])) month = i + 1;
+        }
+        if (month == 0 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+        out = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+        return true;
+    }
+
+    bool parse_url(const std::string& url, Url& out) {
+        size_t scheme_end = url.find("://");
+        if (scheme_end == std::string::npos) return false;
+
+        out.scheme = url.substr(0, scheme_end);
+        std::transform(out.scheme.begin(), out.scheme.end(), out.scheme.begin(), ::tolower);
+        if (out.scheme == "http") {
+            out.secure = false;
+            out.port = 80;
+        } else if (out.scheme == "https") {
+            out.secure = true;
+            out.port = 443;
+        } else {
+            return false;
+        }
+
+        size_t authority_start = scheme_end + 3;
+        size_t authority_end = url.find_first_of("/?#", authority_start);
+        if (authority_end == std::string::npos) authority_end = url.size();
+        std::string authority = url.substr(authority_start, authority_end - authority_start);
+
+        size_t at = authority.rfind('@');
+        if (at != std::string::npos) authority.erase(0, at + 1);
+
+        size_t colon = authority.rfind(':');
+        size_t bracket = authority.rfind(']');
+        if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+            unsigned long port = std::strtoul(authority.c_str() + colon + 1, nullptr, 10);
+            if (port == 0 || port > 65535) return false;
+            out.port = (uint16_t)port;
+            authority.erase(colon);
+        }
+        if (authority.size() >= 2 && authority.front() == '[' && authority.back() == ']') {
+            authority = authority.substr(1, authority.size() - 2);
+        }
+        if (authority.empty()) return false;
+        out.host = authority;
+
+        out.target = url.substr(authority_end);
+        size_t fragment = out.target.find('#');
+        if (fragment != std::string::npos) out.target.erase(fragment);
+        if (out.target.empty() || out.target[0] != '/') out.target.insert(0, "/");
+        return true;
+    }
+
+    bool ContentDecoder::start(const Response& head, bool enabled, uint64_t max_bytes) {
+        active_ = false;
+        if (!enabled) return false;
+
+        std::string encoding = head.header("Content-Encoding");
+        Inflater::Format format;
+        if (iequals(encoding, "gzip") || iequals(encoding, "x-gzip")) format = Inflater::Format::Gzip;
+        else if (iequals(encoding, "deflate")) format = Inflater::Format::Deflate;
+        else return false;
+
+        // Created on first use, then kept with its buffers for later responses.
+        if (!inflater_) inflater_.reset(new Inflater());
+        inflater_->reset(format, max_bytes);
+        active_ = true;
+        return true;
+    }
+
+    bool ContentDecoder::write(const char* data, size_t len, const Inflater::Output& out) {
+        return inflater_->feed(data, len, out);
+    }
+
+    ResponseParser::ResponseParser(size_t max_header_bytes)
+        : max_header_bytes_(max_header_bytes) {
+        header_buf_.reserve(max_header_bytes_);
+    }
+
+    void ResponseParser::reset(bool head_request) {
+        header_buf_.clear();
+        scanned_ = 0;
+        head_request_ = head_request;
+        state_ = State::Headers;
+        framing_ = Framing::None;
+        remaining_ = 0;
+        chunk_state_ = ChunkState::Size;
+        chunk_size_seen_ = false;
+        trailer_line_empty_ = true;
+        keep_alive_ = false;
+        aborted_ = false;
+        decoder_.stop();
+    }
+
+    size_t ResponseParser::feed(const char* data, size_t len, Response& resp) {
+        size_t used = 0;
+        while (used < len && state_ != State::Done && state_ != State::Error) {
+            if (state_ == State::Body) {
+                used += feed_body(data + used, len - used, resp);
+                continue;
+            }
+
+            // Append, then scan only bytes not examined by earlier calls.
+            size_t room = max_header_bytes_ - header_buf_.size();
+            size_t copy = std::min(len - used, room);
+            size_t before = header_buf_.size();
+            header_buf_.insert(header_buf_.end(), data + used, data + used + copy);
+
+            size_t found = std::string::npos;
+            for (size_t i = scanned_ >= 3 ? scanned_ - 3 : 0; i + 4 <= header_buf_.size(); ++i) {
+                if (header_buf_[i] == '\r' && header_buf_[i + 1] == '\n' &&
+                    header_buf_[i + 2] == '\r' && header_buf_[i + 3] == '\n') {
+                    found = i + 4;
+                    break;
+                }
+            }
+            scanned_ = header_buf_.size();
+
+            if (found == std::string::npos) {
+                used += copy;
+                if (header_buf_.size() >= max_header_bytes_) state_ = State::Error;
+                continue;
+            }
+
+            // Bytes after the blank line are left for the body.
+            used += found - before;
+            header_buf_.resize(found);
+            if (!parse_headers(resp)) {
+                state_ = State::Error;
+            }
+        }
+        return used;
+    }
+
+    bool ResponseParser::parse_headers(Response& resp) {
+        const char* p = header_buf_.data();
+        const char* end = p + header_buf_.size();
+
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!line_end || end - p < 12 || std::memcmp(p, "HTTP/1.", 7) != 0) return false;
+
+        bool http11 = p[7] == '1';
+        int status = 0;
+        for (const char* q = p + 9; q < p + 12; ++q) {
+            if (*q < '0' || *q > '9') return false;
+            status = status * 10 + (*q - '0');
+        }
+
+        // Interim responses are dropped; the final one follows on the wire.
+        if (status >= 100 && status < 200 && status != 101) {
+            header_buf_.clear();
+            scanned_ = 0;
+            return true;
+        }
+
+        resp.status_code = status;
+        resp.headers.parse(line_end + 1, (size_t)(end - (line_end + 1)));
+        std::string connection = resp.headers.combined("Connection");
+        std::string transfer_encoding = resp.headers.combined("Transfer-Encoding");
+        std::string content_length(resp.headers.get("Content-Length"));
+
+        keep_alive_ = http11 ? !icontains(connection, "close") : icontains(connection, "keep-alive");
+
+        if (head_request_ || status == 204 || status == 304) {
+            framing_ = Framing::None;
+        } else if (icontains(transfer_encoding, "chunked")) {
+            framing_ = Framing::Chunked;
+        } else if (!content_length.empty()) {
+            char* parse_end = nullptr;
+            unsigned long long length = std::strtoull(content_length.c_str(), &parse_end, 10);
+            if (parse_end == content_length.c_str()) return false;
+            framing_ = Framing::Length;
+            remaining_ = length;
+        } else {
+            framing_ = Framing::UntilClose;
+            keep_alive_ = false;
+        }
+
+        if (framing_ == Framing::None || (framing_ == Framing::Length && remaining_ == 0)) {
+            state_ = State::Done;
+        } else {
+            state_ = State::Body;
+            decoder_.start(resp, decode_, max_decoded_);
+            if (!sink_ && framing_ == Framing::Length && remaining_ < (64u << 20)) {
+                resp.text.reserve((size_t)remaining_);
+            }
+        }
+        return true;
+    }
+
+    size_t ResponseParser::feed_body(const char* data, size_t len, Response& resp) {
+        switch (framing_) {
+            case Framing::Length: {
+                size_t take = (size_t)std::min<uint64_t>(remaining_, len);
+                remaining_ -= take;
+                if (emit(data, take, resp) && remaining_ == 0) body_complete();
+                return take;
+            }
+            case Framing::Chunked:
+                return feed_chunked(data, len, resp);
+            case Framing::UntilClose:
+                emit(data, len, resp);
+                return len;
+            case Framing::None:
+                break;
+        }
+        state_ = State::Done;
+        return 0;
+    }
+
+    size_t ResponseParser::feed_chunked(const char* data, size_t len, Response& resp) {
+        size_t i = 0;
+        while (i < len && state_ == State::Body) {
+            char c = data[i];
+            switch (chunk_state_) {
+                case ChunkState::Size:
+                    if (std::isxdigit((unsigned char)c)) {
+                        if (remaining_ > (UINT64_MAX >> 4)) {
+                            state_ = State::Error;
+                            return i;
+                        }
+                        int digit = (c <= '9') ? c - '0' : (std::tolower((unsigned char)c) - 'a' + 10);
+                        remaining_ = (remaining_ << 4) | (uint64_t)digit;
+                        chunk_size_seen_ = true;
+                        ++i;
+                    } else if (!chunk_size_seen_) {
+                        state_ = State::Error;
+                        return i;
+                    } else {
+                        chunk_state_ = ChunkState::Extension;
+                    }
+                    break;
+                case ChunkState::Extension:
+                    // Chunk extensions are ignored.
+                    if (c == '\n') chunk_state_ = ChunkState::SizeLF;
+                    else ++i;
+                    break;
+                case ChunkState::SizeLF:
+                    ++i;
+                    chunk_size_seen_ = false;
+                    if (remaining_ == 0) {
+                        chunk_state_ = ChunkState::Trailer;
+                        trailer_line_empty_ = true;
+                    } else {
+                        chunk_state_ = ChunkState::Data;
+                    }
+                    break;
+                case ChunkState::Data: {
+                    size_t take = (size_t)std::min<uint64_t>(remaining_, len - i);
+                    if (!emit(data + i, take, resp)) return i + take;
+                    remaining_ -= take;
+                    i += take;
+                    if (remaining_ == 0) chunk_state_ = ChunkState::DataCR;
+                    break;
+                }
+                case ChunkState::DataCR:
+                    if (c == '\r') {
+                        ++i;
+                        chunk_state_ = ChunkState::DataLF;
+                    } else {
+                        chunk_state_ = ChunkState::DataLF;
+                    }
+                    break;
+                case ChunkState::DataLF:
+                    if (c != '\n') {
+                        state_ = State::Error;
+                        return i;
+                    }
+                    ++i;
+                    chunk_state_ = ChunkState::Size;
+                    break;
+                case ChunkState::Trailer:
+                    // Trailer fields are skipped up to the terminating blank line.
+                    ++i;
+                    if (c == '\n') {
+                        if (trailer_line_empty_) body_complete();
+                        trailer_line_empty_ = true;
+                    } else if (c != '\r') {
+                        trailer_line_empty_ = false;
+                    }
+                    break;
+            }
+        }
+        return i;
+    }
+
+    bool ResponseParser::emit(const char* data, size_t len, Response& resp) {
+        bool ok = decoder_.active()
+            ? decoder_.write(data, len, [&](const char* out, size_t n) { return deliver(out, n, resp); })
+            : deliver(data, len, resp);
+        if (!ok) state_ = State::Error;
+        return ok;
+    }
+
+    bool ResponseParser::deliver(const char* data, size_t len, Response& resp) {
+        if (!sink_) {
+            resp.text.append(data, len);
+            return true;
+        }
+        if (len == 0 || (*sink_)(resp, data, len)) return true;
+        aborted_ = true;
+        return false;
+    }
+
+    // A compressed body must also end where its encoded stream ends.
+    void ResponseParser::body_complete() {
+        state_ = decoder_.done() ? State::Done : State::Error;
+    }
+
+    void ResponseParser::finish(Response& resp) {
+        (void)resp;
+        if (state_ == State::Body && framing_ == Framing::UntilClose) {
+            body_complete();
+        } else if (state_ != State::Done) {
+            state_ = State::Error;
+        }
+        keep_alive_ = false;
+    }
+
+} // namespace detail
+} // namespace NetClient
@@ -0,0 +1,138 @@
+#ifndef NETCLIENT_HTTP_PARSER_H
+#define NETCLIENT_HTTP_PARSER_H
+
+#include "NetClient.h"
+#include "Inflate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace NetClient {
+namespace detail {
+
+    struct Url {
+        std::string scheme;
+        std::string host;
+        std::string target;     // path and query, always starting with '/'
+        uint16_t port = 0;
+        bool secure = false;
+    };
+
+    bool parse_url(const std::string& url, Url& out);
+
+    bool has_header(const std::map<std::string, std::string>& headers, const char* name);
+
+    // Value of a header matched without regard to case; empty when absent.
+    std::string header_value(const std::map<std::string, std::string>& headers, const char* name);
+    std::string header_value(const Headers& headers, const char* name);
+
+    // IMF-fixdate, "Sun, 06 Nov 1994 08:49:37 GMT", as unix seconds. The
+    // obsolete RFC 850 and asctime forms count as invalid.
+    bool parse_http_date(const std::string& value, int64_t& out);
+
+    // Compressed responses are requested and decoded unless the caller sent
+    // its own Accept-Encoding, which then also gets the body as sent.
+    inline bool decode_requested(const SessionOptions& config, const std::map<std::string, std::string>& headers) {
+        return config.decompress && !has_header(headers, "Accept-Encoding");
+    }
+
+    // Undoes a gzip or deflate Content-Encoding while the body arrives.
+    // Other encodings pass through untouched.
+    class ContentDecoder {
+    public:
+        // Returns whether the body of head will be decoded.
+        bool start(const Response& head, bool enabled, uint64_t max_bytes);
+        void stop() { active_ = false; }
+
+        bool active() const { return active_; }
+        bool write(const char* data, size_t len, const Inflater::Output& out);
+
+        // True when the encoded stream ended completely.
+        bool done() const { return !active_ || inflater_->done(); }
+        bool limit_exceeded() const { return active_ && inflater_->limit_exceeded(); }
+
+    private:
+        std::unique_ptr<Inflater> inflater_;
+        bool active_ = false;
+    };
+
+    // Incremental HTTP/1.1 response parser. Bytes may arrive in any split;
+    // the header block is collected into a buffer reserved once up front and
+    // only newly received bytes are scanned for its end. Bodies framed by
+    // Content-Length, chunked transfer coding or connection close are
+    // decoded straight into Response::text, or handed to a BodySink.
+    class ResponseParser {
+    public:
+        explicit ResponseParser(size_t max_header_bytes = 64 * 1024);
+
+        // Prepares for a new response. Responses to HEAD carry no body.
+        void reset(bool head_request);
+
+        // Routes body bytes to sink instead of Response::text; null restores
+        // the default. Kept across reset().
+        void set_sink(const BodySink* sink) { sink_ = sink; }
+
+        // Decodes gzip and deflate bodies, failing past max_bytes of output.
+        // Kept across reset().
+        void set_decoding(bool enabled, uint64_t max_bytes) {
+            decode_ = enabled;
+            max_decoded_ = max_bytes;
+        }
+
+        // Consumes up to len bytes and returns how many were used; bytes after
+        // a complete response are left for the caller.
+        size_t feed(const char* data, size_t len, Response& resp);
+
+        // Signals that the peer closed the connection.
+        void finish(Response& resp);
+
+        bool done() const { return state_ == State::Done; }
+        bool failed() const { return state_ == State::Error; }
+
+        // True when the failure came from the sink rather than the wire.
+        bool aborted() const { return aborted_; }
+
+        // True when decoding stopped at the size limit.
+        bool too_large() const { return decoder_.limit_exceeded(); }
+
+        // True when the connection may carry another request afterwards.
+        bool keep_alive() const { return keep_alive_; }
+
+    private:
+        enum class State { Headers, Body, Done, Error };
+        enum class Framing { None, Length, Chunked, UntilClose };
+        enum class ChunkState { Size, Extension, SizeLF, Data, DataCR, DataLF, Trailer };
+
+        bool parse_headers(Response& resp);
+        size_t feed_body(const char* data, size_t len, Response& resp);
+        size_t feed_chunked(const char* data, size_t len, Response& resp);
+        bool emit(const char* data, size_t len, Response& resp);
+        bool deliver(const char* data, size_t len, Response& resp);
+        void body_complete();
+
+        std::vector<char> header_buf_;
+        size_t max_header_bytes_;
+        size_t scanned_ = 0;
+        bool head_request_ = false;
+
+        State state_ = State::Headers;
+        Framing framing_ = Framing::None;
+        uint64_t remaining_ = 0;
+        ChunkState chunk_state_ = ChunkState::Size;
+        bool chunk_size_seen_ = false;
+        bool trailer_line_empty_ = true;
+        bool keep_alive_ = false;
+        bool aborted_ = false;
+        const BodySink* sink_ = nullptr;
+        bool decode_ = false;
+        uint64_t max_decoded_ = 0;
+        ContentDecoder decoder_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_HTTP_PARSER_H
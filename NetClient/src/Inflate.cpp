@@ -0,0 +1,495 @@
+#include "Inflate.h"
+
+#include <cstring>
+
+namespace NetClient {
+namespace detail {
+
+    static const size_t kWindow = 32 * 1024;
+    static const size_t kChunk = 64 * 1024;
+    // A match writes at most 258 bytes, and copies run up to 7 bytes past it.
+    static const size_t kSlack = 512;
+
+    static const uint16_t kLengthBase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    static const uint8_t kLengthExtra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    static const uint16_t kDistanceBase[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    static const uint8_t kDistanceExtra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+    static const uint8_t kCodeLengthOrder[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+    };
+
+    struct Crc32Table {
+        uint32_t entries[4][256];
+
+        Crc32Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int t = 1; t < 4; ++t) {
+                    uint32_t prev = entries[t - 1][i];
+                    entries[t][i] = entries[0][prev & 0xFF] ^ (prev >> 8);
+                }
+            }
+        }
+    };
+
+    // Slicing-by-4; the checksum runs over every decoded byte.
+    static uint32_t crc32_update(uint32_t crc, const uint8_t* p, size_t len) {
+        static const Crc32Table table;
+        crc = ~crc;
+        for (; len >= 4; p += 4, len -= 4) {
+            crc ^= (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+            crc = table.entries[3][crc & 0xFF] ^ table.entries[2][(crc >> 8) & 0xFF] ^
+                  table.entries[1][(crc >> 16) & 0xFF] ^ table.entries[0][crc >> 24];
+        }
+        while (len--) crc = table.entries[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static uint32_t adler32_update(uint32_t adler, const uint8_t* p, size_t len) {
+        uint32_t a = adler & 0xFFFF;
+        uint32_t b = adler >> 16;
+        while (len > 0) {
+            // 5552 bytes is the most that cannot overflow b before the modulo.
+            size_t n = len < 5552 ? len : 5552;
+            len -= n;
+            while (n--) {
+                a += *p++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t read_le32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    Inflater::Inflater() {
+        window_.resize(kWindow + kChunk + kSlack);
+        in_.resize(8);
+    }
+
+    void Inflater::reset(Format format, uint64_t max_output) {
+        format_ = format;
+        max_output_ = max_output;
+        state_ = State::Wrapper;
+        limit_exceeded_ = false;
+        in_len_ = 0;
+        bitpos_ = 0;
+        std::memset(in_.data(), 0, 8);
+        out_pos_ = 0;
+        emitted_ = 0;
+        total_out_ = 0;
+    }
+
+    bool Inflater::fail() {
+        state_ = State::Error;
+        return false;
+    }
+
+    // The next 57 or more input bits, least significant first.
+    uint64_t Inflater::peek() const {
+        uint64_t word;
+        std::memcpy(&word, in_.data() + (bitpos_ >> 3), 8);
+        return word >> (bitpos_ & 7);
+    }
+
+    bool Inflater::feed(const char* data, size_t len, const Output& out) {
+        if (state_ == State::Error) return false;
+
+        // Drop consumed bytes, then append the new ones ahead of the padding.
+        size_t consumed = (size_t)(bitpos_ >> 3);
+        if (consumed > 0) {
+            std::memmove(in_.data(), in_.data() + consumed, in_len_ - consumed);
+            in_len_ -= consumed;
+            bitpos_ &= 7;
+        }
+        if (in_.size() < in_len_ + len + 8) in_.resize(in_len_ + len + 8);
+        if (len > 0) std::memcpy(in_.data() + in_len_, data, len);
+        in_len_ += len;
+        std::memset(in_.data() + in_len_, 0, 8);
+
+        bool progress = true;
+        while (progress) {
+            switch (state_) {
+                case State::Wrapper: progress = parse_wrapper(); break;
+                case State::BlockHeader: progress = parse_block_header(); break;
+                case State::Stored: progress = inflate_stored(out); break;
+                case State::Huffman: progress = inflate_huffman(out); break;
+                case State::Trailer: progress = parse_trailer(out); break;
+                case State::Done:
+                    // Another gzip member may follow; anything else is ignored.
+                    progress = false;
+                    if (format_ == Format::Gzip && available_bits() >= 8 && in_[bitpos_ >> 3] == 0x1F) {
+                        state_ = State::Wrapper;
+                        progress = true;
+                    } else {
+                        bitpos_ = (uint64_t)in_len_ * 8;
+                    }
+                    break;
+                case State::Error:
+                    return false;
+            }
+        }
+        if (state_ == State::Error) return false;
+        return flush(out);
+    }
+
+    bool Inflater::parse_wrapper() {
+        const uint8_t* p = in_.data() + (bitpos_ >> 3);
+        size_t avail = in_len_ - (size_t)(bitpos_ >> 3);
+
+        if (format_ == Format::Gzip) {
+            if (avail < 10) return false;
+            if (p[0] != 0x1F || p[1] != 0x8B || p[2] != 8) return fail();
+            uint8_t flags = p[3];
+            size_t pos = 10;
+            if (flags & 0x04) {     // FEXTRA
+                if (avail < pos + 2) return false;
+                pos += 2 + (size_t)(p[pos] | (p[pos + 1] << 8));
+            }
+            for (uint8_t bit : {(uint8_t)0x08, (uint8_t)0x10}) {   // FNAME, FCOMMENT
+                if (!(flags & bit)) continue;
+                while (pos < avail && p[pos] != 0) ++pos;
+                if (pos >= avail) return false;
+                ++pos;
+            }
+            if (flags & 0x02) pos += 2;     // FHCRC
+            if (avail < pos) return false;
+            bitpos_ += (uint64_t)pos * 8;
+            zlib_ = false;
+        } else if (format_ == Format::Deflate) {
+            if (avail < 2) return false;
+            bool zlib = (p[0] & 0x0F) == 8 && (p[0] >> 4) <= 7 && !(p[1] & 0x20) &&
+                        ((p[0] << 8) | p[1]) % 31 == 0;
+            if (zlib) bitpos_ += 16;
+            zlib_ = zlib;
+        } else {
+            zlib_ = false;
+        }
+
+        // A new member starts with an empty history.
+        out_pos_ = 0;
+        emitted_ = 0;
+        member_out_ = 0;
+        crc_ = 0;
+        adler_ = 1;
+        final_block_ = false;
+        state_ = State::BlockHeader;
+        return true;
+    }
+
+    bool Inflater::build(Huffman& table, const uint8_t* lengths, int n) {
+        std::memset(table.count, 0, sizeof(table.count));
+        std::memset(table.fast, 0, sizeof(table.fast));
+        for (int i = 0; i < n; ++i) ++table.count[lengths[i]];
+        table.count[0] = 0;
+
+        // Over-subscribed codes are invalid; incomplete ones are tolerated,
+        // as a lone distance code is legal.
+        int left = 1;
+        for (int len = 1; len <= 15; ++len) {
+            left = (left << 1) - table.count[len];
+            if (left < 0) return false;
+        }
+
+        uint16_t offsets[16];
+        uint16_t next_code[16];
+        offsets[1] = 0;
+        next_code[1] = 0;
+        for (int len = 1; len < 15; ++len) {
+            offsets[len + 1] = offsets[len] + table.count[len];
+            next_code[len + 1] = (uint16_t)((next_code[len] + table.count[len]) << 1);
+        }
+
+        for (int sym = 0; sym < n; ++sym) {
+            int len = lengths[sym];
+            if (len == 0) continue;
+            table.symbol[offsets[len]++] = (uint16_t)sym;
+
+            uint32_t code = next_code[len]++;
+            if (len > 10) continue;
+            uint32_t reversed = 0;
+            for (int i = 0; i < len; ++i) reversed |= ((code >> i) & 1) << (len - 1 - i);
+            for (uint32_t r = reversed; r < 1024; r += 1u << len) {
+                table.fast[r] = (uint16_t)((sym << 4) | len);
+            }
+        }
+        return true;
+    }
+
+    // Canonical decoding one bit at a time, for codes the fast table
+    // does not cover. Returns -1 for a bit pattern outside the code.
+    int Inflater::decode_slow(const Huffman& table, uint64_t bits, int& used) const {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= 15; ++len) {
+            code |= (int)((bits >> (len - 1)) & 1);
+            int count = table.count[len];
+            if (code - count < first) {
+                used = len;
+                return table.symbol[index + (code - first)];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool Inflater::parse_block_header() {
+        if (available_bits() < 3) return false;
+        uint64_t bits = peek();
+        bool final_block = (bits & 1) != 0;
+        int type = (int)((bits >> 1) & 3);
+
+        if (type == 0) {
+            uint64_t pos = (bitpos_ + 3 + 7) & ~(uint64_t)7;
+            if (pos + 32 > (uint64_t)in_len_ * 8) return false;
+            const uint8_t* p = in_.data() + (pos >> 3);
+            uint16_t len = (uint16_t)(p[0] | (p[1] << 8));
+            uint16_t nlen = (uint16_t)(p[2] | (p[3] << 8));
+            if ((uint16_t)~nlen != len) return fail();
+            bitpos_ = pos + 32;
+            stored_left_ = len;
+            final_block_ = final_block;
+            state_ = State::Stored;
+            return true;
+        }
+        if (type == 1) {
+            uint8_t lengths[320];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            build(literals_, lengths, 288);
+            std::memset(lengths, 5, 30);
+            build(distances_, lengths, 30);
+            bitpos_ += 3;
+            final_block_ = final_block;
+            state_ = State::Huffman;
+            return true;
+        }
+        if (type == 2) {
+            // Parsed in one go; on a short read nothing is consumed.
+            uint64_t start = bitpos_;
+            bitpos_ += 3;
+            if (!parse_dynamic_tables()) {
+                if (state_ != State::Error) bitpos_ = start;
+                return false;
+            }
+            final_block_ = final_block;
+            state_ = State::Huffman;
+            return true;
+        }
+        return fail();
+    }
+
+    bool Inflater::parse_dynamic_tables() {
+        uint64_t limit = (uint64_t)in_len_ * 8;
+        if (bitpos_ + 14 > limit) return false;
+        uint64_t bits = peek();
+        int hlit = (int)(bits & 31) + 257;
+        int hdist = (int)((bits >> 5) & 31) + 1;
+        int hclen = (int)((bits >> 10) & 15) + 4;
+        bitpos_ += 14;
+        if (hlit > 286 || hdist > 30) return fail();
+
+        if (bitpos_ + 3 * (uint64_t)hclen > limit) return false;
+        uint8_t lengths[320] = {};
+        for (int i = 0; i < hclen; ++i) {
+            lengths[kCodeLengthOrder[i]] = (uint8_t)(peek() & 7);
+            bitpos_ += 3;
+        }
+        Huffman& code_lengths = distances_;     // free until the real tables are built
+        if (!build(code_lengths, lengths, 19)) return fail();
+
+        std::memset(lengths, 0, sizeof(lengths));
+        int n = 0;
+        while (n < hlit + hdist) {
+            bits = peek();
+            uint16_t entry = code_lengths.fast[bits & 1023];
+            if (entry == 0) return bitpos_ + 7 > limit ? false : fail();
+            int sym = entry >> 4;
+            int used = entry & 15;
+            int repeat = 0;
+            uint8_t value = 0;
+            if (sym < 16) {
+                value = (uint8_t)sym;
+                repeat = 1;
+            } else if (sym == 16) {
+                value = n > 0 ? lengths[n - 1] : 0;
+                repeat = 3 + (int)((bits >> used) & 3);
+                used += 2;
+            } else if (sym == 17) {
+                repeat = 3 + (int)((bits >> used) & 7);
+                used += 3;
+            } else {
+                repeat = 11 + (int)((bits >> used) & 127);
+                used += 7;
+            }
+            if (bitpos_ + used > limit) return false;
+            if ((sym == 16 && n == 0) || n + repeat > hlit + hdist) return fail();
+            bitpos_ += used;
+            while (repeat--) lengths[n++] = value;
+        }
+        if (lengths[256] == 0) return fail();
+
+        uint8_t distance_lengths[30];
+        std::memcpy(distance_lengths, lengths + hlit, hdist);
+        if (!build(literals_, lengths, hlit)) return fail();
+        if (!build(distances_, distance_lengths, hdist)) return fail();
+        return true;
+    }
+
+    bool Inflater::flush(const Output& out) {
+        size_t n = out_pos_ - emitted_;
+        if (n == 0) return true;
+        const uint8_t* p = window_.data() + emitted_;
+        if (zlib_) adler_ = adler32_update(adler_, p, n);
+        else if (format_ == Format::Gzip) crc_ = crc32_update(crc_, p, n);
+
+        total_out_ += n;
+        member_out_ += n;
+        emitted_ = out_pos_;
+        if (total_out_ > max_output_) {
+            limit_exceeded_ = true;
+            return fail();
+        }
+        if (!out(reinterpret_cast<const char*>(p), n)) return fail();
+        return true;
+    }
+
+    // Hands a full chunk to the caller and keeps only the history window.
+    bool Inflater::make_room(const Output& out) {
+        if (out_pos_ < kWindow + kChunk) return true;
+        if (!flush(out)) return false;
+        std::memmove(window_.data(), window_.data() + out_pos_ - kWindow, kWindow);
+        out_pos_ = kWindow;
+        emitted_ = kWindow;
+        return true;
+    }
+
+    bool Inflater::inflate_stored(const Output& out) {
+        while (stored_left_ > 0) {
+            if (!make_room(out)) return false;
+            size_t avail = in_len_ - (size_t)(bitpos_ >> 3);
+            if (avail == 0) return false;
+            size_t n = kWindow + kChunk - out_pos_;
+            if (n > avail) n = avail;
+            if (n > stored_left_) n = stored_left_;
+            std::memcpy(window_.data() + out_pos_, in_.data() + (bitpos_ >> 3), n);
+            out_pos_ += n;
+            bitpos_ += (uint64_t)n * 8;
+            stored_left_ -= (uint32_t)n;
+        }
+        state_ = final_block_ ? State::Trailer : State::BlockHeader;
+        return true;
+    }
+
+    bool Inflater::inflate_huffman(const Output& out) {
+        const uint64_t limit = (uint64_t)in_len_ * 8;
+        uint8_t* window = window_.data();
+
+        while (true) {
+            if (!make_room(out)) return false;
+
+            uint64_t bits = peek();
+            int used = 0;
+            int sym;
+            uint16_t entry = literals_.fast[bits & 1023];
+            if (entry) {
+                sym = entry >> 4;
+                used = entry & 15;
+            } else {
+                sym = decode_slow(literals_, bits, used);
+                if (sym < 0) return bitpos_ + 15 > limit ? false : fail();
+            }
+
+            if (sym < 256) {
+                if (bitpos_ + used > limit) return false;
+                window[out_pos_++] = (uint8_t)sym;
+                bitpos_ += used;
+                continue;
+            }
+            if (sym == 256) {
+                if (bitpos_ + used > limit) return false;
+                bitpos_ += used;
+                state_ = final_block_ ? State::Trailer : State::BlockHeader;
+                return true;
+            }
+
+            // At most 15 + 5 + 15 + 13 = 48 bits, all inside one peek.
+            sym -= 257;
+            if (sym >= 29) return bitpos_ + used > limit ? false : fail();
+            uint32_t length = kLengthBase[sym] + (uint32_t)((bits >> used) & ((1u << kLengthExtra[sym]) - 1));
+            used += kLengthExtra[sym];
+
+            uint64_t dbits = bits >> used;
+            int dused = 0;
+            int dsym;
+            entry = distances_.fast[dbits & 1023];
+            if (entry) {
+                dsym = entry >> 4;
+                dused = entry & 15;
+            } else {
+                dsym = decode_slow(distances_, dbits, dused);
+                if (dsym < 0) return bitpos_ + used + 15 > limit ? false : fail();
+            }
+            if (dsym >= 30) return bitpos_ + used + dused > limit ? false : fail();
+            uint32_t distance = kDistanceBase[dsym] + (uint32_t)((dbits >> dused) & ((1u << kDistanceExtra[dsym]) - 1));
+            used += dused + kDistanceExtra[dsym];
+
+            if (bitpos_ + used > limit) return false;
+            if (distance > out_pos_) return fail();
+            bitpos_ += used;
+
+            uint8_t* dst = window + out_pos_;
+            const uint8_t* src = dst - distance;
+            if (distance >= 8) {
+                for (uint32_t i = 0; i < length; i += 8) std::memcpy(dst + i, src + i, 8);
+            } else {
+                for (uint32_t i = 0; i < length; ++i) dst[i] = src[i];
+            }
+            out_pos_ += length;
+        }
+    }
+
+    bool Inflater::parse_trailer(const Output& out) {
+        if (!flush(out)) return false;
+
+        uint64_t pos = (bitpos_ + 7) & ~(uint64_t)7;
+        size_t need = zlib_ ? 4 : (format_ == Format::Gzip ? 8 : 0);
+        if (pos + need * 8 > (uint64_t)in_len_ * 8) return false;
+        const uint8_t* p = in_.data() + (pos >> 3);
+
+        if (format_ == Format::Gzip) {
+            if (read_le32(p) != crc_ || read_le32(p + 4) != (uint32_t)member_out_) return fail();
+        } else if (zlib_) {
+            uint32_t expected = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+            if (expected != adler_) return fail();
+        }
+        bitpos_ = pos + need * 8;
+        state_ = State::Done;
+        return true;
+    }
+
+} // namespace detail
+} // namespace NetClient
@@ -0,0 +1,95 @@
+#ifndef NETCLIENT_INFLATE_H
+#define NETCLIENT_INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace NetClient {
+namespace detail {
+
+    // Streaming DEFLATE decoder (RFC 1951) with the gzip (RFC 1952) and zlib
+    // (RFC 1950) wrappers used by Content-Encoding. Input may be split at any
+    // byte: a symbol or block header that is not complete yet is retried when
+    // more bytes arrive. Output is handed over in pieces of about 64 KB (up
+    // to 96 KB for the first) from a fixed buffer that also holds the 32 KB
+    // history window, so memory use does not depend on the size of the stream.
+    class Inflater {
+    public:
+        enum class Format {
+            Gzip,
+            Deflate,    // zlib wrapper, or bare DEFLATE as some servers send
+            Raw         // bare DEFLATE only, as in WebSocket permessage-deflate
+        };
+
+        typedef std::function<bool(const char* data, size_t len)> Output;
+
+        Inflater();
+
+        // Starts a new stream; output beyond max_output is an error.
+        void reset(Format format, uint64_t max_output);
+
+        // Decodes as much of data as possible. Returns false on corrupt data,
+        // when output would pass max_output, or when out returns false.
+        bool feed(const char* data, size_t len, const Output& out);
+
+        // True once the complete stream, including its checksum, was read.
+        bool done() const { return state_ == State::Done; }
+        bool limit_exceeded() const { return limit_exceeded_; }
+
+    private:
+        enum class State { Wrapper, BlockHeader, Stored, Huffman, Trailer, Done, Error };
+
+        struct Huffman {
+            uint16_t fast[1 << 10];     // symbol << 4 | code length, 0 when longer
+            uint16_t count[16];
+            uint16_t symbol[320];
+        };
+
+        bool build(Huffman& table, const uint8_t* lengths, int n);
+        int decode_slow(const Huffman& table, uint64_t bits, int& used) const;
+
+        bool parse_wrapper();
+        bool parse_block_header();
+        bool parse_dynamic_tables();
+        bool inflate_stored(const Output& out);
+        bool inflate_huffman(const Output& out);
+        bool parse_trailer(const Output& out);
+        bool flush(const Output& out);
+        bool make_room(const Output& out);
+        bool fail();
+
+        uint64_t peek() const;
+        uint64_t available_bits() const { return (uint64_t)in_len_ * 8 - bitpos_; }
+
+        uint64_t max_output_ = 0;
+        Format format_ = Format::Gzip;
+        State state_ = State::Wrapper;
+        bool zlib_ = false;
+        bool final_block_ = false;
+        bool limit_exceeded_ = false;
+        uint32_t stored_left_ = 0;
+
+        // Unconsumed input, read at a bit position; 8 zero bytes of padding
+        // past in_len_ let peek() load a whole word near the end.
+        std::vector<uint8_t> in_;
+        size_t in_len_ = 0;
+        uint64_t bitpos_ = 0;
+
+        std::vector<uint8_t> window_;
+        size_t out_pos_ = 0;
+        size_t emitted_ = 0;
+        uint64_t total_out_ = 0;
+        uint64_t member_out_ = 0;
+        uint32_t crc_ = 0;
+        uint32_t adler_ = 1;
+
+        Huffman literals_;
+        Huffman distances_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_INFLATE_H
@@ -0,0 +1,536 @@
+#include "NetClientJson.h"
+#include "JsonIndex.h"
+
+#include <charconv>
+#include <deque>
+#include <vector>
+
+namespace NetClient {
+namespace json {
+
+    // Indexing runs this far ahead of the deepest lookup.
+    static const size_t kChunk = 64 * 1024;
+    static const size_t kNone = SIZE_MAX;
+    static const int kMaxDepth = 1024;
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static bool is_value_start(char c) {
+        return c == '{' || c == '[' || c == '"' || c == 't' || c == 'f' || c == 'n' || c == '-' ||
+               (c >= '0' && c <= '9');
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    static bool is_number(std::string_view s, bool& integer) {
+        size_t i = 0;
+        auto digits = [&]() {
+            size_t start = i;
+            while (i < s.size() && s[i] >= '0' && s[i] <= '9') ++i;
+            return i > start;
+        };
+        if (i < s.size() && s[i] == '-') ++i;
+        if (i < s.size() && s[i] == '0') ++i;
+        else if (!digits()) return false;
+        integer = true;
+        if (i < s.size() && s[i] == '.') {
+            ++i;
+            if (!digits()) return false;
+            integer = false;
+        }
+        if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+            ++i;
+            if (i < s.size() && (s[i] == '+' || s[i] == '-')) ++i;
+            if (!digits()) return false;
+            integer = false;
+        }
+        return i == s.size();
+    }
+
+    static bool hex4(std::string_view s, size_t at, uint32_t& out) {
+        if (at + 4 > s.size()) return false;
+        out = 0;
+        for (size_t i = at; i < at + 4; ++i) {
+            char c = s[i];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') out |= (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') out |= (uint32_t)(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // Decodes the contents of a string literal; \u escapes become UTF-8.
+    static bool unescape(std::string_view raw, std::string& out) {
+        out.clear();
+        out.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            char c = raw[i];
+            if ((unsigned char)c < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (++i == raw.size()) return false;
+            switch (raw[i]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!hex4(raw, i + 1, cp)) return false;
+                    i += 4;
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        uint32_t low = 0;
+                        if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' ||
+                            !hex4(raw, i + 3, low) || low < 0xDC00 || low >= 0xE000) {
+                            return false;
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else if (cp >= 0xDC00 && cp < 0xE000) {
+                        return false;
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    struct Document::Impl {
+        std::string_view text;
+        detail::JsonIndexer indexer;
+        std::vector<uint32_t> index;        // byte offsets of the structurals found so far
+        std::deque<std::string> decoded;    // strings that had escapes; never moved
+        std::string scratch;
+        std::string error;
+
+        // True once structural i has been found, indexing more as needed.
+        bool has(size_t i) {
+            while (i >= index.size()) {
+                if (!indexer.next_chunk(index, kChunk)) return false;
+            }
+            return true;
+        }
+
+        char at(size_t i) {
+            return has(i) ? text[index[i]] : '\0';
+        }
+
+        // Where the value at structural i ends at the latest.
+        size_t limit(size_t i) {
+            return has(i + 1) ? index[i + 1] : text.size();
+        }
+
+        bool fail(const char* what, size_t i) {
+            if (error.empty()) {
+                error = what;
+                error += " at byte " + std::to_string(has(i) ? (size_t)index[i] : text.size());
+            }
+            return false;
+        }
+
+        // Index of the structural after the value at i, or kNone. Nested
+        // containers are skipped by counting brackets, without reading them.
+        size_t skip(size_t i) {
+            char c = at(i);
+            if (c != '{' && c != '[') {
+                if (is_value_start(c)) return i + 1;
+                fail("expected a value", i);
+                return kNone;
+            }
+            size_t depth = 1;
+            for (size_t j = i + 1;; ++j) {
+                if (!has(j)) {
+                    fail("unexpected end of input", j);
+                    return kNone;
+                }
+                char d = text[index[j]];
+                if (d == '{' || d == '[') {
+                    ++depth;
+                } else if ((d == '}' || d == ']') && --depth == 0) {
+                    return j + 1;
+                }
+            }
+        }
+
+        // The bytes between the quotes of the string at i, still escaped.
+        // The closing quote is the last byte before the next structural
+        // that is not blank.
+        bool raw_string(size_t i, std::string_view& out) {
+            if (at(i) != '"') return false;
+            size_t begin = index[i] + 1;
+            size_t end = limit(i);
+            while (end > begin && is_space(text[end - 1])) --end;
+            if (end <= begin || text[end - 1] != '"') return fail("unterminated string", i);
+            out = text.substr(begin, end - 1 - begin);
+            return true;
+        }
+
+        bool string_at(size_t i, std::string_view& out) {
+            std::string_view raw;
+            if (!raw_string(i, raw)) return false;
+            if (raw.find('\\') == std::string_view::npos) {
+                out = raw;
+                return true;
+            }
+            std::string value;
+            if (!unescape(raw, value)) return fail("invalid string", i);
+            decoded.push_back(std::move(value));
+            out = decoded.back();
+            return true;
+        }
+
+        bool key_equals(size_t i, std::string_view key) {
+            std::string_view raw;
+            if (!raw_string(i, raw)) return false;
+            if (raw.find('\\') == std::string_view::npos) return raw == key;
+            return unescape(raw, scratch) && scratch == key;
+        }
+
+        std::string_view scalar_at(size_t i) {
+            size_t begin = index[i];
+            size_t end = limit(i);
+            while (end > begin && is_space(text[end - 1])) --end;
+            return text.substr(begin, end - begin);
+        }
+
+        // Hands visit each child of the container at i: the index of an
+        // element, or of a key whose value follows at key + 2. visit
+        // returns false to stop early. False on malformed input.
+        template <typename Visit>
+        bool walk(size_t i, Visit visit) {
+            bool object = at(i) == '{';
+            char close = object ? '}' : ']';
+            size_t j = i + 1;
+            if (at(j) == close) return true;
+            while (true) {
+                size_t value = j;
+                if (object) {
+                    if (at(j) != '"') return fail("expected a key", j);
+                    if (at(j + 1) != ':') return fail("expected ':'", j + 1);
+                    value = j + 2;
+                }
+                if (!is_value_start(at(value))) return fail("expected a value", value);
+                if (!visit(j)) return true;
+
+                size_t after = skip(value);
+                if (after == kNone) return false;
+                char c = at(after);
+                if (c == ',') {
+                    j = after + 1;
+                } else if (c == close) {
+                    return true;
+                } else {
+                    return fail(object ? "expected ',' or '}'" : "expected ',' or ']'", after);
+                }
+            }
+        }
+
+        // Checks the value at i completely; the index after it, or kNone.
+        size_t check(size_t i, int depth) {
+            char c = at(i);
+            if (c == '{' || c == '[') {
+                if (depth >= kMaxDepth) {
+                    fail("nesting too deep", i);
+                    return kNone;
+                }
+                bool object = c == '{';
+                char close = object ? '}' : ']';
+                size_t j = i + 1;
+                if (at(j) == close) return j + 1;
+                while (true) {
+                    if (object) {
+                        if (at(j) != '"' || check(j, depth) == kNone) {
+                            fail("expected a key", j);
+                            return kNone;
+                        }
+                        if (at(j + 1) != ':') {
+                            fail("expected ':'", j + 1);
+                            return kNone;
+                        }
+                        j += 2;
+                    }
+                    j = check(j, depth + 1);
+                    if (j == kNone) return kNone;
+                    char d = at(j);
+                    if (d == ',') {
+                        ++j;
+                    } else if (d == close) {
+                        return j + 1;
+                    } else {
+                        fail(object ? "expected ',' or '}'" : "expected ',' or ']'", j);
+                        return kNone;
+                    }
+                }
+            }
+            if (c == '"') {
+                std::string_view raw;
+                if (!raw_string(i, raw)) return kNone;
+                for (char b : raw) {
+                    if ((unsigned char)b < 0x20 || b == '\\') {
+                        if (!unescape(raw, scratch)) {
+                            fail("invalid string", i);
+                            return kNone;
+                        }
+                        break;
+                    }
+                }
+                return i + 1;
+            }
+            if (!has(i)) {
+                fail("unexpected end of input", i);
+                return kNone;
+            }
+            std::string_view s = scalar_at(i);
+            bool integer = false;
+            if (s == "true" || s == "false" || s == "null" || is_number(s, integer)) return i + 1;
+            fail("invalid value", i);
+            return kNone;
+        }
+    };
+
+    Document::Document() : impl_(new Impl()) {}
+
+    Document::Document(std::string_view text) : impl_(new Impl()) {
+        reset(text);
+    }
+
+    Document::~Document() {
+        delete impl_;
+    }
+
+    void Document::reset(std::string_view text) {
+        impl_->text = text;
+        impl_->index.clear();
+        impl_->decoded.clear();
+        impl_->error.clear();
+        // Offsets are 32-bit.
+        if (text.size() >= UINT32_MAX) {
+            impl_->text = std::string_view();
+            impl_->error = "document too large";
+        }
+        impl_->indexer.reset(impl_->text.data(), impl_->text.size());
+    }
+
+    Value Document::root() const {
+        if (!impl_->has(0)) {
+            impl_->fail("empty document", 0);
+            return Value();
+        }
+        return Value(this, 0);
+    }
+
+    bool Document::validate() const {
+        Impl& d = *impl_;
+        if (!d.error.empty()) return false;
+        if (!d.has(0)) return d.fail("empty document", 0);
+        size_t after = d.check(0, 0);
+        if (after == kNone) return false;
+        if (d.has(after)) return d.fail("unexpected content after the document", after);
+        return true;
+    }
+
+    const std::string& Document::error() const {
+        return impl_->error;
+    }
+
+    Type Value::type() const {
+        if (!doc_) return Type::Invalid;
+        switch (doc_->impl_->at(index_)) {
+            case '{': return Type::Object;
+            case '[': return Type::Array;
+            case '"': return Type::String;
+            case 't': case 'f': return Type::Bool;
+            case 'n': return Type::Null;
+            case '-': case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9': return Type::Number;
+            default: return Type::Invalid;
+        }
+    }
+
+    Value Value::operator[](std::string_view key) const {
+        if (type() != Type::Object) return Value();
+        Document::Impl& d = *doc_->impl_;
+        size_t found = kNone;
+        d.walk(index_, [&](size_t j) {
+            if (!d.key_equals(j, key)) return true;
+            found = j + 2;
+            return false;
+        });
+        return found == kNone ? Value() : Value(doc_, found);
+    }
+
+    Value Value::operator[](size_t index) const {
+        if (type() != Type::Array) return Value();
+        size_t found = kNone;
+        size_t n = 0;
+        doc_->impl_->walk(index_, [&](size_t j) {
+            if (n++ != index) return true;
+            found = j;
+            return false;
+        });
+        return found == kNone ? Value() : Value(doc_, found);
+    }
+
+    size_t Value::size() const {
+        Type t = type();
+        if (t != Type::Array && t != Type::Object) return 0;
+        size_t n = 0;
+        doc_->impl_->walk(index_, [&](size_t) {
+            ++n;
+            return true;
+        });
+        return n;
+    }
+
+    bool Value::for_each(const std::function<bool(Value)>& fn) const {
+        if (type() != Type::Array) return false;
+        return doc_->impl_->walk(index_, [&](size_t j) { return fn(Value(doc_, j)); });
+    }
+
+    bool Value::for_each_member(const std::function<bool(std::string_view key, Value value)>& fn) const {
+        if (type() != Type::Object) return false;
+        Document::Impl& d = *doc_->impl_;
+        bool broken = false;
+        bool ok = d.walk(index_, [&](size_t j) {
+            std::string_view key;
+            if (!d.string_at(j, key)) {
+                broken = true;
+                return false;
+            }
+            return fn(key, Value(doc_, j + 2));
+        });
+        return ok && !broken;
+    }
+
+    bool Value::get(bool& out) const {
+        if (type() != Type::Bool) return false;
+        std::string_view s = doc_->impl_->scalar_at(index_);
+        if (s == "true") out = true;
+        else if (s == "false") out = false;
+        else return false;
+        return true;
+    }
+
+    bool Value::get(int64_t& out) const {
+        if (type() != Type::Number) return false;
+        std::string_view s = doc_->impl_->scalar_at(index_);
+        bool integer = false;
+        if (!is_number(s, integer) || !integer) return false;
+        int64_t value = 0;
+        auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (result.ec != std::errc()) return false;
+        out = value;
+        return true;
+    }
+
+    bool Value::get(uint64_t& out) const {
+        if (type() != Type::Number) return false;
+        std::string_view s = doc_->impl_->scalar_at(index_);
+        bool integer = false;
+        if (!is_number(s, integer) || !integer || s[0] == '-') return false;
+        uint64_t value = 0;
+        auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (result.ec != std::errc()) return false;
+        out = value;
+        return true;
+    }
+
+    bool Value::get(double& out) const {
+        if (type() != Type::Number) return false;
+        std::string_view s = doc_->impl_->scalar_at(index_);
+        bool integer = false;
+        if (!is_number(s, integer)) return false;
+        double value = 0;
+        auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (result.ec != std::errc()) return false;
+        out = value;
+        return true;
+    }
+
+    bool Value::get(std::string_view& out) const {
+        if (type() != Type::String) return false;
+        return doc_->impl_->string_at(index_, out);
+    }
+
+    bool Value::get(std::string& out) const {
+        std::string_view view;
+        if (!get(view)) return false;
+        out.assign(view.data(), view.size());
+        return true;
+    }
+
+    std::string_view Value::as_string(std::string_view fallback) const {
+        std::string_view out;
+        return get(out) ? out : fallback;
+    }
+
+    int64_t Value::as_int(int64_t fallback) const {
+        int64_t out = 0;
+        return get(out) ? out : fallback;
+    }
+
+    double Value::as_double(double fallback) const {
+        double out = 0;
+        return get(out) ? out : fallback;
+    }
+
+    bool Value::as_bool(bool fallback) const {
+        bool out = false;
+        return get(out) ? out : fallback;
+    }
+
+    bool Value::is_null() const {
+        return type() == Type::Null && doc_->impl_->scalar_at(index_) == "null";
+    }
+
+    std::string_view Value::raw() const {
+        Type t = type();
+        if (t == Type::Invalid) return std::string_view();
+        Document::Impl& d = *doc_->impl_;
+        size_t begin = d.index[index_];
+        if (t == Type::Object || t == Type::Array) {
+            size_t after = d.skip(index_);
+            if (after == kNone) return std::string_view();
+            return d.text.substr(begin, d.index[after - 1] + 1 - begin);
+        }
+        if (t == Type::String) {
+            std::string_view contents;
+            if (!d.raw_string(index_, contents)) return std::string_view();
+            return d.text.substr(begin, contents.size() + 2);
+        }
+        return d.scalar_at(index_);
+    }
+
+} // namespace json
+} // namespace NetClient
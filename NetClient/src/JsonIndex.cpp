@@ -0,0 +1,194 @@
+#include "JsonIndex.h"
+
+#include <cstring>
+
+// NETCLIENT_JSON_SCALAR forces the portable classifier; the tests build
+// it both ways.
+#if !defined(NETCLIENT_JSON_SCALAR) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NETCLIENT_JSON_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace NetClient {
+namespace detail {
+
+    // Bit i of each mask describes byte i of a 64-byte block.
+    struct BlockMasks {
+        uint64_t quote = 0;
+        uint64_t backslash = 0;
+        uint64_t op = 0;        // { } [ ] : ,
+        uint64_t space = 0;     // space, tab, CR, LF
+    };
+
+#ifdef NETCLIENT_JSON_SSE2
+    static inline uint64_t movemask(__m128i v) {
+        return (uint64_t)(uint32_t)_mm_movemask_epi8(v);
+    }
+
+    static BlockMasks classify(const char* bytes) {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i open = _mm_set1_epi8('{');
+        const __m128i close = _mm_set1_epi8('}');
+        const __m128i colon = _mm_set1_epi8(':');
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i blank = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        BlockMasks m;
+        for (int i = 0; i < 4; ++i) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16 * i));
+            // '[' and ']' differ from '{' and '}' only in bit 5.
+            __m128i folded = _mm_or_si128(v, case_bit);
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+            __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, blank), _mm_cmpeq_epi8(v, tab)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+            int shift = 16 * i;
+            m.quote |= movemask(_mm_cmpeq_epi8(v, quote)) << shift;
+            m.backslash |= movemask(_mm_cmpeq_epi8(v, backslash)) << shift;
+            m.op |= movemask(op) << shift;
+            m.space |= movemask(space) << shift;
+        }
+        return m;
+    }
+#else
+    static BlockMasks classify(const char* bytes) {
+        BlockMasks m;
+        for (int i = 0; i < 64; ++i) {
+            uint64_t bit = 1ull << i;
+            switch (bytes[i]) {
+                case '"': m.quote |= bit; break;
+                case '\\': m.backslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+                case ' ': case '\t': case '\n': case '\r': m.space |= bit; break;
+                default: break;
+            }
+        }
+        return m;
+    }
+#endif
+
+    static inline int trailing_zeros(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return (int)index;
+#elif defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    static inline int count_bits(uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return (int)((x * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    // Bit i set when an odd number of quotes precede byte i or sit on it:
+    // the opening quote and string contents, but not the closing quote.
+    static inline uint64_t prefix_xor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    // Bytes preceded by an unescaped backslash. Backslashes are rare in
+    // manifests, so walking them one by one costs nothing in the common
+    // case and keeps runs like \\\" easy to get right.
+    static inline uint64_t find_escaped(uint64_t backslash, uint64_t& carry) {
+        uint64_t escaped = carry;
+        carry = 0;
+        backslash &= ~escaped;
+        while (backslash) {
+            int bit = trailing_zeros(backslash);
+            backslash &= backslash - 1;
+            if (bit == 63) {
+                carry = 1;
+                break;
+            }
+            uint64_t next = 1ull << (bit + 1);
+            escaped |= next;
+            backslash &= ~next;
+        }
+        return escaped;
+    }
+
+    void JsonIndexer::reset(const char* data, size_t size) {
+        data_ = data;
+        size_ = size;
+        pos_ = 0;
+        in_string_ = 0;
+        escaped_ = 0;
+        scalar_ = 0;
+    }
+
+    bool JsonIndexer::next_chunk(std::vector<uint32_t>& out, size_t chunk) {
+        if (pos_ >= size_) return false;
+        size_t end = size_ - pos_ > chunk ? pos_ + chunk : size_;
+        while (pos_ + 64 <= end) {
+            block(data_ + pos_, pos_, out);
+            pos_ += 64;
+        }
+        if (pos_ < end) {
+            // Padding with blanks adds no structurals and ends no scalar early.
+            char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data_ + pos_, end - pos_);
+            block(tail, pos_, out);
+            pos_ = end;
+        }
+        return true;
+    }
+
+    void JsonIndexer::block(const char* bytes, size_t offset, std::vector<uint32_t>& out) {
+        BlockMasks m = classify(bytes);
+
+        uint64_t quote = m.quote & ~find_escaped(m.backslash, escaped_);
+        uint64_t in_string = prefix_xor(quote) ^ in_string_;
+        in_string_ = 0 - (in_string >> 63);
+
+        // Anything else outside strings belongs to a number or literal; only
+        // the first byte of each run is recorded.
+        uint64_t scalar = ~(m.op | m.space | quote | in_string);
+        uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_);
+        scalar_ = scalar >> 63;
+
+        uint64_t bits = (m.op & ~in_string) | (quote & in_string) | scalar_start;
+        if (!bits) return;
+
+        size_t at = out.size();
+        out.resize(at + count_bits(bits));
+        uint32_t* slot = out.data() + at;
+        while (bits) {
+            *slot++ = (uint32_t)(offset + trailing_zeros(bits));
+            bits &= bits - 1;
+        }
+    }
+
+} // namespace detail
+} // namespace NetClient
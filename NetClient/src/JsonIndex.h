@@ -0,0 +1,40 @@
+#ifndef NETCLIENT_JSON_INDEX_H
+#define NETCLIENT_JSON_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NetClient {
+namespace detail {
+
+    // First stage of the JSON parser. Classifies the input 64 bytes at a
+    // time into bitmasks (SSE2 where available) and records the offset of
+    // every { } [ ] : , outside strings, every opening quote and the first
+    // byte of every number or literal. String contents are skipped without
+    // looking at them byte by byte.
+    class JsonIndexer {
+    public:
+        void reset(const char* data, size_t size);
+
+        // Indexes up to chunk more bytes (a multiple of 64), appending the
+        // offsets found to out. False once the whole input has been indexed.
+        bool next_chunk(std::vector<uint32_t>& out, size_t chunk);
+
+    private:
+        void block(const char* bytes, size_t offset, std::vector<uint32_t>& out);
+
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        size_t pos_ = 0;
+
+        // State carried from one block into the next.
+        uint64_t in_string_ = 0;    // all ones while a string continues
+        uint64_t escaped_ = 0;      // 1 when the next block's first byte is escaped
+        uint64_t scalar_ = 0;       // 1 when the previous block ended inside a number or literal
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_JSON_INDEX_H
@@ -0,0 +1,152 @@
+#include "Metrics.h"
+#include "HttpParser.h"
+
+#include <cstdio>
+
+namespace NetClient {
+namespace detail {
+
+    // Bucket i holds values under 2^i ms; the last one everything slower.
+    static int bucket_of(double ms) {
+        int bucket = 0;
+        double bound = 1.0;
+        while (bucket < HostMetrics::kBuckets - 1 && ms >= bound) {
+            ++bucket;
+            bound *= 2.0;
+        }
+        return bucket;
+    }
+
+    static std::string host_key(const std::string& url) {
+        Url parsed;
+        if (!parse_url(url, parsed)) return "(invalid url)";
+        return parsed.host + ":" + std::to_string(parsed.port);
+    }
+
+    MetricsRegistry& MetricsRegistry::instance() {
+        // Never destroyed, so requests finishing during exit can still record.
+        static MetricsRegistry* registry = new MetricsRegistry();
+        return *registry;
+    }
+
+    void MetricsRegistry::record(const Response& resp) {
+        std::string key = host_key(resp.url);
+        std::lock_guard<std::mutex> lock(mutex_);
+        HostMetrics& host = hosts_[key];
+        ++host.requests;
+        if (resp.status_code == 0) {
+            ++host.failures;
+            if (resp.error == "timeout") ++host.timeouts;
+        }
+        if (resp.reused_connection) ++host.connections_reused;
+        else if (resp.status_code != 0) ++host.connections_opened;
+        host.bytes_sent += resp.bytes_sent;
+        host.bytes_received += resp.bytes_received;
+        host.total_ms += resp.timing.total;
+        ++host.latency_ms[bucket_of(resp.timing.total)];
+        if (resp.status_code != 0) ++host.ttfb_ms[bucket_of(resp.timing.ttfb)];
+    }
+
+    void MetricsRegistry::record_cache_hit(const std::string& url) {
+        std::string key = host_key(url);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++hosts_[key].cache_hits;
+    }
+
+    std::map<std::string, HostMetrics> MetricsRegistry::snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::map<std::string, HostMetrics>(hosts_.begin(), hosts_.end());
+    }
+
+    void MetricsRegistry::reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hosts_.clear();
+    }
+
+    int MetricsRegistry::add_reporter(PoolReporter reporter) {
+        std::lock_guard<std::mutex> lock(reporters_mutex_);
+        int id = next_reporter_++;
+        reporters_.emplace(id, std::move(reporter));
+        return id;
+    }
+
+    void MetricsRegistry::remove_reporter(int id) {
+        std::lock_guard<std::mutex> lock(reporters_mutex_);
+        reporters_.erase(id);
+    }
+
+    // Upper bound of the bucket holding the given fraction of the samples.
+    static std::string percentile(const uint64_t* buckets, double fraction) {
+        uint64_t count = 0;
+        for (int i = 0; i < HostMetrics::kBuckets; ++i) count += buckets[i];
+        if (count == 0) return "-";
+
+        uint64_t wanted = (uint64_t)(fraction * (double)count + 0.999999);
+        uint64_t seen = 0;
+        for (int i = 0; i < HostMetrics::kBuckets - 1; ++i) {
+            seen += buckets[i];
+            if (seen >= wanted) return "< " + std::to_string(1ull << i) + " ms";
+        }
+        return ">= " + std::to_string(1ull << (HostMetrics::kBuckets - 2)) + " ms";
+    }
+
+    static std::string format_bytes(uint64_t bytes) {
+        char text[32];
+        if (bytes < 1024) std::snprintf(text, sizeof(text), "%llu B", (unsigned long long)bytes);
+        else if (bytes < (1ull << 20)) std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+        else std::snprintf(text, sizeof(text), "%.1f MB", bytes / 1048576.0);
+        return text;
+    }
+
+    std::string MetricsRegistry::report() {
+        std::map<std::string, HostMetrics> hosts = snapshot();
+        std::string out = "NetClient metrics\n";
+        char line[256];
+        for (const auto& entry : hosts) {
+            const HostMetrics& m = entry.second;
+            uint64_t connections = m.connections_opened + m.connections_reused;
+            out += entry.first + "\n";
+            std::snprintf(line, sizeof(line), "  requests %llu, failed %llu (%llu timed out), cache hits %llu\n",
+                          (unsigned long long)m.requests, (unsigned long long)m.failures,
+                          (unsigned long long)m.timeouts, (unsigned long long)m.cache_hits);
+            out += line;
+            std::snprintf(line, sizeof(line), "  connections opened %llu, reused %llu (%.1f%%)\n",
+                          (unsigned long long)m.connections_opened, (unsigned long long)m.connections_reused,
+                          connections ? 100.0 * m.connections_reused / connections : 0.0);
+            out += line;
+            out += "  sent " + format_bytes(m.bytes_sent) + ", received " + format_bytes(m.bytes_received) + "\n";
+            std::snprintf(line, sizeof(line), "  latency mean %.1f ms, p50 %s, p90 %s, p99 %s\n",
+                          m.requests ? m.total_ms / m.requests : 0.0,
+                          percentile(m.latency_ms, 0.5).c_str(), percentile(m.latency_ms, 0.9).c_str(),
+                          percentile(m.latency_ms, 0.99).c_str());
+            out += line;
+            std::snprintf(line, sizeof(line), "  ttfb p50 %s, p90 %s, p99 %s\n",
+                          percentile(m.ttfb_ms, 0.5).c_str(), percentile(m.ttfb_ms, 0.9).c_str(),
+                          percentile(m.ttfb_ms, 0.99).c_str());
+            out += line;
+        }
+
+        std::lock_guard<std::mutex> lock(reporters_mutex_);
+        out += "sessions\n";
+        for (const auto& entry : reporters_) {
+            out += "  session " + std::to_string(entry.first) + "\n";
+            entry.second(out);
+        }
+        return out;
+    }
+
+} // namespace detail
+
+    std::map<std::string, HostMetrics> metrics() {
+        return detail::MetricsRegistry::instance().snapshot();
+    }
+
+    void reset_metrics() {
+        detail::MetricsRegistry::instance().reset();
+    }
+
+    std::string metrics_report() {
+        return detail::MetricsRegistry::instance().report();
+    }
+
+} // namespace NetClient
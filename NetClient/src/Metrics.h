@@ -0,0 +1,54 @@
+#ifndef NETCLIENT_METRICS_H
+#define NETCLIENT_METRICS_H
+
+#include "NetClient.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace NetClient {
+namespace detail {
+
+    inline double elapsed_ms(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    // Process-wide counters behind metrics() and metrics_report(). Recording
+    // costs one lock and one hash lookup per request, so it is always on.
+    class MetricsRegistry {
+    public:
+        // Appends one session's connection pool state to a report.
+        typedef std::function<void(std::string& out)> PoolReporter;
+
+        static MetricsRegistry& instance();
+
+        void record(const Response& resp);
+        void record_cache_hit(const std::string& url);
+
+        std::map<std::string, HostMetrics> snapshot();
+        void reset();
+        std::string report();
+
+        int add_reporter(PoolReporter reporter);
+        void remove_reporter(int id);
+
+    private:
+        MetricsRegistry() = default;
+
+        std::mutex mutex_;
+        std::unordered_map<std::string, HostMetrics> hosts_;
+
+        // Separate, so a report walking the pools never delays record().
+        std::mutex reporters_mutex_;
+        std::map<int, PoolReporter> reporters_;
+        int next_reporter_ = 1;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_METRICS_H
@@ -1,32 +1,41 @@
 #include "NetClient.h"
+#include "Delta.h"
+#include "HttpCache.h"
+#include "Metrics.h"
+#include "PartialFile.h"
+#include "RetryPolicy.h"
+#include "Sha256.h"
 
 #ifdef _WIN32
 #include <windows.h>
 #include <winhttp.h>
-#include <algorithm>
 #pragma comment(lib, "winhttp.lib")
+#include "HttpParser.h"
+#else
+#include "PosixEventLoop.h"
+#include "PosixHttp.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace NetClient {
 
     std::string Response::header(const std::string& name) const {
-        std::string lower_name = name;
-        std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
-
-        for (const auto& h : headers) {
-            std::string h_name = h.first;
-            std::transform(h_name.begin(), h_name.end(), h_name.begin(), ::tolower);
-            if (h_name == lower_name) return h.second;
-        }
-        return "";
+        return headers.combined(name);
     }
 
     bool Response::is_json() const {
-        std::string ct = header("Content-Type");
-        if (ct.find("application/json") != std::string::npos) return true;
+        if (headers.get("Content-Type").find("application/json") != std::string_view::npos) return true;
 
         // Fallback: check if it looks like JSON
         std::string trimmed = text;
@@ -38,20 +47,559 @@ namespace NetClient {
                (trimmed.front() == '[' && trimmed.back() == ']');
     }
 
+    static detail::HttpCache* make_cache(const SessionOptions& options) {
+        if (!options.cache) return nullptr;
+        return new detail::HttpCache(options.cache_memory_bytes, options.cache_directory);
+    }
+
 #ifdef _WIN32
-    static Response internal_request(const std::string& method,
+    struct AsyncContext;
+
+    // WinHTTP keeps the sockets of a session alive and enforces the
+    // per-server limit itself; idle sockets are reclaimed by WinHTTP's own
+    // timer, so idle_timeout_ms has no effect here. Connect handles are
+    // cached per host so they are created once.
+    //
+    // Asynchronous requests use a second session opened in WinHTTP's async
+    // mode, whose completions arrive on WinHTTP's own worker threads. A
+    // periodic timer enforces their deadlines.
+    struct Session::Impl {
+        SessionOptions config;
+        HINTERNET session = nullptr;
+        std::mutex mutex;
+        std::map<std::wstring, HINTERNET> connections;
+
+        HINTERNET async_session = nullptr;
+        std::map<std::wstring, HINTERNET> async_connections;
+        std::map<RequestId, AsyncContext*> active;
+        HANDLE sweep_timer = nullptr;
+        std::atomic<RequestId> next_id{1};
+        std::atomic<int> open_requests{0};
+
+        std::unique_ptr<detail::HttpCache> cache;
+        std::unique_ptr<detail::CircuitBreaker> breaker;
+        int metrics_reporter = 0;
+
+        explicit Impl(const SessionOptions& options) : config(options), cache(make_cache(options)) {
+            session = open_session(0);
+        }
+
+        ~Impl();
+
+        HINTERNET open_session(DWORD flags) {
+            HINTERNET handle = WinHttpOpen(L"NetClient/1.0",
+                                           WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+                                           WINHTTP_NO_PROXY_NAME,
+                                           WINHTTP_NO_PROXY_BYPASS, flags);
+            if (handle) {
+                DWORD maxConns = (DWORD)config.max_connections_per_host;
+                WinHttpSetOption(handle, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &maxConns, sizeof(maxConns));
+                WinHttpSetOption(handle, WINHTTP_OPTION_MAX_CONNS_PER_1_0_SERVER, &maxConns, sizeof(maxConns));
+                int timeout = config.request_timeout_ms;
+                WinHttpSetTimeouts(handle, timeout, timeout, timeout, timeout);
+            }
+            return handle;
+        }
+
+        HINTERNET connect(const wchar_t* host, INTERNET_PORT port) {
+            std::wstring key = std::wstring(host) + L":" + std::to_wstring(port);
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = connections.find(key);
+            if (it != connections.end()) return it->second;
+
+            HINTERNET hConnect = WinHttpConnect(session, host, port, 0);
+            if (hConnect) connections.emplace(key, hConnect);
+            return hConnect;
+        }
+
+        HINTERNET connect_async(const wchar_t* host, INTERNET_PORT port);
+
+        // Removes ctx from the active set. Exactly one caller wins the
+        // right to complete it and close its handle.
+        bool claim(AsyncContext* ctx);
+        void complete(AsyncContext* ctx, const char* error);
+    };
+
+    // Lives from WinHttpSendRequest until WinHTTP reports the request
+    // handle closing.
+    struct AsyncContext {
+        Session::Impl* impl = nullptr;
+        RequestId id = 0;
+        HINTERNET request = nullptr;
+        Completion on_complete;
+        Response resp;
+        std::string data;
+        std::vector<char> buffer;
+        bool decode = false;
+        detail::ContentDecoder decoder;
+        ULONGLONG deadline = 0;
+        std::atomic<bool> finished{false};
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point first_byte;
+    };
+
+    // Length of the request or response header block as sent on the wire.
+    static uint64_t header_block_size(HINTERNET hRequest, DWORD flags) {
+        DWORD dwSize = 0;
+        WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF | flags,
+                            WINHTTP_HEADER_NAME_BY_INDEX, NULL, &dwSize, WINHTTP_NO_HEADER_INDEX);
+        return dwSize / sizeof(wchar_t);
+    }
+
+    // The response header block as UTF-8. WINHTTP_QUERY_FLAG_WIRE_ENCODING
+    // returns the bytes as they came off the wire; where the SDK or the
+    // system lacks it, WinHTTP's wide block is converted instead.
+    static bool read_raw_headers(HINTERNET hRequest, std::string& block) {
+        DWORD dwSize = 0;
+#ifdef WINHTTP_QUERY_FLAG_WIRE_ENCODING
+        WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF | WINHTTP_QUERY_FLAG_WIRE_ENCODING,
+                            WINHTTP_HEADER_NAME_BY_INDEX, NULL, &dwSize, WINHTTP_NO_HEADER_INDEX);
+        if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+            block.assign(dwSize, '\0');
+            if (WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF | WINHTTP_QUERY_FLAG_WIRE_ENCODING,
+                                    WINHTTP_HEADER_NAME_BY_INDEX, &block[0], &dwSize, WINHTTP_NO_HEADER_INDEX)) {
+                block.resize(dwSize);
+                return true;
+            }
+        }
+        dwSize = 0;
+#endif
+        WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF,
+                            WINHTTP_HEADER_NAME_BY_INDEX, NULL, &dwSize, WINHTTP_NO_HEADER_INDEX);
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) return false;
+        std::vector<wchar_t> wide(dwSize / sizeof(wchar_t));
+        if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF,
+                                 WINHTTP_HEADER_NAME_BY_INDEX, wide.data(), &dwSize, WINHTTP_NO_HEADER_INDEX)) {
+            return false;
+        }
+        int chars = (int)(dwSize / sizeof(wchar_t));
+        int len = WideCharToMultiByte(CP_UTF8, 0, wide.data(), chars, NULL, 0, NULL, NULL);
+        block.assign(len > 0 ? len : 0, '\0');
+        if (len > 0) WideCharToMultiByte(CP_UTF8, 0, wide.data(), chars, &block[0], len, NULL, NULL);
+        return true;
+    }
+
+    static void read_response_head(HINTERNET hRequest, Response& resp) {
+        DWORD dwStatusCode = 0;
+        DWORD dwSize = sizeof(dwStatusCode);
+        WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                            WINHTTP_HEADER_NAME_BY_INDEX, &dwStatusCode, &dwSize, WINHTTP_NO_HEADER_INDEX);
+        resp.status_code = (int)dwStatusCode;
+        resp.bytes_received += header_block_size(hRequest, 0);
+
+        std::string block;
+        if (read_raw_headers(hRequest, block)) {
+            // The first line is the status line.
+            size_t first = block.find('\n');
+            first = first == std::string::npos ? block.size() : first + 1;
+            resp.headers.parse(block.data() + first, block.size() - first);
+        }
+    }
+
+    // WinHTTP sets up connections internally; Windows 10 1709 and later
+    // report how long each step took, in 100 ns units. Elsewhere the steps
+    // stay 0 and their time is part of ttfb.
+    static void read_request_times(HINTERNET hRequest, Response& resp) {
+#ifdef WINHTTP_OPTION_REQUEST_TIMES
+        WINHTTP_REQUEST_TIMES times = {};
+        DWORD size = sizeof(times);
+        if (!WinHttpQueryOption(hRequest, WINHTTP_OPTION_REQUEST_TIMES, &times, &size)) return;
+        auto span = [&times](int start, int end) {
+            if ((ULONG)end >= times.cTimes || times.rgullTimes[start] == 0 ||
+                times.rgullTimes[end] < times.rgullTimes[start]) {
+                return 0.0;
+            }
+            return (double)(times.rgullTimes[end] - times.rgullTimes[start]) / 10000.0;
+        };
+        resp.timing.queued = span(WinHttpConnectionAcquireStart, WinHttpConnectionAcquireWaitEnd);
+        resp.timing.dns = span(WinHttpNameResolutionStart, WinHttpNameResolutionEnd);
+        resp.timing.connect = span(WinHttpConnectionEstablishmentStart, WinHttpConnectionEstablishmentEnd);
+        resp.timing.tls = span(WinHttpTlsHandshakeClientLeg1Start, WinHttpTlsHandshakeClientLeg3End);
+        resp.reused_connection = (ULONG)WinHttpConnectionEstablishmentStart < times.cTimes &&
+                                 times.rgullTimes[WinHttpConnectionEstablishmentStart] == 0;
+#else
+        (void)hRequest;
+        (void)resp;
+#endif
+    }
+
+    // Fills in resp's timing once its request has ended. started is when
+    // the request was sent; first_byte is unset when no response came.
+    static void finish_timing(HINTERNET hRequest, Response& resp, uint64_t body_size,
+                              std::chrono::steady_clock::time_point started,
+                              std::chrono::steady_clock::time_point first_byte) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        read_request_times(hRequest, resp);
+        Timing& timing = resp.timing;
+        timing.total = detail::elapsed_ms(started, now);
+        if (first_byte != std::chrono::steady_clock::time_point()) {
+            double setup = timing.queued + timing.dns + timing.connect + timing.tls;
+            timing.ttfb = std::max<double>(0.0, detail::elapsed_ms(started, first_byte) - setup);
+            timing.transfer = detail::elapsed_ms(first_byte, now);
+        }
+        resp.bytes_sent = header_block_size(hRequest, WINHTTP_QUERY_FLAG_REQUEST_HEADERS) + body_size;
+    }
+
+    static const char* describe_error(DWORD error) {
+        switch (error) {
+            case ERROR_WINHTTP_TIMEOUT: return "timeout";
+            case ERROR_WINHTTP_NAME_NOT_RESOLVED: return "name lookup failed";
+            case ERROR_WINHTTP_CANNOT_CONNECT: return "connect failed";
+            case ERROR_WINHTTP_OPERATION_CANCELLED: return "cancelled";
+            default: return "connection failed";
+        }
+    }
+
+    HINTERNET Session::Impl::connect_async(const wchar_t* host, INTERNET_PORT port) {
+        std::wstring key = std::wstring(host) + L":" + std::to_wstring(port);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = async_connections.find(key);
+        if (it != async_connections.end()) return it->second;
+
+        HINTERNET hConnect = WinHttpConnect(async_session, host, port, 0);
+        if (hConnect) async_connections.emplace(key, hConnect);
+        return hConnect;
+    }
+
+    bool Session::Impl::claim(AsyncContext* ctx) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ctx->finished.exchange(true)) return false;
+        active.erase(ctx->id);
+        return true;
+    }
+
+    // Delivers the response and closes the request; the context is freed
+    // once WinHTTP reports the handle closing. Failures deliver a fresh
+    // Response because a callback may still be filling ctx->resp.
+    void Session::Impl::complete(AsyncContext* ctx, const char* error) {
+        if (ctx->on_complete) {
+            if (error) {
+                Response failed;
+                failed.url = ctx->resp.url;
+                failed.status_code = 0;
+                failed.error = error;
+                finish_timing(ctx->request, failed, ctx->data.size(), ctx->started, {});
+                ctx->on_complete(std::move(failed));
+            } else {
+                finish_timing(ctx->request, ctx->resp, ctx->data.size(), ctx->started, ctx->first_byte);
+                ctx->on_complete(std::move(ctx->resp));
+            }
+        }
+        WinHttpCloseHandle(ctx->request);
+    }
+
+    static void CALLBACK async_callback(HINTERNET hInternet, DWORD_PTR context, DWORD status,
+                                        LPVOID info, DWORD length) {
+        AsyncContext* ctx = reinterpret_cast<AsyncContext*>(context);
+        if (!ctx) return;
+        Session::Impl* impl = ctx->impl;
+
+        if (status == WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING) {
+            delete ctx;
+            --impl->open_requests;
+            return;
+        }
+        if (ctx->finished.load()) return;
+
+        bool ok = true;
+        switch (status) {
+            case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE:
+                ok = WinHttpReceiveResponse(hInternet, NULL) != FALSE;
+                break;
+            case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE:
+                ctx->first_byte = std::chrono::steady_clock::now();
+                read_response_head(hInternet, ctx->resp);
+                ctx->decoder.start(ctx->resp, ctx->decode, impl->config.max_decompressed_bytes);
+                ok = WinHttpQueryDataAvailable(hInternet, NULL) != FALSE;
+                break;
+            case WINHTTP_CALLBACK_STATUS_DATA_AVAILABLE: {
+                DWORD available = *static_cast<DWORD*>(info);
+                if (available == 0) {
+                    if (impl->claim(ctx)) impl->complete(ctx, ctx->decoder.done() ? nullptr : "bad response");
+                    return;
+                }
+                ctx->buffer.resize(std::min<DWORD>(available, 64 * 1024));
+                ok = WinHttpReadData(hInternet, ctx->buffer.data(), (DWORD)ctx->buffer.size(), NULL) != FALSE;
+                break;
+            }
+            case WINHTTP_CALLBACK_STATUS_READ_COMPLETE: {
+                if (length == 0) {
+                    if (impl->claim(ctx)) impl->complete(ctx, ctx->decoder.done() ? nullptr : "bad response");
+                    return;
+                }
+                const char* data = static_cast<const char*>(info);
+                Response& resp = ctx->resp;
+                resp.bytes_received += length;
+                if (!ctx->decoder.active()) {
+                    resp.text.append(data, length);
+                } else if (!ctx->decoder.write(data, length, [&resp](const char* out, size_t n) {
+                               resp.text.append(out, n);
+                               return true;
+                           })) {
+                    const char* error = ctx->decoder.limit_exceeded() ? "response too large" : "bad response";
+                    if (impl->claim(ctx)) impl->complete(ctx, error);
+                    return;
+                }
+                ok = WinHttpQueryDataAvailable(hInternet, NULL) != FALSE;
+                break;
+            }
+            case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR: {
+                const WINHTTP_ASYNC_RESULT* result = static_cast<const WINHTTP_ASYNC_RESULT*>(info);
+                if (impl->claim(ctx)) impl->complete(ctx, describe_error(result->dwError));
+                return;
+            }
+            default:
+                return;
+        }
+        if (!ok && impl->claim(ctx)) impl->complete(ctx, describe_error(GetLastError()));
+    }
+
+    static void CALLBACK sweep_deadlines(PVOID param, BOOLEAN) {
+        Session::Impl* impl = static_cast<Session::Impl*>(param);
+        ULONGLONG now = GetTickCount64();
+
+        std::vector<AsyncContext*> expired;
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            for (auto it = impl->active.begin(); it != impl->active.end();) {
+                AsyncContext* ctx = it->second;
+                if (ctx->deadline <= now && !ctx->finished.exchange(true)) {
+                    expired.push_back(ctx);
+                    it = impl->active.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (AsyncContext* ctx : expired) impl->complete(ctx, "timeout");
+    }
+
+    Session::Impl::~Impl() {
+        if (sweep_timer) DeleteTimerQueueTimer(NULL, sweep_timer, INVALID_HANDLE_VALUE);
+
+        std::vector<AsyncContext*> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& entry : active) {
+                if (!entry.second->finished.exchange(true)) pending.push_back(entry.second);
+            }
+            active.clear();
+        }
+        for (AsyncContext* ctx : pending) complete(ctx, "cancelled");
+
+        // Contexts point back here until WinHTTP has closed their handles.
+        while (open_requests.load() > 0) Sleep(1);
+
+        for (auto& entry : async_connections) WinHttpCloseHandle(entry.second);
+        if (async_session) WinHttpCloseHandle(async_session);
+        for (auto& entry : connections) WinHttpCloseHandle(entry.second);
+        if (session) WinHttpCloseHandle(session);
+    }
+
+    static RequestId send_async_request(Session::Impl& impl,
+                                        const std::string& method,
+                                        const std::string& url,
+                                        const std::string& data,
+                                        const std::map<std::string, std::string>& headers,
+                                        Completion on_complete,
+                                        int timeout_ms) {
+        RequestId id = impl.next_id.fetch_add(1);
+        int timeout = timeout_ms > 0 ? timeout_ms : impl.config.request_timeout_ms;
+
+        auto fail_now = [&](const char* error) {
+            Response resp;
+            resp.url = url;
+            resp.status_code = 0;
+            resp.error = error;
+            if (on_complete) on_complete(std::move(resp));
+            return id;
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            if (!impl.async_session) {
+                impl.async_session = impl.open_session(WINHTTP_FLAG_ASYNC);
+                if (impl.async_session) {
+                    WinHttpSetStatusCallback(impl.async_session, async_callback,
+                                             WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_HANDLES, 0);
+                    CreateTimerQueueTimer(&impl.sweep_timer, NULL, sweep_deadlines, &impl,
+                                          100, 100, WT_EXECUTEDEFAULT);
+                }
+            }
+        }
+        if (!impl.async_session) return fail_now("connection failed");
+
+        URL_COMPONENTS urlComp = {0};
+        urlComp.dwStructSize = sizeof(urlComp);
+        urlComp.dwHostNameLength = (DWORD)-1;
+        urlComp.dwUrlPathLength = (DWORD)-1;
+        urlComp.dwExtraInfoLength = (DWORD)-1;
+
+        wchar_t wUrl[2048];
+        MultiByteToWideChar(CP_UTF8, 0, url.c_str(), -1, wUrl, 2048);
+        if (!WinHttpCrackUrl(wUrl, (DWORD)wcslen(wUrl), 0, &urlComp)) return fail_now("unsupported url");
+
+        wchar_t szHost[256];
+        wcsncpy_s(szHost, urlComp.lpszHostName, urlComp.dwHostNameLength);
+        szHost[urlComp.dwHostNameLength] = L'\0';
+
+        HINTERNET hConnect = impl.connect_async(szHost, urlComp.nPort);
+        if (!hConnect) return fail_now("connect failed");
+
+        std::wstring wMethod(method.begin(), method.end());
+        DWORD dwFlags = (urlComp.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0;
+        HINTERNET hRequest = WinHttpOpenRequest(hConnect, wMethod.c_str(), urlComp.lpszUrlPath,
+                                                NULL, WINHTTP_NO_REFERER,
+                                                WINHTTP_DEFAULT_ACCEPT_TYPES, dwFlags);
+        if (!hRequest) return fail_now("connection failed");
+
+        WinHttpSetTimeouts(hRequest, timeout, timeout, timeout, timeout);
+        for (const auto& head : headers) {
+            std::wstring wHeader = std::wstring(head.first.begin(), head.first.end()) + L": " +
+                                   std::wstring(head.second.begin(), head.second.end());
+            WinHttpAddRequestHeaders(hRequest, wHeader.c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
+        }
+        bool decode = detail::decode_requested(impl.config, headers);
+        if (decode) {
+            WinHttpAddRequestHeaders(hRequest, L"Accept-Encoding: gzip, deflate", (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
+        }
+
+        AsyncContext* ctx = new AsyncContext();
+        ctx->impl = &impl;
+        ctx->id = id;
+        ctx->request = hRequest;
+        ctx->on_complete = std::move(on_complete);
+        ctx->resp.url = url;
+        ctx->resp.status_code = 0;
+        ctx->data = data;
+        ctx->decode = decode;
+        ctx->deadline = GetTickCount64() + (ULONGLONG)timeout;
+        // Set before sending so even a failed send reports the handle
+        // closing against this context.
+        DWORD_PTR contextValue = (DWORD_PTR)ctx;
+        WinHttpSetOption(hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &contextValue, sizeof(contextValue));
+        ++impl.open_requests;
+        {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            impl.active.emplace(id, ctx);
+        }
+
+        // The request body must stay valid until the send completes, so it
+        // is sent from the context's own copy.
+        ctx->started = std::chrono::steady_clock::now();
+        DWORD dwDataSize = (DWORD)ctx->data.size();
+        LPVOID lpOptional = dwDataSize > 0 ? (LPVOID)ctx->data.data() : WINHTTP_NO_REQUEST_DATA;
+        if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                                lpOptional, dwDataSize, dwDataSize, (DWORD_PTR)ctx)) {
+            DWORD error = GetLastError();
+            if (impl.claim(ctx)) impl.complete(ctx, describe_error(error));
+        }
+        return id;
+    }
+
+    static void describe_connections(Session::Impl& impl, std::string& out) {
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        out += "    connections managed by WinHTTP; " + std::to_string(impl.active.size()) +
+               " asynchronous requests in flight\n";
+    }
+
+    static void cancel_async_request(Session::Impl& impl, RequestId id) {
+        AsyncContext* ctx = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            auto it = impl.active.find(id);
+            if (it == impl.active.end() || it->second->finished.exchange(true)) return;
+            ctx = it->second;
+            impl.active.erase(it);
+        }
+        impl.complete(ctx, "cancelled");
+    }
+
+    // Sends the request with a RequestBody, written through WinHttpWriteData
+    // as it is read. WinHTTP leaves chunked framing to the caller, so a body
+    // of unknown size is framed here. error is set when the body rather than
+    // the connection failed.
+    static bool send_request_body(HINTERNET hRequest, const RequestBody& body, uint64_t& sent, std::string& error) {
+        uint64_t size = body.size();
+        bool chunked = size == RequestBody::kUnknownSize;
+        // Given as a header, the length may pass the 4 GB a DWORD holds.
+        std::wstring framing = chunked ? L"Transfer-Encoding: chunked" : L"Content-Length: " + std::to_wstring(size);
+        WinHttpAddRequestHeaders(hRequest, framing.c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+        if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0,
+                                WINHTTP_IGNORE_REQUEST_TOTAL_LENGTH, 0)) {
+            return false;
+        }
+
+        auto write = [&](const char* data, size_t len) {
+            while (len > 0) {
+                DWORD written = 0;
+                if (!WinHttpWriteData(hRequest, data, (DWORD)std::min<size_t>(len, 1u << 30), &written)) return false;
+                data += written;
+                len -= written;
+                sent += written;
+            }
+            return true;
+        };
+        auto piece = [&](const char* data, size_t len) {
+            if (len == 0) return true;
+            if (!chunked) return write(data, len);
+            char line[24];
+            int n = std::snprintf(line, sizeof(line), "%llx\r\n", (unsigned long long)len);
+            return write(line, (size_t)n) && write(data, len) && write("\r\n", 2);
+        };
+        auto fail = [&](const char* why) {
+            error = why;
+            return false;
+        };
+
+        std::vector<char> buffer(64 * 1024);
+        for (const RequestBody::Part& part : body.parts()) {
+            if (part.kind == RequestBody::Part::Kind::Bytes) {
+                if (!piece(part.data.data(), part.data.size())) return false;
+            } else if (part.kind == RequestBody::Part::Kind::File) {
+                detail::PartialFile file;
+                if (!file.open_existing(part.data)) return fail("body read failed");
+                for (uint64_t offset = 0; offset < part.size;) {
+                    size_t want = (size_t)std::min<uint64_t>(part.size - offset, buffer.size());
+                    size_t got = 0;
+                    if (!file.read_at(offset, buffer.data(), want, got) || got == 0) return fail("body read failed");
+                    if (!piece(buffer.data(), got)) return false;
+                    offset += got;
+                }
+            } else {
+                bool sized = part.size != RequestBody::kUnknownSize;
+                uint64_t left = part.size;
+                while (!sized || left > 0) {
+                    size_t want = sized ? (size_t)std::min<uint64_t>(left, buffer.size()) : buffer.size();
+                    long long n = part.reader(buffer.data(), want);
+                    if (n < 0) return fail("aborted");
+                    if (n == 0) {
+                        if (sized) return fail("body read failed");
+                        break;
+                    }
+                    if ((uint64_t)n > want) return fail("body read failed");
+                    if (!piece(buffer.data(), (size_t)n)) return false;
+                    left -= (uint64_t)n;
+                }
+            }
+        }
+        return (!chunked || write("0\r\n\r\n", 5)) && WinHttpReceiveResponse(hRequest, NULL);
+    }
+
+    static Response internal_request(Session::Impl& impl,
+                                     const std::string& method,
                                      const std::string& url,
                                      const std::string& data,
-                                     const std::map<std::string, std::string>& headers) {
+                                     const std::map<std::string, std::string>& headers,
+                                     const BodySink* sink,
+                                     int timeout_ms,
+                                     const RequestBody* body) {
 
         Response resp;
         resp.url = url;
         resp.status_code = 0;
 
-        HINTERNET hSession = WinHttpOpen(L"NetClient/1.0",
-                                         WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-                                         WINHTTP_NO_PROXY_NAME,
-                                         WINHTTP_NO_PROXY_BYPASS, 0);
+        HINTERNET hSession = impl.session;
 
         if (hSession) {
             URL_COMPONENTS urlComp = {0};
@@ -68,7 +616,7 @@ namespace NetClient {
                 wcsncpy_s(szHost, urlComp.lpszHostName, urlComp.dwHostNameLength);
                 szHost[urlComp.dwHostNameLength] = L'\0';
 
-                HINTERNET hConnect = WinHttpConnect(hSession, szHost, urlComp.nPort, 0);
+                HINTERNET hConnect = impl.connect(szHost, urlComp.nPort);
                 if (hConnect) {
                     std::wstring wMethod(method.begin(), method.end());
                     DWORD dwFlags = (urlComp.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0;
@@ -78,83 +626,748 @@ namespace NetClient {
                                                             WINHTTP_DEFAULT_ACCEPT_TYPES, dwFlags);
 
                     if (hRequest) {
+                        if (timeout_ms > 0) WinHttpSetTimeouts(hRequest, timeout_ms, timeout_ms, timeout_ms, timeout_ms);
+
                         // Add headers
                         for (const auto& head : headers) {
                             std::wstring wHeader = std::wstring(head.first.begin(), head.first.end()) + L": " +
                                                    std::wstring(head.second.begin(), head.second.end());
                             WinHttpAddRequestHeaders(hRequest, wHeader.c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
                         }
+                        bool decode = detail::decode_requested(impl.config, headers);
+                        if (decode) {
+                            WinHttpAddRequestHeaders(hRequest, L"Accept-Encoding: gzip, deflate", (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
+                        }
+
+                        if (body && !body->content_type.empty() && !detail::has_header(headers, "Content-Type")) {
+                            std::wstring wType = L"Content-Type: " +
+                                                 std::wstring(body->content_type.begin(), body->content_type.end());
+                            WinHttpAddRequestHeaders(hRequest, wType.c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
+                        }
 
                         DWORD dwDataSize = (DWORD)data.size();
                         LPVOID lpOptional = dwDataSize > 0 ? (LPVOID)data.c_str() : WINHTTP_NO_REQUEST_DATA;
+                        uint64_t body_sent = data.size();
+                        std::string body_error;
+                        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+                        std::chrono::steady_clock::time_point first_byte;
 
-                        if (WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-                                               lpOptional, dwDataSize, dwDataSize, 0)) {
+                        bool sent;
+                        if (body) {
+                            body_sent = 0;
+                            sent = send_request_body(hRequest, *body, body_sent, body_error);
+                        } else {
+                            sent = WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                                                      lpOptional, dwDataSize, dwDataSize, 0) &&
+                                   WinHttpReceiveResponse(hRequest, NULL);
+                        }
+                        if (sent) {
+                            first_byte = std::chrono::steady_clock::now();
+                            read_response_head(hRequest, resp);
 
-                            if (WinHttpReceiveResponse(hRequest, NULL)) {
-                                // Status Code
-                                DWORD dwStatusCode = 0;
-                                DWORD dwSize = sizeof(dwStatusCode);
-                                WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
-                                                    WINHTTP_HEADER_NAME_BY_INDEX, &dwStatusCode, &dwSize, WINHTTP_NO_HEADER_INDEX);
-                                resp.status_code = (int)dwStatusCode;
+                            detail::ContentDecoder decoder;
+                            decoder.start(resp, decode, impl.config.max_decompressed_bytes);
+                            bool aborted = false;
+                            auto deliver = [&](const char* data, size_t len) {
+                                if (!sink) {
+                                    resp.text.append(data, len);
+                                    return true;
+                                }
+                                if ((*sink)(resp, data, len)) return true;
+                                aborted = true;
+                                return false;
+                            };
 
-                                // Headers
+                            // Body, read through one buffer reused for every chunk
+                            std::vector<char> buffer(64 * 1024);
+                            DWORD dwDownloaded = 0;
+                            DWORD dwSize = 0;
+                            bool complete = false;
+                            do {
                                 dwSize = 0;
-                                WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF,
-                                                    WINHTTP_HEADER_NAME_BY_INDEX, NULL, &dwSize, WINHTTP_NO_HEADER_INDEX);
-                                if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-                                    wchar_t* lpHeaders = new wchar_t[dwSize / sizeof(wchar_t)];
-                                    if (WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF,
-                                                            WINHTTP_HEADER_NAME_BY_INDEX, lpHeaders, &dwSize, WINHTTP_NO_HEADER_INDEX)) {
-                                        std::wstring wAllHeaders(lpHeaders);
-                                        std::wstringstream ss(wAllHeaders);
-                                        std::wstring line;
-                                        while (std::getline(ss, line) && line != L"\r") {
-                                            size_t pos = line.find(L":");
-                                            if (pos != std::string::npos) {
-                                                std::wstring key = line.substr(0, pos);
-                                                std::wstring val = line.substr(pos + 1);
-                                                // Basic trim and convert to std::string
-                                                std::string sKey(key.begin(), key.end());
-                                                std::string sVal(val.begin(), val.end());
-                                                resp.headers[sKey] = sVal;
-                                            }
-                                        }
-                                    }
-                                    delete[] lpHeaders;
+                                if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) break;
+                                if (dwSize == 0) {
+                                    complete = true;
+                                    break;
                                 }
 
-                                // Body
-                                DWORD dwDownloaded = 0;
-                                do {
-                                    dwSize = 0;
-                                    if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) break;
-                                    if (dwSize == 0) break;
-
-                                    char* pszOutBuffer = new char[dwSize + 1];
-                                    if (WinHttpReadData(hRequest, (LPVOID)pszOutBuffer, dwSize, &dwDownloaded)) {
-                                        pszOutBuffer[dwDownloaded] = '\0';
-                                        resp.text.append(pszOutBuffer, dwDownloaded);
-                                    }
-                                    delete[] pszOutBuffer;
-                                } while (dwSize > 0);
+                                DWORD dwRead = std::min<DWORD>(dwSize, (DWORD)buffer.size());
+                                if (!WinHttpReadData(hRequest, buffer.data(), dwRead, &dwDownloaded)) break;
+                                resp.bytes_received += dwDownloaded;
+                                bool ok = decoder.active() ? decoder.write(buffer.data(), dwDownloaded, deliver)
+                                                           : deliver(buffer.data(), dwDownloaded);
+                                if (!ok) {
+                                    resp.status_code = 0;
+                                    resp.error = aborted ? "aborted"
+                                               : decoder.limit_exceeded() ? "response too large" : "bad response";
+                                    break;
+                                }
+                            } while (dwSize > 0);
+
+                            if (complete && !decoder.done()) {
+                                resp.status_code = 0;
+                                resp.error = "bad response";
                             }
                         }
+                        if (!body_error.empty()) resp.error = body_error;
+                        if (resp.status_code == 0 && resp.error.empty()) resp.error = describe_error(GetLastError());
+                        finish_timing(hRequest, resp, body_sent, started, first_byte);
                         WinHttpCloseHandle(hRequest);
                     }
-                    WinHttpCloseHandle(hConnect);
                 }
             }
-            WinHttpCloseHandle(hSession);
         }
 
+        if (resp.status_code == 0 && resp.error.empty()) resp.error = "connection failed";
         return resp;
     }
 
-    Response get(const std::string& url,
-                 const std::map<std::string, std::string>& params,
-                 const std::map<std::string, std::string>& headers) {
+    // WinHTTP writes one request per connection at a time, so batches take
+    // the pooled path.
+    static void pipeline_requests(Session::Impl&, const std::vector<BatchRequest>&,
+                                  std::vector<Response>&, std::vector<char>&) {}
+#else
+    struct Session::Impl {
+        SessionOptions config;
+        detail::ConnectionPool pool;
+
+        // Started by the first asynchronous request; declared after the pool
+        // so it stops before the pool closes its sockets.
+        std::mutex loop_mutex;
+        std::unique_ptr<detail::EventLoop> loop;
+
+        std::unique_ptr<detail::HttpCache> cache;
+        std::unique_ptr<detail::CircuitBreaker> breaker;
+        int metrics_reporter = 0;
+
+        // Hosts that left pipelined requests unanswered; batches to them
+        // take the pooled path.
+        std::mutex pipeline_mutex;
+        std::set<std::string> no_pipelining;
+
+        explicit Impl(const SessionOptions& options) : config(options), pool(options), cache(make_cache(options)) {}
+
+        detail::EventLoop& event_loop() {
+            std::lock_guard<std::mutex> lock(loop_mutex);
+            if (!loop) loop.reset(new detail::EventLoop(pool, config));
+            return *loop;
+        }
+    };
+
+    static Response internal_request(Session::Impl& impl,
+                                     const std::string& method,
+                                     const std::string& url,
+                                     const std::string& data,
+                                     const std::map<std::string, std::string>& headers,
+                                     const BodySink* sink,
+                                     int timeout_ms,
+                                     const RequestBody* body) {
+        return detail::posix_request(impl.pool, impl.config, method, url, data, headers, sink, timeout_ms, body);
+    }
+
+    static RequestId send_async_request(Session::Impl& impl,
+                                        const std::string& method,
+                                        const std::string& url,
+                                        const std::string& data,
+                                        const std::map<std::string, std::string>& headers,
+                                        Completion on_complete,
+                                        int timeout_ms) {
+        return impl.event_loop().submit(method, url, data, headers, std::move(on_complete), timeout_ms);
+    }
+
+    static void cancel_async_request(Session::Impl& impl, RequestId id) {
+        std::lock_guard<std::mutex> lock(impl.loop_mutex);
+        if (impl.loop) impl.loop->cancel(id);
+    }
+
+    static void describe_connections(Session::Impl& impl, std::string& out) {
+        impl.pool.describe(out);
+    }
+
+    // Deep enough to hide the round trip on most links, shallow enough that
+    // a server closing early leaves little to send again.
+    static const size_t kPipelineDepth = 32;
+
+    // Pipelines the GET and HEAD requests of a batch, one connection per
+    // host and all hosts at once, and marks the requests answered.
+    static void pipeline_requests(Session::Impl& impl, const std::vector<BatchRequest>& requests,
+                                  std::vector<Response>& responses, std::vector<char>& answered) {
+        struct Group {
+            std::vector<size_t> indices;
+            std::vector<const BatchRequest*> requests;
+            std::vector<Response> responses;
+            size_t answered = 0;
+        };
+        std::map<std::string, Group> groups;
+        {
+            std::lock_guard<std::mutex> lock(impl.pipeline_mutex);
+            for (size_t i = 0; i < requests.size(); ++i) {
+                const BatchRequest& request = requests[i];
+                detail::Url parsed;
+                if ((request.method != "GET" && request.method != "HEAD") || !detail::parse_url(request.url, parsed) ||
+                    parsed.secure) {
+                    continue;
+                }
+                std::string host = parsed.host + ":" + std::to_string(parsed.port);
+                if (impl.no_pipelining.count(host)) continue;
+                groups[host].indices.push_back(i);
+                groups[host].requests.push_back(&request);
+            }
+        }
+
+        std::vector<std::thread> workers;
+        for (auto& entry : groups) {
+            Group& group = entry.second;
+            if (group.requests.size() < 2) continue;    // nothing to gain
+            workers.emplace_back([&impl, &group] {
+                group.answered = detail::posix_pipeline(impl.pool, impl.config, group.requests, group.responses,
+                                                        kPipelineDepth);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        for (auto& entry : groups) {
+            Group& group = entry.second;
+            if (group.requests.size() < 2) continue;
+            for (size_t i = 0; i < group.answered; ++i) {
+                detail::MetricsRegistry::instance().record(group.responses[i]);
+                responses[group.indices[i]] = std::move(group.responses[i]);
+                answered[group.indices[i]] = 1;
+            }
+            // A connection that failed before any answer says nothing about
+            // pipelining; one that failed after some does.
+            if (group.answered > 0 && group.answered < group.requests.size()) {
+                std::lock_guard<std::mutex> lock(impl.pipeline_mutex);
+                impl.no_pipelining.insert(entry.first);
+            }
+        }
+    }
+#endif
+
+    // Every request that reaches the network passes through here, so the
+    // metrics registry sees each exactly once.
+    static Response measured_request(Session::Impl& impl,
+                                     const std::string& method,
+                                     const std::string& url,
+                                     const std::string& data,
+                                     const std::map<std::string, std::string>& headers,
+                                     const BodySink* sink,
+                                     int timeout_ms = 0,
+                                     const RequestBody* body = nullptr) {
+        Response resp = internal_request(impl, method, url, data, headers, sink, timeout_ms, body);
+        detail::MetricsRegistry::instance().record(resp);
+        return resp;
+    }
+
+    // Sends a GET and, if it is still unanswered after hedge_after_ms, a
+    // second copy through the asynchronous path. The first usable response
+    // wins; a failed copy waits for the other.
+    static Response hedged_request(Session::Impl& impl,
+                                   const std::string& url,
+                                   const std::map<std::string, std::string>& headers,
+                                   int timeout_ms) {
+        const RetryPolicy& policy = impl.config.retry;
+        struct Race {
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::vector<Response> results;
+        };
+        std::shared_ptr<Race> race = std::make_shared<Race>();
+        auto usable = [&policy](const Response& resp) {
+            return resp.status_code != 0 && !detail::should_retry(policy, "GET", resp);
+        };
+        Completion on_complete = [race](Response resp) {
+            // The loser is cancelled by us, which says nothing about the host.
+            if (resp.error != "cancelled") detail::MetricsRegistry::instance().record(resp);
+            std::lock_guard<std::mutex> lock(race->mutex);
+            race->results.push_back(std::move(resp));
+            race->finished.notify_all();
+        };
+
+        RequestId ids[2] = {send_async_request(impl, "GET", url, "", headers, on_complete, timeout_ms), 0};
+        size_t sent = 1;
+
+        std::unique_lock<std::mutex> lock(race->mutex);
+        race->finished.wait_for(lock, std::chrono::milliseconds(policy.hedge_after_ms),
+                                [&] { return !race->results.empty(); });
+        if (race->results.empty()) {
+            lock.unlock();
+            // The copy ends when the original would, not hedge_after_ms later.
+            int left_ms = std::max<int>(1, timeout_ms - policy.hedge_after_ms);
+            ids[1] = send_async_request(impl, "GET", url, "", headers, on_complete, left_ms);
+            sent = 2;
+            lock.lock();
+        }
+        race->finished.wait(lock, [&] {
+            for (const Response& resp : race->results) {
+                if (usable(resp)) return true;
+            }
+            return race->results.size() == sent;
+        });
+
+        size_t winner = race->results.size() - 1;
+        for (size_t i = 0; i < race->results.size(); ++i) {
+            if (usable(race->results[i])) {
+                winner = i;
+                break;
+            }
+        }
+        Response resp = std::move(race->results[winner]);
+        lock.unlock();
+
+        for (size_t i = 0; i < sent; ++i) cancel_async_request(impl, ids[i]);
+        return resp;
+    }
+
+    // Applies SessionOptions::retry: the circuit breaker, hedging, and
+    // retries with backoff within the overall deadline.
+    static Response policy_request(Session::Impl& impl,
+                                   const std::string& method,
+                                   const std::string& url,
+                                   const std::string& data,
+                                   const std::map<std::string, std::string>& headers) {
+        const RetryPolicy& policy = impl.config.retry;
+        bool hedge = policy.hedge_after_ms > 0 && method == "GET";
+        if (policy.max_attempts <= 1 && !impl.breaker && !hedge) {
+            return measured_request(impl, method, url, data, headers, nullptr);
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point deadline = Clock::time_point::max();
+        if (policy.deadline_ms > 0) deadline = Clock::now() + std::chrono::milliseconds(policy.deadline_ms);
+
+        Response resp;
+        resp.url = url;
+        resp.status_code = 0;
+        resp.error = "timeout";
+        for (int attempt = 1;; ++attempt) {
+            if (impl.breaker && !impl.breaker->allow(url)) {
+                resp = Response();
+                resp.url = url;
+                resp.status_code = 0;
+                resp.error = "circuit open";
+                break;
+            }
+
+            // Each attempt gets what is left of the deadline at most.
+            int timeout_ms = impl.config.request_timeout_ms;
+            if (deadline != Clock::time_point::max()) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                if (left <= 0) break;
+                timeout_ms = (int)std::min<long long>(timeout_ms, left);
+            }
+
+            resp = hedge ? hedged_request(impl, url, headers, timeout_ms)
+                         : measured_request(impl, method, url, data, headers, nullptr, timeout_ms);
+            if (impl.breaker) impl.breaker->record(url, detail::counts_as_failure(resp));
+
+            if (attempt >= policy.max_attempts || !detail::should_retry(policy, method, resp)) break;
+            int delay_ms = detail::backoff_delay_ms(policy, attempt, resp);
+            if (delay_ms < 0 || Clock::now() + std::chrono::milliseconds(delay_ms) >= deadline) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        }
+        return resp;
+    }
+
+    // Requests carrying credentials, ranges or their own validators bypass
+    // the cache, as does Cache-Control: no-store.
+    static bool cacheable_request(const std::string& method, const std::map<std::string, std::string>& headers) {
+        if (method != "GET") return false;
+        if (detail::has_header(headers, "Authorization") || detail::has_header(headers, "Range") ||
+            detail::has_header(headers, "If-None-Match") || detail::has_header(headers, "If-Modified-Since")) {
+            return false;
+        }
+        return detail::header_value(headers, "Cache-Control").find("no-store") == std::string::npos;
+    }
+
+    static Response from_cache(const detail::CachedResponse& entry, const std::string& url) {
+        Response resp;
+        resp.status_code = entry.status_code;
+        resp.url = url;
+        resp.headers = entry.headers;
+        resp.text = Body(entry.body);
+        return resp;
+    }
+
+    static Response cached_request(Session::Impl& impl,
+                                   const std::string& url,
+                                   const std::map<std::string, std::string>& headers) {
+        detail::HttpCache& cache = *impl.cache;
+
+        // Vary is matched against the headers as sent, including the
+        // Accept-Encoding added for transparent decoding.
+        std::map<std::string, std::string> sent = headers;
+        if (detail::decode_requested(impl.config, headers)) sent["Accept-Encoding"] = "gzip, deflate";
+
+        detail::CacheEntry entry = cache.lookup(url, sent);
+        bool revalidate = detail::header_value(headers, "Cache-Control").find("no-cache") != std::string::npos;
+        if (entry && !revalidate && detail::HttpCache::is_fresh(*entry, detail::HttpCache::now())) {
+            detail::MetricsRegistry::instance().record_cache_hit(url);
+            return from_cache(*entry, url);
+        }
+
+        std::map<std::string, std::string> conditional = headers;
+        if (entry) {
+            std::string etag = detail::header_value(entry->headers, "ETag");
+            std::string last_modified = detail::header_value(entry->headers, "Last-Modified");
+            if (!etag.empty()) conditional["If-None-Match"] = etag;
+            if (!last_modified.empty()) conditional["If-Modified-Since"] = last_modified;
+        }
+
+        Response resp = policy_request(impl, "GET", url, "", conditional);
+        if (entry && resp.status_code == 304) {
+            Response served = from_cache(*cache.refresh(entry, resp), url);
+            served.timing = resp.timing;
+            served.bytes_sent = resp.bytes_sent;
+            served.bytes_received = resp.bytes_received;
+            served.reused_connection = resp.reused_connection;
+            return served;
+        }
+        // A replacement that may not be kept drops the old entry; server
+        // errors and failed connections leave it for the next attempt.
+        bool stored = resp.status_code == 200 && cache.store(url, sent, resp);
+        if (entry && !stored && resp.status_code != 0 && resp.status_code < 500) cache.remove(url);
+        return resp;
+    }
+
+    Session::Session(const SessionOptions& config) : impl_(new Impl(config)) {
+        const RetryPolicy& policy = config.retry;
+        if (policy.breaker_threshold > 0) {
+            impl_->breaker.reset(new detail::CircuitBreaker(policy.breaker_threshold, policy.breaker_cooldown_ms));
+        }
+        Impl* impl = impl_;
+        impl_->metrics_reporter = detail::MetricsRegistry::instance().add_reporter(
+            [impl](std::string& out) { describe_connections(*impl, out); });
+    }
+
+    Session::~Session() {
+        detail::MetricsRegistry::instance().remove_reporter(impl_->metrics_reporter);
+        delete impl_;
+    }
+
+    Response Session::request(const std::string& method,
+                              const std::string& url,
+                              const std::string& data,
+                              const std::map<std::string, std::string>& headers) {
+        if (impl_->cache && cacheable_request(method, headers)) {
+            return cached_request(*impl_, url, headers);
+        }
+        return policy_request(*impl_, method, url, data, headers);
+    }
+
+    Response Session::request_stream(const std::string& method,
+                                     const std::string& url,
+                                     const std::string& data,
+                                     const std::map<std::string, std::string>& headers,
+                                     const BodySink& sink) {
+        return measured_request(*impl_, method, url, data, headers, &sink);
+    }
+
+    Response Session::upload(const std::string& method,
+                             const std::string& url,
+                             const RequestBody& body,
+                             const std::map<std::string, std::string>& headers) {
+        return measured_request(*impl_, method, url, "", headers, nullptr, 0, &body);
+    }
+
+    // Content-Range is "bytes <first>-<last>/<total>"; total may be "*".
+    static bool parse_content_range(const std::string& value, uint64_t& first, uint64_t& total) {
+        size_t space = value.find(' ');
+        size_t slash = value.rfind('/');
+        if (space == std::string::npos || slash == std::string::npos) return false;
+        first = std::strtoull(value.c_str() + space + 1, nullptr, 10);
+        total = std::strtoull(value.c_str() + slash + 1, nullptr, 10);
+        return true;
+    }
+
+    DownloadResult Session::download(const std::string& url,
+                                     const std::string& path,
+                                     const DownloadOptions& options) {
+        DownloadResult result;
+        result.response.url = url;
+        result.response.status_code = 0;
+
+        std::string part_path = path + ".part";
+        detail::PartialFile file;
+        if (!file.open(part_path, !options.resume)) {
+            result.response.error = "cannot open file";
+            return result;
+        }
+
+        // Bytes left by an earlier attempt are hashed before new ones arrive.
+        detail::Sha256 sha;
+        if (file.size() > 0 && !file.read_all([&](const char* data, size_t len) { sha.update(data, len); })) {
+            sha.reset();
+            if (!file.truncate()) {
+                result.response.error = "cannot open file";
+                return result;
+            }
+        }
+        result.resumed = file.size() > 0;
+
+        auto restart = [&]() {
+            sha.reset();
+            result.resumed = false;
+            return file.truncate();
+        };
+
+        Response resp;
+        int attempts = std::max<int>(1, options.max_attempts);
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            uint64_t offset = file.size();
+            std::map<std::string, std::string> headers = options.headers;
+            // Ranges count bytes of the encoded body, so a resumable
+            // download must receive the file exactly as stored.
+            if (!detail::has_header(headers, "Accept-Encoding")) headers["Accept-Encoding"] = "identity";
+            if (offset > 0) headers["Range"] = "bytes=" + std::to_string(offset) + "-";
+
+            bool writing = false;
+            bool bad_range = false;
+            bool write_failed = false;
+            bool stopped = false;
+            uint64_t received = 0, announced = 0;
+            BodySink sink = [&](const Response& head, const char* data, size_t len) {
+                if (!writing) {
+                    uint64_t first = 0, total = 0;
+                    if (head.status_code == 206) {
+                        if (!parse_content_range(head.header("Content-Range"), first, total) || first != file.size()) {
+                            bad_range = true;
+                            return false;
+                        }
+                        file.preallocate(total);
+                        announced = total - first;
+                    } else if (head.status_code == 200) {
+                        // The server ignored the Range and sent everything.
+                        if (file.size() > 0 && !restart()) {
+                            write_failed = true;
+                            return false;
+                        }
+                        announced = std::strtoull(head.header("Content-Length").c_str(), nullptr, 10);
+                        file.preallocate(announced);
+                    } else {
+                        return true;    // error pages are not written to the file
+                    }
+                    writing = true;
+                }
+                if (!file.write(data, len)) {
+                    write_failed = true;
+                    return false;
+                }
+                sha.update(data, len);
+                received += len;
+                if (options.on_progress && !options.on_progress(received, announced)) {
+                    stopped = true;
+                    return false;
+                }
+                return true;
+            };
+
+            resp = request_stream("GET", url, "", headers, sink);
+
+            if (write_failed) {
+                resp.status_code = 0;
+                resp.error = "write failed";
+                break;
+            }
+            if (stopped) {
+                resp.status_code = 0;
+                resp.error = "aborted";
+                break;
+            }
+            // A part that no longer matches the file on the server is
+            // dropped and the download starts over.
+            if (bad_range || (resp.status_code == 416 && offset > 0)) {
+                if (!restart()) break;
+                continue;
+            }
+            if (resp.status_code == 200 && !writing && file.size() > 0 && !restart()) break;
+
+            // Only an interrupted transfer that made progress is resumed.
+            if (resp.status_code != 0 || file.size() == offset) break;
+        }
+
+        result.response = std::move(resp);
+        result.size = file.size();
+        if (!result.response.ok() || !result.response.error.empty()) {
+            // The part stays behind so a later call can resume it.
+            return result;
+        }
+
+        result.sha256 = sha.finish_hex();
+        file.close();
+
+        std::string expected = options.expected_sha256;
+        std::transform(expected.begin(), expected.end(), expected.begin(), ::tolower);
+        if (!expected.empty() && expected != result.sha256) {
+            detail::PartialFile::remove(part_path);
+            result.response.error = "hash mismatch";
+            return result;
+        }
+        if (!detail::PartialFile::commit(part_path, path)) {
+            result.response.error = "rename failed";
+        }
+        return result;
+    }
+
+    DownloadResult Session::download_delta(const std::string& url,
+                                           const std::string& base_path,
+                                           const std::string& path,
+                                           const DownloadOptions& options) {
+        DownloadResult result;
+        result.response.url = url;
+        result.response.status_code = 0;
+
+        detail::PartialFile base;
+        detail::Sha256 base_sha;
+        if (!base.open_existing(base_path) ||
+            !base.read_all([&](const char* data, size_t len) { base_sha.update(data, len); })) {
+            result.response.error = "cannot open base";
+            return result;
+        }
+        std::string base_hash = base_sha.finish_hex();
+
+        std::string part_path = path + ".part";
+        detail::PartialFile file;
+        if (!file.open(part_path, true)) {
+            result.response.error = "cannot open file";
+            return result;
+        }
+
+        detail::DeltaPatcher patcher;
+        detail::Sha256 sha;
+        bool write_failed = false;
+        bool stopped = false;
+        detail::DeltaPatcher::Output write = [&](const char* data, size_t len) {
+            if (!file.write(data, len)) {
+                write_failed = true;
+                return false;
+            }
+            sha.update(data, len);
+            return true;
+        };
+
+        Response resp;
+        int attempts = std::max<int>(1, options.max_attempts);
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            // Deltas are not resumed: a retry applies the delta from the start.
+            if (file.size() > 0 && !file.truncate()) {
+                write_failed = true;
+                break;
+            }
+            patcher.reset(&base, base_hash);
+            sha.reset();
+
+            uint64_t received = 0, announced = 0;
+            BodySink sink = [&](const Response& head, const char* data, size_t len) {
+                if (head.status_code != 200) return true;   // error pages are not applied
+                if (received == 0) announced = std::strtoull(head.header("Content-Length").c_str(), nullptr, 10);
+                if (!patcher.feed(data, len, write)) return false;
+                received += len;
+                if (options.on_progress && !options.on_progress(received, announced)) {
+                    stopped = true;
+                    return false;
+                }
+                return true;
+            };
+            resp = request_stream("GET", url, "", options.headers, sink);
+
+            if (write_failed || stopped || patcher.failed() || resp.status_code != 0) break;
+        }
+
+        result.response = std::move(resp);
+        result.size = file.size();
+        if (write_failed) {
+            result.response.status_code = 0;
+            result.response.error = "write failed";
+        } else if (stopped) {
+            result.response.status_code = 0;
+            result.response.error = "aborted";
+        } else if (patcher.failed()) {
+            result.response.status_code = 0;
+            result.response.error = patcher.base_mismatch() ? "base mismatch" : "bad delta";
+        } else if (result.response.ok() && result.response.error.empty() && !patcher.done()) {
+            result.response.status_code = 0;
+            result.response.error = "bad delta";
+        }
+        file.close();
+        base.close();
+        if (!result.response.ok() || !result.response.error.empty()) {
+            detail::PartialFile::remove(part_path);
+            return result;
+        }
+
+        result.sha256 = sha.finish_hex();
+        std::string expected = options.expected_sha256;
+        std::transform(expected.begin(), expected.end(), expected.begin(), ::tolower);
+        if (result.sha256 != patcher.target_sha256() || (!expected.empty() && expected != result.sha256)) {
+            detail::PartialFile::remove(part_path);
+            result.response.error = "hash mismatch";
+            return result;
+        }
+        if (!detail::PartialFile::commit(part_path, path)) {
+            result.response.error = "rename failed";
+        }
+        return result;
+    }
+
+    std::vector<Response> Session::batch(const std::vector<BatchRequest>& requests, BatchMode mode) {
+        std::vector<Response> responses(requests.size());
+        if (mode == BatchMode::Serial) {
+            for (size_t i = 0; i < requests.size(); ++i) {
+                const BatchRequest& r = requests[i];
+                responses[i] = request(r.method, r.url, r.data, r.headers);
+            }
+            return responses;
+        }
+
+        std::vector<char> answered(requests.size(), 0);
+        if (mode == BatchMode::Pipelined) pipeline_requests(*impl_, requests, responses, answered);
+
+        std::vector<std::future<Response>> pending(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const BatchRequest& r = requests[i];
+            if (!answered[i]) pending[i] = request_async(r.method, r.url, r.data, r.headers).response;
+        }
+        for (size_t i = 0; i < requests.size(); ++i) {
+            if (pending[i].valid()) responses[i] = pending[i].get();
+        }
+        return responses;
+    }
+
+    RequestId Session::send_async(const std::string& method,
+                                  const std::string& url,
+                                  const std::string& data,
+                                  const std::map<std::string, std::string>& headers,
+                                  Completion on_complete,
+                                  int timeout_ms) {
+        Completion recorded = [on_complete = std::move(on_complete)](Response resp) {
+            detail::MetricsRegistry::instance().record(resp);
+            if (on_complete) on_complete(std::move(resp));
+        };
+        return send_async_request(*impl_, method, url, data, headers, std::move(recorded), timeout_ms);
+    }
+
+    AsyncResponse Session::request_async(const std::string& method,
+                                         const std::string& url,
+                                         const std::string& data,
+                                         const std::map<std::string, std::string>& headers,
+                                         int timeout_ms) {
+        auto promise = std::make_shared<std::promise<Response>>();
+        AsyncResponse result;
+        result.response = promise->get_future();
+        result.id = send_async(method, url, data, headers,
+                               [promise](Response resp) { promise->set_value(std::move(resp)); },
+                               timeout_ms);
+        return result;
+    }
+
+    void Session::cancel(RequestId id) {
+        cancel_async_request(*impl_, id);
+    }
+
+    Response Session::get(const std::string& url,
+                          const std::map<std::string, std::string>& params,
+                          const std::map<std::string, std::string>& headers) {
         std::string full_url = url;
         if (!params.empty()) {
             full_url += (url.find('?') == std::string::npos) ? "?" : "&";
@@ -163,32 +1376,104 @@ namespace NetClient {
                 full_url += it->first + "=" + it->second; // Note: Simple encoding
             }
         }
-        return internal_request("GET", full_url, "", headers);
+        return request("GET", full_url, "", headers);
+    }
+
+    Response Session::post(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) {
+        return request("POST", url, data, headers);
+    }
+
+    Response Session::put(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) {
+        return request("PUT", url, data, headers);
+    }
+
+    Response Session::del(const std::string& url, const std::map<std::string, std::string>& headers) {
+        return request("DELETE", url, "", headers);
+    }
+
+    Response Session::options(const std::string& url, const std::map<std::string, std::string>& headers) {
+        return request("OPTIONS", url, "", headers);
+    }
+
+    Session& default_session() {
+        // Never destroyed: tearing down WinHTTP handles while the DLL unloads
+        // is unsafe, and the OS reclaims the sockets at exit anyway.
+        static Session* session = new Session();
+        return *session;
+    }
+
+    Response get(const std::string& url,
+                 const std::map<std::string, std::string>& params,
+                 const std::map<std::string, std::string>& headers) {
+        return default_session().get(url, params, headers);
     }
 
     Response post(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) {
-        return internal_request("POST", url, data, headers);
+        return default_session().post(url, data, headers);
     }
 
     Response put(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) {
-        return internal_request("PUT", url, data, headers);
+        return default_session().put(url, data, headers);
     }
 
     Response del(const std::string& url, const std::map<std::string, std::string>& headers) {
-        return internal_request("DELETE", url, "", headers);
+        return default_session().del(url, headers);
     }
 
     Response options(const std::string& url, const std::map<std::string, std::string>& headers) {
-        return internal_request("OPTIONS", url, "", headers);
+        return default_session().options(url, headers);
     }
 
-#else
-    // Linux/UNIX placeholders
-    Response get(const std::string& url, const std::map<std::string, std::string>& params, const std::map<std::string, std::string>& headers) { return {0}; }
-    Response post(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) { return {0}; }
-    Response put(const std::string& url, const std::string& data, const std::map<std::string, std::string>& headers) { return {0}; }
-    Response del(const std::string& url, const std::map<std::string, std::string>& headers) { return {0}; }
-    Response options(const std::string& url, const std::map<std::string, std::string>& headers) { return {0}; }
-#endif
+    Response upload(const std::string& method,
+                    const std::string& url,
+                    const RequestBody& body,
+                    const std::map<std::string, std::string>& headers) {
+        return default_session().upload(method, url, body, headers);
+    }
+
+    DownloadResult download(const std::string& url, const std::string& path, const DownloadOptions& options) {
+        return default_session().download(url, path, options);
+    }
+
+    DownloadResult download_delta(const std::string& url,
+                                  const std::string& base_path,
+                                  const std::string& path,
+                                  const DownloadOptions& options) {
+        return default_session().download_delta(url, base_path, path, options);
+    }
+
+    std::string file_sha256(const std::string& path) {
+        detail::PartialFile file;
+        detail::Sha256 sha;
+        if (!file.open_existing(path) ||
+            !file.read_all([&](const char* data, size_t len) { sha.update(data, len); })) {
+            return std::string();
+        }
+        return sha.finish_hex();
+    }
+
+    bool make_delta(const std::string& base_path, const std::string& target_path, const std::string& delta_path) {
+        std::string base, target;
+        detail::PartialFile file;
+        if (!file.open_existing(base_path) ||
+            !file.read_all([&](const char* data, size_t len) { base.append(data, len); }) ||
+            !file.open_existing(target_path) ||
+            !file.read_all([&](const char* data, size_t len) { target.append(data, len); })) {
+            return false;
+        }
+        file.close();
+
+        std::string delta;
+        detail::encode_delta(base, target, delta);
+
+        std::string part_path = delta_path + ".part";
+        bool ok = file.open(part_path, true) && file.write(delta.data(), delta.size());
+        file.close();
+        if (!ok || !detail::PartialFile::commit(part_path, delta_path)) {
+            detail::PartialFile::remove(part_path);
+            return false;
+        }
+        return true;
+    }
 
 }
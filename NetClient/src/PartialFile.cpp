@@ -0,0 +1,210 @@
+#include "PartialFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NetClient {
+namespace detail {
+
+#ifdef _WIN32
+    static std::wstring widen(const std::string& utf8) {
+        int len = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.size(), NULL, 0);
+        std::wstring wide(len, L'\0');
+        if (len > 0) MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.size(), &wide[0], len);
+        return wide;
+    }
+
+    PartialFile::~PartialFile() {
+        close();
+    }
+
+    bool PartialFile::open(const std::string& path, bool truncate) {
+        close();
+        HANDLE h = CreateFileW(widen(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                               truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(h, &size)) {
+            CloseHandle(h);
+            return false;
+        }
+        handle_ = h;
+        size_ = (uint64_t)size.QuadPart;
+        return true;
+    }
+
+    bool PartialFile::open_existing(const std::string& path) {
+        close();
+        HANDLE h = CreateFileW(widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(h, &size)) {
+            CloseHandle(h);
+            return false;
+        }
+        handle_ = h;
+        size_ = (uint64_t)size.QuadPart;
+        return true;
+    }
+
+    void PartialFile::close() {
+        if (handle_) CloseHandle((HANDLE)handle_);
+        handle_ = nullptr;
+        size_ = 0;
+    }
+
+    bool PartialFile::truncate() {
+        LARGE_INTEGER zero = {};
+        if (!SetFilePointerEx((HANDLE)handle_, zero, NULL, FILE_BEGIN) || !SetEndOfFile((HANDLE)handle_)) return false;
+        size_ = 0;
+        return true;
+    }
+
+    void PartialFile::preallocate(uint64_t total_size) {
+        FILE_ALLOCATION_INFO info;
+        info.AllocationSize.QuadPart = (LONGLONG)total_size;
+        SetFileInformationByHandle((HANDLE)handle_, FileAllocationInfo, &info, sizeof(info));
+    }
+
+    bool PartialFile::write(const char* data, size_t len) {
+        // Always appends at the logical end, whatever was read before.
+        LARGE_INTEGER offset;
+        offset.QuadPart = (LONGLONG)size_;
+        if (!SetFilePointerEx((HANDLE)handle_, offset, NULL, FILE_BEGIN)) return false;
+        while (len > 0) {
+            DWORD chunk = len > 0x40000000 ? 0x40000000 : (DWORD)len;
+            DWORD written = 0;
+            if (!WriteFile((HANDLE)handle_, data, chunk, &written, NULL) || written == 0) return false;
+            data += written;
+            len -= written;
+            size_ += written;
+        }
+        return true;
+    }
+
+    bool PartialFile::read_at(uint64_t offset, char* buffer, size_t len, size_t& got) {
+        OVERLAPPED at = {};
+        at.Offset = (DWORD)offset;
+        at.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD read = 0;
+        if (!ReadFile((HANDLE)handle_, buffer, (DWORD)len, &read, &at)) return false;
+        got = read;
+        return true;
+    }
+
+    bool PartialFile::commit(const std::string& part_path, const std::string& final_path) {
+        return MoveFileExW(widen(part_path).c_str(), widen(final_path).c_str(),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+    }
+
+    void PartialFile::remove(const std::string& path) {
+        DeleteFileW(widen(path).c_str());
+    }
+
+    void PartialFile::create_directory(const std::string& path) {
+        CreateDirectoryW(widen(path).c_str(), NULL);
+    }
+#else
+    PartialFile::~PartialFile() {
+        close();
+    }
+
+    bool PartialFile::open(const std::string& path, bool truncate) {
+        close();
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        fd_ = fd;
+        size_ = (uint64_t)st.st_size;
+        return true;
+    }
+
+    bool PartialFile::open_existing(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        fd_ = fd;
+        size_ = (uint64_t)st.st_size;
+        return true;
+    }
+
+    void PartialFile::close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        size_ = 0;
+    }
+
+    bool PartialFile::truncate() {
+        if (::ftruncate(fd_, 0) != 0) return false;
+        size_ = 0;
+        return true;
+    }
+
+    void PartialFile::preallocate(uint64_t total_size) {
+#ifdef FALLOC_FL_KEEP_SIZE
+        if (total_size > size_) {
+            ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)size_, (off_t)(total_size - size_));
+        }
+#else
+        (void)total_size;
+#endif
+    }
+
+    bool PartialFile::write(const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::pwrite(fd_, data, len, (off_t)size_);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            len -= (size_t)n;
+            size_ += (uint64_t)n;
+        }
+        return true;
+    }
+
+    bool PartialFile::read_at(uint64_t offset, char* buffer, size_t len, size_t& got) {
+        ssize_t n;
+        do {
+            n = ::pread(fd_, buffer, len, (off_t)offset);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) return false;
+        got = (size_t)n;
+        return true;
+    }
+
+    bool PartialFile::commit(const std::string& part_path, const std::string& final_path) {
+        return ::rename(part_path.c_str(), final_path.c_str()) == 0;
+    }
+
+    void PartialFile::remove(const std::string& path) {
+        ::unlink(path.c_str());
+    }
+
+    void PartialFile::create_directory(const std::string& path) {
+        ::mkdir(path.c_str(), 0755);
+    }
+#endif
+
+} // namespace detail
+} // namespace NetClient
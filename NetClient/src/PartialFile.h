@@ -0,0 +1,79 @@
+#ifndef NETCLIENT_PARTIAL_FILE_H
+#define NETCLIENT_PARTIAL_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace NetClient {
+namespace detail {
+
+    // The "<path>.part" file a download is written to. Its size is always
+    // the number of bytes received so far, which is what a resumed
+    // download asks the server for; preallocation reserves disk space
+    // without moving the end of file.
+    class PartialFile {
+    public:
+        PartialFile() = default;
+        ~PartialFile();
+
+        PartialFile(const PartialFile&) = delete;
+        PartialFile& operator=(const PartialFile&) = delete;
+
+        // Opens for appending, keeping earlier contents unless truncate.
+        bool open(const std::string& path, bool truncate);
+
+        // Opens read-only; fails when path does not exist.
+        bool open_existing(const std::string& path);
+        void close();
+
+        bool truncate();
+        uint64_t size() const { return size_; }
+
+        // Best effort; failure only loses the fragmentation benefit.
+        void preallocate(uint64_t total_size);
+
+        bool write(const char* data, size_t len);
+
+        // Reads the current contents back from the start, for hashing the
+        // bytes of an earlier attempt.
+        template <typename Fn>
+        bool read_all(Fn&& fn);
+
+        // Reads up to len bytes at offset; got is 0 at the end of the file.
+        bool read_at(uint64_t offset, char* buffer, size_t len, size_t& got);
+
+        // Moves the finished file over final_path.
+        static bool commit(const std::string& part_path, const std::string& final_path);
+        static void remove(const std::string& path);
+
+        // Creates the last component of path if missing.
+        static void create_directory(const std::string& path);
+
+    private:
+#ifdef _WIN32
+        void* handle_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+        uint64_t size_ = 0;
+    };
+
+    template <typename Fn>
+    bool PartialFile::read_all(Fn&& fn) {
+        char buffer[64 * 1024];
+        uint64_t offset = 0;
+        while (offset < size_) {
+            size_t want = (size_t)((size_ - offset) < sizeof(buffer) ? (size_ - offset) : sizeof(buffer));
+            size_t got = 0;
+            if (!read_at(offset, buffer, want, got) || got == 0) return false;
+            fn(buffer, got);
+            offset += got;
+        }
+        return true;
+    }
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_PARTIAL_FILE_H
@@ -0,0 +1,488 @@
+#include "PosixEventLoop.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace NetClient {
+namespace detail {
+
+    // epoll data of the wakeup eventfd; request ids start at 1.
+    static const uint64_t kWakeToken = 0;
+
+    enum class Phase { WaitingSlot, Resolving, Connecting, Sending, Receiving };
+
+    struct AsyncOp {
+        RequestId id = 0;
+        bool valid = false;
+        bool head = false;
+        Url url;
+        std::string request;
+        Completion on_complete;
+        Clock::time_point deadline;
+
+        Phase phase = Phase::WaitingSlot;
+        Response resp;
+        ResponseParser parser;
+
+        int fd = -1;
+        bool holds_slot = false;    // counted against the host's limit
+        bool registered = false;    // fd is in the epoll set
+        bool reused = false;
+        bool received = false;
+        int attempts = 0;
+        size_t sent = 0;
+
+        Clock::time_point submitted;
+        Clock::time_point queued_since;     // reset when a failed attempt starts over
+        Clock::time_point step_start;       // of the lookup, connect or send under way
+        Clock::time_point first_byte;
+
+        addrinfo* addresses = nullptr;
+        addrinfo* next_address = nullptr;
+
+        ~AsyncOp() {
+            if (addresses) ::freeaddrinfo(addresses);
+        }
+    };
+
+    EventLoop::EventLoop(ConnectionPool& pool, const SessionOptions& config)
+        : pool_(pool), config_(config) {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeToken;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+        pool_.set_release_hook([this] {
+            slot_released_.store(true, std::memory_order_release);
+            wake();
+        });
+
+        thread_ = std::thread(&EventLoop::run, this);
+        resolver_ = std::thread(&EventLoop::resolve_loop, this);
+    }
+
+    EventLoop::~EventLoop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake();
+        thread_.join();
+
+        {
+            std::lock_guard<std::mutex> lock(resolve_mutex_);
+            resolver_stopping_ = true;
+        }
+        resolve_cv_.notify_one();
+        resolver_.join();
+
+        pool_.set_release_hook(nullptr);
+        for (const Resolved& r : resolved_) {
+            if (r.addresses) ::freeaddrinfo(r.addresses);
+        }
+        ::close(wake_fd_);
+        ::close(epoll_fd_);
+    }
+
+    RequestId EventLoop::submit(const std::string& method,
+                                const std::string& url,
+                                const std::string& data,
+                                const std::map<std::string, std::string>& headers,
+                                Completion on_complete,
+                                int timeout_ms) {
+        std::unique_ptr<AsyncOp> op(new AsyncOp());
+        op->id = next_id_.fetch_add(1, std::memory_order_relaxed);
+        op->valid = parse_url(url, op->url) && !op->url.secure;
+        op->head = method == "HEAD";
+        bool decode = decode_requested(config_, headers);
+        if (op->valid) op->request = build_request(method, op->url, data, headers, decode);
+        op->parser.set_decoding(decode, config_.max_decompressed_bytes);
+        op->on_complete = std::move(on_complete);
+        op->resp.url = url;
+        op->resp.status_code = 0;
+
+        int timeout = timeout_ms > 0 ? timeout_ms : config_.request_timeout_ms;
+        op->submitted = Clock::now();
+        op->queued_since = op->submitted;
+        op->deadline = op->submitted + std::chrono::milliseconds(timeout);
+
+        RequestId id = op->id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            submitted_.push_back(std::move(op));
+        }
+        wake();
+        return id;
+    }
+
+    void EventLoop::cancel(RequestId id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_.push_back(id);
+        }
+        wake();
+    }
+
+    void EventLoop::wake() {
+        uint64_t one = 1;
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+
+    void EventLoop::run() {
+        epoll_event events[128];
+        while (true) {
+            int count = ::epoll_wait(epoll_fd_, events, 128, next_timeout(Clock::now()));
+
+            for (int i = 0; i < count; ++i) {
+                if (events[i].data.u64 == kWakeToken) {
+                    uint64_t value;
+                    ssize_t n = ::read(wake_fd_, &value, sizeof(value));
+                    (void)n;
+                    continue;
+                }
+                // An earlier event in this batch may have finished the op.
+                auto it = ops_.find(events[i].data.u64);
+                if (it != ops_.end()) on_ready(*it->second);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) break;
+            }
+            drain_queues();
+            if (slot_released_.exchange(false, std::memory_order_acquire)) retry_waiting();
+            expire(Clock::now());
+        }
+
+        // Everything still pending, started or not, completes as cancelled.
+        std::vector<std::unique_ptr<AsyncOp>> submitted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            submitted.swap(submitted_);
+        }
+        for (auto& op : submitted) ops_.emplace(op->id, std::move(op));
+        while (!ops_.empty()) fail(*ops_.begin()->second, "cancelled");
+    }
+
+    void EventLoop::drain_queues() {
+        std::vector<std::unique_ptr<AsyncOp>> submitted;
+        std::vector<RequestId> cancelled;
+        std::vector<Resolved> resolved;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            submitted.swap(submitted_);
+            cancelled.swap(cancelled_);
+            resolved.swap(resolved_);
+        }
+
+        for (const Resolved& r : resolved) {
+            auto it = ops_.find(r.id);
+            if (it == ops_.end() || it->second->phase != Phase::Resolving) {
+                // The request ended while its lookup was running.
+                if (r.addresses) ::freeaddrinfo(r.addresses);
+                continue;
+            }
+            AsyncOp& op = *it->second;
+            Clock::time_point now = Clock::now();
+            op.resp.timing.dns += elapsed_ms(op.step_start, now);
+            op.step_start = now;
+            if (op.addresses) ::freeaddrinfo(op.addresses);
+            op.addresses = r.addresses;
+            op.next_address = r.addresses;
+            if (!r.addresses) {
+                fail(op, "name lookup failed");
+                continue;
+            }
+            op.phase = Phase::Connecting;
+            try_connect(op);
+        }
+
+        for (auto& submitted_op : submitted) {
+            AsyncOp& op = *submitted_op;
+            deadlines_.emplace(op.deadline, op.id);
+            ops_.emplace(op.id, std::move(submitted_op));
+            if (op.valid) start(op);
+            else fail(op, "unsupported url");
+        }
+
+        for (RequestId id : cancelled) {
+            auto it = ops_.find(id);
+            if (it != ops_.end()) fail(*it->second, "cancelled");
+        }
+    }
+
+    void EventLoop::start(AsyncOp& op) {
+        op.phase = Phase::WaitingSlot;
+        bool reserved = false;
+        int fd = pool_.try_acquire(op.url, reserved);
+        if (fd >= 0 || reserved) {
+            op.step_start = Clock::now();
+            op.resp.timing.queued += elapsed_ms(op.queued_since, op.step_start);
+            op.resp.reused_connection = fd >= 0;
+        }
+        if (fd >= 0) {
+            op.fd = fd;
+            op.holds_slot = true;
+            op.reused = true;
+            begin_send(op);
+        } else if (reserved) {
+            op.holds_slot = true;
+            op.reused = false;
+            op.phase = Phase::Resolving;
+            {
+                std::lock_guard<std::mutex> lock(resolve_mutex_);
+                resolve_queue_.emplace_back(op.id, op.url);
+            }
+            resolve_cv_.notify_one();
+        } else {
+            waiting_.push_back(op.id);
+        }
+    }
+
+    // Gives every request waiting for a slot one more try, in arrival order.
+    void EventLoop::retry_waiting() {
+        size_t count = waiting_.size();
+        for (size_t i = 0; i < count; ++i) {
+            RequestId id = waiting_.front();
+            waiting_.pop_front();
+            auto it = ops_.find(id);
+            if (it != ops_.end() && it->second->phase == Phase::WaitingSlot) start(*it->second);
+        }
+    }
+
+    void EventLoop::try_connect(AsyncOp& op) {
+        while (op.next_address) {
+            addrinfo* ai = op.next_address;
+            op.next_address = ai->ai_next;
+
+            int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            op.fd = fd;
+            op.registered = false;
+            int rc = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+            if (rc == 0) {
+                begin_send(op);
+                return;
+            }
+            if (errno == EINPROGRESS && watch(op, EPOLLOUT)) return;
+
+            ::close(fd);
+            op.fd = -1;
+        }
+        fail(op, "connect failed");
+    }
+
+    void EventLoop::begin_send(AsyncOp& op) {
+        Clock::time_point now = Clock::now();
+        if (op.phase == Phase::Connecting) op.resp.timing.connect += elapsed_ms(op.step_start, now);
+        op.step_start = now;
+        op.phase = Phase::Sending;
+        op.sent = 0;
+        op.received = false;
+        op.parser.reset(op.head);
+        op.resp.status_code = 0;
+        op.resp.text.clear();
+        op.resp.headers.clear();
+        send_some(op);
+    }
+
+    void EventLoop::on_ready(AsyncOp& op) {
+        switch (op.phase) {
+            case Phase::Connecting: {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (::getsockopt(op.fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                    begin_send(op);
+                } else {
+                    ::close(op.fd);
+                    op.fd = -1;
+                    op.registered = false;
+                    try_connect(op);
+                }
+                break;
+            }
+            case Phase::Sending:
+                send_some(op);
+                break;
+            case Phase::Receiving:
+                receive_some(op);
+                break;
+            case Phase::WaitingSlot:
+            case Phase::Resolving:
+                break;
+        }
+    }
+
+    void EventLoop::send_some(AsyncOp& op) {
+        while (op.sent < op.request.size()) {
+            ssize_t n = ::send(op.fd, op.request.data() + op.sent, op.request.size() - op.sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                op.sent += (size_t)n;
+                op.resp.bytes_sent += (uint64_t)n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!watch(op, EPOLLOUT)) fail(op, "connection failed");
+                return;
+            } else {
+                transport_failed(op);
+                return;
+            }
+        }
+        op.phase = Phase::Receiving;
+        if (!watch(op, EPOLLIN)) fail(op, "connection failed");
+    }
+
+    void EventLoop::receive_some(AsyncOp& op) {
+        char buffer[16 * 1024];
+        while (true) {
+            ssize_t n = ::recv(op.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                if (!op.received) {
+                    op.first_byte = Clock::now();
+                    op.resp.timing.ttfb += elapsed_ms(op.step_start, op.first_byte);
+                }
+                op.received = true;
+                op.resp.bytes_received += (uint64_t)n;
+                op.parser.feed(buffer, (size_t)n, op.resp);
+            } else if (n == 0) {
+                op.parser.finish(op.resp);
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            } else {
+                transport_failed(op);
+                return;
+            }
+
+            if (op.parser.done()) {
+                release_connection(op, op.parser.keep_alive());
+                deliver(op);
+                return;
+            }
+            if (op.parser.failed()) {
+                transport_failed(op);
+                return;
+            }
+        }
+    }
+
+    bool EventLoop::watch(AsyncOp& op, uint32_t events) {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.u64 = op.id;
+        if (::epoll_ctl(epoll_fd_, op.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, op.fd, &ev) != 0) return false;
+        op.registered = true;
+        return true;
+    }
+
+    void EventLoop::release_connection(AsyncOp& op, bool reusable) {
+        if (op.registered) {
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, op.fd, nullptr);
+            op.registered = false;
+        }
+        if (op.holds_slot) {
+            op.holds_slot = false;
+            pool_.checkin(op.url, op.fd, reusable);
+        } else if (op.fd >= 0) {
+            ::close(op.fd);
+        }
+        op.fd = -1;
+    }
+
+    // A reused socket the server closed meanwhile fails before any response
+    // byte arrives; that attempt is repeated once on a fresh connection.
+    void EventLoop::transport_failed(AsyncOp& op) {
+        bool retry = op.reused && !op.received && op.attempts == 0;
+        if (!retry) {
+            if (op.parser.too_large()) fail(op, "response too large");
+            else fail(op, op.received ? "bad response" : "connection failed");
+            return;
+        }
+        release_connection(op, false);
+        ++op.attempts;
+        op.queued_since = Clock::now();
+        start(op);
+    }
+
+    void EventLoop::fail(AsyncOp& op, const char* error) {
+        release_connection(op, false);
+        op.resp.status_code = 0;
+        op.resp.error = error;
+        deliver(op);
+    }
+
+    void EventLoop::deliver(AsyncOp& op) {
+        Clock::time_point now = Clock::now();
+        if (op.received) op.resp.timing.transfer += elapsed_ms(op.first_byte, now);
+        op.resp.timing.total = elapsed_ms(op.submitted, now);
+        deadlines_.erase({op.deadline, op.id});
+        auto it = ops_.find(op.id);
+        std::unique_ptr<AsyncOp> owned = std::move(it->second);
+        ops_.erase(it);
+
+        if (owned->on_complete) owned->on_complete(std::move(owned->resp));
+    }
+
+    void EventLoop::expire(Clock::time_point now) {
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            RequestId id = deadlines_.begin()->second;
+            deadlines_.erase(deadlines_.begin());
+            auto it = ops_.find(id);
+            if (it != ops_.end()) fail(*it->second, "timeout");
+        }
+    }
+
+    int EventLoop::next_timeout(Clock::time_point now) const {
+        if (deadlines_.empty()) return -1;
+        Clock::time_point first = deadlines_.begin()->first;
+        if (first <= now) return 0;
+        // Rounded up so the loop never wakes just short of a deadline.
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(first - now).count() + 1;
+        return left > 60000 ? 60000 : (int)left;
+    }
+
+    void EventLoop::resolve_loop() {
+        while (true) {
+            std::pair<RequestId, Url> job;
+            {
+                std::unique_lock<std::mutex> lock(resolve_mutex_);
+                resolve_cv_.wait(lock, [this] { return resolver_stopping_ || !resolve_queue_.empty(); });
+                if (resolver_stopping_) return;
+                job = std::move(resolve_queue_.front());
+                resolve_queue_.pop_front();
+            }
+
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* results = nullptr;
+            std::string port = std::to_string(job.second.port);
+            if (::getaddrinfo(job.second.host.c_str(), port.c_str(), &hints, &results) != 0) results = nullptr;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                resolved_.push_back({job.first, results});
+            }
+            wake();
+        }
+    }
+
+} // namespace detail
+} // namespace NetClient
@@ -0,0 +1,102 @@
+#ifndef NETCLIENT_POSIX_EVENT_LOOP_H
+#define NETCLIENT_POSIX_EVENT_LOOP_H
+
+#include "PosixHttp.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct addrinfo;
+
+namespace NetClient {
+namespace detail {
+
+    struct AsyncOp;
+
+    // One epoll thread driving every asynchronous request of a session.
+    // Requests are small state machines (wait for a pool slot, resolve,
+    // connect, send, receive) advanced by socket readiness, so hundreds of
+    // them share the thread. Name lookup, the only step without a
+    // non-blocking form, runs on a single helper thread.
+    class EventLoop {
+    public:
+        EventLoop(ConnectionPool& pool, const SessionOptions& config);
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        RequestId submit(const std::string& method,
+                         const std::string& url,
+                         const std::string& data,
+                         const std::map<std::string, std::string>& headers,
+                         Completion on_complete,
+                         int timeout_ms);
+
+        void cancel(RequestId id);
+
+    private:
+        struct Resolved {
+            RequestId id;
+            addrinfo* addresses;
+        };
+
+        void run();
+        void wake();
+        void drain_queues();
+        void start(AsyncOp& op);
+        void retry_waiting();
+        void try_connect(AsyncOp& op);
+        void begin_send(AsyncOp& op);
+        void on_ready(AsyncOp& op);
+        void send_some(AsyncOp& op);
+        void receive_some(AsyncOp& op);
+        bool watch(AsyncOp& op, uint32_t events);
+        void release_connection(AsyncOp& op, bool reusable);
+        void transport_failed(AsyncOp& op);
+        void fail(AsyncOp& op, const char* error);
+        void deliver(AsyncOp& op);
+        void expire(Clock::time_point now);
+        int next_timeout(Clock::time_point now) const;
+        void resolve_loop();
+
+        ConnectionPool& pool_;
+        SessionOptions config_;
+        int epoll_fd_ = -1;
+        int wake_fd_ = -1;
+        std::atomic<RequestId> next_id_{1};
+        std::atomic<bool> slot_released_{false};
+
+        // Handed over from other threads, guarded by mutex_.
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<AsyncOp>> submitted_;
+        std::vector<RequestId> cancelled_;
+        std::vector<Resolved> resolved_;
+        bool stopping_ = false;
+
+        // Touched only by the loop thread.
+        std::unordered_map<RequestId, std::unique_ptr<AsyncOp>> ops_;
+        std::deque<RequestId> waiting_;
+        std::set<std::pair<Clock::time_point, RequestId>> deadlines_;
+
+        std::mutex resolve_mutex_;
+        std::condition_variable resolve_cv_;
+        std::deque<std::pair<RequestId, Url>> resolve_queue_;
+        bool resolver_stopping_ = false;
+
+        std::thread thread_;
+        std::thread resolver_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_POSIX_EVENT_LOOP_H
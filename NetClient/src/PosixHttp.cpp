@@ -0,0 +1,644 @@
+#include "PosixHttp.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace NetClient {
+namespace detail {
+
+    bool wait_fd(int fd, short events, Clock::time_point deadline) {
+        while (true) {
+            // Rounded up, so a timed-out wait returns only once the deadline
+            // has passed and callers can tell a timeout by the clock.
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) return false;
+
+            pollfd pfd = {fd, events, 0};
+            int rc = ::poll(&pfd, 1, (int)left);
+            if (rc > 0) return true;
+            if (rc < 0 && errno != EINTR) return false;
+        }
+    }
+
+    int connect_to(const Url& url, Clock::time_point deadline, Timing* timing) {
+        Clock::time_point begin = Clock::now();
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* results = nullptr;
+        std::string port = std::to_string(url.port);
+        if (::getaddrinfo(url.host.c_str(), port.c_str(), &hints, &results) != 0) return -1;
+        Clock::time_point resolved = Clock::now();
+        if (timing) timing->dns += elapsed_ms(begin, resolved);
+
+        int fd = -1;
+        for (addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+
+            int rc = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+            if (rc != 0 && errno == EINPROGRESS && wait_fd(fd, POLLOUT, deadline)) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                rc = (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) ? 0 : -1;
+            }
+            if (rc != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(results);
+
+        if (fd >= 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (timing) timing->connect += elapsed_ms(resolved, Clock::now());
+        }
+        return fd;
+    }
+
+    bool send_all(int fd, const std::string& bytes, Clock::time_point deadline) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += (size_t)n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait_fd(fd, POLLOUT, deadline)) return false;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The request line and headers, without the blank line that ends them.
+    static void start_request(std::string& req, const std::string& method, const Url& url,
+                              const std::map<std::string, std::string>& headers, bool accept_compressed) {
+        req += method;
+        req += ' ';
+        req += url.target;
+        req += " HTTP/1.1\r\n";
+
+        if (!has_header(headers, "Host")) {
+            bool ipv6 = url.host.find(':') != std::string::npos;
+            req += "Host: ";
+            req += ipv6 ? "[" + url.host + "]" : url.host;
+            if (url.port != 80) req += ":" + std::to_string(url.port);
+            req += "\r\n";
+        }
+        if (!has_header(headers, "User-Agent")) req += "User-Agent: NetClient/1.0\r\n";
+        if (!has_header(headers, "Accept")) req += "Accept: */*\r\n";
+        if (accept_compressed) req += "Accept-Encoding: gzip, deflate\r\n";
+        for (const auto& h : headers) {
+            req += h.first;
+            req += ": ";
+            req += h.second;
+            req += "\r\n";
+        }
+    }
+
+    std::string build_request(const std::string& method, const Url& url, const std::string& data,
+                              const std::map<std::string, std::string>& headers, bool accept_compressed) {
+        std::string req;
+        req.reserve(256 + data.size());
+        start_request(req, method, url, headers, accept_compressed);
+        if (!data.empty() || method == "POST" || method == "PUT") {
+            req += "Content-Length: " + std::to_string(data.size()) + "\r\n";
+        }
+        req += "\r\n";
+        req += data;
+        return req;
+    }
+
+    std::string build_upload_head(const std::string& method, const Url& url, const RequestBody& body,
+                                  const std::map<std::string, std::string>& headers, bool accept_compressed) {
+        std::string req;
+        req.reserve(256);
+        start_request(req, method, url, headers, accept_compressed);
+        if (!body.content_type.empty() && !has_header(headers, "Content-Type")) {
+            req += "Content-Type: " + body.content_type + "\r\n";
+        }
+        uint64_t size = body.size();
+        if (size == RequestBody::kUnknownSize) req += "Transfer-Encoding: chunked\r\n";
+        else req += "Content-Length: " + std::to_string(size) + "\r\n";
+        req += "\r\n";
+        return req;
+    }
+
+    BodySender::BodySender(int fd, std::chrono::milliseconds timeout, bool use_sendfile)
+        : fd_(fd), timeout_(timeout), use_sendfile_(use_sendfile) {
+        int one = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &one, sizeof(one));
+    }
+
+    BodySender::~BodySender() {
+        int zero = 0;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &zero, sizeof(zero));
+    }
+
+    bool BodySender::send(const std::string& head, const RequestBody& body) {
+        chunked_ = body.size() == RequestBody::kUnknownSize;
+        if (!write(head.data(), head.size())) return false;
+        for (const RequestBody::Part& part : body.parts()) {
+            bool ok = false;
+            switch (part.kind) {
+                case RequestBody::Part::Kind::Bytes:
+                    ok = piece(part.data.data(), part.data.size());
+                    break;
+                case RequestBody::Part::Kind::File:
+                    ok = send_file(part.data, part.size);
+                    break;
+                case RequestBody::Part::Kind::Reader:
+                    ok = send_reader(part);
+                    break;
+            }
+            if (!ok) return false;
+        }
+        return !chunked_ || write("0\r\n\r\n", 5);
+    }
+
+    bool BodySender::write(const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::send(fd_, data, len, MSG_NOSIGNAL);
+            if (n > 0) {
+                data += n;
+                len -= (size_t)n;
+                sent_ += (uint64_t)n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait_fd(fd_, POLLOUT, Clock::now() + timeout_)) return fail(Failure::Socket);
+            } else {
+                return fail(Failure::Socket);
+            }
+        }
+        return true;
+    }
+
+    bool BodySender::chunk_header(uint64_t len) {
+        char line[24];
+        int n = std::snprintf(line, sizeof(line), "%llx\r\n", (unsigned long long)len);
+        return write(line, (size_t)n);
+    }
+
+    // Writes len bytes as they are, or as one chunk.
+    bool BodySender::piece(const char* data, size_t len) {
+        if (len == 0) return true;
+        if (!chunked_) return write(data, len);
+        return chunk_header(len) && write(data, len) && write("\r\n", 2);
+    }
+
+    // Sends the size bytes the file had when it was added: bytes it gained
+    // since are left out, and a file that shrank fails the body.
+    bool BodySender::send_file(const std::string& path, uint64_t size) {
+        int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) return fail(Failure::Source);
+        bool ok = !chunked_ || size == 0 || chunk_header(size);
+        if (ok && !use_sendfile_) ok = copy_file(file, 0, size);
+        off_t offset = 0;
+        while (ok && use_sendfile_ && (uint64_t)offset < size) {
+            size_t want = (size_t)std::min<uint64_t>(size - (uint64_t)offset, 1u << 30);
+            ssize_t n = ::sendfile(fd_, file, &offset, want);
+            if (n > 0) {
+                sent_ += (uint64_t)n;
+            } else if (n == 0) {
+                ok = fail(Failure::Source);     // the file shrank
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!wait_fd(fd_, POLLOUT, Clock::now() + timeout_)) ok = fail(Failure::Socket);
+            } else if (errno == EINVAL || errno == ENOSYS) {
+                ok = copy_file(file, offset, size);     // no sendfile for this file
+                break;
+            } else {
+                ok = fail(errno == EPIPE || errno == ECONNRESET ? Failure::Socket : Failure::Source);
+            }
+        }
+        ::close(file);
+        return ok && (!chunked_ || size == 0 || write("\r\n", 2));
+    }
+
+    bool BodySender::copy_file(int file, off_t offset, uint64_t size) {
+        buffer_.resize(kBufferSize);
+        while ((uint64_t)offset < size) {
+            size_t want = (size_t)std::min<uint64_t>(size - (uint64_t)offset, buffer_.size());
+            ssize_t n = ::pread(file, buffer_.data(), want, offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return fail(Failure::Source);
+            if (!write(buffer_.data(), (size_t)n)) return false;
+            offset += n;
+        }
+        return true;
+    }
+
+    bool BodySender::send_reader(const RequestBody::Part& part) {
+        buffer_.resize(kBufferSize);
+        bool sized = part.size != RequestBody::kUnknownSize;
+        uint64_t left = part.size;
+        while (!sized || left > 0) {
+            size_t want = sized ? (size_t)std::min<uint64_t>(left, buffer_.size()) : buffer_.size();
+            consumed_ = true;
+            long long n = part.reader(buffer_.data(), want);
+            if (n < 0) return fail(Failure::Aborted);
+            if (n == 0) return !sized || fail(Failure::Source);
+            if ((uint64_t)n > want) return fail(Failure::Source);
+            if (!piece(buffer_.data(), (size_t)n)) return false;
+            left -= (uint64_t)n;
+        }
+        return true;
+    }
+
+    bool BodySender::fail(Failure failure) {
+        failure_ = failure;
+        return false;
+    }
+
+    ConnectionPool::ConnectionPool(const SessionOptions& config) : config_(config) {
+        if (config_.max_connections_per_host < 1) config_.max_connections_per_host = 1;
+    }
+
+    ConnectionPool::~ConnectionPool() {
+        for (auto& entry : hosts_) {
+            for (const Idle& idle : entry.second.idle) ::close(idle.fd);
+        }
+    }
+
+    std::string ConnectionPool::key(const Url& url) {
+        return url.host + ":" + std::to_string(url.port);
+    }
+
+    void ConnectionPool::prune(Host& host, Clock::time_point now) {
+        auto timeout = std::chrono::milliseconds(config_.idle_timeout_ms);
+        auto it = host.idle.begin();
+        while (it != host.idle.end()) {
+            if (now - it->since >= timeout) {
+                ::close(it->fd);
+                --host.open;
+                it = host.idle.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // An idle keep-alive socket is only usable if the server has neither
+    // closed it nor sent anything unsolicited.
+    static bool still_open(int fd) {
+        char probe;
+        ssize_t n = ::recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    int ConnectionPool::acquire_locked(Host& host, bool& reserved) {
+        reserved = false;
+        prune(host, Clock::now());
+        while (!host.idle.empty()) {
+            int fd = host.idle.back().fd;
+            host.idle.pop_back();
+            if (still_open(fd)) {
+                host.peak_busy = std::max(host.peak_busy, host.open - (int)host.idle.size());
+                return fd;
+            }
+            ::close(fd);
+            --host.open;
+        }
+        if (host.open < config_.max_connections_per_host) {
+            ++host.open;
+            reserved = true;
+            host.peak_busy = std::max(host.peak_busy, host.open);
+        }
+        return -1;
+    }
+
+    int ConnectionPool::try_acquire(const Url& url, bool& reserved) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return acquire_locked(hosts_[key(url)], reserved);
+    }
+
+    int ConnectionPool::checkout(const Url& url, Clock::time_point deadline, bool& reused, Timing* timing) {
+        Clock::time_point begin = Clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        Host& host = hosts_[key(url)];
+        bool reserved = false;
+        while (true) {
+            int fd = acquire_locked(host, reserved);
+            if (fd >= 0) {
+                reused = true;
+                if (timing) timing->queued += elapsed_ms(begin, Clock::now());
+                return fd;
+            }
+            if (reserved) break;
+            if (released_.wait_until(lock, deadline) == std::cv_status::timeout) return -1;
+        }
+        lock.unlock();
+        if (timing) timing->queued += elapsed_ms(begin, Clock::now());
+
+        // Connect outside the lock; the slot is already reserved.
+        reused = false;
+        int fd = connect_to(url, deadline, timing);
+        if (fd < 0) checkin(url, -1, false);
+        return fd;
+    }
+
+    void ConnectionPool::checkin(const Url& url, int fd, bool reusable) {
+        std::function<void()> hook;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Host& host = hosts_[key(url)];
+            if (reusable && fd >= 0) {
+                host.idle.push_back({fd, Clock::now()});
+            } else {
+                if (fd >= 0) ::close(fd);
+                --host.open;
+            }
+            hook = release_hook_;
+        }
+        released_.notify_one();
+        if (hook) hook();
+    }
+
+    void ConnectionPool::set_release_hook(std::function<void()> hook) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        release_hook_ = std::move(hook);
+    }
+
+    void ConnectionPool::describe(std::string& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Clock::time_point now = Clock::now();
+        char line[256];
+        for (auto& entry : hosts_) {
+            Host& host = entry.second;
+            prune(host, now);
+            int busy = host.open - (int)host.idle.size();
+            std::snprintf(line, sizeof(line), "    %s busy %d/%d (%.0f%%, peak %d), idle %d\n",
+                          entry.first.c_str(), busy, config_.max_connections_per_host,
+                          100.0 * busy / config_.max_connections_per_host, host.peak_busy,
+                          (int)host.idle.size());
+            out += line;
+        }
+    }
+
+    Response posix_request(ConnectionPool& pool,
+                           const SessionOptions& config,
+                           const std::string& method,
+                           const std::string& url,
+                           const std::string& data,
+                           const std::map<std::string, std::string>& headers,
+                           const BodySink* sink,
+                           int timeout_ms,
+                           const RequestBody* body) {
+        Response resp;
+        resp.url = url;
+        resp.status_code = 0;
+
+        Url parsed;
+        if (!parse_url(url, parsed) || parsed.secure) {
+            resp.error = "unsupported url";
+            return resp;
+        }
+
+        std::chrono::milliseconds timeout(timeout_ms > 0 ? timeout_ms : config.request_timeout_ms);
+        Clock::time_point started = Clock::now();
+        Clock::time_point deadline = started + timeout;
+        bool decode = decode_requested(config, headers);
+        std::string request = body ? build_upload_head(method, parsed, *body, headers, decode)
+                                   : build_request(method, parsed, data, headers, decode);
+        ResponseParser parser;
+        parser.set_sink(sink);
+        parser.set_decoding(decode, config.max_decompressed_bytes);
+        char buffer[16 * 1024];
+
+        // A reused socket the server closed meanwhile fails before any
+        // response byte arrives; that attempt is repeated on a new socket.
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            bool reused = false;
+            int fd = pool.checkout(parsed, deadline, reused, &resp.timing);
+            if (fd < 0) {
+                resp.error = Clock::now() >= deadline ? "timeout" : "connect failed";
+                resp.timing.total = elapsed_ms(started, Clock::now());
+                return resp;
+            }
+            resp.reused_connection = reused;
+
+            parser.reset(method == "HEAD");
+            Clock::time_point send_start = Clock::now();
+            Clock::time_point first_byte;
+            bool ok;
+            bool consumed = false;
+            BodySender::Failure body_failure = BodySender::Failure::None;
+            if (body) {
+                // An upload may take far longer than one timeout; the
+                // timeout bounds each wait instead, as for streamed bodies.
+                BodySender sender(fd, timeout);
+                ok = sender.send(request, *body);
+                resp.bytes_sent += sender.sent();
+                consumed = sender.consumed();
+                body_failure = sender.failure();
+                send_start = Clock::now();
+                deadline = send_start + timeout;
+            } else {
+                ok = send_all(fd, request, deadline);
+                if (ok) resp.bytes_sent += request.size();
+            }
+            bool received = false;
+            while (ok && !parser.done() && !parser.failed()) {
+                ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    if (!received) {
+                        first_byte = Clock::now();
+                        resp.timing.ttfb += elapsed_ms(send_start, first_byte);
+                    }
+                    received = true;
+                    resp.bytes_received += (uint64_t)n;
+                    parser.feed(buffer, (size_t)n, resp);
+                    // A streamed body may be far larger than one timeout's
+                    // worth; like WinHTTP, the timeout then bounds each wait.
+                    if (sink) deadline = Clock::now() + timeout;
+                } else if (n == 0) {
+                    parser.finish(resp);
+                } else if (errno == EINTR) {
+                    continue;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    ok = wait_fd(fd, POLLIN, deadline);
+                } else {
+                    ok = false;
+                }
+            }
+
+            Clock::time_point finished = Clock::now();
+            if (received) resp.timing.transfer += elapsed_ms(first_byte, finished);
+            resp.timing.total = elapsed_ms(started, finished);
+
+            bool success = ok && parser.done();
+            pool.checkin(parsed, fd, success && parser.keep_alive());
+            if (success) return resp;
+            if (body_failure == BodySender::Failure::Aborted) {
+                resp.error = "aborted";
+                break;
+            }
+            if (body_failure == BodySender::Failure::Source) {
+                resp.error = "body read failed";
+                break;
+            }
+            if (!reused || received || consumed) {
+                if (parser.aborted()) resp.error = "aborted";
+                else if (parser.too_large()) resp.error = "response too large";
+                else if (Clock::now() >= deadline) resp.error = "timeout";
+                else resp.error = received ? "bad response" : "connection failed";
+                break;
+            }
+        }
+
+        // A truncated or malformed response is reported like a transport error.
+        resp.status_code = 0;
+        if (resp.error.empty()) resp.error = "connection failed";
+        return resp;
+    }
+
+    size_t posix_pipeline(ConnectionPool& pool,
+                          const SessionOptions& config,
+                          const std::vector<const BatchRequest*>& requests,
+                          std::vector<Response>& responses,
+                          size_t max_depth) {
+        const size_t count = requests.size();
+        responses.assign(count, Response());
+        std::vector<std::string> wire(count);
+        std::vector<char> decode(count);
+        Url host;
+        for (size_t i = 0; i < count; ++i) {
+            const BatchRequest& request = *requests[i];
+            Url parsed;
+            responses[i].url = request.url;
+            responses[i].status_code = 0;
+            if (!parse_url(request.url, parsed) || parsed.secure) return 0;
+            if (i == 0) host = parsed;
+            decode[i] = decode_requested(config, request.headers);
+            wire[i] = build_request(request.method, parsed, request.data, request.headers, decode[i] != 0);
+        }
+        if (count == 0) return 0;
+        if (max_depth < 1) max_depth = 1;
+
+        std::chrono::milliseconds timeout(config.request_timeout_ms);
+        Clock::time_point started = Clock::now();
+        Clock::time_point deadline = started + timeout;
+        bool reused = false;
+        int fd = pool.checkout(host, deadline, reused, &responses[0].timing);
+        if (fd < 0) return 0;
+
+        ResponseParser parser;
+        parser.set_decoding(decode[0] != 0, config.max_decompressed_bytes);
+        parser.reset(requests[0]->method == "HEAD");
+        std::vector<Clock::time_point> sent_at(count, started);
+        Clock::time_point first_byte;
+        bool received = false;      // any byte of the response being read
+        size_t sent = 0;            // requests written in full
+        size_t offset = 0;          // bytes of wire[sent] written
+        size_t answered = 0;
+        bool open = true;           // the connection may carry more
+        char buffer[16 * 1024];
+
+        while (open && answered < count) {
+            while (sent < count && sent < answered + max_depth) {
+                const std::string& bytes = wire[sent];
+                ssize_t n = ::send(fd, bytes.data() + offset, bytes.size() - offset, MSG_NOSIGNAL);
+                if (n > 0) {
+                    offset += (size_t)n;
+                    if (offset == bytes.size()) {
+                        sent_at[sent] = Clock::now();
+                        responses[sent].bytes_sent = bytes.size();
+                        ++sent;
+                        offset = 0;
+                    }
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else {
+                    open = false;
+                    break;
+                }
+            }
+            if (!open) break;
+
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                deadline = Clock::now() + timeout;
+                size_t used = 0;
+                while (used < (size_t)n) {
+                    // Bytes beyond the last response were never asked for.
+                    if (answered == count) {
+                        open = false;
+                        break;
+                    }
+                    Response& resp = responses[answered];
+                    if (!received) {
+                        first_byte = Clock::now();
+                        resp.timing.ttfb = elapsed_ms(sent_at[answered], first_byte);
+                        resp.reused_connection = reused || answered > 0;
+                        received = true;
+                    }
+                    size_t consumed = parser.feed(buffer + used, (size_t)n - used, resp);
+                    resp.bytes_received += consumed;
+                    used += consumed;
+                    if (parser.failed()) {
+                        open = false;
+                        break;
+                    }
+                    if (!parser.done()) continue;
+
+                    Clock::time_point finished = Clock::now();
+                    resp.timing.transfer = elapsed_ms(first_byte, finished);
+                    resp.timing.total = elapsed_ms(started, finished);
+                    ++answered;
+                    received = false;
+                    if (!parser.keep_alive()) {
+                        open = false;
+                        break;
+                    }
+                    if (answered < count) {
+                        parser.set_decoding(decode[answered] != 0, config.max_decompressed_bytes);
+                        parser.reset(requests[answered]->method == "HEAD");
+                    }
+                }
+            } else if (n == 0) {
+                // A body framed by the close ends here.
+                if (received) {
+                    parser.finish(responses[answered]);
+                    if (parser.done()) {
+                        responses[answered].timing.total = elapsed_ms(started, Clock::now());
+                        ++answered;
+                    }
+                }
+                open = false;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                bool writing = sent < count && sent < answered + max_depth;
+                open = wait_fd(fd, writing ? POLLIN | POLLOUT : POLLIN, deadline);
+            } else {
+                open = false;
+            }
+        }
+
+        // A response cut short is reported as not answered.
+        if (answered < count) responses[answered].status_code = 0;
+        pool.checkin(host, fd, open && answered == count);
+        return answered;
+    }
+
+} // namespace detail
+} // namespace NetClient
@@ -0,0 +1,166 @@
+#ifndef NETCLIENT_POSIX_HTTP_H
+#define NETCLIENT_POSIX_HTTP_H
+
+#include "NetClient.h"
+#include "HttpParser.h"
+#include "Metrics.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace NetClient {
+namespace detail {
+
+    using Clock = std::chrono::steady_clock;
+
+    // Waits until fd is ready for events or the deadline passes.
+    bool wait_fd(int fd, short events, Clock::time_point deadline);
+
+    // Resolves and connects to url's host, returning a non-blocking socket
+    // with Nagle disabled, or -1. Lookup and connect times are added to
+    // timing when given.
+    int connect_to(const Url& url, Clock::time_point deadline, Timing* timing = nullptr);
+
+    // Writes all of bytes to a non-blocking socket.
+    bool send_all(int fd, const std::string& bytes, Clock::time_point deadline);
+
+    // Keep-alive sockets grouped by host and port. Checkout prefers the most
+    // recently used idle socket and blocks while the host is at its limit.
+    class ConnectionPool {
+    public:
+        explicit ConnectionPool(const SessionOptions& config);
+        ~ConnectionPool();
+
+        // Returns a connected socket or -1. reused tells whether it carried
+        // an earlier request. The wait for a slot and, for a new socket,
+        // name lookup and connect are added to timing when given.
+        int checkout(const Url& url, Clock::time_point deadline, bool& reused, Timing* timing = nullptr);
+
+        // Non-blocking variant for the event loop: returns an idle socket, or
+        // -1 with reserved set when the caller may open a new connection, or
+        // -1 alone when the host is at its limit.
+        int try_acquire(const Url& url, bool& reserved);
+
+        // Returns fd to the pool, or closes it (fd may be -1 to give back a
+        // reserved slot) when it cannot carry another request.
+        void checkin(const Url& url, int fd, bool reusable);
+
+        // Called after every checkin, outside the pool lock.
+        void set_release_hook(std::function<void()> hook);
+
+        // Appends a line per host with busy, peak and idle sockets.
+        void describe(std::string& out);
+
+    private:
+        struct Idle {
+            int fd;
+            Clock::time_point since;
+        };
+
+        struct Host {
+            std::vector<Idle> idle;
+            int open = 0;
+            int peak_busy = 0;
+        };
+
+        static std::string key(const Url& url);
+        void prune(Host& host, Clock::time_point now);
+        int acquire_locked(Host& host, bool& reserved);
+
+        SessionOptions config_;
+        std::mutex mutex_;
+        std::condition_variable released_;
+        std::map<std::string, Host> hosts_;
+        std::function<void()> release_hook_;
+    };
+
+    std::string build_request(const std::string& method, const Url& url, const std::string& data,
+                              const std::map<std::string, std::string>& headers, bool accept_compressed);
+
+    // The head of a request whose body follows separately: Content-Length
+    // when the body's size is known, chunked transfer coding otherwise.
+    std::string build_upload_head(const std::string& method, const Url& url, const RequestBody& body,
+                                  const std::map<std::string, std::string>& headers, bool accept_compressed);
+
+    // Streams a RequestBody after the request head. Bytes and reader output
+    // are written from memory; files go from the page cache to the socket
+    // with sendfile(), or through a buffer with pread() where sendfile()
+    // cannot read them or use_sendfile is false. The socket is corked
+    // throughout so the head, chunk framing and body leave in full segments
+    // despite TCP_NODELAY.
+    class BodySender {
+    public:
+        enum class Failure { None, Socket, Source, Aborted };
+
+        BodySender(int fd, std::chrono::milliseconds timeout, bool use_sendfile = true);
+        ~BodySender();
+
+        // Chunked when the body's size is unknown, as build_upload_head()
+        // announced it.
+        bool send(const std::string& head, const RequestBody& body);
+
+        Failure failure() const { return failure_; }
+        // Once a reader has been called the body cannot be sent again.
+        bool consumed() const { return consumed_; }
+        uint64_t sent() const { return sent_; }
+
+    private:
+        bool write(const char* data, size_t len);
+        bool chunk_header(uint64_t len);
+        bool piece(const char* data, size_t len);
+        bool send_file(const std::string& path, uint64_t size);
+        bool copy_file(int file, off_t offset, uint64_t size);
+        bool send_reader(const RequestBody::Part& part);
+        bool fail(Failure failure);
+
+        static const size_t kBufferSize = 64 * 1024;
+
+        int fd_;
+        std::chrono::milliseconds timeout_;
+        bool use_sendfile_;
+        bool chunked_ = false;
+        bool consumed_ = false;
+        uint64_t sent_ = 0;
+        Failure failure_ = Failure::None;
+        std::vector<char> buffer_;
+    };
+
+    // HTTP/1.1 over non-blocking POSIX sockets. Plain http:// only; other
+    // schemes and transport failures yield status_code 0. With a sink the
+    // body is streamed to it instead of Response::text. With a body, data
+    // is ignored and the body is streamed after the head. timeout_ms of 0
+    // means config.request_timeout_ms.
+    Response posix_request(ConnectionPool& pool,
+                           const SessionOptions& config,
+                           const std::string& method,
+                           const std::string& url,
+                           const std::string& data,
+                           const std::map<std::string, std::string>& headers,
+                           const BodySink* sink = nullptr,
+                           int timeout_ms = 0,
+                           const RequestBody* body = nullptr);
+
+    // Writes requests, all to the host of the first, back to back on one
+    // keep-alive connection and reads their responses in order, keeping at
+    // most max_depth unanswered (HTTP/1.1 pipelining). The timeout bounds
+    // each wait rather than the whole exchange. Returns how many responses,
+    // from the front, were read in full into responses; the rest were not
+    // answered before the server closed the connection, sent something
+    // unreadable or stalled.
+    size_t posix_pipeline(ConnectionPool& pool,
+                          const SessionOptions& config,
+                          const std::vector<const BatchRequest*>& requests,
+                          std::vector<Response>& responses,
+                          size_t max_depth);
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_POSIX_HTTP_H
@@ -0,0 +1,106 @@
+#include "NetClient.h"
+#include "PartialFile.h"
+
+#include <cstdio>
+#include <random>
+
+namespace NetClient {
+
+    void RequestBody::add_bytes(std::string_view bytes) {
+        // Neighbouring bytes share a part, so they go out in one write.
+        if (parts_.empty() || parts_.back().kind != Part::Kind::Bytes) parts_.emplace_back();
+        parts_.back().data.append(bytes.data(), bytes.size());
+    }
+
+    bool RequestBody::add_file(const std::string& path) {
+        detail::PartialFile file;
+        if (!file.open_existing(path)) return false;
+        Part part;
+        part.kind = Part::Kind::File;
+        part.data = path;
+        part.size = file.size();
+        parts_.push_back(std::move(part));
+        return true;
+    }
+
+    void RequestBody::add_reader(Reader reader, uint64_t size) {
+        Part part;
+        part.kind = Part::Kind::Reader;
+        part.size = size;
+        part.reader = std::move(reader);
+        parts_.push_back(std::move(part));
+    }
+
+    uint64_t RequestBody::size() const {
+        uint64_t total = 0;
+        for (const Part& part : parts_) {
+            uint64_t size = part.kind == Part::Kind::Bytes ? part.data.size() : part.size;
+            if (size == kUnknownSize) return kUnknownSize;
+            total += size;
+        }
+        return total;
+    }
+
+    // Quotes and line breaks in names are percent-encoded, as browsers do.
+    static std::string quoted(const std::string& value) {
+        std::string out = "\"";
+        for (char c : value) {
+            if (c == '"') out += "%22";
+            else if (c == '\r') out += "%0D";
+            else if (c == '\n') out += "%0A";
+            else out += c;
+        }
+        return out + "\"";
+    }
+
+    MultipartForm::MultipartForm() {
+        std::random_device device;
+        std::mt19937_64 rng(((uint64_t)device() << 32) ^ device());
+        char suffix[17];
+        std::snprintf(suffix, sizeof(suffix), "%016llx", (unsigned long long)rng());
+        boundary_ = std::string("NetClientBoundary") + suffix;
+        body_.content_type = "multipart/form-data; boundary=" + boundary_;
+    }
+
+    void MultipartForm::begin_part(const std::string& name, const std::string* filename,
+                                   const std::string& content_type) {
+        std::string head = "--" + boundary_ + "\r\nContent-Disposition: form-data; name=" + quoted(name);
+        if (filename) head += "; filename=" + quoted(*filename);
+        head += "\r\n";
+        if (!content_type.empty()) head += "Content-Type: " + content_type + "\r\n";
+        head += "\r\n";
+        body_.add_bytes(head);
+    }
+
+    void MultipartForm::add_field(const std::string& name, std::string_view value) {
+        begin_part(name, nullptr, "");
+        body_.add_bytes(value);
+        body_.add_bytes("\r\n");
+    }
+
+    bool MultipartForm::add_file(const std::string& name, const std::string& path,
+                                 const std::string& filename, const std::string& content_type) {
+        RequestBody file;
+        if (!file.add_file(path)) return false;
+        std::string shown = filename;
+        if (shown.empty()) shown = path.substr(path.find_last_of("/\\") + 1);
+        begin_part(name, &shown, content_type);
+        body_.parts_.push_back(std::move(file.parts_.front()));
+        body_.add_bytes("\r\n");
+        return true;
+    }
+
+    void MultipartForm::add_reader(const std::string& name, const std::string& filename,
+                                   const std::string& content_type, RequestBody::Reader reader, uint64_t size) {
+        begin_part(name, &filename, content_type);
+        body_.add_reader(std::move(reader), size);
+        body_.add_bytes("\r\n");
+    }
+
+    RequestBody MultipartForm::body() const {
+        RequestBody body = body_;
+        body.add_bytes("--" + boundary_ + "--\r\n");
+        return body;
+    }
+
+} // namespace NetClient
@@ -0,0 +1,110 @@
+#include "RetryPolicy.h"
+#include "HttpParser.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+
+namespace NetClient {
+namespace detail {
+
+    bool is_idempotent(const std::string& method) {
+        return method == "GET" || method == "HEAD" || method == "OPTIONS" ||
+               method == "PUT" || method == "DELETE" || method == "TRACE";
+    }
+
+    // Errors that say the request never left this machine, so repeating
+    // it cannot apply it twice.
+    static bool never_sent(const Response& resp) {
+        return resp.error == "name lookup failed" || resp.error == "connect failed";
+    }
+
+    // Outcomes the caller chose or caused; another attempt ends the same way.
+    static bool final_error(const std::string& error) {
+        return error == "cancelled" || error == "aborted" || error == "unsupported url" ||
+               error == "response too large" || error == "circuit open";
+    }
+
+    bool should_retry(const RetryPolicy& policy, const std::string& method, const Response& resp) {
+        if (resp.status_code == 0) {
+            if (final_error(resp.error)) return false;
+            return policy.retry_non_idempotent || is_idempotent(method) || never_sent(resp);
+        }
+        if (std::find(policy.retry_statuses.begin(), policy.retry_statuses.end(), resp.status_code) ==
+            policy.retry_statuses.end()) {
+            return false;
+        }
+        return policy.retry_non_idempotent || is_idempotent(method);
+    }
+
+    bool counts_as_failure(const Response& resp) {
+        if (resp.status_code == 0) return !final_error(resp.error);
+        return resp.status_code >= 500;
+    }
+
+    // Retry-After is either delay-seconds or an HTTP-date.
+    static bool retry_after_ms(const Response& resp, int64_t& out) {
+        std::string value = resp.header("Retry-After");
+        if (value.empty()) return false;
+        char* end = nullptr;
+        long long seconds = std::strtoll(value.c_str(), &end, 10);
+        if (end != value.c_str() && *end == '\0') {
+            out = std::max(0LL, seconds) * 1000;
+            return true;
+        }
+        int64_t when = 0;
+        if (!parse_http_date(value, when)) return false;
+        out = std::max<int64_t>(0, when - (int64_t)std::time(nullptr)) * 1000;
+        return true;
+    }
+
+    int backoff_delay_ms(const RetryPolicy& policy, int attempt, const Response& resp) {
+        int64_t requested = 0;
+        if (retry_after_ms(resp, requested)) {
+            return requested > policy.max_delay_ms ? -1 : (int)requested;
+        }
+
+        int64_t bound = std::max(1, policy.base_delay_ms);
+        for (int i = 1; i < attempt && bound < policy.max_delay_ms; ++i) bound *= 2;
+        bound = std::min<int64_t>(bound, std::max(1, policy.max_delay_ms));
+
+        // Full jitter: clients that failed together spread out instead of
+        // retrying in lockstep.
+        thread_local std::mt19937 rng{std::random_device{}()};
+        return (int)std::uniform_int_distribution<int64_t>(0, bound)(rng);
+    }
+
+    static std::string host_of(const std::string& url) {
+        Url parsed;
+        if (!parse_url(url, parsed)) return url;
+        return parsed.host + ":" + std::to_string(parsed.port);
+    }
+
+    CircuitBreaker::CircuitBreaker(int threshold, int cooldown_ms)
+        : threshold_(threshold), cooldown_(cooldown_ms) {}
+
+    bool CircuitBreaker::allow(const std::string& url) {
+        std::string key = host_of(url);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Host& host = hosts_[key];
+        if (host.failures < threshold_) return true;
+        if (Clock::now() < host.open_until || host.trial) return false;
+        host.trial = true;
+        return true;
+    }
+
+    void CircuitBreaker::record(const std::string& url, bool failed) {
+        std::string key = host_of(url);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Host& host = hosts_[key];
+        host.trial = false;
+        if (!failed) {
+            host.failures = 0;
+            return;
+        }
+        if (++host.failures >= threshold_) host.open_until = Clock::now() + cooldown_;
+    }
+
+} // namespace detail
+} // namespace NetClient
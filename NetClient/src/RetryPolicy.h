@@ -0,0 +1,58 @@
+#ifndef NETCLIENT_RETRY_POLICY_H
+#define NETCLIENT_RETRY_POLICY_H
+
+#include "NetClient.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace NetClient {
+namespace detail {
+
+    bool is_idempotent(const std::string& method);
+
+    // True when resp is a failure another attempt might fix and the
+    // method allows repeating it. The attempt budget is the caller's.
+    bool should_retry(const RetryPolicy& policy, const std::string& method, const Response& resp);
+
+    // True for transport errors and 5xx, which count against a host's
+    // circuit breaker; cancellations and the caller's own limits do not.
+    bool counts_as_failure(const Response& resp);
+
+    // Wait before retry number attempt (1-based): Retry-After when the
+    // server sent one, otherwise a uniform pick up to the exponential
+    // bound. -1 when Retry-After asks for longer than max_delay_ms.
+    int backoff_delay_ms(const RetryPolicy& policy, int attempt, const Response& resp);
+
+    // Per-host breaker: closed until threshold consecutive failures, then
+    // open for cooldown_ms, then half-open with a single trial request.
+    class CircuitBreaker {
+    public:
+        CircuitBreaker(int threshold, int cooldown_ms);
+
+        // False while the host's breaker is open, or half-open with the
+        // trial request still under way.
+        bool allow(const std::string& url);
+        void record(const std::string& url, bool failed);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Host {
+            int failures = 0;
+            Clock::time_point open_until;
+            bool trial = false;
+        };
+
+        int threshold_;
+        std::chrono::milliseconds cooldown_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, Host> hosts_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_RETRY_POLICY_H
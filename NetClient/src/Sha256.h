@@ -0,0 +1,35 @@
+#ifndef NETCLIENT_SHA256_H
+#define NETCLIENT_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace NetClient {
+namespace detail {
+
+    // Incremental SHA-256 (FIPS 180-4), fed as download chunks arrive.
+    class Sha256 {
+    public:
+        Sha256();
+
+        void update(const void* data, size_t len);
+
+        // Lowercase hex digest. The object must be reset before reuse.
+        std::string finish_hex();
+
+        void reset();
+
+    private:
+        void compress(const uint8_t* block);
+
+        uint32_t state_[8];
+        uint8_t block_[64];
+        size_t block_len_;
+        uint64_t total_len_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_SHA256_H
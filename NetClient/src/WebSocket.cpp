@@ -0,0 +1,860 @@
+#include "NetClient.h"
+#include "WebSocket.h"
+#include "HttpParser.h"
+#include "Inflate.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winhttp.h>
+#else
+#include "PosixHttp.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace NetClient {
+namespace detail {
+
+    static uint32_t rotl(uint32_t x, int n) {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    // Only the opening handshake uses SHA-1, where RFC 6455 requires it.
+    static std::string sha1(const std::string& data) {
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::string msg = data;
+        uint64_t bits = (uint64_t)data.size() * 8;
+        msg.push_back((char)0x80);
+        while (msg.size() % 64 != 56) msg.push_back(0);
+        for (int i = 7; i >= 0; --i) msg.push_back((char)(bits >> (8 * i)));
+
+        for (size_t block = 0; block < msg.size(); block += 64) {
+            uint32_t w[80];
+            const uint8_t* p = (const uint8_t*)msg.data() + block;
+            for (int i = 0; i < 16; ++i) {
+                w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 |
+                       p[4 * i + 3];
+            }
+            for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t t = rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotl(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+
+        std::string digest;
+        for (uint32_t v : h) {
+            for (int i = 3; i >= 0; --i) digest.push_back((char)(v >> (8 * i)));
+        }
+        return digest;
+    }
+
+    std::string base64_encode(const void* data, size_t len) {
+        static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const uint8_t* p = (const uint8_t*)data;
+        std::string out;
+        out.reserve((len + 2) / 3 * 4);
+        for (size_t i = 0; i < len; i += 3) {
+            uint32_t v = (uint32_t)p[i] << 16;
+            if (i + 1 < len) v |= (uint32_t)p[i + 1] << 8;
+            if (i + 2 < len) v |= p[i + 2];
+            out.push_back(digits[v >> 18]);
+            out.push_back(digits[(v >> 12) & 63]);
+            out.push_back(i + 1 < len ? digits[(v >> 6) & 63] : '=');
+            out.push_back(i + 2 < len ? digits[v & 63] : '=');
+        }
+        return out;
+    }
+
+    std::string websocket_accept(const std::string& key) {
+        std::string digest = sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+        return base64_encode(digest.data(), digest.size());
+    }
+
+    bool valid_utf8(const char* data, size_t len) {
+        const uint8_t* p = (const uint8_t*)data;
+        const uint8_t* end = p + len;
+        while (p < end) {
+            uint8_t c = *p;
+            if (c < 0x80) {
+                ++p;
+                continue;
+            }
+            int extra;
+            uint32_t cp, min;
+            if ((c & 0xE0) == 0xC0) {
+                extra = 1;
+                cp = c & 0x1F;
+                min = 0x80;
+            } else if ((c & 0xF0) == 0xE0) {
+                extra = 2;
+                cp = c & 0x0F;
+                min = 0x800;
+            } else if ((c & 0xF8) == 0xF0) {
+                extra = 3;
+                cp = c & 0x07;
+                min = 0x10000;
+            } else {
+                return false;
+            }
+            if (end - p <= extra) return false;
+            for (int i = 1; i <= extra; ++i) {
+                if ((p[i] & 0xC0) != 0x80) return false;
+                cp = cp << 6 | (p[i] & 0x3F);
+            }
+            // Overlong forms, surrogates and code points past Unicode.
+            if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+            p += extra + 1;
+        }
+        return true;
+    }
+
+    void encode_frame(uint8_t opcode, bool fin, const char* data, size_t len, const uint8_t mask[4],
+                      std::string& out) {
+        out.push_back((char)((fin ? 0x80 : 0) | opcode));
+        if (len < 126) {
+            out.push_back((char)(0x80 | len));
+        } else if (len <= 0xFFFF) {
+            out.push_back((char)(0x80 | 126));
+            out.push_back((char)(len >> 8));
+            out.push_back((char)len);
+        } else {
+            out.push_back((char)(0x80 | 127));
+            for (int i = 7; i >= 0; --i) out.push_back((char)((uint64_t)len >> (8 * i)));
+        }
+        out.append((const char*)mask, 4);
+        size_t start = out.size();
+        out.append(data, len);
+        char* payload = &out[start];
+        for (size_t i = 0; i < len; ++i) payload[i] ^= (char)mask[i & 3];
+    }
+
+    void FrameReader::reset(uint64_t max_payload) {
+        state_ = State::Header;
+        header_.clear();
+        payload_left_ = 0;
+        max_payload_ = max_payload;
+        too_large_ = false;
+    }
+
+    bool FrameReader::fail() {
+        state_ = State::Error;
+        return false;
+    }
+
+    int FrameReader::parse_header() {
+        if (header_.size() < 2) return 0;
+        const uint8_t* p = (const uint8_t*)header_.data();
+        uint8_t opcode = p[0] & 0x0F;
+        bool control = (opcode & 0x08) != 0;
+        if ((p[0] & 0x30) || (p[1] & 0x80)) return -1;     // RSV2, RSV3, or a masked frame
+        if (opcode > (control ? kWsPong : kWsBinary)) return -1;
+
+        uint64_t length = p[1] & 0x7F;
+        size_t need = 2 + (length == 126 ? 2 : length == 127 ? 8 : 0);
+        if (header_.size() < need) return 0;
+        if (length == 126) {
+            length = (uint64_t)p[2] << 8 | p[3];
+        } else if (length == 127) {
+            length = 0;
+            for (int i = 0; i < 8; ++i) length = length << 8 | p[2 + i];
+        }
+
+        bool fin = (p[0] & 0x80) != 0;
+        bool rsv1 = (p[0] & 0x40) != 0;
+        if (control && (!fin || rsv1 || length > 125)) return -1;
+        if (length > max_payload_) {
+            too_large_ = true;
+            return -1;
+        }
+        frame_.opcode = opcode;
+        frame_.fin = fin;
+        frame_.rsv1 = rsv1;
+        frame_.payload.clear();
+        payload_left_ = length;
+        return 1;
+    }
+
+    bool FrameReader::feed(const char* data, size_t len, const Output& out) {
+        for (;;) {
+            switch (state_) {
+                case State::Header: {
+                    if (len == 0) return true;
+                    // Headers are at most 10 bytes; gathering them a byte at
+                    // a time keeps partial headers simple.
+                    header_.push_back(*data++);
+                    --len;
+                    int complete = parse_header();
+                    if (complete < 0) return fail();
+                    if (complete > 0) {
+                        header_.clear();
+                        state_ = State::Payload;
+                    }
+                    break;
+                }
+                case State::Payload: {
+                    size_t take = (size_t)std::min<uint64_t>(payload_left_, len);
+                    frame_.payload.append(data, take);
+                    data += take;
+                    len -= take;
+                    payload_left_ -= take;
+                    if (payload_left_ > 0) return true;
+                    state_ = State::Header;
+                    if (!out(frame_)) return fail();
+                    break;
+                }
+                case State::Error:
+                    return false;
+            }
+        }
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Fields shared by both transports. The connection's thread owns the
+    // message being assembled; the mutexes guard the rest.
+    struct WebSocketBase {
+        WebSocket::MessageHandler on_message;
+        WebSocket::CloseHandler on_close;
+        WebSocketOptions options;
+
+        mutable std::mutex mutex;           // guards error, protocol and finished
+        std::condition_variable finished_changed;
+        std::string error;
+        std::string protocol;
+        bool compressed = false;
+        bool finished = false;              // on_close has returned
+        std::atomic<bool> open{false};
+        std::thread reader;
+
+        std::mutex send_mutex;
+        bool close_sent = false;
+        Clock::time_point close_deadline = Clock::time_point::max();
+
+        int close_code = 1006;
+        std::string close_reason = "connection lost";
+        std::string message;
+
+        bool connect_failed(const std::string& why) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = why;
+            return false;
+        }
+
+        // Runs on the connection's thread once it stops reading.
+        void finish() {
+            open = false;
+            if (on_close) on_close(close_code, close_reason);
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            finished_changed.notify_all();
+        }
+    };
+
+} // namespace detail
+
+    using detail::Clock;
+
+    static std::string close_payload(int code, const std::string& reason) {
+        std::string payload;
+        payload.push_back((char)(code >> 8));
+        payload.push_back((char)code);
+        // Control frames carry at most 125 bytes.
+        payload += reason.substr(0, 123);
+        return payload;
+    }
+
+#ifdef _WIN32
+    static std::wstring widen(const std::string& text) {
+        if (text.empty()) return std::wstring();
+        int len = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0);
+        std::wstring out(len, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &out[0], len);
+        return out;
+    }
+
+    static std::string narrow(const wchar_t* text, size_t size) {
+        if (size == 0) return std::string();
+        int len = WideCharToMultiByte(CP_UTF8, 0, text, (int)size, nullptr, 0, nullptr, nullptr);
+        std::string out(len, '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text, (int)size, &out[0], len, nullptr, nullptr);
+        return out;
+    }
+
+    // WinHTTP performs the handshake, masking, fragmentation and pings
+    // itself, on Windows 8 and later. It does not negotiate extensions, so
+    // messages arrive uncompressed, and it pings at its own keep-alive
+    // interval of at least 15 seconds.
+    struct WebSocket::Impl : detail::WebSocketBase {
+        HINTERNET session = nullptr;
+        HINTERNET connection = nullptr;
+        HINTERNET socket = nullptr;
+
+        ~Impl() {
+            if (socket) WinHttpCloseHandle(socket);
+            if (connection) WinHttpCloseHandle(connection);
+            if (session) WinHttpCloseHandle(session);
+        }
+
+        bool handshake(const std::string& url) {
+            std::wstring wide_url = widen(url);
+            URL_COMPONENTS parts = {0};
+            parts.dwStructSize = sizeof(parts);
+            parts.dwHostNameLength = (DWORD)-1;
+            parts.dwUrlPathLength = (DWORD)-1;
+            parts.dwExtraInfoLength = (DWORD)-1;
+            if (!WinHttpCrackUrl(wide_url.c_str(), (DWORD)wide_url.size(), 0, &parts)) {
+                return connect_failed("unsupported url");
+            }
+            std::wstring host(parts.lpszHostName, parts.dwHostNameLength);
+            std::wstring path = parts.dwUrlPathLength ? std::wstring(parts.lpszUrlPath) : std::wstring(L"/");
+
+            session = WinHttpOpen(L"NetClient/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME,
+                                  WINHTTP_NO_PROXY_BYPASS, 0);
+            if (!session) return connect_failed("connect failed");
+            int timeout = options.timeout_ms;
+            WinHttpSetTimeouts(session, timeout, timeout, timeout, timeout);
+            if (options.ping_interval_ms > 0) {
+                DWORD interval = (DWORD)std::max<int>(15000, options.ping_interval_ms);
+                WinHttpSetOption(session, WINHTTP_OPTION_WEB_SOCKET_KEEPALIVE_INTERVAL, &interval, sizeof(interval));
+            }
+            connection = WinHttpConnect(session, host.c_str(), parts.nPort, 0);
+            if (!connection) return connect_failed("connect failed");
+
+            DWORD flags = parts.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0;
+            HINTERNET request = WinHttpOpenRequest(connection, L"GET", path.c_str(), nullptr, WINHTTP_NO_REFERER,
+                                                   WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+            if (!request) return connect_failed("connect failed");
+            WinHttpSetOption(request, WINHTTP_OPTION_UPGRADE_TO_WEB_SOCKET, nullptr, 0);
+
+            std::map<std::string, std::string> headers = options.headers;
+            if (!options.protocols.empty()) {
+                std::string offered;
+                for (const std::string& name : options.protocols) offered += (offered.empty() ? "" : ", ") + name;
+                headers["Sec-WebSocket-Protocol"] = offered;
+            }
+            for (const auto& header : headers) {
+                std::wstring line = widen(header.first + ": " + header.second);
+                WinHttpAddRequestHeaders(request, line.c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD);
+            }
+
+            DWORD status = 0;
+            DWORD size = sizeof(status);
+            bool sent = WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) &&
+                        WinHttpReceiveResponse(request, nullptr) &&
+                        WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                                            WINHTTP_HEADER_NAME_BY_INDEX, &status, &size, WINHTTP_NO_HEADER_INDEX);
+            if (!sent || status != 101) {
+                WinHttpCloseHandle(request);
+                return connect_failed(sent ? "handshake failed (HTTP " + std::to_string(status) + ")"
+                                           : "connect failed");
+            }
+
+            wchar_t chosen[256];
+            size = sizeof(chosen);
+            if (WinHttpQueryHeaders(request, WINHTTP_QUERY_CUSTOM, L"Sec-WebSocket-Protocol", chosen, &size,
+                                    WINHTTP_NO_HEADER_INDEX)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                protocol = narrow(chosen, size / sizeof(wchar_t));
+            }
+
+            socket = WinHttpWebSocketCompleteUpgrade(request, 0);
+            WinHttpCloseHandle(request);
+            if (!socket) return connect_failed("handshake failed");
+            return true;
+        }
+
+        bool send_message(bool binary, const std::string& data) {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            if (close_sent || !socket) return false;
+            WINHTTP_WEB_SOCKET_BUFFER_TYPE type = binary ? WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE
+                                                         : WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE;
+            return WinHttpWebSocketSend(socket, type, (PVOID)data.data(), (DWORD)data.size()) == NO_ERROR;
+        }
+
+        void send_close(int code, const std::string& reason) {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            if (close_sent || !socket) return;
+            close_sent = true;
+            close_deadline = Clock::now() + std::chrono::milliseconds(options.timeout_ms);
+            std::string text = reason.substr(0, 123);
+            WinHttpWebSocketShutdown(socket, (USHORT)code, text.empty() ? nullptr : (PVOID)text.data(),
+                                     (DWORD)text.size());
+        }
+
+        // Closing the handle fails the pending receive.
+        void abort() {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            if (socket) WinHttpCloseHandle(socket);
+            socket = nullptr;
+            close_sent = true;
+        }
+
+        void run(std::string) {
+            std::vector<char> buffer(64 * 1024);
+            HINTERNET handle = socket;
+            for (;;) {
+                DWORD read = 0;
+                WINHTTP_WEB_SOCKET_BUFFER_TYPE type;
+                if (WinHttpWebSocketReceive(handle, buffer.data(), (DWORD)buffer.size(), &read, &type) != NO_ERROR) {
+                    break;
+                }
+                if (type == WINHTTP_WEB_SOCKET_CLOSE_BUFFER_TYPE) {
+                    USHORT status = 0;
+                    BYTE reason[123];
+                    DWORD length = 0;
+                    close_code = 1005;
+                    close_reason.clear();
+                    if (WinHttpWebSocketQueryCloseStatus(handle, &status, reason, sizeof(reason), &length) == NO_ERROR) {
+                        close_code = status;
+                        close_reason.assign((const char*)reason, length);
+                    }
+                    // Completes the handshake the server started.
+                    send_close(close_code, "");
+                    break;
+                }
+                if (message.size() + read > options.max_message_bytes) {
+                    send_close(1009, "message too big");
+                    close_code = 1009;
+                    close_reason = "message too big";
+                    break;
+                }
+                message.append(buffer.data(), read);
+                if (type == WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE ||
+                    type == WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE) {
+                    if (on_message) on_message(message, type == WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE);
+                    message.clear();
+                }
+            }
+            finish();
+        }
+    };
+#else
+    // Fills out from the kernel's CSPRNG. Frame masks must be unpredictable
+    // to whoever chooses the payload (RFC 6455 section 10.3), which rules
+    // out a seeded generator. WinHTTP masks its frames itself.
+    static bool secure_random(uint8_t* out, size_t len) {
+#ifdef __linux__
+        while (len > 0) {
+            ssize_t n = ::getrandom(out, len, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;      // ENOSYS on old kernels: read the device instead
+            out += n;
+            len -= (size_t)n;
+        }
+        if (len == 0) return true;
+#endif
+        int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        while (len > 0) {
+            ssize_t n = ::read(fd, out, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            out += n;
+            len -= (size_t)n;
+        }
+        ::close(fd);
+        return len == 0;
+    }
+
+    struct WebSocket::Impl : detail::WebSocketBase {
+        int fd = -1;
+        uint8_t masks[256];                 // random bytes for the next 64 frames
+        size_t masks_used = sizeof(masks);
+        detail::FrameReader frames;
+        detail::Inflater inflater;
+        bool reset_inflater = false;        // the server compresses each message on its own
+        bool in_message = false;
+        bool message_binary = false;
+        bool message_compressed = false;
+        bool too_big = false;
+        bool stopping = false;
+
+        ~Impl() {
+            if (fd >= 0) ::close(fd);
+        }
+
+        bool handshake(const std::string& url) {
+            detail::Url parsed;
+            if (!detail::parse_url(url, parsed) || parsed.secure) return connect_failed("unsupported url");
+
+            std::chrono::milliseconds timeout(options.timeout_ms);
+            Clock::time_point deadline = Clock::now() + timeout;
+            fd = detail::connect_to(parsed, deadline);
+            if (fd < 0) return connect_failed(Clock::now() >= deadline ? "timeout" : "connect failed");
+
+            uint8_t nonce[16];
+            if (!secure_random(nonce, sizeof(nonce))) return connect_failed("no random source");
+            std::string key = detail::base64_encode(nonce, sizeof(nonce));
+
+            std::map<std::string, std::string> headers = options.headers;
+            headers["Upgrade"] = "websocket";
+            headers["Connection"] = "Upgrade";
+            headers["Sec-WebSocket-Key"] = key;
+            headers["Sec-WebSocket-Version"] = "13";
+            if (options.compress) {
+                // We never compress, so the server may drop its inflate
+                // state between our messages.
+                headers["Sec-WebSocket-Extensions"] = "permessage-deflate; client_no_context_takeover";
+            }
+            if (!options.protocols.empty()) {
+                std::string offered;
+                for (const std::string& name : options.protocols) offered += (offered.empty() ? "" : ", ") + name;
+                headers["Sec-WebSocket-Protocol"] = offered;
+            }
+            std::string request = detail::build_request("GET", parsed, "", headers, false);
+            if (!detail::send_all(fd, request, deadline)) return connect_failed("connect failed");
+
+            // The 101 head carries no body; frames may follow in the same read.
+            Response head;
+            head.status_code = 0;
+            detail::ResponseParser parser;
+            parser.reset(true);
+            std::string pending;
+            char buffer[4096];
+            while (!parser.done()) {
+                ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    size_t used = parser.feed(buffer, (size_t)n, head);
+                    if (parser.failed()) return connect_failed("bad response");
+                    pending.assign(buffer + used, (size_t)n - used);
+                } else if (n == 0) {
+                    return connect_failed("connection closed");
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (!detail::wait_fd(fd, POLLIN, deadline)) return connect_failed("timeout");
+                } else if (errno != EINTR) {
+                    return connect_failed("connection failed");
+                }
+            }
+
+            if (head.status_code != 101) {
+                return connect_failed("handshake failed (HTTP " + std::to_string(head.status_code) + ")");
+            }
+            std::string upgrade = detail::header_value(head.headers, "Upgrade");
+            std::transform(upgrade.begin(), upgrade.end(), upgrade.begin(), ::tolower);
+            if (upgrade != "websocket" ||
+                detail::header_value(head.headers, "Sec-WebSocket-Accept") != detail::websocket_accept(key)) {
+                return connect_failed("handshake failed");
+            }
+
+            std::string extensions = detail::header_value(head.headers, "Sec-WebSocket-Extensions");
+            if (!extensions.empty()) {
+                if (!options.compress || extensions.find("permessage-deflate") == std::string::npos) {
+                    return connect_failed("handshake failed (unexpected extension)");
+                }
+                compressed = true;
+                reset_inflater = extensions.find("server_no_context_takeover") != std::string::npos;
+                inflater.reset(detail::Inflater::Format::Raw, UINT64_MAX);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                protocol = detail::header_value(head.headers, "Sec-WebSocket-Protocol");
+            }
+            frames.reset(options.max_message_bytes);
+            message_pending = pending;
+            return true;
+        }
+
+        std::string message_pending;    // frame bytes read with the handshake
+
+        bool send_frame(uint8_t opcode, const char* data, size_t len) {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            if (close_sent) return false;
+            if (masks_used == sizeof(masks)) {
+                if (!secure_random(masks, sizeof(masks))) return false;
+                masks_used = 0;
+            }
+            const uint8_t* mask = masks + masks_used;
+            masks_used += 4;
+            std::string frame;
+            frame.reserve(len + 14);
+            detail::encode_frame(opcode, true, data, len, mask, frame);
+            if (opcode == detail::kWsClose) {
+                close_sent = true;
+                close_deadline = Clock::now() + std::chrono::milliseconds(options.timeout_ms);
+            }
+            return detail::send_all(fd, frame, Clock::now() + std::chrono::milliseconds(options.timeout_ms));
+        }
+
+        bool send_message(bool binary, const std::string& data) {
+            return send_frame(binary ? detail::kWsBinary : detail::kWsText, data.data(), data.size());
+        }
+
+        void send_close(int code, const std::string& reason) {
+            std::string payload = close_payload(code, reason);
+            send_frame(detail::kWsClose, payload.data(), payload.size());
+        }
+
+        // Wakes the reader, whose next recv() then sees the end.
+        void abort() {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+
+        // Sends a close frame for an error found in the stream and stops.
+        bool fail(int code, const char* reason) {
+            send_close(code, reason);
+            close_code = code;
+            close_reason = reason;
+            stopping = true;
+            return false;
+        }
+
+        bool append(const char* data, size_t len) {
+            auto out = [this](const char* bytes, size_t n) {
+                if (message.size() + n > options.max_message_bytes) {
+                    too_big = true;
+                    return false;
+                }
+                message.append(bytes, n);
+                return true;
+            };
+            return message_compressed ? inflater.feed(data, len, out) : out(data, len);
+        }
+
+        bool on_frame(detail::WsFrame& frame) {
+            switch (frame.opcode) {
+                case detail::kWsPing:
+                    send_frame(detail::kWsPong, frame.payload.data(), frame.payload.size());
+                    return true;
+                case detail::kWsPong:
+                    return true;
+                case detail::kWsClose: {
+                    const std::string& payload = frame.payload;
+                    if (payload.size() == 1 || !detail::valid_utf8(payload.data() + std::min<size_t>(2, payload.size()),
+                                                                   payload.size() - std::min<size_t>(2, payload.size()))) {
+                        return fail(1002, "protocol error");
+                    }
+                    close_code = payload.empty() ? 1005 : ((uint8_t)payload[0] << 8 | (uint8_t)payload[1]);
+                    close_reason = payload.size() > 2 ? payload.substr(2) : std::string();
+                    // Echoes the code unless we started the handshake.
+                    send_frame(detail::kWsClose, payload.data(), std::min<size_t>(2, payload.size()));
+                    stopping = true;
+                    return false;
+                }
+                case detail::kWsText:
+                case detail::kWsBinary:
+                    if (in_message || (frame.rsv1 && !compressed)) return fail(1002, "protocol error");
+                    in_message = true;
+                    message_binary = frame.opcode == detail::kWsBinary;
+                    message_compressed = frame.rsv1;
+                    message.clear();
+                    break;
+                default:
+                    if (!in_message || frame.rsv1) return fail(1002, "protocol error");
+                    break;
+            }
+
+            if (!append(frame.payload.data(), frame.payload.size())) {
+                return too_big ? fail(1009, "message too big") : fail(1007, "bad compressed data");
+            }
+            if (!frame.fin) return true;
+            in_message = false;
+
+            if (message_compressed) {
+                // The sender stripped this empty block off the end of the message.
+                static const char tail[4] = {0, 0, (char)0xFF, (char)0xFF};
+                if (!append(tail, sizeof(tail))) {
+                    return too_big ? fail(1009, "message too big") : fail(1007, "bad compressed data");
+                }
+                if (reset_inflater || inflater.done()) inflater.reset(detail::Inflater::Format::Raw, UINT64_MAX);
+            }
+            if (!message_binary && !detail::valid_utf8(message.data(), message.size())) {
+                return fail(1007, "invalid UTF-8");
+            }
+            if (on_message) on_message(message, message_binary);
+            return true;
+        }
+
+        // False once reading should stop.
+        bool feed(const char* data, size_t len) {
+            bool ok = frames.feed(data, len, [this](detail::WsFrame& frame) { return on_frame(frame); });
+            if (!ok && !stopping) {
+                if (frames.too_large()) fail(1009, "message too big");
+                else fail(1002, "protocol error");
+            }
+            return ok;
+        }
+
+        void run(std::string pending) {
+            using std::chrono::milliseconds;
+            const milliseconds ping_interval(options.ping_interval_ms);
+            const milliseconds pong_timeout(options.pong_timeout_ms);
+            Clock::time_point last_heard = Clock::now();
+            Clock::time_point ping_sent_at;
+            bool ping_sent = false;
+            char buffer[16 * 1024];
+
+            bool reading = pending.empty() || feed(pending.data(), pending.size());
+            while (reading) {
+                // Sleep until data arrives or a ping, its answer, or the
+                // answer to our close frame is due.
+                Clock::time_point wake = Clock::time_point::max();
+                if (options.ping_interval_ms > 0) {
+                    wake = ping_sent ? ping_sent_at + pong_timeout : last_heard + ping_interval;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(send_mutex);
+                    wake = std::min(wake, close_deadline);
+                }
+                int wait_ms = -1;
+                if (wake != Clock::time_point::max()) {
+                    auto left = std::chrono::duration_cast<milliseconds>(wake - Clock::now()).count();
+                    wait_ms = (int)std::max<long long>(0, std::min<long long>(left + 1, INT32_MAX));
+                }
+
+                pollfd pfd = {fd, POLLIN, 0};
+                int rc = ::poll(&pfd, 1, wait_ms);
+                if (rc < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                Clock::time_point now = Clock::now();
+                if (rc == 0) {
+                    {
+                        std::lock_guard<std::mutex> lock(send_mutex);
+                        if (now >= close_deadline) break;
+                    }
+                    if (ping_sent && now >= ping_sent_at + pong_timeout) {
+                        close_reason = "ping timeout";
+                        break;
+                    }
+                    if (!ping_sent && options.ping_interval_ms > 0 && now >= last_heard + ping_interval) {
+                        send_frame(detail::kWsPing, nullptr, 0);
+                        ping_sent = true;
+                        ping_sent_at = now;
+                    }
+                    continue;
+                }
+
+                ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    // Any data shows the connection is alive.
+                    last_heard = now;
+                    ping_sent = false;
+                    reading = feed(buffer, (size_t)n);
+                } else if (n == 0) {
+                    break;
+                } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    break;
+                }
+            }
+            ::shutdown(fd, SHUT_RDWR);
+            finish();
+        }
+    };
+#endif
+
+    WebSocket::WebSocket(MessageHandler on_message, CloseHandler on_close) : impl_(new Impl()) {
+        impl_->on_message = std::move(on_message);
+        impl_->on_close = std::move(on_close);
+    }
+
+    WebSocket::~WebSocket() {
+        close(1001, "going away");
+        if (impl_->reader.joinable()) {
+            impl_->abort();
+            impl_->reader.join();
+        }
+        delete impl_;
+    }
+
+    bool WebSocket::connect(const std::string& url, const WebSocketOptions& options) {
+        if (impl_->reader.joinable()) return impl_->connect_failed("already connected");
+        impl_->options = options;
+
+        // The handshake is an HTTP request, made to the matching scheme.
+        std::string http_url = url;
+        if (url.compare(0, 5, "ws://") == 0) http_url = "http://" + url.substr(5);
+        else if (url.compare(0, 6, "wss://") == 0) http_url = "https://" + url.substr(6);
+        else return impl_->connect_failed("unsupported url");
+        if (!impl_->handshake(http_url)) return false;
+
+        impl_->open = true;
+#ifdef _WIN32
+        std::string pending;
+#else
+        std::string pending = std::move(impl_->message_pending);
+#endif
+        impl_->reader = std::thread([this, pending] { impl_->run(pending); });
+        return true;
+    }
+
+    bool WebSocket::send_text(const std::string& message) {
+        return impl_->open && impl_->send_message(false, message);
+    }
+
+    bool WebSocket::send_binary(const std::string& message) {
+        return impl_->open && impl_->send_message(true, message);
+    }
+
+    void WebSocket::close(int code, const std::string& reason) {
+        if (!impl_->open) return;
+        impl_->send_close(code, reason);
+        if (std::this_thread::get_id() == impl_->reader.get_id()) return;
+
+        std::unique_lock<std::mutex> lock(impl_->mutex);
+        bool answered = impl_->finished_changed.wait_for(lock, std::chrono::milliseconds(impl_->options.timeout_ms),
+                                                         [this] { return impl_->finished; });
+        lock.unlock();
+        if (!answered) impl_->abort();
+    }
+
+    bool WebSocket::is_open() const {
+        return impl_->open;
+    }
+
+    std::string WebSocket::error() const {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        return impl_->error;
+    }
+
+    std::string WebSocket::protocol() const {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        return impl_->protocol;
+    }
+
+    bool WebSocket::compressed() const {
+        return impl_->compressed;
+    }
+
+} // namespace NetClient
@@ -0,0 +1,76 @@
+#ifndef NETCLIENT_WEBSOCKET_H
+#define NETCLIENT_WEBSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace NetClient {
+namespace detail {
+
+    // Frame opcodes (RFC 6455 section 5.2).
+    enum : uint8_t {
+        kWsContinuation = 0x0,
+        kWsText = 0x1,
+        kWsBinary = 0x2,
+        kWsClose = 0x8,
+        kWsPing = 0x9,
+        kWsPong = 0xA,
+    };
+
+    std::string base64_encode(const void* data, size_t len);
+
+    // The Sec-WebSocket-Accept a server must answer key with.
+    std::string websocket_accept(const std::string& key);
+
+    // True when data is well-formed UTF-8, as text messages must be.
+    bool valid_utf8(const char* data, size_t len);
+
+    // Appends one frame to out, masked with mask as every client frame is.
+    void encode_frame(uint8_t opcode, bool fin, const char* data, size_t len, const uint8_t mask[4],
+                      std::string& out);
+
+    struct WsFrame {
+        uint8_t opcode = 0;
+        bool fin = false;
+        bool rsv1 = false;      // set on the first frame of a compressed message
+        std::string payload;
+    };
+
+    // Splits the byte stream from a server into frames. Input may be split at
+    // any byte. Masked frames, RSV2/RSV3, unknown opcodes and malformed
+    // control frames are protocol errors; so is a payload over max_payload.
+    class FrameReader {
+    public:
+        typedef std::function<bool(WsFrame& frame)> Output;
+
+        void reset(uint64_t max_payload);
+
+        // Hands each complete frame to out. Returns false on a protocol
+        // error, a payload that is too large, or when out returns false.
+        bool feed(const char* data, size_t len, const Output& out);
+
+        bool failed() const { return state_ == State::Error; }
+        bool too_large() const { return too_large_; }
+
+    private:
+        enum class State { Header, Payload, Error };
+
+        // 1 when the header in header_ is complete, 0 when it needs more
+        // bytes, -1 on error.
+        int parse_header();
+        bool fail();
+
+        State state_ = State::Header;
+        std::string header_;
+        uint64_t payload_left_ = 0;
+        uint64_t max_payload_ = 0;
+        bool too_large_ = false;
+        WsFrame frame_;
+    };
+
+} // namespace detail
+} // namespace NetClient
+
+#endif // NETCLIENT_WEBSOCKET_H
@@ -0,0 +1,198 @@
+// Keep-alive pooling and request lifetimes of the POSIX transport, against
+// a loopback server.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "HttpParser.h"
+#include "PosixHttp.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::Response;
+using NetClient::Session;
+using NetClient::SessionOptions;
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool answer(Connection& conn, const HttpRequest& request) {
+    return conn.send(http_response(200, "ok " + request.target));
+}
+
+static void test_keep_alive_reuse() {
+    LoopbackServer server(answer);
+    CHECK(server.start());
+    Session session;
+
+    Response first = session.get(server.url("/a"));
+    Response second = session.get(server.url("/b"));
+    CHECK(first.status_code == 200 && first.text == "ok /a");
+    CHECK(second.status_code == 200 && second.text == "ok /b");
+    CHECK(!first.reused_connection);
+    CHECK(second.reused_connection);
+    CHECK(server.connections() == 1);
+}
+
+static void test_checkout_blocks_at_host_limit() {
+    LoopbackServer server(answer);
+    CHECK(server.start());
+    SessionOptions config;
+    config.max_connections_per_host = 1;
+    NetClient::detail::ConnectionPool pool(config);
+    NetClient::detail::Url url;
+    CHECK(NetClient::detail::parse_url(server.url("/"), url));
+
+    bool reused = true;
+    int fd = pool.checkout(url, Clock::now() + std::chrono::seconds(2), reused);
+    CHECK(fd >= 0);
+    CHECK(!reused);
+
+    // At the limit, a checkout with a short deadline gives up.
+    Clock::time_point start = Clock::now();
+    bool ignored = false;
+    CHECK(pool.checkout(url, Clock::now() + std::chrono::milliseconds(100), ignored) < 0);
+    CHECK(ms_since(start) >= 90);
+
+    // A waiting checkout gets the socket back when it is checked in.
+    std::atomic<bool> checked_in{false};
+    std::future<int> waiter = std::async(std::launch::async, [&] {
+        bool again = false;
+        int second = pool.checkout(url, Clock::now() + std::chrono::seconds(2), again);
+        CHECK(checked_in);
+        CHECK(again);
+        return second;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    checked_in = true;
+    pool.checkin(url, fd, true);
+    CHECK(waiter.get() == fd);
+    pool.checkin(url, fd, true);
+    CHECK(server.connections() == 1);
+}
+
+static void test_session_queues_at_host_limit() {
+    LoopbackServer server([](Connection& conn, const HttpRequest& request) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        return answer(conn, request);
+    });
+    CHECK(server.start());
+    SessionOptions config;
+    config.max_connections_per_host = 1;
+    Session session(config);
+
+    std::future<Response> a = std::async(std::launch::async, [&] { return session.get(server.url("/a")); });
+    std::future<Response> b = std::async(std::launch::async, [&] { return session.get(server.url("/b")); });
+    Response ra = a.get();
+    Response rb = b.get();
+    CHECK(ra.ok() && rb.ok());
+    // One of them waited for the other's connection.
+    CHECK(std::max(ra.timing.queued, rb.timing.queued) >= 100);
+    CHECK(server.connections() == 1);
+}
+
+static void test_stale_reused_socket_is_retried() {
+    // The server drops the connection on its second request unanswered, as
+    // one does when its keep-alive timer fires just as a request arrives.
+    LoopbackServer server([](Connection& conn, const HttpRequest& request) {
+        if (request.sequence == 2) return false;
+        return answer(conn, request);
+    });
+    CHECK(server.start());
+    Session session;
+
+    CHECK(session.get(server.url("/first")).ok());
+    Response resp = session.get(server.url("/second"));
+    CHECK(resp.status_code == 200 && resp.text == "ok /second");
+    CHECK(!resp.reused_connection);
+    CHECK(server.connections() == 2);
+}
+
+static void test_timeouts() {
+    LoopbackServer server([](Connection& conn, const HttpRequest&) {
+        conn.hang();
+        return false;
+    });
+    CHECK(server.start());
+    SessionOptions config;
+    config.request_timeout_ms = 200;
+    Session session(config);
+
+    Clock::time_point start = Clock::now();
+    Response resp = session.get(server.url("/slow"));
+    CHECK(resp.status_code == 0);
+    CHECK(resp.error == "timeout");
+    CHECK(ms_since(start) >= 190 && ms_since(start) < 2000);
+
+    start = Clock::now();
+    Response async = session.request_async("GET", server.url("/slow"), "", {}, 150).response.get();
+    CHECK(async.status_code == 0);
+    CHECK(async.error == "timeout");
+    CHECK(ms_since(start) >= 140 && ms_since(start) < 2000);
+}
+
+static void test_cancel() {
+    LoopbackServer server([](Connection& conn, const HttpRequest&) {
+        conn.hang();
+        return false;
+    });
+    CHECK(server.start());
+    Session session;
+
+    std::promise<Response> done;
+    std::atomic<int> completions{0};
+    NetClient::RequestId id = session.send_async("GET", server.url("/never"), "", {}, [&](Response resp) {
+        if (completions++ == 0) done.set_value(std::move(resp));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Clock::time_point start = Clock::now();
+    session.cancel(id);
+    std::future<Response> result = done.get_future();
+    CHECK(result.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    Response resp = result.get();
+    CHECK(resp.status_code == 0);
+    CHECK(resp.error == "cancelled");
+    CHECK(ms_since(start) < 1000);
+
+    // Cancelling again, or after completion, changes nothing.
+    session.cancel(id);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(completions == 1);
+}
+
+static void test_async_requests_share_connections() {
+    LoopbackServer server(answer);
+    CHECK(server.start());
+    SessionOptions config;
+    config.max_connections_per_host = 2;
+    Session session(config);
+
+    std::vector<NetClient::AsyncResponse> pending;
+    for (int i = 0; i < 20; ++i) {
+        pending.push_back(session.request_async("GET", server.url("/item/" + std::to_string(i))));
+    }
+    for (int i = 0; i < 20; ++i) {
+        Response resp = pending[i].response.get();
+        CHECK(resp.ok() && resp.text == "ok /item/" + std::to_string(i));
+    }
+    CHECK(server.connections() <= 2);
+}
+
+int main() {
+    test_keep_alive_reuse();
+    test_checkout_blocks_at_host_limit();
+    test_session_queues_at_host_limit();
+    test_stale_reused_socket_is_retried();
+    test_timeouts();
+    test_cancel();
+    test_async_requests_share_connections();
+    return test_result();
+}
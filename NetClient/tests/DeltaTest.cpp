@@ -0,0 +1,382 @@
+// Binary deltas: encode_delta round trips with the delta fed in arbitrary
+// pieces, the patcher's rejections, and download_delta against a loopback
+// file server, including the scheduler's fallback to a full download.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include "Delta.h"
+#include "PartialFile.h"
+#include "Sha256.h"
+
+#include <atomic>
+#include <map>
+#include <random>
+
+using namespace NetClientTest;
+using NetClient::DownloadResult;
+using NetClient::Session;
+using NetClient::detail::DeltaPatcher;
+using NetClient::detail::PartialFile;
+
+static std::string random_bytes(std::mt19937& rng, size_t len) {
+    std::string out(len, '\0');
+    for (char& c : out) c = (char)(rng() & 0xff);
+    return out;
+}
+
+static std::string sha256_of(const std::string& bytes) {
+    NetClient::detail::Sha256 sha;
+    sha.update(bytes.data(), bytes.size());
+    return sha.finish_hex();
+}
+
+// Applies delta to the base stored at base_path, feeding it in pieces of
+// random length up to max_piece. False when the patcher rejects it.
+static bool apply(const std::string& base_path, const std::string& delta, size_t max_piece, std::mt19937& rng,
+                  std::string& target, DeltaPatcher& patcher) {
+    PartialFile base;
+    if (!base.open_existing(base_path)) return false;
+    patcher.reset(&base, NetClient::file_sha256(base_path));
+    target.clear();
+    DeltaPatcher::Output out = [&](const char* data, size_t len) {
+        target.append(data, len);
+        return true;
+    };
+    size_t at = 0;
+    while (at < delta.size()) {
+        size_t piece = std::min<size_t>(delta.size() - at, 1 + rng() % max_piece);
+        if (!patcher.feed(delta.data() + at, piece, out)) return false;
+        at += piece;
+    }
+    return true;
+}
+
+struct Edit {
+    const char* name;
+    std::string base;
+    std::string target;
+};
+
+static std::vector<Edit> sample_edits(std::mt19937& rng) {
+    std::string base = random_bytes(rng, 300 * 1024);
+    std::vector<Edit> edits;
+    edits.push_back({"identical", base, base});
+    edits.push_back({"empty base", "", random_bytes(rng, 5000)});
+    edits.push_back({"empty target", base, ""});
+    edits.push_back({"unrelated", base, random_bytes(rng, 20000)});
+
+    std::string changed = base;
+    changed.replace(100000, 50, random_bytes(rng, 50));
+    edits.push_back({"replace", base, changed});
+
+    std::string inserted = base;
+    inserted.insert(150001, random_bytes(rng, 777));
+    edits.push_back({"insert", base, inserted});
+
+    std::string removed = base;
+    removed.erase(12345, 4096);
+    edits.push_back({"remove", base, removed});
+
+    // Moved blocks, a new prefix and a repeated tail.
+    std::string shuffled = random_bytes(rng, 10) + base.substr(200000) + base.substr(0, 200000) + base.substr(0, 3000);
+    edits.push_back({"shuffle", base, shuffled});
+    return edits;
+}
+
+static void test_round_trip_with_arbitrary_splits() {
+    std::mt19937 rng(42);
+    std::string base_path = temp_path("delta-base");
+    for (const Edit& edit : sample_edits(rng)) {
+        CHECK(write_file(base_path, edit.base));
+        std::string delta;
+        NetClient::detail::encode_delta(edit.base, edit.target, delta);
+        CHECK(delta.size() >= NetClient::detail::kDeltaHeaderSize);
+
+        // One byte at a time, small pieces, and pieces beyond the 64 KB copy buffer.
+        for (size_t max_piece : {(size_t)1, (size_t)7, (size_t)4096, (size_t)200000}) {
+            if (max_piece == 1 && delta.size() > 100000) continue;
+            DeltaPatcher patcher;
+            std::string target;
+            bool applied = apply(base_path, delta, max_piece, rng, target, patcher);
+            CHECK(applied);
+            CHECK(patcher.done());
+            CHECK(target == edit.target);
+            CHECK(patcher.target_size() == edit.target.size());
+            CHECK(patcher.target_sha256() == sha256_of(edit.target));
+            if (!applied || target != edit.target) {
+                std::fprintf(stderr, "  edit \"%s\", pieces up to %zu\n", edit.name, max_piece);
+            }
+        }
+
+        // A small edit costs about the edit plus a block or two, not the file.
+        std::string name = edit.name;
+        if (name == "identical" || name == "replace" || name == "insert" || name == "remove") {
+            CHECK(delta.size() < 8 * 1024);
+        }
+    }
+    PartialFile::remove(base_path);
+}
+
+static void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static std::string hex_to_raw(const std::string& hex) {
+    std::string raw;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) raw.push_back((char)std::stoi(hex.substr(i, 2), nullptr, 16));
+    return raw;
+}
+
+// A delta header by hand, for ops encode_delta would never write.
+static std::string delta_header(const std::string& base, const std::string& target) {
+    std::string out = "NCDELTA1" + hex_to_raw(sha256_of(base));
+    for (int i = 0; i < 8; ++i) out.push_back((char)((uint64_t)target.size() >> (8 * i)));
+    return out + hex_to_raw(sha256_of(target));
+}
+
+static void test_rejections() {
+    std::mt19937 rng(7);
+    std::string base = random_bytes(rng, 100000);
+    std::string target = base.substr(0, 60000) + "edit" + base.substr(60000);
+    std::string base_path = temp_path("delta-base");
+    CHECK(write_file(base_path, base));
+    std::string delta;
+    NetClient::detail::encode_delta(base, target, delta);
+    DeltaPatcher patcher;
+    std::string out;
+
+    // Made for another base.
+    std::string other = base;
+    other[5] ^= 1;
+    std::string foreign;
+    NetClient::detail::encode_delta(other, target, foreign);
+    CHECK(!apply(base_path, foreign, 16, rng, out, patcher));
+    CHECK(patcher.failed() && patcher.base_mismatch());
+    CHECK(out.empty());
+
+    // Truncated anywhere: every byte is accepted but the target never completes.
+    for (size_t cut : {(size_t)10, NetClient::detail::kDeltaHeaderSize, delta.size() / 2, delta.size() - 1}) {
+        CHECK(apply(base_path, delta.substr(0, cut), 64, rng, out, patcher));
+        CHECK(!patcher.done() && !patcher.failed());
+    }
+
+    // Bytes after END.
+    CHECK(!apply(base_path, delta + "x", 64, rng, out, patcher));
+    CHECK(patcher.failed() && !patcher.base_mismatch());
+
+    // Bad magic.
+    std::string renamed = delta;
+    renamed[0] = 'X';
+    CHECK(!apply(base_path, renamed, 64, rng, out, patcher));
+    CHECK(patcher.failed() && !patcher.base_mismatch());
+
+    // A COPY past the end of the base, and one starting beyond it.
+    std::string small_target = base.substr(base.size() - 10) + "tail";
+    std::string past = delta_header(base, small_target);
+    past += '\x01';
+    put_varint(past, base.size() - 10);
+    put_varint(past, 14);
+    past += '\x00';
+    CHECK(!apply(base_path, past, 64, rng, out, patcher));
+    CHECK(patcher.failed() && !patcher.base_mismatch());
+
+    std::string beyond = delta_header(base, "x");
+    beyond += '\x01';
+    put_varint(beyond, base.size() + 1);
+    put_varint(beyond, 1);
+    beyond += '\x00';
+    CHECK(!apply(base_path, beyond, 64, rng, out, patcher));
+    CHECK(patcher.failed());
+
+    // Ops writing more than the announced target, and an END short of it.
+    std::string overlong = delta_header(base, "ab");
+    overlong += '\x02';
+    put_varint(overlong, 3);
+    overlong += "abc";
+    overlong += '\x00';
+    CHECK(!apply(base_path, overlong, 64, rng, out, patcher));
+    CHECK(patcher.failed());
+
+    std::string early = delta_header(base, "abc");
+    early += '\x02';
+    put_varint(early, 2);
+    early += "ab";
+    early += '\x00';
+    CHECK(!apply(base_path, early, 64, rng, out, patcher));
+    CHECK(patcher.failed());
+
+    // An unknown op.
+    std::string unknown = delta_header(base, "abc");
+    unknown += '\x07';
+    CHECK(!apply(base_path, unknown, 64, rng, out, patcher));
+    CHECK(patcher.failed());
+
+    PartialFile::remove(base_path);
+}
+
+// Serves the files in its map by path with 404 for the rest. A path
+// beginning with "/cut" sends half the body and drops the connection the
+// first time it is asked for.
+class FileServer {
+public:
+    std::map<std::string, std::string> files;
+
+    FileServer() : server_([this](Connection& conn, const HttpRequest& request) { return serve(conn, request); }) {}
+
+    bool start() { return server_.start(); }
+    std::string url(const std::string& path) const { return server_.url(path); }
+    int requests() const { return server_.requests(); }
+
+private:
+    bool serve(Connection& conn, const HttpRequest& request) {
+        auto it = files.find(request.target);
+        if (it == files.end()) return conn.send(http_response(404, "not found"));
+        if (request.target.compare(0, 4, "/cut") == 0 && ++cuts_ == 1) {
+            std::string whole = http_response(200, it->second);
+            conn.send(whole.substr(0, whole.size() - it->second.size() / 2));
+            return false;
+        }
+        return conn.send(http_response(200, it->second));
+    }
+
+    std::atomic<int> cuts_{0};
+    LoopbackServer server_;
+};
+
+static void test_download_delta() {
+    std::mt19937 rng(3);
+    std::string base = random_bytes(rng, 200000);
+    std::string target = base;
+    target.replace(50000, 100, random_bytes(rng, 300));
+    std::string other = random_bytes(rng, 1000);
+
+    FileServer server;
+    NetClient::detail::encode_delta(base, target, server.files["/good.delta"]);
+    server.files["/cut.delta"] = server.files["/good.delta"];
+    NetClient::detail::encode_delta(other, target, server.files["/foreign.delta"]);
+    server.files["/short.delta"] = server.files["/good.delta"].substr(0, server.files["/good.delta"].size() - 20);
+    CHECK(server.start());
+
+    std::string base_path = temp_path("delta-base");
+    std::string path = temp_path("delta-target");
+    CHECK(write_file(base_path, base));
+    Session session;
+    std::string got;
+
+    DownloadResult result = session.download_delta(server.url("/good.delta"), base_path, path);
+    CHECK(result.ok());
+    CHECK(result.size == target.size());
+    CHECK(result.sha256 == sha256_of(target));
+    CHECK(read_file(path, got) && got == target);
+    CHECK(!read_file(path + ".part", got));
+    PartialFile::remove(path);
+
+    // An interrupted transfer is applied again from the start.
+    result = session.download_delta(server.url("/cut.delta"), base_path, path);
+    CHECK(result.ok());
+    CHECK(read_file(path, got) && got == target);
+    PartialFile::remove(path);
+
+    // In place: the base is the file being rebuilt.
+    std::string in_place = temp_path("delta-in-place");
+    CHECK(write_file(in_place, base));
+    result = session.download_delta(server.url("/good.delta"), in_place, in_place);
+    CHECK(result.ok());
+    CHECK(read_file(in_place, got) && got == target);
+    PartialFile::remove(in_place);
+
+    // Failures leave neither the file nor its part behind.
+    result = session.download_delta(server.url("/foreign.delta"), base_path, path);
+    CHECK(!result.ok() && result.response.error == "base mismatch");
+    CHECK(!read_file(path, got) && !read_file(path + ".part", got));
+
+    result = session.download_delta(server.url("/short.delta"), base_path, path);
+    CHECK(!result.ok() && result.response.error == "bad delta");
+    CHECK(!read_file(path, got) && !read_file(path + ".part", got));
+
+    result = session.download_delta(server.url("/missing.delta"), base_path, path);
+    CHECK(!result.ok() && result.response.status_code == 404);
+    CHECK(!read_file(path, got) && !read_file(path + ".part", got));
+
+    NetClient::DownloadOptions options;
+    options.expected_sha256 = sha256_of(other);
+    result = session.download_delta(server.url("/good.delta"), base_path, path, options);
+    CHECK(!result.ok() && result.response.error == "hash mismatch");
+    CHECK(!read_file(path, got));
+
+    result = session.download_delta(server.url("/good.delta"), temp_path("no-such-base"), path);
+    CHECK(!result.ok() && result.response.error == "cannot open base");
+
+    PartialFile::remove(base_path);
+}
+
+static void test_scheduler_falls_back_to_full_download() {
+    std::mt19937 rng(5);
+    std::string base = random_bytes(rng, 100000);
+    std::string target = base + random_bytes(rng, 1000);
+    std::string stale = random_bytes(rng, 100000);
+
+    FileServer server;
+    server.files["/file"] = target;
+    NetClient::detail::encode_delta(base, target, server.files["/file.delta"]);
+    CHECK(server.start());
+
+    std::string base_path = temp_path("delta-base");
+    std::string stale_path = temp_path("delta-stale");
+    CHECK(write_file(base_path, base));
+    CHECK(write_file(stale_path, stale));
+    std::string paths[3] = {temp_path("delta-a"), temp_path("delta-b"), temp_path("delta-c")};
+
+    Session session;
+    NetClient::DownloadScheduler scheduler(session);
+    NetClient::ScheduledDownload download;
+    download.url = server.url("/file");
+
+    // The delta applies; the full file is never fetched.
+    download.path = paths[0];
+    download.delta_url = server.url("/file.delta");
+    download.base_path = base_path;
+    uint64_t patched = scheduler.add(download);
+    scheduler.wait();
+    CHECK(server.requests() == 1);
+
+    // A delta for another base, and a missing delta, fall back to url.
+    download.path = paths[1];
+    download.base_path = stale_path;
+    uint64_t mismatched = scheduler.add(download);
+    download.path = paths[2];
+    download.delta_url = server.url("/gone.delta");
+    download.base_path = base_path;
+    uint64_t missing = scheduler.add(download);
+    scheduler.wait();
+    CHECK(server.requests() == 5);
+
+    for (uint64_t id : {patched, mismatched, missing}) {
+        DownloadResult result;
+        CHECK(scheduler.result(id, result));
+        CHECK(result.ok());
+        CHECK(result.sha256 == sha256_of(target));
+    }
+    for (const std::string& path : paths) {
+        std::string got;
+        CHECK(read_file(path, got) && got == target);
+        PartialFile::remove(path);
+    }
+    PartialFile::remove(base_path);
+    PartialFile::remove(stale_path);
+}
+
+int main() {
+    test_round_trip_with_arbitrary_splits();
+    test_rejections();
+    test_download_delta();
+    test_scheduler_falls_back_to_full_download();
+    return test_result();
+}
@@ -0,0 +1,373 @@
+// DownloadScheduler against loopback file servers: the order queued
+// downloads start in, the per-host and overall limits, the shared rate
+// limit and cancelling queued and running downloads.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::DownloadEvent;
+using NetClient::DownloadResult;
+using NetClient::DownloadScheduler;
+using NetClient::DownloadState;
+using NetClient::ScheduledDownload;
+using NetClient::SchedulerOptions;
+using NetClient::Session;
+
+typedef std::chrono::steady_clock Clock;
+
+// Holds requests for /gate until opened.
+class Gate {
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        reached_ = true;
+        changed_.notify_all();
+        changed_.wait(lock, [&] { return open_; });
+    }
+
+    void wait_reached() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return reached_; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool reached_ = false;
+    bool open_ = false;
+};
+
+// Records, per server, the order requests arrive in and how many are
+// answered at once; every response takes hold_ms.
+class FileServer {
+public:
+    explicit FileServer(Gate* gate = nullptr, int hold_ms = 0, size_t body_size = 100)
+        : gate_(gate), hold_ms_(hold_ms), body_(body_size, 'x'),
+          server_([this](Connection& conn, const HttpRequest& request) { return serve(conn, request); }) {
+        CHECK(server_.start());
+    }
+
+    std::string url(const std::string& path) const { return server_.url(path); }
+
+    std::vector<std::string> order() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_;
+    }
+
+    int peak() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_;
+    }
+
+    static int overall_peak() {
+        std::lock_guard<std::mutex> lock(overall_mutex());
+        return overall().second;
+    }
+
+private:
+    static std::mutex& overall_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // In flight across every server, and the most seen at once.
+    static std::pair<int, int>& overall() {
+        static std::pair<int, int> counts;
+        return counts;
+    }
+
+    bool serve(Connection& conn, const HttpRequest& request) {
+        if (request.target == "/gate" && gate_) gate_->wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            order_.push_back(request.target);
+            peak_ = std::max(peak_, ++active_);
+        }
+        {
+            std::lock_guard<std::mutex> lock(overall_mutex());
+            overall().second = std::max(overall().second, ++overall().first);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(hold_ms_));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+        }
+        {
+            std::lock_guard<std::mutex> lock(overall_mutex());
+            --overall().first;
+        }
+        return conn.send(http_response(200, body_));
+    }
+
+    Gate* gate_;
+    int hold_ms_;
+    std::string body_;
+    std::mutex mutex_;
+    std::vector<std::string> order_;
+    int active_ = 0;
+    int peak_ = 0;
+    LoopbackServer server_;
+};
+
+// Collects every event's state per download.
+class EventLog {
+public:
+    DownloadScheduler::EventCallback callback() {
+        return [this](const DownloadEvent& event) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (event.state == DownloadState::Active && seen_.insert(event.id).second) started_.push_back(event.id);
+            if (event.state != DownloadState::Active) final_[event.id] = event.state;
+        };
+    }
+
+    std::vector<uint64_t> started() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return started_;
+    }
+
+    DownloadState state(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return final_[id];
+    }
+
+private:
+    std::mutex mutex_;
+    std::set<uint64_t> seen_;
+    std::vector<uint64_t> started_;
+    std::map<uint64_t, DownloadState> final_;
+};
+
+static ScheduledDownload download_of(const std::string& url, const std::string& path, int priority = 0) {
+    ScheduledDownload d;
+    d.url = url;
+    d.path = path;
+    d.priority = priority;
+    return d;
+}
+
+static void test_priority_order() {
+    Gate gate;
+    FileServer server(&gate);
+    Session session;
+    EventLog log;
+    SchedulerOptions options;
+    options.max_active = 1;
+    DownloadScheduler scheduler(session, options, log.callback());
+
+    // The single worker is held by the first download while the rest queue.
+    const std::string dir = temp_path("priority");
+    scheduler.add(download_of(server.url("/gate"), dir + "-gate"));
+    gate.wait_reached();
+    scheduler.add(download_of(server.url("/low"), dir + "-low", 0));
+    scheduler.add(download_of(server.url("/high"), dir + "-high", 5));
+    scheduler.add(download_of(server.url("/mid"), dir + "-mid", 2));
+    scheduler.add(download_of(server.url("/high2"), dir + "-high2", 5));
+    uint64_t raised = scheduler.add(download_of(server.url("/raised"), dir + "-raised", 1));
+    CHECK(scheduler.set_priority(raised, 9));
+    gate.open();
+    scheduler.wait();
+
+    // Equal priorities keep the order they were added in.
+    CHECK((server.order() == std::vector<std::string>{"/gate", "/raised", "/high", "/high2", "/mid", "/low"}));
+    CHECK(!scheduler.set_priority(raised, 0));      // already finished
+    for (const char* name : {"-gate", "-low", "-high", "-mid", "-high2", "-raised"}) {
+        std::string body;
+        CHECK(read_file(dir + name, body) && body == std::string(100, 'x'));
+    }
+}
+
+static void test_hosts_take_turns() {
+    Gate gate;
+    FileServer a(&gate);
+    FileServer b;
+    Session session;
+    EventLog log;
+    SchedulerOptions options;
+    options.max_active = 1;
+    DownloadScheduler scheduler(session, options, log.callback());
+
+    // a has just started a download, so b goes next, then they alternate.
+    const std::string dir = temp_path("turns");
+    scheduler.add(download_of(a.url("/gate"), dir + "-gate"));
+    gate.wait_reached();
+    uint64_t a1 = scheduler.add(download_of(a.url("/a1"), dir + "-a1"));
+    uint64_t a2 = scheduler.add(download_of(a.url("/a2"), dir + "-a2"));
+    uint64_t b1 = scheduler.add(download_of(b.url("/b1"), dir + "-b1"));
+    uint64_t b2 = scheduler.add(download_of(b.url("/b2"), dir + "-b2"));
+    gate.open();
+    scheduler.wait();
+    std::vector<uint64_t> started = log.started();
+    CHECK(started.size() == 5);
+    CHECK((std::vector<uint64_t>(started.begin() + 1, started.end()) == std::vector<uint64_t>{b1, a1, b2, a2}));
+}
+
+static void test_concurrency_limits() {
+    FileServer a(nullptr, 150);
+    FileServer b(nullptr, 150);
+    Session session;
+    SchedulerOptions options;
+    options.max_active = 3;
+    options.max_per_host = 2;
+    DownloadScheduler scheduler(session, options);
+
+    const std::string dir = temp_path("limits");
+    for (int i = 0; i < 6; ++i) {
+        scheduler.add(download_of(a.url("/a" + std::to_string(i)), dir + "-a" + std::to_string(i)));
+    }
+    for (int i = 0; i < 3; ++i) {
+        scheduler.add(download_of(b.url("/b" + std::to_string(i)), dir + "-b" + std::to_string(i)));
+    }
+    scheduler.wait();
+    CHECK(a.order().size() == 6 && b.order().size() == 3);
+    CHECK(a.peak() == 2);
+    CHECK(b.peak() >= 1 && b.peak() <= 2);     // b holds a second slot only if one frees while a is queued
+    // The third slot went to b while a was at its limit.
+    CHECK(FileServer::overall_peak() == 3);
+}
+
+static void test_rate_limit() {
+    const size_t size = 100 * 1024;
+    FileServer server(nullptr, 0, size);
+    Session session;
+    SchedulerOptions options;
+    options.max_active = 3;
+    options.max_per_host = 3;
+    options.max_bytes_per_second = 200 * 1024;
+    options.burst_bytes = 16 * 1024;
+    DownloadScheduler scheduler(session, options);
+
+    // 300 KB through one 200 KB/s bucket, less the burst: about 1.4 s
+    // however the bytes are split between the downloads.
+    const std::string dir = temp_path("rate");
+    Clock::time_point start = Clock::now();
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 3; ++i) {
+        ids.push_back(scheduler.add(download_of(server.url("/f" + std::to_string(i)), dir + std::to_string(i))));
+    }
+    scheduler.wait();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    CHECK(seconds >= 1.2);
+    CHECK(seconds < 4.0);
+    for (uint64_t id : ids) {
+        DownloadResult result;
+        CHECK(scheduler.result(id, result) && result.ok() && result.size == size);
+    }
+
+    // Lifting the limit takes effect for the next downloads.
+    scheduler.set_rate_limit(0);
+    start = Clock::now();
+    for (int i = 3; i < 6; ++i) {
+        scheduler.add(download_of(server.url("/f" + std::to_string(i)), dir + std::to_string(i)));
+    }
+    scheduler.wait();
+    CHECK(std::chrono::duration<double>(Clock::now() - start).count() < 0.5);
+}
+
+static void test_cancel() {
+    // /stall sends part of its body and then nothing.
+    LoopbackServer server([](Connection& conn, const HttpRequest& request) {
+        if (request.target == "/stall") {
+            conn.send("HTTP/1.1 200 OK\r\nContent-Length: 100000\r\n\r\n" + std::string(1000, 's'));
+            conn.hang();
+            return false;
+        }
+        return conn.send(http_response(200, "done"));
+    });
+    CHECK(server.start());
+    Session session;
+    SchedulerOptions options;
+    options.max_active = 1;
+
+    const std::string dir = temp_path("cancel");
+    const std::string stall_url = server.url("/stall");
+    std::mutex mutex;
+    std::map<uint64_t, DownloadState> final;
+    DownloadScheduler* self = nullptr;
+    DownloadScheduler scheduler(session, options, [&](const DownloadEvent& event) {
+        // The running download is stopped from its own progress event.
+        if (event.state == DownloadState::Active && event.received > 0 && event.download->url == stall_url) {
+            self->cancel(event.id);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (event.state != DownloadState::Active) final[event.id] = event.state;
+    });
+    self = &scheduler;
+
+    uint64_t stalled = scheduler.add(download_of(stall_url, dir + "-stall"));
+    uint64_t queued = scheduler.add(download_of(server.url("/queued"), dir + "-queued"));
+    uint64_t kept = scheduler.add(download_of(server.url("/kept"), dir + "-kept"));
+    // Cancelling a queued download reports it at once, on this thread.
+    CHECK(scheduler.cancel(queued));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(final[queued] == DownloadState::Cancelled);
+    }
+    CHECK(!scheduler.cancel(queued));
+    CHECK(!scheduler.cancel(12345));
+    scheduler.wait();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(final[stalled] == DownloadState::Cancelled);
+    CHECK(final[kept] == DownloadState::Done);
+    DownloadResult result;
+    CHECK(scheduler.result(stalled, result) && !result.ok());
+    CHECK(scheduler.result(kept, result) && result.ok());
+    std::string part;
+    CHECK(read_file(dir + "-stall.part", part) && part == std::string(1000, 's'));
+    CHECK(!read_file(dir + "-queued", part));
+    CHECK(!scheduler.cancel(kept));
+}
+
+static void test_cancel_all() {
+    Gate gate;
+    FileServer server(&gate);
+    Session session;
+    EventLog log;
+    SchedulerOptions options;
+    options.max_active = 1;
+    std::vector<uint64_t> ids;
+    const std::string dir = temp_path("cancel-all");
+    {
+        DownloadScheduler scheduler(session, options, log.callback());
+        ids.push_back(scheduler.add(download_of(server.url("/gate"), dir + "-gate")));
+        gate.wait_reached();
+        for (int i = 0; i < 4; ++i) {
+            ids.push_back(scheduler.add(download_of(server.url("/q" + std::to_string(i)), dir + std::to_string(i))));
+        }
+        scheduler.cancel_all();
+        gate.open();
+        scheduler.wait();
+        // Only the download that had started was requested.
+        CHECK((server.order() == std::vector<std::string>{"/gate"}));
+        for (size_t i = 1; i < ids.size(); ++i) CHECK(log.state(ids[i]) == DownloadState::Cancelled);
+    }
+}
+
+int main() {
+    test_priority_order();
+    test_hosts_take_turns();
+    test_concurrency_limits();
+    test_rate_limit();
+    test_cancel();
+    test_cancel_all();
+    return test_result();
+}
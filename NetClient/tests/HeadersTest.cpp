@@ -0,0 +1,287 @@
+// Headers: lookups through the open-addressed name index whatever the
+// case, repeated names chained in arrival order, set() and remove()
+// rebuilding the block, parse() of raw header blocks and the index growing
+// as names are added. Random edits are checked against a plain list.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include <cctype>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::Headers;
+
+typedef std::vector<std::pair<std::string, std::string>> HeaderList;
+
+static bool same_name(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static HeaderList list_of(const Headers& headers) {
+    HeaderList out;
+    for (const Headers::value_type& header : headers) out.emplace_back(header.first, header.second);
+    return out;
+}
+
+static std::vector<std::string> strings(const std::vector<std::string_view>& views) {
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+// The block raw() should hold for list.
+static std::string block_of(const HeaderList& list) {
+    std::string out;
+    for (const auto& header : list) out += header.first + ": " + header.second + "\r\n";
+    return out;
+}
+
+// Every lookup on headers agrees with a scan of expected.
+static bool matches(const Headers& headers, const HeaderList& expected, const std::vector<std::string>& names) {
+    if (list_of(headers) != expected || headers.size() != expected.size()) return false;
+    for (const std::string& name : names) {
+        std::vector<std::string> values;
+        std::string combined;
+        for (const auto& header : expected) {
+            if (!same_name(header.first, name)) continue;
+            values.push_back(header.second);
+            combined += (combined.empty() ? "" : ", ") + header.second;
+        }
+        if (headers.has(name) != !values.empty()) return false;
+        if (headers.get(name) != (values.empty() ? std::string() : values[0])) return false;
+        if (strings(headers.values(name)) != values) return false;
+        if (headers.combined(name) != combined) return false;
+    }
+    return true;
+}
+
+static void test_case_folding() {
+    Headers headers;
+    CHECK(headers.empty() && !headers.has("Host") && headers.get("Host").empty());
+    headers.add("Content-Type", "text/plain");
+    headers.add("X-Mixed-CASE", "1");
+    CHECK(headers.get("content-type") == "text/plain");
+    CHECK(headers.get("CONTENT-TYPE") == "text/plain");
+    CHECK(headers.get("x-mixed-case") == "1");
+    CHECK(!headers.has("Content-Typ") && !headers.has("Content-Type "));
+    // Names keep the case they were added in.
+    CHECK(headers.at(1).first == "X-Mixed-CASE");
+    CHECK(headers.raw() == "Content-Type: text/plain\r\nX-Mixed-CASE: 1\r\n");
+
+    // Differently cased spellings of one name are the same header.
+    headers.add("content-TYPE", "charset=utf-8");
+    CHECK(strings(headers.values("Content-Type")) == (std::vector<std::string>{"text/plain", "charset=utf-8"}));
+    headers.set("CONTENT-type", "text/html");
+    CHECK(headers.size() == 2);
+    CHECK(headers.at(1).first == "CONTENT-type" && headers.get("content-type") == "text/html");
+}
+
+static void test_repeated_names_keep_order() {
+    Headers headers;
+    headers.add("Set-Cookie", "a=1");
+    headers.add("Date", "today");
+    headers.add("set-cookie", "b=2");
+    headers.add("Vary", "Accept");
+    headers.add("SET-COOKIE", "c=3; Path=/");
+    headers.add("Vary", "Origin");
+    headers.add("Set-Cookie", "d=4");
+
+    CHECK(strings(headers.values("Set-Cookie")) == (std::vector<std::string>{"a=1", "b=2", "c=3; Path=/", "d=4"}));
+    CHECK(headers.get("set-cookie") == "a=1");
+    CHECK(headers.combined("Vary") == "Accept, Origin");
+    CHECK(headers.combined("Missing").empty() && headers.values("Missing").empty());
+
+    // Removing another name keeps the cookies and their order.
+    headers.remove("date");
+    CHECK(strings(headers.values("Set-Cookie")) == (std::vector<std::string>{"a=1", "b=2", "c=3; Path=/", "d=4"}));
+    CHECK(headers.size() == 6 && !headers.has("Date"));
+
+    // More cookies after the rebuild chain onto the end.
+    headers.add("Set-Cookie", "e=5");
+    CHECK(headers.values("set-cookie").size() == 5 && headers.values("set-cookie").back() == "e=5");
+
+    headers.set("Set-Cookie", "only=1");
+    CHECK(strings(headers.values("Set-Cookie")) == std::vector<std::string>{"only=1"});
+    CHECK(headers.combined("Vary") == "Accept, Origin");
+    CHECK(headers.raw() == "Vary: Accept\r\nVary: Origin\r\nSet-Cookie: only=1\r\n");
+}
+
+static void test_set_and_remove() {
+    Headers headers;
+    headers.set("A", "1");                      // set of an absent name adds it
+    headers.add("B", "2");
+    headers.add("a", "3");
+    headers.set("a", "4");                      // every value goes; the new one moves to the end
+    CHECK((list_of(headers) == HeaderList{{"B", "2"}, {"a", "4"}}));
+    headers.remove("missing");
+    CHECK(headers.size() == 2);
+    headers.remove("b");
+    CHECK((list_of(headers) == HeaderList{{"a", "4"}}));
+    CHECK(headers.raw() == "a: 4\r\n");
+
+    // A name and value viewed from the headers themselves survive the
+    // rebuild that set() does.
+    headers.add("Location", "/next");
+    Headers::value_type own = headers.at(1);
+    headers.set(own.first, own.second);
+    CHECK((list_of(headers) == HeaderList{{"a", "4"}, {"Location", "/next"}}));
+
+    headers.clear();
+    CHECK(headers.empty() && headers.raw().empty() && !headers.has("a"));
+    headers.add("a", "5");
+    CHECK(headers.get("A") == "5");
+}
+
+static void test_parse() {
+    const std::string block = "Content-Length: 12\r\n"
+                              "Set-Cookie:  a=1 \r\n"
+                              "no colon here\r\n"
+                              ": empty name\r\n"
+                              "X-Spaced \t: \t padded value\t \r\n"
+                              "set-cookie: b=2\n"
+                              "Empty:\r\n"
+                              "Last: no newline";
+    Headers headers;
+    headers.add("Stale", "gone");
+    headers.parse(block.data(), block.size());
+    CHECK((list_of(headers) == HeaderList{{"Content-Length", "12"},
+                                          {"Set-Cookie", "a=1"},
+                                          {"X-Spaced", "padded value"},
+                                          {"set-cookie", "b=2"},
+                                          {"Empty", ""},
+                                          {"Last", "no newline"}}));
+    CHECK(!headers.has("Stale"));
+    CHECK(headers.raw() == block);              // copied as it came
+    CHECK(headers.has("empty") && headers.get("empty").empty());
+    CHECK(strings(headers.values("SET-COOKIE")) == (std::vector<std::string>{"a=1", "b=2"}));
+
+    // Views point into the copy, not the caller's block.
+    CHECK(headers.get("last").data() >= headers.raw().data() &&
+          headers.get("last").data() < headers.raw().data() + headers.raw().size());
+
+    // Edits after a parse rebuild in the usual layout.
+    headers.remove("Content-Length");
+    CHECK(headers.raw().substr(0, 14) == "Set-Cookie: a=");
+    CHECK(headers.get("x-spaced") == "padded value");
+
+    headers.parse("", 0);
+    CHECK(headers.empty());
+}
+
+static void test_index_grows() {
+    // The index starts at 16 slots and doubles whenever it would be over
+    // half full, so 9, 17 and 33 names each force a rehash. Every name must
+    // still be found afterwards, with repeated names chained correctly.
+    Headers headers;
+    HeaderList expected;
+    std::vector<std::string> names;
+    for (int i = 0; i < 200; ++i) {
+        std::string name = "X-Name-" + std::to_string(i);
+        names.push_back(name);
+        headers.add(name, std::to_string(i));
+        expected.emplace_back(name, std::to_string(i));
+        if (i % 3 == 0) {
+            // A repeat of an earlier name, so chains span rehashes.
+            std::string earlier = "x-name-" + std::to_string(i / 2);
+            headers.add(earlier, "again " + std::to_string(i));
+            expected.emplace_back(earlier, "again " + std::to_string(i));
+        }
+        if (i == 8 || i == 9 || i == 16 || i == 17 || i == 33 || i == 199) CHECK(matches(headers, expected, names));
+    }
+    names.push_back("X-Name-200");
+    names.push_back("absent");
+    CHECK(matches(headers, expected, names));
+
+    // parse() of the same block builds an equal index in one pass.
+    Headers parsed;
+    std::string block = block_of(expected);
+    parsed.parse(block.data(), block.size());
+    CHECK(matches(parsed, expected, names));
+}
+
+static void test_random_edits() {
+    // Few names in several spellings, so every operation often hits a name
+    // that is present, repeated or freshly removed.
+    static const char* const spellings[] = {"Accept", "ACCEPT", "accept", "Set-Cookie", "set-cookie", "Vary",
+                                            "ETag",   "etag",   "Age",    "X-A",        "x-a",        "X-B",
+                                            "X-C",    "X-D",    "X-E",    "X-F",        "X-G",        "X-H",
+                                            "X-I",    "X-J"};
+    const size_t count = sizeof(spellings) / sizeof(spellings[0]);
+    std::vector<std::string> names(spellings, spellings + count);
+    std::mt19937 rng(46);
+    for (int round = 0; round < 200; ++round) {
+        Headers headers;
+        HeaderList expected;
+        for (int step = 0; step < 60; ++step) {
+            std::string name = spellings[rng() % count];
+            std::string value = "v" + std::to_string(rng() % 1000);
+            switch (rng() % 6) {
+                case 0:
+                case 1:
+                case 2:
+                    headers.add(name, value);
+                    expected.emplace_back(name, value);
+                    break;
+                case 3: {
+                    headers.set(name, value);
+                    HeaderList kept;
+                    for (const auto& header : expected) {
+                        if (!same_name(header.first, name)) kept.push_back(header);
+                    }
+                    kept.emplace_back(name, value);
+                    expected = kept;
+                    break;
+                }
+                case 4: {
+                    headers.remove(name);
+                    HeaderList kept;
+                    for (const auto& header : expected) {
+                        if (!same_name(header.first, name)) kept.push_back(header);
+                    }
+                    expected = kept;
+                    break;
+                }
+                default: {
+                    std::string block = block_of(expected);
+                    headers.parse(block.data(), block.size());
+                    break;
+                }
+            }
+            CHECK(matches(headers, expected, names));
+            CHECK(headers.raw() == block_of(expected));
+        }
+    }
+}
+
+static void test_response_headers() {
+    // A response read off the wire keeps repeated headers as sent.
+    LoopbackServer server([](Connection& conn, const HttpRequest&) {
+        return conn.send("HTTP/1.1 200 OK\r\nSet-Cookie: a=1\r\nCache-Control: no-store\r\nset-cookie: b=2\r\n"
+                         "SET-COOKIE: c=3\r\nContent-Length: 2\r\n\r\nok");
+    });
+    CHECK(server.start());
+    NetClient::Session session;
+    NetClient::Response response = session.get(server.url("/"));
+    CHECK(response.status_code == 200 && response.text == "ok");
+    CHECK(strings(response.headers.values("Set-Cookie")) == (std::vector<std::string>{"a=1", "b=2", "c=3"}));
+    CHECK(response.headers.get("cache-control") == "no-store");
+}
+
+int main() {
+    test_case_folding();
+    test_repeated_names_keep_order();
+    test_set_and_remove();
+    test_parse();
+    test_index_grows();
+    test_random_edits();
+    test_response_headers();
+    return test_result();
+}
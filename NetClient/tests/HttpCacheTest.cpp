@@ -0,0 +1,325 @@
+// The HTTP cache behind Session::get(): freshness, revalidation, Vary, the
+// memory bound and the disk tier, against a loopback origin that counts
+// what actually reaches it.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+using namespace NetClientTest;
+using NetClient::Response;
+using NetClient::Session;
+using NetClient::SessionOptions;
+
+// Serves configured resources. A request whose If-None-Match equals the
+// resource's ETag gets a 304 carrying not_modified_headers.
+class Origin {
+public:
+    struct Resource {
+        int status = 200;
+        std::string body;
+        std::string headers;                // "Name: value\r\n" lines
+        std::string etag;
+        std::string not_modified_headers;
+    };
+
+    Origin() : server_([this](Connection& conn, const HttpRequest& request) { return serve(conn, request); }) {
+        CHECK(server_.start());
+    }
+
+    void set(const std::string& path, const Resource& resource) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        resources_[path] = resource;
+    }
+
+    int hits(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hits_[path];
+    }
+
+    HttpRequest last(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_[path];
+    }
+
+    std::string url(const std::string& path) const { return server_.url(path); }
+
+private:
+    bool serve(Connection& conn, const HttpRequest& request) {
+        Resource resource;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++hits_[request.target];
+            last_[request.target] = request;
+            auto it = resources_.find(request.target);
+            if (it == resources_.end()) return conn.send(http_response(404, "missing"));
+            resource = it->second;
+        }
+        std::string etag = resource.etag.empty() ? "" : "ETag: " + resource.etag + "\r\n";
+        if (!resource.etag.empty() && request.header("if-none-match") == resource.etag) {
+            return conn.send("HTTP/1.1 304 Not Modified\r\n" + etag + resource.not_modified_headers + "\r\n");
+        }
+        return conn.send(http_response(resource.status, resource.body, resource.headers + etag));
+    }
+
+    std::mutex mutex_;
+    std::map<std::string, Resource> resources_;
+    std::map<std::string, int> hits_;
+    std::map<std::string, HttpRequest> last_;
+    LoopbackServer server_;
+};
+
+static SessionOptions cached(size_t memory_bytes = 8u << 20, const std::string& directory = "") {
+    SessionOptions options;
+    options.cache = true;
+    options.cache_memory_bytes = memory_bytes;
+    options.cache_directory = directory;
+    return options;
+}
+
+static std::string http_date(time_t t) {
+    char buffer[64];
+    std::tm tm = *std::gmtime(&t);
+    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buffer;
+}
+
+static void test_fresh_hits_share_the_body() {
+    Origin origin;
+    origin.set("/doc", {200, std::string(50000, 'd'), "Cache-Control: max-age=60\r\n"});
+    Session session(cached());
+
+    Response first = session.get(origin.url("/doc"));
+    Response second = session.get(origin.url("/doc"));
+    Response third = session.get(origin.url("/doc"));
+    CHECK(origin.hits("/doc") == 1);
+    CHECK(first.status_code == 200 && second.status_code == 200 && third.status_code == 200);
+    CHECK(second.text == std::string(50000, 'd'));
+    CHECK(second.header("Cache-Control") == "max-age=60");
+    // Stored and served without a copy: every response reads one buffer.
+    CHECK(first.text.data() == second.text.data() && second.text.data() == third.text.data());
+
+    // Changing a served body leaves the cached one alone.
+    second.text.append("!", 1);
+    CHECK(second.text.size() == 50001 && second.text.data() != third.text.data());
+    CHECK(session.get(origin.url("/doc")).text == third.text.str());
+}
+
+static void test_not_storable() {
+    Origin origin;
+    origin.set("/no-store", {200, "a", "Cache-Control: no-store, max-age=60\r\n"});
+    origin.set("/plain", {200, "b"});
+    origin.set("/vary-star", {200, "c", "Cache-Control: max-age=60\r\nVary: *\r\n"});
+    origin.set("/created", {201, "d", "Cache-Control: max-age=60\r\n"});
+    Session session(cached());
+    for (const char* path : {"/no-store", "/plain", "/vary-star", "/created"}) {
+        session.get(origin.url(path));
+        session.get(origin.url(path));
+        CHECK(origin.hits(path) == 2);
+    }
+    // POST is never answered from the cache.
+    origin.set("/post", {200, "e", "Cache-Control: max-age=60\r\n"});
+    session.post(origin.url("/post"), "x");
+    session.post(origin.url("/post"), "x");
+    CHECK(origin.hits("/post") == 2);
+}
+
+static void test_not_modified_refresh() {
+    Origin origin;
+    origin.set("/etag", {200, std::string(20000, 'e'), "Cache-Control: max-age=0\r\nX-Version: 1\r\n",
+                         "\"v1\"", "X-Version: 2\r\n"});
+    Session session(cached());
+
+    Response first = session.get(origin.url("/etag"));
+    CHECK(origin.last("/etag").header("if-none-match").empty());
+    Response second = session.get(origin.url("/etag"));
+    CHECK(origin.hits("/etag") == 2);
+    CHECK(origin.last("/etag").header("if-none-match") == "\"v1\"");
+    // The 304 is served as the stored 200, without copying the body, and
+    // its headers replace the stored ones.
+    CHECK(second.status_code == 200 && second.text == first.text.str());
+    CHECK(second.text.data() == first.text.data());
+    CHECK(second.header("X-Version") == "2");
+    CHECK(second.header("Cache-Control") == "max-age=0");
+    CHECK(second.bytes_received > 0 && second.bytes_received < 1000);
+
+    // A changed resource replaces the entry.
+    origin.set("/etag", {200, "new body", "Cache-Control: max-age=0\r\n", "\"v2\""});
+    Response changed = session.get(origin.url("/etag"));
+    CHECK(changed.text == "new body");
+    Response again = session.get(origin.url("/etag"));
+    CHECK(origin.last("/etag").header("if-none-match") == "\"v2\"");
+    CHECK(again.text == "new body");
+}
+
+static void test_last_modified_and_expires() {
+    Origin origin;
+    const time_t now = std::time(nullptr);
+    // Modified ten days ago: fresh for a tenth of that, capped at a day.
+    origin.set("/old", {200, "old", "Date: " + http_date(now) + "\r\nLast-Modified: " +
+                                        http_date(now - 10 * 86400) + "\r\n"});
+    // Modified a minute ago: fresh for six seconds, so revalidated with the date.
+    origin.set("/recent", {200, "recent", "Date: " + http_date(now - 60) + "\r\nLast-Modified: " +
+                                              http_date(now - 120) + "\r\n"});
+    origin.set("/expires", {200, "exp", "Date: " + http_date(now) + "\r\nExpires: " + http_date(now + 3600) + "\r\n"});
+    origin.set("/expired", {200, "gone", "Expires: 0\r\n"});
+    Session session(cached());
+    for (const char* path : {"/old", "/recent", "/expires", "/expired"}) {
+        session.get(origin.url(path));
+        session.get(origin.url(path));
+    }
+    CHECK(origin.hits("/old") == 1);
+    CHECK(origin.hits("/expires") == 1);
+    CHECK(origin.hits("/recent") == 2);
+    CHECK(origin.last("/recent").header("if-modified-since") == http_date(now - 120));
+    CHECK(origin.hits("/expired") == 2);
+}
+
+static void test_request_no_cache_revalidates() {
+    Origin origin;
+    origin.set("/fresh", {200, "fresh", "Cache-Control: max-age=600\r\n", "\"f\""});
+    Session session(cached());
+    session.get(origin.url("/fresh"));
+    Response forced = session.request("GET", origin.url("/fresh"), "", {{"Cache-Control", "no-cache"}});
+    CHECK(origin.hits("/fresh") == 2);
+    CHECK(origin.last("/fresh").header("if-none-match") == "\"f\"");
+    CHECK(forced.status_code == 200 && forced.text == "fresh");
+    // Requests with their own validators bypass the cache.
+    Response own = session.request("GET", origin.url("/fresh"), "", {{"If-None-Match", "\"f\""}});
+    CHECK(own.status_code == 304);
+}
+
+static void test_vary() {
+    Origin origin;
+    origin.set("/lang", {200, "text", "Cache-Control: max-age=60\r\nVary: X-Lang\r\n"});
+    Session session(cached());
+    auto get = [&](const char* lang) { return session.request("GET", origin.url("/lang"), "", {{"X-Lang", lang}}); };
+
+    get("bn");
+    get("bn");
+    CHECK(origin.hits("/lang") == 1);
+    get("en");      // a different variant replaces the stored one
+    CHECK(origin.hits("/lang") == 2);
+    get("en");
+    CHECK(origin.hits("/lang") == 2);
+    get("bn");
+    CHECK(origin.hits("/lang") == 3);
+    // Without the header the variant does not match either.
+    session.get(origin.url("/lang"));
+    CHECK(origin.hits("/lang") == 4);
+}
+
+static void test_errors_and_removal() {
+    Origin origin;
+    origin.set("/flaky", {200, "v1", "Cache-Control: max-age=0\r\n", "\"1\""});
+    Session session(cached());
+    session.get(origin.url("/flaky"));
+
+    // A server error leaves the entry for the next attempt.
+    origin.set("/flaky", {500, "oops"});
+    CHECK(session.get(origin.url("/flaky")).status_code == 500);
+    origin.set("/flaky", {200, "v1", "Cache-Control: max-age=0\r\n", "\"1\""});
+    CHECK(session.get(origin.url("/flaky")).text == "v1");
+    CHECK(origin.last("/flaky").header("if-none-match") == "\"1\"");
+
+    // A 404 drops it.
+    origin.set("/flaky", {404, "gone"});
+    CHECK(session.get(origin.url("/flaky")).status_code == 404);
+    origin.set("/flaky", {200, "v2"});
+    CHECK(session.get(origin.url("/flaky")).text == "v2");
+    CHECK(origin.last("/flaky").header("if-none-match").empty());
+}
+
+static void test_memory_bound_is_lru() {
+    Origin origin;
+    const std::string extra = "Cache-Control: max-age=60\r\n";
+    for (const char* path : {"/a", "/b", "/c", "/d"}) origin.set(path, {200, std::string(12000, path[1]), extra});
+    origin.set("/huge", {200, std::string(100000, 'h'), extra});
+    // Room for three 12 KB entries.
+    Session session(cached(40000));
+
+    session.get(origin.url("/a"));
+    session.get(origin.url("/b"));
+    session.get(origin.url("/c"));
+    session.get(origin.url("/a"));         // hit; /b is now the oldest
+    session.get(origin.url("/d"));         // evicts /b
+    CHECK(origin.hits("/a") == 1);
+
+    session.get(origin.url("/a"));
+    session.get(origin.url("/c"));
+    session.get(origin.url("/d"));
+    CHECK(origin.hits("/a") == 1 && origin.hits("/c") == 1 && origin.hits("/d") == 1);
+    session.get(origin.url("/b"));
+    CHECK(origin.hits("/b") == 2);
+
+    // Larger than the whole budget: served but never kept, and nothing else
+    // is evicted for it.
+    session.get(origin.url("/huge"));
+    session.get(origin.url("/huge"));
+    CHECK(origin.hits("/huge") == 2);
+    session.get(origin.url("/d"));
+    CHECK(origin.hits("/d") == 1);
+}
+
+static void test_disk_tier() {
+    const std::string directory = temp_path("http-cache");
+    Origin origin;
+    origin.set("/persist", {200, std::string(30000, 'p'), "Cache-Control: max-age=600\r\nVary: X-Lang\r\n"});
+    origin.set("/stale", {200, "stale body", "Cache-Control: max-age=0\r\n", "\"s\"", "X-Refreshed: yes\r\n"});
+    const std::map<std::string, std::string> bn = {{"X-Lang", "bn"}};
+    {
+        Session session(cached(8u << 20, directory));
+        session.request("GET", origin.url("/persist"), "", bn);
+        session.get(origin.url("/stale"));
+    }
+    {
+        // A new session reloads the entries, Vary included.
+        Session session(cached(8u << 20, directory));
+        Response persisted = session.request("GET", origin.url("/persist"), "", bn);
+        CHECK(origin.hits("/persist") == 1);
+        CHECK(persisted.status_code == 200 && persisted.text == std::string(30000, 'p'));
+        CHECK(persisted.header("Vary") == "X-Lang");
+
+        Response stale = session.get(origin.url("/stale"));
+        CHECK(origin.hits("/stale") == 2);
+        CHECK(origin.last("/stale").header("if-none-match") == "\"s\"");
+        CHECK(stale.text == "stale body");
+    }
+    {
+        // The 304's headers reached the disk too.
+        Session session(cached(8u << 20, directory));
+        CHECK(session.get(origin.url("/stale")).header("X-Refreshed") == "yes");
+    }
+
+    // A body file of the wrong size is ignored.
+    for (const auto& file : std::filesystem::directory_iterator(directory)) {
+        if (file.path().extension() == ".body") std::filesystem::resize_file(file.path(), 10);
+    }
+    {
+        Session session(cached(8u << 20, directory));
+        Response reloaded = session.request("GET", origin.url("/persist"), "", bn);
+        CHECK(origin.hits("/persist") == 2);
+        CHECK(reloaded.text == std::string(30000, 'p'));
+    }
+    std::filesystem::remove_all(directory);
+}
+
+int main() {
+    test_fresh_hits_share_the_body();
+    test_not_storable();
+    test_not_modified_refresh();
+    test_last_modified_and_expires();
+    test_request_no_cache_revalidates();
+    test_vary();
+    test_errors_and_removal();
+    test_memory_bound_is_lru();
+    test_disk_tier();
+    return test_result();
+}
@@ -0,0 +1,245 @@
+// The streaming inflater against zlib's own encoder: every wrapper and
+// compression level, fed whole and a byte at a time, plus the failure modes
+// a Content-Encoding decoder has to catch.
+
+#include "TestCheck.h"
+
+#include "Inflate.h"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::detail::Inflater;
+
+// Text with long repeats plus incompressible runs, larger than both the
+// 32 KB window and the 64 KB output chunk.
+static std::string make_payload() {
+    std::string out;
+    std::mt19937 rng(7);
+    for (int i = 0; out.size() < 300 * 1024; ++i) {
+        out += "<key code=\"" + std::to_string(i % 97) + "\" normal=\"\xE0\xA6\x95\" shift=\"\xE0\xA6\x96\"/>\n";
+        if (i % 50 == 0) {
+            for (int j = 0; j < 600; ++j) out += (char)(rng() & 0xFF);
+        }
+    }
+    return out;
+}
+
+// window_bits as for deflateInit2: 15 zlib, -15 raw, 31 gzip.
+static std::string compress(const std::string& data, int level, int window_bits, int strategy = Z_DEFAULT_STRATEGY) {
+    z_stream z = {};
+    CHECK(deflateInit2(&z, level, Z_DEFLATED, window_bits, 8, strategy) == Z_OK);
+    std::string out(deflateBound(&z, data.size()) + 64, '\0');
+    z.next_in = (Bytef*)data.data();
+    z.avail_in = (uInt)data.size();
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = (uInt)out.size();
+    CHECK(deflate(&z, Z_FINISH) == Z_STREAM_END);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+struct Result {
+    bool ok = false;
+    bool done = false;
+    bool limit_exceeded = false;
+    std::string output;
+};
+
+// Feeds input in pieces of at most step bytes, stopping at the first error.
+static Result inflate(const std::string& input, Inflater::Format format, size_t step,
+                      uint64_t max_output = UINT64_MAX) {
+    Inflater inflater;
+    inflater.reset(format, max_output);
+    Result result;
+    result.ok = true;
+    for (size_t pos = 0; pos < input.size() && result.ok; pos += step) {
+        size_t len = input.size() - pos < step ? input.size() - pos : step;
+        result.ok = inflater.feed(input.data() + pos, len, [&](const char* data, size_t n) {
+            CHECK(n <= 96 * 1024 + 512);
+            result.output.append(data, n);
+            return true;
+        });
+    }
+    result.done = inflater.done();
+    result.limit_exceeded = inflater.limit_exceeded();
+    return result;
+}
+
+static void put_le32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out += (char)((value >> (8 * i)) & 0xFF);
+}
+
+static void test_round_trips() {
+    const std::string payload = make_payload();
+    struct Wrapper {
+        int window_bits;
+        Inflater::Format format;
+    };
+    const Wrapper wrappers[] = {
+        {31, Inflater::Format::Gzip},
+        {15, Inflater::Format::Deflate},
+        {-15, Inflater::Format::Deflate},   // bare DEFLATE sent as "deflate"
+        {-15, Inflater::Format::Raw},
+    };
+    for (const Wrapper& wrapper : wrappers) {
+        for (int level : {0, 1, 6, 9}) {
+            const std::string compressed = compress(payload, level, wrapper.window_bits);
+            for (size_t step : {compressed.size(), (size_t)4096, (size_t)1}) {
+                Result result = inflate(compressed, wrapper.format, step);
+                CHECK(result.ok && result.done);
+                CHECK(result.output == payload);
+            }
+        }
+    }
+}
+
+static void test_strategies_and_small_windows() {
+    const std::string payload = make_payload().substr(0, 100 * 1024);
+    // Fixed Huffman codes, literals only, run-length matches, and a 512-byte
+    // window all exercise different block shapes.
+    for (int strategy : {Z_FIXED, Z_HUFFMAN_ONLY, Z_RLE, Z_FILTERED}) {
+        Result result = inflate(compress(payload, 6, 15, strategy), Inflater::Format::Deflate, 1);
+        CHECK(result.ok && result.done && result.output == payload);
+    }
+    Result small = inflate(compress(payload, 9, 9 + 16), Inflater::Format::Gzip, 777);
+    CHECK(small.ok && small.done && small.output == payload);
+}
+
+static void test_empty_and_tiny() {
+    for (const std::string& data : {std::string(), std::string("a"), std::string(300, 'x')}) {
+        Result gzip = inflate(compress(data, 6, 31), Inflater::Format::Gzip, 1);
+        CHECK(gzip.ok && gzip.done && gzip.output == data);
+        Result zlib = inflate(compress(data, 6, 15), Inflater::Format::Deflate, 1);
+        CHECK(zlib.ok && zlib.done && zlib.output == data);
+    }
+}
+
+static void test_multi_member_gzip() {
+    const std::string first = "first member\n";
+    const std::string second = make_payload().substr(0, 40000);
+    const std::string stream = compress(first, 6, 31) + compress(second, 1, 31) + compress("", 9, 31);
+    for (size_t step : {stream.size(), (size_t)1, (size_t)5}) {
+        Result result = inflate(stream, Inflater::Format::Gzip, step);
+        CHECK(result.ok && result.done);
+        CHECK(result.output == first + second);
+    }
+}
+
+static void test_gzip_header_fields() {
+    const std::string payload = "header fields";
+    std::string stream = std::string("\x1F\x8B\x08", 3);
+    stream += (char)(0x04 | 0x08 | 0x10 | 0x02);    // FEXTRA, FNAME, FCOMMENT, FHCRC
+    stream += std::string(6, '\0');
+    stream += std::string("\x05\x00" "extra", 7);
+    stream += std::string("name.txt\0", 9);
+    stream += std::string("a comment\0", 10);
+    stream += std::string("\xAB\xCD", 2);
+    stream += compress(payload, 6, -15);
+    put_le32(stream, (uint32_t)crc32(0, (const Bytef*)payload.data(), (uInt)payload.size()));
+    put_le32(stream, (uint32_t)payload.size());
+
+    for (size_t step : {stream.size(), (size_t)1}) {
+        Result result = inflate(stream, Inflater::Format::Gzip, step);
+        CHECK(result.ok && result.done && result.output == payload);
+    }
+}
+
+static void test_output_limit() {
+    // A 10 MB run of zeros compresses to about 10 KB.
+    const std::string bomb = compress(std::string(10 << 20, '\0'), 9, 31);
+    CHECK(bomb.size() < 64 * 1024);
+    Result limited = inflate(bomb, Inflater::Format::Gzip, 4096, 1 << 20);
+    CHECK(!limited.ok && limited.limit_exceeded && !limited.done);
+    CHECK(limited.output.size() <= (1u << 20));
+
+    // Exactly at the limit is fine.
+    const std::string data(5000, 'y');
+    Result exact = inflate(compress(data, 6, 15), Inflater::Format::Deflate, 1, data.size());
+    CHECK(exact.ok && exact.done && !exact.limit_exceeded && exact.output == data);
+    Result over = inflate(compress(data, 6, 15), Inflater::Format::Deflate, 1, data.size() - 1);
+    CHECK(!over.ok && over.limit_exceeded);
+}
+
+static void test_corrupt_checksums() {
+    const std::string payload = make_payload().substr(0, 20000);
+
+    std::string gzip = compress(payload, 6, 31);
+    std::string bad_crc = gzip;
+    bad_crc[bad_crc.size() - 8] ^= 0x01;
+    Result crc = inflate(bad_crc, Inflater::Format::Gzip, 1);
+    CHECK(!crc.ok && !crc.done);
+    std::string bad_size = gzip;
+    bad_size[bad_size.size() - 1] ^= 0x01;
+    CHECK(!inflate(bad_size, Inflater::Format::Gzip, gzip.size()).ok);
+
+    std::string zlib = compress(payload, 6, 15);
+    zlib[zlib.size() - 1] ^= 0x80;
+    Result adler = inflate(zlib, Inflater::Format::Deflate, 3);
+    CHECK(!adler.ok && !adler.done);
+}
+
+static void test_corrupt_streams() {
+    const std::string payload = make_payload().substr(0, 20000);
+    const std::string gzip = compress(payload, 6, 31);
+
+    std::string bad_magic = gzip;
+    bad_magic[1] = 0x00;
+    CHECK(!inflate(bad_magic, Inflater::Format::Gzip, 1).ok);
+    std::string bad_method = gzip;
+    bad_method[2] = 0x07;
+    CHECK(!inflate(bad_method, Inflater::Format::Gzip, 1).ok);
+
+    // Reserved block type 3.
+    CHECK(!inflate(std::string("\x07", 1), Inflater::Format::Raw, 1).ok);
+    // Stored block whose length and complement disagree.
+    CHECK(!inflate(std::string("\x01\x05\x00\x00\x00", 5), Inflater::Format::Raw, 1).ok);
+
+    // Flipped bits inside the compressed data must never pass as complete
+    // and correct output.
+    std::mt19937 rng(11);
+    for (int i = 0; i < 200; ++i) {
+        std::string damaged = gzip;
+        size_t at = 10 + rng() % (damaged.size() - 18);
+        damaged[at] ^= (char)(1 << (rng() % 8));
+        Result result = inflate(damaged, Inflater::Format::Gzip, 1 + rng() % 64);
+        CHECK(!(result.ok && result.done));
+    }
+
+    // A truncated stream decodes what it can but never reports done.
+    Result truncated = inflate(gzip.substr(0, gzip.size() - 3), Inflater::Format::Gzip, 1);
+    CHECK(truncated.ok && !truncated.done);
+}
+
+static void test_output_callback_can_abort() {
+    const std::string stream = compress(make_payload(), 6, 31);
+    Inflater inflater;
+    inflater.reset(Inflater::Format::Gzip, UINT64_MAX);
+    size_t calls = 0;
+    bool ok = inflater.feed(stream.data(), stream.size(), [&](const char*, size_t) { return ++calls < 2; });
+    CHECK(!ok && calls == 2);
+    // The failure sticks until reset.
+    CHECK(!inflater.feed("", 0, [](const char*, size_t) { return true; }));
+    inflater.reset(Inflater::Format::Gzip, UINT64_MAX);
+    CHECK(inflater.feed(stream.data(), stream.size(), [](const char*, size_t) { return true; }));
+    CHECK(inflater.done());
+}
+
+int main() {
+    test_round_trips();
+    test_strategies_and_small_windows();
+    test_empty_and_tiny();
+    test_multi_member_gzip();
+    test_gzip_header_fields();
+    test_output_limit();
+    test_corrupt_checksums();
+    test_corrupt_streams();
+    test_output_callback_can_abort();
+    return test_result();
+}
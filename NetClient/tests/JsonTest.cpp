@@ -0,0 +1,285 @@
+// The JSON parser: the structural indexer against a byte-at-a-time
+// reference, escapes and backslash runs across 64-byte blocks, surrogate
+// pairs, numbers, the nesting limit, early stops and lookups that index
+// only as far as they read. JsonScalarTest runs the same checks with the
+// portable classifier instead of SSE2.
+
+#include "TestCheck.h"
+
+#include "NetClientJson.h"
+
+#include "JsonIndex.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::detail::JsonIndexer;
+using NetClient::json::Document;
+using NetClient::json::Type;
+using NetClient::json::Value;
+
+// What the indexer should find, one byte at a time: the first byte of
+// each number or literal, each { } [ ] : , outside strings and each
+// opening quote. A backslash escapes the byte after it wherever it is.
+static std::vector<uint32_t> reference_index(const std::string& text) {
+    std::vector<uint32_t> out;
+    bool in_string = false;
+    bool escaped = false;
+    bool in_scalar = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        bool quote = c == '"' && !escaped;
+        escaped = c == '\\' && !escaped;
+        if (quote) {
+            if (!in_string) out.push_back((uint32_t)i);
+            in_string = !in_string;
+            in_scalar = false;
+        } else if (in_string) {
+            in_scalar = false;
+        } else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') {
+            out.push_back((uint32_t)i);
+            in_scalar = false;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            in_scalar = false;
+        } else {
+            if (!in_scalar) out.push_back((uint32_t)i);
+            in_scalar = true;
+        }
+    }
+    return out;
+}
+
+static std::vector<uint32_t> index_of(const std::string& text, size_t chunk) {
+    JsonIndexer indexer;
+    indexer.reset(text.data(), text.size());
+    std::vector<uint32_t> out;
+    while (indexer.next_chunk(out, chunk)) {
+    }
+    return out;
+}
+
+static void test_indexer_matches_reference() {
+    // Heavy on quotes and backslashes so that escape runs and strings
+    // cross block boundaries in every alignment.
+    static const char alphabet[] = "\"\\\\\\{}[]:, \n\tax1-";
+    std::mt19937 rng(40);
+    for (int round = 0; round < 3000; ++round) {
+        std::string text(rng() % 300, ' ');
+        for (char& c : text) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+        std::vector<uint32_t> expected = reference_index(text);
+        CHECK(index_of(text, 64) == expected);
+        CHECK(index_of(text, 1 << 16) == expected);
+    }
+
+    // A run of backslashes ending on the last byte of a block escapes the
+    // first byte of the next one only when the run is odd.
+    for (size_t run = 1; run <= 70; ++run) {
+        for (size_t start = 0; start < 64; ++start) {
+            std::string text = "[\"" + std::string(start, 'x') + std::string(run, '\\') + "\",1]";
+            CHECK(index_of(text, 64) == reference_index(text));
+        }
+    }
+}
+
+static void test_escapes() {
+    Document doc(R"(["\"\\\/\b\f\n\r\t", "éঅ", "😀", "plain", "a\u0000b"])");
+    CHECK(doc.validate());
+    Value root = doc.root();
+    CHECK(root[0].as_string() == "\"\\/\b\f\n\r\t");
+    CHECK(root[1].as_string() == "\xC3\xA9\xE0\xA6\x85");
+    CHECK(root[2].as_string() == "\xF0\x9F\x98\x80");
+    CHECK(root[3].as_string() == "plain");
+    CHECK(root[4].as_string() == std::string("a\0b", 3));
+    CHECK(root[2].raw() == R"("😀")");
+
+    // Lone or misordered surrogates, bad hex digits, unknown escapes and
+    // an unterminated string.
+    for (const char* bad : {R"(["\ud83d"])", R"(["\ude00"])", R"(["\ud83dA"])", R"(["\ude00\ud83d"])",
+                            R"(["\ud83dx"])", R"(["\u12g4"])", R"(["\u12"])", R"(["\x"])", R"(["\"])"}) {
+        Document broken(bad);
+        CHECK(!broken.validate());
+        CHECK(!broken.error().empty());
+        std::string out;
+        CHECK(!broken.root()[0].get(out));
+    }
+
+    // A raw control character is only looked for by validate(); get() of
+    // a string without escapes hands out the text as it is.
+    Document control("[\"a\tb\"]");
+    CHECK(control.root()[0].as_string() == "a\tb");
+    CHECK(!control.validate());
+}
+
+static void test_backslash_runs_across_blocks() {
+    // n escaped backslashes then an escaped quote, starting at every
+    // offset of a block; the element after the string must still be found.
+    for (size_t pairs = 0; pairs <= 33; ++pairs) {
+        for (size_t pad = 0; pad < 64; ++pad) {
+            std::string content = std::string(pad, 'p');
+            for (size_t i = 0; i < pairs; ++i) content += "\\\\";
+            content += "\\\"";
+            std::string text = "[\"" + content + "\", \"" + std::string(pairs * 2, '\\') + "\", 7]";
+            // The second string is invalid unless its backslash run is even,
+            // which it is, so both parse.
+            Document doc(text);
+            Value root = doc.root();
+            CHECK(root[0].as_string() == std::string(pad, 'p') + std::string(pairs, '\\') + "\"");
+            CHECK(root[1].as_string() == std::string(pairs, '\\'));
+            CHECK(root[2].as_int() == 7);
+            CHECK(root.size() == 3);
+            CHECK(doc.validate());
+        }
+    }
+}
+
+static void test_numbers() {
+    Document doc("[0, -0, 42, -17, 1.5, -2.5e-3, 1E3, 9223372036854775807, -9223372036854775808, "
+                 "18446744073709551615, 9223372036854775808, 1e400, true, false, null]");
+    CHECK(doc.validate());
+    Value root = doc.root();
+    CHECK(root.size() == 15);
+    CHECK(root[0].as_int(-1) == 0);
+    CHECK(root[1].as_int(-1) == 0);
+    CHECK(root[2].as_int() == 42);
+    CHECK(root[3].as_int() == -17);
+    CHECK(root[4].as_double() == 1.5);
+    CHECK(root[5].as_double() == -2.5e-3);
+    CHECK(root[6].as_double() == 1000);
+    CHECK(root[7].as_int() == INT64_MAX);
+    CHECK(root[8].as_int() == INT64_MIN);
+
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0;
+    CHECK(!root[4].get(i));                     // a fraction
+    CHECK(!root[6].get(i));                     // an exponent
+    CHECK(!root[3].get(u));                     // negative
+    CHECK(root[9].get(u) && u == UINT64_MAX);
+    CHECK(!root[9].get(i));                     // past int64
+    CHECK(root[10].get(u) && u == 9223372036854775808ull);
+    CHECK(root[10].get(d) && d == 9223372036854775808.0);
+    CHECK(!root[11].get(d));                    // out of range
+    CHECK(root[12].as_bool() && !root[13].as_bool(true) && root[14].is_null());
+    CHECK(root[12].type() == Type::Bool && root[14].type() == Type::Null && root[2].type() == Type::Number);
+
+    for (const char* bad : {"[01]", "[1.]", "[-]", "[1e]", "[.5]", "[+1]", "[1e+]", "[--1]", "[0x10]",
+                            "[tru]", "[nul]", "[truex]", "[1 2]"}) {
+        Document broken(bad);
+        CHECK(!broken.validate());
+    }
+    Document broken("[01]");
+    CHECK(!broken.root()[0].get(i));
+}
+
+static void test_depth_limit() {
+    const int limit = 1024;
+    std::string deep = std::string(limit, '[') + "1" + std::string(limit, ']');
+    Document ok(deep);
+    CHECK(ok.validate());
+
+    std::string deeper = std::string(limit + 1, '[') + std::string(limit + 1, ']');
+    Document too_deep(deeper);
+    CHECK(!too_deep.validate());
+    CHECK(too_deep.error().find("nesting too deep") == 0);
+
+    std::string objects;
+    for (int i = 0; i <= limit; ++i) objects += "{\"k\":";
+    objects += "1" + std::string(limit + 1, '}');
+    Document too_deep_objects(objects);
+    CHECK(!too_deep_objects.validate());
+
+    // Lookups skip nested containers without a limit.
+    Value v = too_deep.root();
+    for (int i = 0; i < 5; ++i) v = v[0];
+    CHECK(v.type() == Type::Array);
+}
+
+static void test_malformed_documents() {
+    for (const char* bad : {"", "   ", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}", "[1]]", "[1] x",
+                            "[\"open", "{\"a\":", "[", "}"}) {
+        Document doc(bad);
+        CHECK(!doc.validate());
+        CHECK(!doc.error().empty());
+    }
+    Document empty("");
+    CHECK(!empty.root().valid());
+    CHECK(empty.error().find("empty document") == 0);
+
+    Document doc(R"({"a": [1, {"b": "c"}], "e\u0073c": 2})");
+    Value root = doc.root();
+    CHECK(root["a"][1]["b"].as_string() == "c");
+    CHECK(root["esc"].as_int() == 2);           // keys are compared unescaped
+    CHECK(!root["missing"]["deeper"][3].valid());
+    CHECK(!root["a"][5].valid());
+    CHECK(!root[0].valid());
+    CHECK(root["a"].raw() == R"([1, {"b": "c"}])");
+    CHECK(doc.error().empty());
+}
+
+static void test_early_stop() {
+    // Everything after the second element is garbage; stopping before it
+    // must not report an error.
+    Document doc("[1, 2, @@@ not json");
+    int seen = 0;
+    CHECK(doc.root().for_each([&](Value v) {
+        ++seen;
+        return v.as_int() != 2;
+    }));
+    CHECK(seen == 2);
+    CHECK(doc.error().empty());
+    CHECK(!doc.validate());
+
+    Document members(R"({"a": 1, "b": 2, "c": )");
+    std::vector<std::string> keys;
+    CHECK(members.root().for_each_member([&](std::string_view key, Value) {
+        keys.emplace_back(key);
+        return key != "b";
+    }));
+    CHECK((keys == std::vector<std::string>{"a", "b"}));
+    CHECK(!members.root().for_each_member([](std::string_view, Value) { return true; }));
+}
+
+static void test_lazy_indexing_across_chunks() {
+    // The parser indexes 64 KB at a time. A value at the head of a large
+    // document is read without indexing the rest, so damage at the end
+    // goes unnoticed until validate().
+    const size_t chunk = 64 * 1024;
+    std::string big = R"({"version": 3, "filler": ")" + std::string(4 * chunk, 'f') + R"(", "tail": @})";
+    Document doc(big);
+    CHECK(doc.root()["version"].as_int() == 3);
+    CHECK(doc.error().empty());
+    CHECK(!doc.validate());
+
+    // An escaped string straddling a chunk boundary at every alignment,
+    // followed by a key that can only be found in the next chunk.
+    for (size_t shift = 0; shift < 8; ++shift) {
+        std::string head = "{\"pad\": \"" + std::string(chunk - 16 + shift, 'p');
+        std::string text = head + "\\\\\\\"\\u0985\\\\\", \"key\": [1, \"two\"]}";
+        Document straddle(text);
+        Value root = straddle.root();
+        std::string pad;
+        CHECK(root["pad"].get(pad));
+        CHECK(pad == std::string(chunk - 16 + shift, 'p') + "\\\"\xE0\xA6\x85\\");
+        CHECK(root["key"][1].as_string() == "two");
+        CHECK(straddle.validate());
+    }
+
+    // reset() starts over on new text.
+    Document reused(big);
+    reused.reset(R"([true])");
+    CHECK(reused.validate() && reused.root()[0].as_bool());
+}
+
+int main() {
+    test_indexer_matches_reference();
+    test_escapes();
+    test_backslash_runs_across_blocks();
+    test_numbers();
+    test_depth_limit();
+    test_malformed_documents();
+    test_early_stop();
+    test_lazy_indexing_across_chunks();
+    return test_result();
+}
@@ -0,0 +1,210 @@
+#include "LoopbackServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace NetClientTest {
+
+    bool Connection::send(const std::string& bytes) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            ssize_t n = ::send(fd_, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += (size_t)n;
+        }
+        return true;
+    }
+
+    bool Connection::fill() {
+        char buffer[16 * 1024];
+        while (true) {
+            ssize_t n = ::recv(fd_, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            input_.append(buffer, (size_t)n);
+            return true;
+        }
+    }
+
+    bool Connection::read(std::string& out, size_t len) {
+        while (input_.size() < len) {
+            if (!fill()) return false;
+        }
+        out.assign(input_, 0, len);
+        input_.erase(0, len);
+        return true;
+    }
+
+    void Connection::hang() {
+        input_.clear();
+        while (fill()) input_.clear();
+    }
+
+    bool Connection::pending(int wait_ms) {
+        if (!input_.empty()) return true;
+        pollfd waiter = {fd_, POLLIN, 0};
+        return ::poll(&waiter, 1, wait_ms) > 0 && fill();
+    }
+
+    LoopbackServer::LoopbackServer(Handler handler) : handler_(std::move(handler)) {}
+
+    LoopbackServer::~LoopbackServer() {
+        stopping_ = true;
+        if (listener_ >= 0) {
+            ::shutdown(listener_, SHUT_RDWR);
+            if (acceptor_.joinable()) acceptor_.join();
+            ::close(listener_);
+        }
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : open_) ::shutdown(fd, SHUT_RDWR);
+            workers.swap(workers_);
+        }
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    bool LoopbackServer::start() {
+        listener_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (listener_ < 0 || ::bind(listener_, (sockaddr*)&addr, len) != 0 || ::listen(listener_, 64) != 0 ||
+            ::getsockname(listener_, (sockaddr*)&addr, &len) != 0) {
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread(&LoopbackServer::accept_loop, this);
+        return true;
+    }
+
+    std::string LoopbackServer::url(const std::string& path, const char* scheme) const {
+        return std::string(scheme) + "://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    void LoopbackServer::accept_loop() {
+        while (!stopping_) {
+            int fd = ::accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                ::close(fd);
+                break;
+            }
+            open_.insert(fd);
+            int index = ++connections_;
+            workers_.emplace_back(&LoopbackServer::serve, this, fd, index);
+        }
+    }
+
+    static std::string lowercase(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return text;
+    }
+
+    static std::string trim(const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t");
+        size_t end = text.find_last_not_of(" \t\r");
+        return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+    }
+
+    void LoopbackServer::serve(int fd, int index) {
+        Connection conn(fd);
+        for (int sequence = 1; !stopping_; ++sequence) {
+            size_t end;
+            bool open = true;
+            while ((end = conn.input_.find("\r\n\r\n")) == std::string::npos && (open = conn.fill())) {
+            }
+            if (!open) break;
+
+            HttpRequest request;
+            request.connection = index;
+            request.sequence = sequence;
+            std::istringstream head(conn.input_.substr(0, end));
+            conn.input_.erase(0, end + 4);
+            std::string line;
+            std::getline(head, line);
+            std::istringstream start(line);
+            start >> request.method >> request.target;
+            while (std::getline(head, line)) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    request.headers[lowercase(line.substr(0, colon))] = trim(line.substr(colon + 1));
+                }
+            }
+
+            bool complete = true;
+            if (lowercase(request.header("transfer-encoding")).find("chunked") != std::string::npos) {
+                while (complete) {
+                    size_t eol;
+                    while ((eol = conn.input_.find("\r\n")) == std::string::npos && (complete = conn.fill())) {
+                    }
+                    if (!complete) break;
+                    size_t size = std::strtoull(conn.input_.c_str(), nullptr, 16);
+                    conn.input_.erase(0, eol + 2);
+                    std::string chunk;
+                    complete = conn.read(chunk, size + 2);
+                    if (size == 0) break;
+                    request.body += chunk.substr(0, size);
+                }
+            } else if (!request.header("content-length").empty()) {
+                complete = conn.read(request.body, std::strtoull(request.header("content-length").c_str(), nullptr, 10));
+            }
+            if (!complete) break;
+
+            ++requests_;
+            if (!handler_(conn, request)) break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_.erase(fd);
+        ::close(fd);
+    }
+
+    std::string http_response(int status, const std::string& body, const std::string& extra) {
+        return "HTTP/1.1 " + std::to_string(status) + " Test\r\nContent-Length: " + std::to_string(body.size()) +
+               "\r\n" + extra + "\r\n" + body;
+    }
+
+    std::string temp_path(const std::string& name) {
+        static std::atomic<int> counter{0};
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+        return (dir / ("netclient-test-" + std::to_string(::getpid()) + "-" + std::to_string(++counter) + "-" + name))
+                .string();
+    }
+
+    bool write_file(const std::string& path, const std::string& bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        return (bool)out;
+    }
+
+    bool read_file(const std::string& path, std::string& out) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        out = buffer.str();
+        return true;
+    }
+
+} // namespace NetClientTest
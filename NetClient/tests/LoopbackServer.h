@@ -0,0 +1,105 @@
+#ifndef NETCLIENT_TEST_LOOPBACK_SERVER_H
+#define NETCLIENT_TEST_LOOPBACK_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NetClientTest {
+
+    struct HttpRequest {
+        std::string method;
+        std::string target;
+        std::map<std::string, std::string> headers;     // names lowercased
+        std::string body;
+        int connection = 0;         // 1 for the server's first connection, ...
+        int sequence = 0;           // 1 for a connection's first request, ...
+
+        std::string header(const std::string& lowercase_name) const {
+            auto it = headers.find(lowercase_name);
+            return it == headers.end() ? std::string() : it->second;
+        }
+    };
+
+    // One accepted socket, handed to the handler with each request.
+    class Connection {
+    public:
+        explicit Connection(int fd) : fd_(fd) {}
+
+        bool send(const std::string& bytes);
+        // Reads exactly len bytes, taking buffered input first.
+        bool read(std::string& out, size_t len);
+        // Blocks until the peer closes or the server stops, for a handler
+        // that never answers.
+        void hang();
+        // True when bytes past the current request have arrived within
+        // wait_ms, as they have when the client pipelines.
+        bool pending(int wait_ms);
+
+        int fd() const { return fd_; }
+
+    private:
+        friend class LoopbackServer;
+        bool fill();
+
+        int fd_;
+        std::string input_;
+    };
+
+    // HTTP/1.1 server on 127.0.0.1 with an ephemeral port, standing in for a
+    // real host. Each connection gets a thread that parses requests (bodies
+    // by Content-Length or chunked) and passes them to the handler, which
+    // writes whatever bytes it likes. A handler returning false closes the
+    // connection; one that hijacks the socket for another protocol keeps
+    // it until it returns.
+    class LoopbackServer {
+    public:
+        typedef std::function<bool(Connection& conn, const HttpRequest& request)> Handler;
+
+        explicit LoopbackServer(Handler handler);
+        // Closes every connection and joins their threads.
+        ~LoopbackServer();
+
+        LoopbackServer(const LoopbackServer&) = delete;
+        LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+        bool start();
+        int port() const { return port_; }
+        std::string url(const std::string& path, const char* scheme = "http") const;
+
+        int connections() const { return connections_; }
+        int requests() const { return requests_; }
+
+    private:
+        void accept_loop();
+        void serve(int fd, int index);
+
+        Handler handler_;
+        int listener_ = -1;
+        int port_ = 0;
+        std::atomic<bool> stopping_{false};
+        std::atomic<int> connections_{0};
+        std::atomic<int> requests_{0};
+        std::thread acceptor_;
+
+        std::mutex mutex_;
+        std::set<int> open_;
+        std::vector<std::thread> workers_;
+    };
+
+    // A complete response with Content-Length; extra is "Name: value\r\n" lines.
+    std::string http_response(int status, const std::string& body, const std::string& extra = "");
+
+    // A unique path under the system temporary directory.
+    std::string temp_path(const std::string& name);
+    bool write_file(const std::string& path, const std::string& bytes);
+    bool read_file(const std::string& path, std::string& out);
+
+} // namespace NetClientTest
+
+#endif // NETCLIENT_TEST_LOOPBACK_SERVER_H
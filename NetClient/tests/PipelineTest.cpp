@@ -0,0 +1,208 @@
+// Session::batch in Pipelined mode against loopback servers: requests to
+// one host share a connection, HEAD responses carry no body, and a host
+// that answers HTTP/1.0 or closes partway through gets the rest of the
+// batch through the pooled path and is not pipelined to again.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::BatchMode;
+using NetClient::BatchRequest;
+using NetClient::Response;
+using NetClient::Session;
+using NetClient::SessionOptions;
+
+// Remembers each request, and the connections on which a request had
+// already arrived before the one ahead of it was answered. Without
+// pipelining that cannot happen.
+class Recorder {
+public:
+    void record(Connection& conn, const HttpRequest& request) {
+        bool pipelined = conn.pending(20);
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(request);
+        if (pipelined) pipelined_.insert(request.connection);
+    }
+
+    std::vector<HttpRequest> requests() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+    // Connections that carried pipelined requests.
+    std::set<int> pipelined() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pipelined_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<HttpRequest> requests_;
+    std::set<int> pipelined_;
+};
+
+static BatchRequest batch_request(const std::string& method, const std::string& url) {
+    BatchRequest request;
+    request.method = method;
+    request.url = url;
+    return request;
+}
+
+static SessionOptions many_connections() {
+    SessionOptions options;
+    options.max_connections_per_host = 8;
+    options.request_timeout_ms = 5000;
+    return options;
+}
+
+static void test_one_connection_per_host() {
+    Recorder recorder;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        recorder.record(conn, request);
+        std::string body = "body of " + request.target;
+        if (request.method == "HEAD") {
+            // Framing headers as for a GET, and no body.
+            return conn.send("HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+        }
+        if (request.target == "/chunked") {
+            return conn.send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n7\r\nchunked\r\n0\r\n\r\n");
+        }
+        return conn.send(http_response(200, body));
+    });
+    CHECK(server.start());
+    LoopbackServer other([](Connection& conn, const HttpRequest&) { return conn.send(http_response(200, "other")); });
+    CHECK(other.start());
+
+    Session session(many_connections());
+    std::vector<BatchRequest> batch = {
+        batch_request("GET", server.url("/a")),      batch_request("HEAD", server.url("/head")),
+        batch_request("GET", server.url("/chunked")), batch_request("POST", server.url("/post")),
+        batch_request("HEAD", server.url("/head2")), batch_request("GET", other.url("/lone")),
+        batch_request("GET", server.url("/b")),
+    };
+    std::vector<Response> responses = session.batch(batch);
+    CHECK(responses.size() == batch.size());
+    CHECK(responses[0].status_code == 200 && responses[0].text == "body of /a");
+    CHECK(responses[1].status_code == 200 && responses[1].text.empty());
+    CHECK(responses[1].header("Content-Length") == "13");
+    CHECK(responses[2].text == "chunked");
+    CHECK(responses[3].status_code == 200 && responses[3].text == "body of /post");
+    CHECK(responses[4].status_code == 200 && responses[4].text.empty());
+    CHECK(responses[5].text == "other");
+    CHECK(responses[6].text == "body of /b");
+    for (size_t i = 0; i < responses.size(); ++i) CHECK(responses[i].url == batch[i].url);
+
+    // The GETs and HEADs shared one connection, in batch order. The POST
+    // went after them, perhaps on the same connection once it was free.
+    std::map<int, std::vector<std::string>> by_connection;
+    for (const HttpRequest& request : recorder.requests()) {
+        if (request.method != "POST") by_connection[request.connection].push_back(request.method + " " + request.target);
+    }
+    CHECK(by_connection.size() == 1);
+    CHECK(recorder.pipelined().size() == 1);
+    const std::vector<std::string> expected = {"GET /a", "HEAD /head", "GET /chunked", "HEAD /head2", "GET /b"};
+    CHECK(by_connection.begin()->second == expected);
+    CHECK(recorder.pipelined().count(by_connection.begin()->first) == 1);
+
+    // Pooled mode never pipelines.
+    std::vector<Response> pooled = session.batch(batch, BatchMode::Pooled);
+    CHECK(pooled[1].text.empty() && pooled[6].text == "body of /b");
+    CHECK(recorder.pipelined().size() == 1);
+}
+
+// Checks that every response of a batch of n GETs to server arrived intact.
+static bool batch_answered(Session& session, LoopbackServer& server, int n) {
+    std::vector<BatchRequest> batch;
+    for (int i = 0; i < n; ++i) batch.push_back(batch_request("GET", server.url("/r" + std::to_string(i))));
+    std::vector<Response> responses = session.batch(batch);
+    bool ok = responses.size() == (size_t)n;
+    for (int i = 0; ok && i < n; ++i) {
+        ok = responses[i].status_code == 200 && responses[i].text == "/r" + std::to_string(i);
+    }
+    return ok;
+}
+
+static void test_http10_falls_back() {
+    // Answers the first request of each connection in HTTP/1.0, whose
+    // connections close after one response.
+    Recorder recorder;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        recorder.record(conn, request);
+        conn.send("HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(request.target.size()) + "\r\n\r\n" +
+                  request.target);
+        return false;
+    });
+    CHECK(server.start());
+
+    Session session(many_connections());
+    CHECK(batch_answered(session, server, 5));
+    CHECK(recorder.pipelined().size() == 1);
+    CHECK(recorder.requests().size() == 5);     // the unanswered four were sent again, one each
+
+    // The session remembers the host: the next batch goes pooled.
+    CHECK(batch_answered(session, server, 5));
+    CHECK(recorder.pipelined().size() == 1);
+
+    // Another session starts afresh.
+    Session fresh(many_connections());
+    CHECK(batch_answered(fresh, server, 3));
+    CHECK(recorder.pipelined().size() == 2);
+}
+
+static void test_close_midway_falls_back() {
+    // Closes each connection after two responses, without announcing it.
+    Recorder recorder;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        recorder.record(conn, request);
+        return conn.send(http_response(200, request.target)) && request.sequence < 2;
+    });
+    CHECK(server.start());
+
+    Session session(many_connections());
+    CHECK(batch_answered(session, server, 8));
+    CHECK(recorder.pipelined().size() == 1);
+
+    // Two answers came off the pipelined connection. The server never read
+    // the other six there, and they were sent once more, one each.
+    std::map<std::string, int> sent;
+    for (const HttpRequest& request : recorder.requests()) ++sent[request.target];
+    CHECK(sent.size() == 8);
+    for (const auto& entry : sent) CHECK(entry.second == 1);
+
+    CHECK(batch_answered(session, server, 8));
+    CHECK(recorder.pipelined().size() == 1);
+}
+
+static void test_failure_before_any_answer_keeps_pipelining() {
+    // The first connection is dropped unanswered; later ones work.
+    Recorder recorder;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        recorder.record(conn, request);
+        if (request.connection == 1) return false;
+        return conn.send(http_response(200, request.target));
+    });
+    CHECK(server.start());
+
+    Session session(many_connections());
+    CHECK(batch_answered(session, server, 4));
+    // Nothing was learned about pipelining, so the next batch tries again.
+    CHECK(batch_answered(session, server, 4));
+    CHECK(recorder.pipelined().size() == 2);
+}
+
+int main() {
+    test_one_connection_per_host();
+    test_http10_falls_back();
+    test_close_midway_falls_back();
+    test_failure_before_any_answer_keeps_pipelining();
+    return test_result();
+}
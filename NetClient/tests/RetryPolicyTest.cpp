@@ -0,0 +1,386 @@
+// RetryPolicy: backoff, Retry-After, the idempotency rules, the circuit
+// breaker and hedging, against loopback servers that inject faults.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "RetryPolicy.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace NetClientTest;
+using NetClient::Response;
+using NetClient::RetryPolicy;
+using NetClient::Session;
+using NetClient::SessionOptions;
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static Response failure(int status, const std::string& retry_after = "") {
+    Response resp;
+    resp.status_code = status;
+    if (!retry_after.empty()) resp.headers.add("Retry-After", retry_after);
+    return resp;
+}
+
+static Response transport_error(const std::string& error) {
+    Response resp;
+    resp.status_code = 0;
+    resp.error = error;
+    return resp;
+}
+
+// A loopback port nothing listens on, so connecting is refused.
+static int closed_port() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = 0;
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && ::getsockname(fd, (sockaddr*)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    ::close(fd);
+    return port;
+}
+
+static SessionOptions retrying(int max_attempts) {
+    SessionOptions config;
+    config.retry.max_attempts = max_attempts;
+    config.retry.base_delay_ms = 10;
+    config.retry.max_delay_ms = 1000;
+    return config;
+}
+
+static void test_should_retry_rules() {
+    RetryPolicy policy;
+    CHECK(NetClient::detail::should_retry(policy, "GET", failure(503)));
+    CHECK(NetClient::detail::should_retry(policy, "PUT", failure(429)));
+    CHECK(!NetClient::detail::should_retry(policy, "GET", failure(500)));
+    CHECK(!NetClient::detail::should_retry(policy, "GET", failure(404)));
+    CHECK(NetClient::detail::should_retry(policy, "GET", transport_error("connection failed")));
+    CHECK(!NetClient::detail::should_retry(policy, "GET", transport_error("cancelled")));
+    CHECK(!NetClient::detail::should_retry(policy, "GET", transport_error("circuit open")));
+
+    // A POST is repeated only when it cannot have reached the server.
+    CHECK(!NetClient::detail::should_retry(policy, "POST", failure(503)));
+    CHECK(!NetClient::detail::should_retry(policy, "POST", transport_error("connection failed")));
+    CHECK(NetClient::detail::should_retry(policy, "POST", transport_error("connect failed")));
+    CHECK(NetClient::detail::should_retry(policy, "POST", transport_error("name lookup failed")));
+    policy.retry_non_idempotent = true;
+    CHECK(NetClient::detail::should_retry(policy, "POST", failure(503)));
+    CHECK(NetClient::detail::should_retry(policy, "POST", transport_error("connection failed")));
+
+    CHECK(NetClient::detail::counts_as_failure(failure(500)));
+    CHECK(NetClient::detail::counts_as_failure(transport_error("timeout")));
+    CHECK(!NetClient::detail::counts_as_failure(failure(404)));
+    CHECK(!NetClient::detail::counts_as_failure(transport_error("cancelled")));
+}
+
+static void test_backoff_delay() {
+    RetryPolicy policy;
+    policy.base_delay_ms = 100;
+    policy.max_delay_ms = 1000;
+
+    // Full jitter up to base * 2^(attempt-1), capped at max_delay_ms.
+    int bounds[] = {100, 200, 400, 800, 1000, 1000};
+    for (int attempt = 1; attempt <= 6; ++attempt) {
+        int largest = 0;
+        for (int i = 0; i < 200; ++i) {
+            int delay = NetClient::detail::backoff_delay_ms(policy, attempt, failure(503));
+            CHECK(delay >= 0 && delay <= bounds[attempt - 1]);
+            largest = std::max(largest, delay);
+        }
+        // Two hundred draws that all stay in the bottom half would be a broken rng.
+        CHECK(largest > bounds[attempt - 1] / 2);
+    }
+
+    // Retry-After overrides the backoff, in seconds or as an HTTP-date, and
+    // asking for more than max_delay_ms ends retrying.
+    CHECK(NetClient::detail::backoff_delay_ms(policy, 1, failure(503, "0")) == 0);
+    CHECK(NetClient::detail::backoff_delay_ms(policy, 3, failure(503, "1")) == 1000);
+    CHECK(NetClient::detail::backoff_delay_ms(policy, 1, failure(503, "2")) == -1);
+    CHECK(NetClient::detail::backoff_delay_ms(policy, 1, failure(503, "Thu, 01 Jan 1970 00:00:00 GMT")) == 0);
+    CHECK(NetClient::detail::backoff_delay_ms(policy, 1, failure(503, "Fri, 01 Jan 2100 00:00:00 GMT")) == -1);
+}
+
+static void test_503_without_retry_after() {
+    std::atomic<int> seen{0};
+    LoopbackServer server([&](Connection& conn, const HttpRequest&) {
+        if (++seen < 3) return conn.send(http_response(503, "busy"));
+        return conn.send(http_response(200, "done"));
+    });
+    CHECK(server.start());
+    Session session(retrying(4));
+
+    Response resp = session.get(server.url("/flaky"));
+    CHECK(resp.status_code == 200 && resp.text == "done");
+    CHECK(server.requests() == 3);
+}
+
+static void test_503_with_retry_after() {
+    std::atomic<int> seen{0};
+    LoopbackServer server([&](Connection& conn, const HttpRequest&) {
+        if (++seen == 1) return conn.send(http_response(503, "later", "Retry-After: 1\r\n"));
+        return conn.send(http_response(200, "done"));
+    });
+    CHECK(server.start());
+    Session session(retrying(3));
+
+    Clock::time_point start = Clock::now();
+    Response resp = session.get(server.url("/later"));
+    CHECK(resp.status_code == 200);
+    CHECK(server.requests() == 2);
+    // The server's one second, not the 10 ms backoff.
+    CHECK(ms_since(start) >= 950);
+
+    // A Retry-After beyond max_delay_ms is returned as is.
+    LoopbackServer distant([](Connection& conn, const HttpRequest&) {
+        return conn.send(http_response(503, "much later", "Retry-After: 60\r\n"));
+    });
+    CHECK(distant.start());
+    start = Clock::now();
+    resp = session.get(distant.url("/later"));
+    CHECK(resp.status_code == 503);
+    CHECK(distant.requests() == 1);
+    CHECK(ms_since(start) < 500);
+}
+
+static void test_attempts_are_bounded() {
+    LoopbackServer server([](Connection& conn, const HttpRequest&) {
+        return conn.send(http_response(503, "busy"));
+    });
+    CHECK(server.start());
+    Session session(retrying(3));
+
+    Response resp = session.get(server.url("/down"));
+    CHECK(resp.status_code == 503);
+    CHECK(server.requests() == 3);
+
+    // Statuses outside retry_statuses are final.
+    LoopbackServer broken([](Connection& conn, const HttpRequest&) {
+        return conn.send(http_response(500, "bug"));
+    });
+    CHECK(broken.start());
+    CHECK(session.get(broken.url("/bug")).status_code == 500);
+    CHECK(broken.requests() == 1);
+}
+
+// Drops its first connection unanswered, then answers on later ones.
+static bool drop_first_connection(Connection& conn, const HttpRequest& request) {
+    if (request.connection == 1) return false;
+    return conn.send(http_response(200, request.method + " " + request.body));
+}
+
+static void test_dropped_connections() {
+    LoopbackServer server(drop_first_connection);
+    CHECK(server.start());
+    Session session(retrying(3));
+    Response resp = session.get(server.url("/get"));
+    CHECK(resp.status_code == 200);
+    CHECK(server.connections() == 2);
+
+    // A POST that reached the server may have been applied; it is not repeated.
+    LoopbackServer once(drop_first_connection);
+    CHECK(once.start());
+    resp = session.post(once.url("/post"), "once");
+    CHECK(resp.status_code == 0);
+    CHECK(resp.error == "connection failed");
+    CHECK(once.requests() == 1);
+
+    SessionOptions config = retrying(3);
+    config.retry.retry_non_idempotent = true;
+    Session reckless(config);
+    LoopbackServer again(drop_first_connection);
+    CHECK(again.start());
+    resp = reckless.post(again.url("/post"), "again");
+    CHECK(resp.status_code == 200 && resp.text == "POST again");
+    CHECK(again.requests() == 2);
+}
+
+static void test_slow_first_response_is_retried() {
+    std::atomic<int> seen{0};
+    LoopbackServer server([&](Connection& conn, const HttpRequest&) {
+        if (++seen == 1) {
+            conn.hang();
+            return false;
+        }
+        return conn.send(http_response(200, "fast"));
+    });
+    CHECK(server.start());
+    SessionOptions config = retrying(2);
+    config.request_timeout_ms = 200;
+    Session session(config);
+
+    Clock::time_point start = Clock::now();
+    Response resp = session.get(server.url("/slow"));
+    CHECK(resp.status_code == 200 && resp.text == "fast");
+    CHECK(ms_since(start) >= 190 && ms_since(start) < 2000);
+}
+
+static void test_deadline_bounds_retries() {
+    int port = closed_port();
+    CHECK(port > 0);
+    SessionOptions config;
+    config.retry.max_attempts = 1000;
+    config.retry.base_delay_ms = 20;
+    config.retry.max_delay_ms = 50;
+    config.retry.deadline_ms = 300;
+    Session session(config);
+
+    // A POST that could not connect never reached the host, so it is
+    // retried like a GET until the deadline.
+    Clock::time_point start = Clock::now();
+    Response resp = session.post("http://127.0.0.1:" + std::to_string(port) + "/", "data");
+    CHECK(resp.status_code == 0);
+    CHECK(resp.error == "connect failed");
+    CHECK(ms_since(start) >= 200 && ms_since(start) < 1500);
+}
+
+static void test_circuit_breaker_states() {
+    NetClient::detail::CircuitBreaker breaker(2, 100);
+    std::string url = "http://example.test/a";
+    CHECK(breaker.allow(url));
+    breaker.record(url, true);
+    CHECK(breaker.allow(url));
+    breaker.record(url, true);
+
+    // Open: everything is refused, for every path on the host.
+    CHECK(!breaker.allow(url));
+    CHECK(!breaker.allow("http://example.test/b"));
+    CHECK(breaker.allow("http://other.test/"));
+
+    // Half-open: one trial at a time; its failure opens the breaker again.
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    CHECK(breaker.allow(url));
+    CHECK(!breaker.allow(url));
+    breaker.record(url, true);
+    CHECK(!breaker.allow(url));
+
+    // A successful trial closes it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    CHECK(breaker.allow(url));
+    breaker.record(url, false);
+    CHECK(breaker.allow(url));
+    CHECK(breaker.allow(url));
+}
+
+static void test_circuit_breaker_with_failing_host() {
+    std::atomic<bool> healthy{false};
+    LoopbackServer server([&](Connection& conn, const HttpRequest&) {
+        return conn.send(healthy ? http_response(200, "up") : http_response(500, "down"));
+    });
+    CHECK(server.start());
+    SessionOptions config;
+    config.retry.breaker_threshold = 2;
+    config.retry.breaker_cooldown_ms = 200;
+    Session session(config);
+
+    CHECK(session.get(server.url("/")).status_code == 500);
+    CHECK(session.get(server.url("/")).status_code == 500);
+
+    // Open: failed without touching the host.
+    Clock::time_point start = Clock::now();
+    Response resp = session.get(server.url("/"));
+    CHECK(resp.status_code == 0 && resp.error == "circuit open");
+    CHECK(ms_since(start) < 100);
+    CHECK(server.requests() == 2);
+
+    // Half-open: the trial reaches the host, fails, and opens it again.
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    CHECK(session.get(server.url("/")).status_code == 500);
+    CHECK(server.requests() == 3);
+    CHECK(session.get(server.url("/")).error == "circuit open");
+
+    // A healthy trial closes it.
+    healthy = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    CHECK(session.get(server.url("/")).status_code == 200);
+    CHECK(session.get(server.url("/")).status_code == 200);
+    CHECK(server.requests() == 5);
+}
+
+static void test_always_failing_host_opens_breaker() {
+    int port = closed_port();
+    CHECK(port > 0);
+    std::string url = "http://127.0.0.1:" + std::to_string(port) + "/";
+    SessionOptions config = retrying(5);
+    config.retry.breaker_threshold = 3;
+    config.retry.breaker_cooldown_ms = 60000;
+    Session session(config);
+
+    // The third failed attempt opens the breaker, which ends the retries.
+    Response resp = session.get(url);
+    CHECK(resp.status_code == 0 && resp.error == "circuit open");
+    resp = session.get(url);
+    CHECK(resp.status_code == 0 && resp.error == "circuit open");
+}
+
+static void test_hedging_trims_slow_first_response() {
+    std::atomic<int> seen{0};
+    LoopbackServer server([&](Connection& conn, const HttpRequest&) {
+        if (++seen == 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+            return conn.send(http_response(200, "slow"));
+        }
+        return conn.send(http_response(200, "fast"));
+    });
+    CHECK(server.start());
+    SessionOptions config;
+    config.retry.hedge_after_ms = 100;
+    Session session(config);
+
+    Clock::time_point start = Clock::now();
+    Response resp = session.get(server.url("/hedged"));
+    CHECK(resp.status_code == 200 && resp.text == "fast");
+    CHECK(ms_since(start) >= 90 && ms_since(start) < 1000);
+    CHECK(server.requests() == 2);
+    CHECK(server.connections() == 2);
+
+    // A prompt answer sends no hedge.
+    LoopbackServer prompt([](Connection& conn, const HttpRequest&) {
+        return conn.send(http_response(200, "prompt"));
+    });
+    CHECK(prompt.start());
+    CHECK(session.get(prompt.url("/")).text == "prompt");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(prompt.requests() == 1);
+
+    // Only GETs are hedged.
+    std::atomic<int> posts{0};
+    LoopbackServer slow_post([&](Connection& conn, const HttpRequest&) {
+        ++posts;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        return conn.send(http_response(200, "posted"));
+    });
+    CHECK(slow_post.start());
+    CHECK(session.post(slow_post.url("/"), "x").text == "posted");
+    CHECK(posts == 1);
+}
+
+int main() {
+    test_should_retry_rules();
+    test_backoff_delay();
+    test_503_without_retry_after();
+    test_503_with_retry_after();
+    test_attempts_are_bounded();
+    test_dropped_connections();
+    test_slow_first_response_is_retried();
+    test_deadline_bounds_retries();
+    test_circuit_breaker_states();
+    test_circuit_breaker_with_failing_host();
+    test_always_failing_host_opens_breaker();
+    test_hedging_trims_slow_first_response();
+    return test_result();
+}
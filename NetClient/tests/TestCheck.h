@@ -0,0 +1,31 @@
+#ifndef NETCLIENT_TEST_CHECK_H
+#define NETCLIENT_TEST_CHECK_H
+
+#include <cstdio>
+
+// A failed CHECK reports and carries on; main returns test_result() so
+// CTest sees the failure.
+namespace NetClientTest {
+
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline int test_result() {
+        if (failures() == 0) return 0;
+        std::fprintf(stderr, "%d check(s) failed\n", failures());
+        return 1;
+    }
+
+} // namespace NetClientTest
+
+#define CHECK(condition)                                                               \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++NetClientTest::failures();                                               \
+        }                                                                              \
+    } while (0)
+
+#endif // NETCLIENT_TEST_CHECK_H
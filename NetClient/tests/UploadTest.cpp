@@ -0,0 +1,360 @@
+// Streamed uploads: the bytes BodySender writes for Content-Length and
+// chunked bodies, with files sent by sendfile() and by the pread() copy,
+// files that change size after they were added, multipart forms and
+// Session::upload against a loopback server.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include "PosixHttp.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace NetClientTest;
+using NetClient::MultipartForm;
+using NetClient::RequestBody;
+using NetClient::Response;
+using NetClient::Session;
+using NetClient::detail::BodySender;
+
+// What BodySender writes for body after head, read off a socket pair.
+struct Sent {
+    bool ok = false;
+    BodySender::Failure failure = BodySender::Failure::None;
+    uint64_t counted = 0;
+    std::string bytes;
+};
+
+static Sent send_body(const std::string& head, const RequestBody& body, bool use_sendfile) {
+    Sent out;
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return out;
+    std::thread reader([&] {
+        char buffer[16 * 1024];
+        ssize_t n;
+        while ((n = ::read(fds[1], buffer, sizeof(buffer))) > 0) out.bytes.append(buffer, (size_t)n);
+    });
+    {
+        BodySender sender(fds[0], std::chrono::milliseconds(2000), use_sendfile);
+        out.ok = sender.send(head, body);
+        out.failure = sender.failure();
+        out.counted = sender.sent();
+    }
+    ::shutdown(fds[0], SHUT_WR);
+    reader.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return out;
+}
+
+static std::string pattern(size_t size, int seed) {
+    std::string out(size, '\0');
+    for (size_t i = 0; i < size; ++i) out[i] = (char)((i * 31 + seed) ^ (i >> 9));
+    return out;
+}
+
+static std::string chunk(const std::string& data) {
+    char size[24];
+    std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    return size + data + "\r\n";
+}
+
+// A reader handing out text step bytes at a time.
+static RequestBody::Reader reader_of(const std::string& text, size_t step) {
+    auto at = std::make_shared<size_t>(0);
+    return [text, step, at](char* buffer, size_t size) -> long long {
+        size_t n = std::min(std::min(step, size), text.size() - *at);
+        std::memcpy(buffer, text.data() + *at, n);
+        *at += n;
+        return (long long)n;
+    };
+}
+
+static void test_sizes() {
+    RequestBody body;
+    CHECK(body.size() == 0 && body.parts().empty());
+    body.add_bytes("ab");
+    body.add_bytes("cd");
+    CHECK(body.parts().size() == 1 && body.parts()[0].data == "abcd");   // neighbouring bytes merge
+
+    const std::string path = temp_path("sizes");
+    CHECK(write_file(path, pattern(1000, 1)));
+    CHECK(body.add_file(path));
+    CHECK(!body.add_file(path + ".missing"));
+    body.add_bytes("e");
+    CHECK(body.parts().size() == 3 && body.size() == 1005);
+
+    body.add_reader(reader_of("xyz", 3), 3);
+    CHECK(body.size() == 1008);
+    body.add_reader(reader_of("more", 4));
+    CHECK(body.size() == RequestBody::kUnknownSize);
+    std::remove(path.c_str());
+}
+
+static void test_content_length_framing() {
+    // Larger than the 64 KB copy buffer, so both file paths loop.
+    const std::string contents = pattern(300 * 1024 + 7, 2);
+    const std::string path = temp_path("framing");
+    const std::string empty_path = temp_path("framing-empty");
+    CHECK(write_file(path, contents));
+    CHECK(write_file(empty_path, ""));
+
+    const std::string tail = pattern(70 * 1024, 3);
+    const std::string expected = "HEAD\r\n\r\nhead-bytes|" + contents + tail + "|end";
+    for (bool use_sendfile : {true, false}) {
+        // A fresh body each time, since its reader is used up.
+        RequestBody body;
+        body.add_bytes("head-bytes|");
+        CHECK(body.add_file(path));
+        CHECK(body.add_file(empty_path));
+        body.add_reader(reader_of(tail, 5000), tail.size());
+        body.add_bytes("|end");
+        Sent sent = send_body("HEAD\r\n\r\n", body, use_sendfile);
+        CHECK(sent.ok && sent.failure == BodySender::Failure::None);
+        CHECK(sent.bytes == expected);
+        CHECK(sent.counted == expected.size());
+    }
+    std::remove(path.c_str());
+    std::remove(empty_path.c_str());
+}
+
+static void test_chunked_framing() {
+    const std::string contents = pattern(100 * 1024, 4);
+    const std::string path = temp_path("chunked");
+    const std::string empty_path = temp_path("chunked-empty");
+    CHECK(write_file(path, contents));
+    CHECK(write_file(empty_path, ""));
+
+    // Each piece is one chunk: the bytes, the file whole, and every read.
+    // An empty file adds nothing, since an empty chunk would end the body.
+    const std::string expected =
+        "H\r\n\r\n" + chunk("abc") + chunk(contents) + chunk("0123") + chunk("4567") + chunk("89") + "0\r\n\r\n";
+    for (bool use_sendfile : {true, false}) {
+        RequestBody body;
+        body.add_bytes("abc");
+        CHECK(body.add_file(path));
+        CHECK(body.add_file(empty_path));
+        body.add_reader(reader_of("0123456789", 4));
+        CHECK(body.size() == RequestBody::kUnknownSize);
+        Sent sent = send_body("H\r\n\r\n", body, use_sendfile);
+        CHECK(sent.ok);
+        CHECK(sent.bytes == expected);
+        CHECK(sent.counted == expected.size());
+    }
+    std::remove(path.c_str());
+    std::remove(empty_path.c_str());
+}
+
+static void test_file_changes_after_add() {
+    const std::string original = pattern(200 * 1024, 5);
+    const std::string path = temp_path("changes");
+    for (bool use_sendfile : {true, false}) {
+        // Bytes appended after add_file() are not sent: the body keeps the
+        // size it announced.
+        CHECK(write_file(path, original));
+        RequestBody grown;
+        CHECK(grown.add_file(path));
+        CHECK(write_file(path, original + "appended later"));
+        Sent sent = send_body("", grown, use_sendfile);
+        CHECK(sent.ok && sent.bytes == original);
+
+        // A file that shrank cannot fill its part.
+        CHECK(write_file(path, original));
+        RequestBody shrunk;
+        CHECK(shrunk.add_file(path));
+        CHECK(write_file(path, original.substr(0, 1000)));
+        sent = send_body("", shrunk, use_sendfile);
+        CHECK(!sent.ok && sent.failure == BodySender::Failure::Source);
+        CHECK(sent.bytes == original.substr(0, 1000));
+
+        // Nor can one that is gone.
+        CHECK(write_file(path, original));
+        RequestBody removed;
+        CHECK(removed.add_file(path));
+        std::remove(path.c_str());
+        sent = send_body("", removed, use_sendfile);
+        CHECK(!sent.ok && sent.failure == BodySender::Failure::Source);
+    }
+}
+
+static void test_reader_failures() {
+    RequestBody aborted;
+    aborted.add_reader([](char*, size_t) -> long long { return -1; });
+    Sent sent = send_body("", aborted, true);
+    CHECK(!sent.ok && sent.failure == BodySender::Failure::Aborted);
+
+    // A sized reader that ends early, or claims more than it was asked for.
+    RequestBody short_reader;
+    short_reader.add_reader(reader_of("abc", 3), 10);
+    sent = send_body("", short_reader, true);
+    CHECK(!sent.ok && sent.failure == BodySender::Failure::Source);
+    RequestBody liar;
+    liar.add_reader([](char*, size_t size) -> long long { return (long long)size + 1; }, 4);
+    sent = send_body("", liar, true);
+    CHECK(!sent.ok && sent.failure == BodySender::Failure::Source);
+}
+
+// Splits a multipart body at its boundary into the text of each part,
+// headers included. Empty when the framing is broken.
+static std::vector<std::string> split_parts(const std::string& body, const std::string& boundary) {
+    std::vector<std::string> parts;
+    const std::string delimiter = "--" + boundary;
+    if (body.compare(0, delimiter.size() + 2, delimiter + "\r\n") != 0) return {};
+    size_t at = delimiter.size() + 2;
+    while (true) {
+        size_t next = body.find("\r\n" + delimiter, at);
+        if (next == std::string::npos) return {};
+        parts.push_back(body.substr(at, next - at));
+        at = next + 2 + delimiter.size();
+        if (body.compare(at, 4, "--\r\n") == 0) return at + 4 == body.size() ? parts : std::vector<std::string>();
+        if (body.compare(at, 2, "\r\n") != 0) return {};
+        at += 2;
+    }
+}
+
+static void test_multipart_upload() {
+    HttpRequest seen;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        seen = request;
+        return conn.send(http_response(200, std::to_string(request.body.size())));
+    });
+    CHECK(server.start());
+
+    // The file holds the boundary's prefix and CRLF-dash runs, which must
+    // not end its part early.
+    const std::string contents = "--NetClientBoundary\r\n--\r\n" + pattern(90 * 1024, 6) + "\r\n--";
+    const std::string path = temp_path("form-file.bin");
+    CHECK(write_file(path, contents));
+
+    MultipartForm form;
+    form.add_field("title", "a \"quoted\"\r\nname");
+    form.add_field("say \"hi\"", "");
+    CHECK(form.add_file("upload", path));
+    CHECK(form.add_file("renamed", path, "shown.txt", "text/plain"));
+    CHECK(!form.add_file("missing", path + ".missing"));
+    form.add_reader("stream", "stream.dat", "application/x-test", reader_of("streamed bytes", 5));
+    RequestBody body = form.body();
+    CHECK(body.size() == RequestBody::kUnknownSize);
+
+    const std::string type = body.content_type;
+    const std::string prefix = "multipart/form-data; boundary=";
+    CHECK(type.compare(0, prefix.size(), prefix) == 0);
+    const std::string boundary = type.substr(prefix.size());
+    CHECK(boundary.size() > 16);
+    CHECK(MultipartForm().body().content_type != type);    // each form draws its own
+
+    Session session;
+    Response response = session.upload("POST", server.url("/form"), body);
+    CHECK(response.status_code == 200);
+    CHECK(seen.header("content-type") == type);
+    CHECK(seen.header("transfer-encoding") == "chunked");  // the reader's size is unknown
+    CHECK(response.text == std::to_string(seen.body.size()));
+
+    std::vector<std::string> parts = split_parts(seen.body, boundary);
+    CHECK(parts.size() == 5);
+    if (parts.size() == 5) {
+        std::string file_name = path.substr(path.find_last_of('/') + 1);
+        CHECK(parts[0] == "Content-Disposition: form-data; name=\"title\"\r\n\r\na \"quoted\"\r\nname");
+        CHECK(parts[1] == "Content-Disposition: form-data; name=\"say %22hi%22\"\r\n\r\n");
+        CHECK(parts[2] == "Content-Disposition: form-data; name=\"upload\"; filename=\"" + file_name +
+                              "\"\r\nContent-Type: application/octet-stream\r\n\r\n" + contents);
+        CHECK(parts[3] == "Content-Disposition: form-data; name=\"renamed\"; filename=\"shown.txt\"\r\n"
+                          "Content-Type: text/plain\r\n\r\n" + contents);
+        CHECK(parts[4] == "Content-Disposition: form-data; name=\"stream\"; filename=\"stream.dat\"\r\n"
+                          "Content-Type: application/x-test\r\n\r\nstreamed bytes");
+    }
+
+    // Without a reader the form's size is known and it goes with Content-Length.
+    MultipartForm sized;
+    sized.add_field("a", "1");
+    CHECK(sized.add_file("f", path));
+    RequestBody sized_body = sized.body();
+    response = session.upload("PUT", server.url("/sized"), sized_body);
+    CHECK(response.status_code == 200);
+    CHECK(seen.method == "PUT" && seen.header("transfer-encoding").empty());
+    CHECK(seen.header("content-length") == std::to_string(sized_body.size()));
+    CHECK(split_parts(seen.body, sized_body.content_type.substr(prefix.size())).size() == 2);
+    std::remove(path.c_str());
+}
+
+static void test_session_upload() {
+    std::vector<HttpRequest> seen;
+    std::mutex mutex;
+    LoopbackServer server([&](Connection& conn, const HttpRequest& request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            seen.push_back(request);
+        }
+        return conn.send(http_response(201, "stored"));
+    });
+    CHECK(server.start());
+
+    const std::string contents = pattern(500 * 1024, 7);
+    const std::string path = temp_path("upload");
+    CHECK(write_file(path, contents));
+
+    Session session;
+    RequestBody body;
+    body.content_type = "application/x-test";
+    body.add_bytes("<");
+    CHECK(body.add_file(path));
+    body.add_bytes(">");
+    Response response = session.upload("PUT", server.url("/file"), body, {{"X-Extra", "1"}});
+    CHECK(response.status_code == 201 && response.text == "stored");
+    CHECK(response.bytes_sent > contents.size());
+
+    RequestBody chunked;
+    chunked.add_reader(reader_of(contents, 10000));
+    response = session.upload("POST", server.url("/stream"), chunked, {{"Content-Type", "text/plain"}});
+    CHECK(response.status_code == 201);
+
+    // The body's source fails: the request is not repeated.
+    RequestBody aborted;
+    aborted.add_reader([](char*, size_t) -> long long { return -1; });
+    response = session.upload("POST", server.url("/aborted"), aborted);
+    CHECK(response.status_code == 0 && response.error == "aborted");
+
+    CHECK(write_file(path, contents));
+    RequestBody shrunk;
+    CHECK(shrunk.add_file(path));
+    CHECK(write_file(path, "tiny"));
+    response = session.upload("PUT", server.url("/shrunk"), shrunk);
+    CHECK(response.status_code == 0 && response.error == "body read failed");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(seen.size() == 2);
+    if (seen.size() == 2) {
+        CHECK(seen[0].method == "PUT" && seen[0].target == "/file");
+        CHECK(seen[0].header("content-length") == std::to_string(contents.size() + 2));
+        CHECK(seen[0].header("transfer-encoding").empty());
+        CHECK(seen[0].header("content-type") == "application/x-test" && seen[0].header("x-extra") == "1");
+        CHECK(seen[0].body == "<" + contents + ">");
+        CHECK(seen[1].header("transfer-encoding") == "chunked" && seen[1].header("content-length").empty());
+        CHECK(seen[1].header("content-type") == "text/plain");     // the request's own wins
+        CHECK(seen[1].body == contents);
+    }
+    std::remove(path.c_str());
+}
+
+int main() {
+    test_sizes();
+    test_content_length_framing();
+    test_chunked_framing();
+    test_file_changes_after_add();
+    test_reader_failures();
+    test_multipart_upload();
+    test_session_upload();
+    return test_result();
+}
@@ -0,0 +1,681 @@
+// The POSIX WebSocket client against a loopback echo server: plain,
+// compressed and fragmented echoes, subprotocols, failed handshakes,
+// closing from either side, and pings.
+
+#include "LoopbackServer.h"
+#include "TestCheck.h"
+
+#include "NetClient.h"
+
+#include "WebSocket.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace NetClientTest;
+using NetClient::WebSocket;
+using NetClient::WebSocketOptions;
+
+typedef std::chrono::steady_clock Clock;
+
+// Raw deflate (RFC 1951) with the fixed Huffman codes, enough to play the
+// server side of permessage-deflate (RFC 7692) without a zlib dependency.
+// With context takeover, matches reach back into earlier messages.
+class DeflateEncoder {
+public:
+    explicit DeflateEncoder(bool context_takeover) : takeover_(context_takeover) {}
+
+    // One message, ending in the empty stored block of a sync flush minus
+    // its 00 00 FF FF, as the extension sends it.
+    std::string compress(const std::string& message) {
+        if (!takeover_) history_.clear();
+        size_t start = history_.size();
+        std::string window = history_ + message;
+        std::unordered_map<uint32_t, std::vector<size_t>> chains;
+        for (size_t i = 0; i + 3 <= start; ++i) chains[key(window, i)].push_back(i);
+
+        bits_ = 0;
+        count_ = 0;
+        out_.clear();
+        put(0, 1);      // not the final block
+        put(1, 2);      // fixed Huffman codes
+        size_t pos = start;
+        while (pos < window.size()) {
+            size_t best = 0, distance = 0;
+            if (pos + 3 <= window.size()) {
+                std::vector<size_t>& chain = chains[key(window, pos)];
+                for (size_t n = 0; n < chain.size() && n < 32; ++n) {
+                    size_t candidate = chain[chain.size() - 1 - n];
+                    if (pos - candidate > 32768) break;
+                    size_t length = 0;
+                    while (length < 258 && pos + length < window.size() &&
+                           window[candidate + length] == window[pos + length]) {
+                        ++length;
+                    }
+                    if (length > best) {
+                        best = length;
+                        distance = pos - candidate;
+                    }
+                }
+            }
+            size_t step = best >= 3 ? best : 1;
+            if (best >= 3) {
+                put_length(best);
+                put_distance(distance);
+            } else {
+                put_symbol((uint8_t)window[pos]);
+            }
+            for (size_t i = pos; i < pos + step && i + 3 <= window.size(); ++i) chains[key(window, i)].push_back(i);
+            pos += step;
+        }
+        put_symbol(256);
+        put(0, 3);      // the flush's empty stored block, whose LEN and NLEN are stripped
+        if (count_ > 0) out_.push_back((char)bits_);
+
+        history_ = window.size() > 32768 ? window.substr(window.size() - 32768) : window;
+        return out_;
+    }
+
+private:
+    static uint32_t key(const std::string& s, size_t i) {
+        return (uint8_t)s[i] | (uint8_t)s[i + 1] << 8 | (uint32_t)(uint8_t)s[i + 2] << 16;
+    }
+
+    // Plain values go least significant bit first.
+    void put(uint32_t value, int n) {
+        for (int i = 0; i < n; ++i) {
+            bits_ |= ((value >> i) & 1) << count_;
+            if (++count_ == 8) {
+                out_.push_back((char)bits_);
+                bits_ = 0;
+                count_ = 0;
+            }
+        }
+    }
+
+    // Huffman codes go most significant bit first.
+    void put_code(uint32_t code, int n) {
+        for (int i = n - 1; i >= 0; --i) put((code >> i) & 1, 1);
+    }
+
+    void put_symbol(int symbol) {
+        if (symbol < 144) put_code(0x30 + symbol, 8);
+        else if (symbol < 256) put_code(0x190 + symbol - 144, 9);
+        else if (symbol < 280) put_code(symbol - 256, 7);
+        else put_code(0xC0 + symbol - 280, 8);
+    }
+
+    void put_length(size_t length) {
+        static const int base[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                   31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        int i = 28;
+        while (base[i] > (int)length) --i;
+        put_symbol(257 + i);
+        put((uint32_t)(length - base[i]), extra[i]);
+    }
+
+    void put_distance(size_t distance) {
+        static const int base[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                   193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const int extra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        int i = 29;
+        while (base[i] > (int)distance) --i;
+        put_code(i, 5);
+        put((uint32_t)(distance - base[i]), extra[i]);
+    }
+
+    bool takeover_;
+    std::string history_;
+    std::string out_;
+    uint32_t bits_ = 0;
+    int count_ = 0;
+};
+
+static std::string server_frame(uint8_t opcode, const std::string& payload, bool fin = true, bool rsv1 = false) {
+    std::string out;
+    out.push_back((char)((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | opcode));
+    size_t len = payload.size();
+    if (len < 126) {
+        out.push_back((char)len);
+    } else if (len < 65536) {
+        out.push_back((char)126);
+        for (int shift = 8; shift >= 0; shift -= 8) out.push_back((char)(len >> shift));
+    } else {
+        out.push_back((char)127);
+        for (int shift = 56; shift >= 0; shift -= 8) out.push_back((char)((uint64_t)len >> shift));
+    }
+    return out + payload;
+}
+
+static std::string close_payload(int code, const std::string& reason) {
+    std::string out;
+    out.push_back((char)(code >> 8));
+    out.push_back((char)code);
+    return out + reason;
+}
+
+struct ClientFrame {
+    uint8_t opcode = 0;
+    bool fin = false;
+    bool rsv1 = false;
+    bool masked = false;
+    std::string mask;
+    std::string payload;
+};
+
+static bool read_client_frame(Connection& conn, ClientFrame& frame) {
+    std::string head;
+    if (!conn.read(head, 2)) return false;
+    frame.fin = (head[0] & 0x80) != 0;
+    frame.rsv1 = (head[0] & 0x40) != 0;
+    frame.opcode = head[0] & 0x0F;
+    frame.masked = (head[1] & 0x80) != 0;
+    uint64_t len = head[1] & 0x7F;
+    if (len >= 126) {
+        std::string extended;
+        if (!conn.read(extended, len == 126 ? 2 : 8)) return false;
+        len = 0;
+        for (char c : extended) len = len << 8 | (uint8_t)c;
+    }
+    frame.mask.clear();
+    if (frame.masked && !conn.read(frame.mask, 4)) return false;
+    if (!conn.read(frame.payload, (size_t)len)) return false;
+    for (size_t i = 0; frame.masked && i < frame.payload.size(); ++i) frame.payload[i] ^= frame.mask[i % 4];
+    return true;
+}
+
+// What the server saw, for checks on the test's thread.
+struct ServerLog {
+    std::mutex mutex;
+    std::condition_variable changed;
+    int close_code = 0;                 // from the client's close frame
+    std::string close_reason;
+    std::string extensions;             // the client's offer
+    bool unmasked = false;              // the client sent a frame without a mask
+    std::vector<std::string> masks;     // of each client frame, in order
+    bool compressed = false;            // the client set RSV1
+
+    void closed(const std::string& payload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        close_code = payload.size() >= 2 ? ((uint8_t)payload[0] << 8 | (uint8_t)payload[1]) : 1005;
+        close_reason = payload.size() > 2 ? payload.substr(2) : std::string();
+        changed.notify_all();
+    }
+
+    bool wait_closed() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(3), [this] { return close_code != 0; });
+    }
+};
+
+// Echoes every message back after completing the handshake, pushing
+// "hello" in the same packet as the 101. The path picks the variant:
+// /reject and /badkey fail the handshake, "deflate" accepts compression
+// ("nct" without context takeover, "force" even when not offered), and
+// "frag" splits each echo in three with a ping between the pieces. A few
+// messages are commands; see the cases below.
+static bool websocket_echo(Connection& conn, const HttpRequest& request, ServerLog& log) {
+    const std::string& path = request.target;
+    if (path == "/reject") return conn.send(http_response(403, "forbidden"));
+
+    std::string offered = request.header("sec-websocket-extensions");
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        log.extensions = offered;
+    }
+    std::string accept = NetClient::detail::websocket_accept(request.header("sec-websocket-key"));
+    if (path == "/badkey") accept[0] = accept[0] == 'x' ? 'y' : 'x';
+    std::string head = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: " + accept + "\r\n";
+
+    bool deflate = path.find("deflate") != std::string::npos &&
+                   (offered.find("permessage-deflate") != std::string::npos || path.find("force") != std::string::npos);
+    bool no_takeover = path.find("nct") != std::string::npos;
+    if (deflate) {
+        head += std::string("Sec-WebSocket-Extensions: permessage-deflate") +
+                (no_takeover ? "; server_no_context_takeover" : "") + "\r\n";
+    }
+
+    // Picks the first offered protocol this server speaks.
+    std::string protocols = request.header("sec-websocket-protocol") + ",";
+    for (size_t at = 0, comma; (comma = protocols.find(',', at)) != std::string::npos; at = comma + 1) {
+        std::string name = protocols.substr(at, comma - at);
+        name.erase(0, name.find_first_not_of(' '));
+        if (name == "chat.v2" || name == "json") {
+            head += "Sec-WebSocket-Protocol: " + name + "\r\n";
+            break;
+        }
+    }
+    if (!conn.send(head + "\r\n" + server_frame(NetClient::detail::kWsText, "hello"))) return false;
+
+    DeflateEncoder encoder(!no_takeover);
+    bool fragment = path.find("frag") != std::string::npos;
+    std::string message;
+    uint8_t message_opcode = 0;
+    ClientFrame frame;
+    while (read_client_frame(conn, frame)) {
+        {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.unmasked = log.unmasked || !frame.masked;
+            log.masks.push_back(frame.mask);
+            log.compressed = log.compressed || frame.rsv1;
+        }
+        if (frame.opcode == NetClient::detail::kWsPing) {
+            if (!conn.send(server_frame(NetClient::detail::kWsPong, frame.payload))) return false;
+            continue;
+        }
+        if (frame.opcode == NetClient::detail::kWsPong) {
+            if (!conn.send(server_frame(NetClient::detail::kWsText, "pong " + frame.payload))) return false;
+            continue;
+        }
+        if (frame.opcode == NetClient::detail::kWsClose) {
+            log.closed(frame.payload);
+            conn.send(server_frame(NetClient::detail::kWsClose, frame.payload.substr(0, 2)));
+            return false;
+        }
+        if (frame.opcode != NetClient::detail::kWsContinuation) {
+            message_opcode = frame.opcode;
+            message.clear();
+        }
+        message += frame.payload;
+        if (!frame.fin) continue;
+
+        // Asks the client for a pong, which is reported back as "pong <payload>".
+        if (message == "ping-me") {
+            if (!conn.send(server_frame(NetClient::detail::kWsPing, "abc"))) return false;
+            continue;
+        }
+        if (message == "close-me") {
+            if (!conn.send(server_frame(NetClient::detail::kWsClose, close_payload(4000, "bye")))) return false;
+            while (read_client_frame(conn, frame)) {
+                if (frame.opcode == NetClient::detail::kWsClose) {
+                    log.closed(frame.payload);
+                    break;
+                }
+            }
+            return false;
+        }
+        // Stops answering, even pings, until the client gives up.
+        if (message == "silent") {
+            conn.hang();
+            return false;
+        }
+        // Drops the connection without a closing handshake.
+        if (message == "drop") return false;
+        // A reserved opcode and invalid UTF-8 in a text message.
+        if (message == "bad-opcode" || message == "bad-utf8") {
+            std::string bad = message == "bad-opcode" ? std::string("\x83\x00", 2)
+                                                      : server_frame(NetClient::detail::kWsText, "\xff\xfe");
+            if (!conn.send(bad)) return false;
+            continue;
+        }
+
+        std::string payload = deflate ? encoder.compress(message) : message;
+        if (fragment && payload.size() >= 3) {
+            size_t third = payload.size() / 3;
+            std::string pieces = server_frame(message_opcode, payload.substr(0, third), false, deflate) +
+                                 server_frame(NetClient::detail::kWsPing, "mid") +
+                                 server_frame(NetClient::detail::kWsContinuation, payload.substr(third, third), false) +
+                                 server_frame(NetClient::detail::kWsContinuation, payload.substr(2 * third));
+            if (!conn.send(pieces)) return false;
+        } else if (!conn.send(server_frame(message_opcode, payload, true, deflate))) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Collects a client's messages and its close.
+struct Received {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::pair<std::string, bool>> messages;
+    int close_code = 0;
+    std::string close_reason;
+    int closes = 0;
+
+    WebSocket::MessageHandler on_message() {
+        return [this](const std::string& message, bool binary) {
+            std::lock_guard<std::mutex> lock(mutex);
+            messages.emplace_back(message, binary);
+            changed.notify_all();
+        };
+    }
+
+    WebSocket::CloseHandler on_close() {
+        return [this](int code, const std::string& reason) {
+            std::lock_guard<std::mutex> lock(mutex);
+            close_code = code;
+            close_reason = reason;
+            ++closes;
+            changed.notify_all();
+        };
+    }
+
+    // The nth message (0 is the server's "hello"), or "<none>" after a wait.
+    std::pair<std::string, bool> message(size_t n) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!changed.wait_for(lock, std::chrono::seconds(3), [&] { return messages.size() > n; })) {
+            return std::make_pair(std::string("<none>"), false);
+        }
+        return messages[n];
+    }
+
+    bool wait_closed(std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, timeout, [this] { return closes > 0; });
+    }
+};
+
+class EchoServer {
+public:
+    ServerLog log;
+
+    EchoServer() : server_([this](Connection& conn, const HttpRequest& request) {
+        return websocket_echo(conn, request, log);
+    }) {}
+
+    bool start() { return server_.start(); }
+    std::string url(const std::string& path) const { return server_.url(path, "ws"); }
+
+private:
+    LoopbackServer server_;
+};
+
+static std::string sample_text(size_t len) {
+    static const char* words[] = {"alpha ", "beta ", "gamma ", "delta ", "\xe0\xa6\x95 ", "omega "};
+    std::mt19937 rng(11);
+    std::string out;
+    while (out.size() < len) out += words[rng() % 6];
+    return out;
+}
+
+static void test_deflate_encoder_matches_rfc_sample() {
+    // RFC 7692 section 7.2.3.1: "Hello" as one compressed message.
+    DeflateEncoder encoder(true);
+    CHECK(encoder.compress("Hello") == std::string("\xf2\x48\xcd\xc9\xc9\x07\x00", 7));
+}
+
+static void test_plain_echo() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    WebSocketOptions options;
+    options.compress = false;
+    CHECK(ws.connect(server.url("/plain"), options));
+    CHECK(ws.is_open());
+    CHECK(!ws.compressed());
+    CHECK(ws.protocol().empty());
+
+    // Pushed with the handshake.
+    CHECK(received.message(0) == std::make_pair(std::string("hello"), false));
+
+    CHECK(ws.send_text("short"));
+    std::string medium = sample_text(1000);
+    std::string large(200000, '\0');
+    for (size_t i = 0; i < large.size(); ++i) large[i] = (char)(i * 7);
+    CHECK(ws.send_text(medium));
+    CHECK(ws.send_binary(large));
+    CHECK(ws.send_text(""));
+    CHECK(received.message(1) == std::make_pair(std::string("short"), false));
+    CHECK(received.message(2) == std::make_pair(medium, false));
+    CHECK(received.message(3) == std::make_pair(large, true));
+    CHECK(received.message(4) == std::make_pair(std::string(), false));
+
+    // Enough frames to use up more than one batch of random mask bytes.
+    for (int i = 0; i < 150; ++i) CHECK(ws.send_text("m" + std::to_string(i)));
+    CHECK(received.message(154) == std::make_pair(std::string("m149"), false));
+
+    std::lock_guard<std::mutex> lock(server.log.mutex);
+    CHECK(server.log.extensions.empty());
+    CHECK(!server.log.unmasked);
+    // Random 32-bit masks are all but certain to differ across 154 frames.
+    std::set<std::string> distinct(server.log.masks.begin(), server.log.masks.end());
+    CHECK(server.log.masks.size() == 154);
+    CHECK(distinct.size() == server.log.masks.size());
+}
+
+static void test_compressed_echo() {
+    for (const char* path : {"/deflate", "/deflate-nct", "/deflate-frag", "/deflate-nct-frag"}) {
+        EchoServer server;
+        CHECK(server.start());
+        Received received;
+        WebSocket ws(received.on_message(), received.on_close());
+        CHECK(ws.connect(server.url(path)));
+        CHECK(ws.compressed());
+        CHECK(received.message(0).first == "hello");
+
+        // The same text twice: with context takeover the second copy is
+        // mostly references into the first.
+        std::string text = sample_text(5000);
+        std::string binary(100000, 'z');
+        for (size_t i = 0; i < binary.size(); i += 97) binary[i] = (char)i;
+        CHECK(ws.send_text(text));
+        CHECK(ws.send_text(text));
+        CHECK(ws.send_binary(binary));
+        CHECK(ws.send_text("x"));
+        CHECK(received.message(1) == std::make_pair(text, false));
+        CHECK(received.message(2) == std::make_pair(text, false));
+        CHECK(received.message(3) == std::make_pair(binary, true));
+        CHECK(received.message(4) == std::make_pair(std::string("x"), false));
+        CHECK(ws.is_open());
+
+        std::lock_guard<std::mutex> lock(server.log.mutex);
+        CHECK(server.log.extensions.find("permessage-deflate") != std::string::npos);
+        CHECK(server.log.extensions.find("client_no_context_takeover") != std::string::npos);
+        // Messages are always sent uncompressed.
+        CHECK(!server.log.compressed);
+    }
+}
+
+static void test_fragmented_echo() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    CHECK(ws.connect(server.url("/frag")));
+    CHECK(!ws.compressed());
+    std::string text = sample_text(70000);
+    CHECK(ws.send_text(text));
+    CHECK(ws.send_binary("abcdef"));
+    CHECK(received.message(1) == std::make_pair(text, false));
+    CHECK(received.message(2) == std::make_pair(std::string("abcdef"), true));
+}
+
+static void test_subprotocols() {
+    EchoServer server;
+    CHECK(server.start());
+
+    Received chosen;
+    WebSocket ws(chosen.on_message(), chosen.on_close());
+    WebSocketOptions options;
+    options.protocols = {"chat.v1", "json", "chat.v2"};
+    CHECK(ws.connect(server.url("/"), options));
+    CHECK(ws.protocol() == "json");
+
+    Received none;
+    WebSocket other(none.on_message(), none.on_close());
+    options.protocols = {"chat.v1"};
+    CHECK(other.connect(server.url("/"), options));
+    CHECK(other.protocol().empty());
+}
+
+static void test_failed_handshakes() {
+    EchoServer server;
+    CHECK(server.start());
+
+    WebSocket bad_key(nullptr);
+    CHECK(!bad_key.connect(server.url("/badkey")));
+    CHECK(bad_key.error() == "handshake failed");
+    CHECK(!bad_key.is_open());
+    CHECK(!bad_key.send_text("x"));
+
+    WebSocket rejected(nullptr);
+    CHECK(!rejected.connect(server.url("/reject")));
+    CHECK(rejected.error() == "handshake failed (HTTP 403)");
+
+    // Compression the client did not offer.
+    WebSocket forced(nullptr);
+    WebSocketOptions options;
+    options.compress = false;
+    CHECK(!forced.connect(server.url("/force-deflate"), options));
+    CHECK(forced.error() == "handshake failed (unexpected extension)");
+
+    WebSocket wrong_scheme(nullptr);
+    CHECK(!wrong_scheme.connect("http://127.0.0.1/"));
+    CHECK(wrong_scheme.error() == "unsupported url");
+}
+
+static void test_client_close() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    CHECK(ws.connect(server.url("/")));
+    CHECK(received.message(0).first == "hello");
+
+    ws.close(1000, "done");
+    CHECK(received.wait_closed());
+    CHECK(!ws.is_open());
+    CHECK(!ws.send_text("late"));
+    CHECK(server.log.wait_closed());
+    {
+        std::lock_guard<std::mutex> lock(server.log.mutex);
+        CHECK(server.log.close_code == 1000 && server.log.close_reason == "done");
+    }
+    std::lock_guard<std::mutex> lock(received.mutex);
+    CHECK(received.close_code == 1000);
+    CHECK(received.closes == 1);
+}
+
+static void test_destructor_closes() {
+    EchoServer server;
+    CHECK(server.start());
+    {
+        WebSocket ws(nullptr);
+        CHECK(ws.connect(server.url("/")));
+    }
+    CHECK(server.log.wait_closed());
+    std::lock_guard<std::mutex> lock(server.log.mutex);
+    CHECK(server.log.close_code == 1001 && server.log.close_reason == "going away");
+}
+
+static void test_server_close() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    CHECK(ws.connect(server.url("/")));
+    CHECK(ws.send_text("close-me"));
+    CHECK(received.wait_closed());
+    {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        CHECK(received.close_code == 4000 && received.close_reason == "bye");
+    }
+    CHECK(!ws.is_open());
+    // The client echoes the server's code to complete the handshake.
+    CHECK(server.log.wait_closed());
+    std::lock_guard<std::mutex> lock(server.log.mutex);
+    CHECK(server.log.close_code == 4000);
+}
+
+static void test_dropped_connection() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    CHECK(ws.connect(server.url("/")));
+    CHECK(ws.send_text("drop"));
+    CHECK(received.wait_closed());
+    std::lock_guard<std::mutex> lock(received.mutex);
+    CHECK(received.close_code == 1006);
+}
+
+static void test_protocol_errors() {
+    struct Case {
+        const char* message;
+        uint64_t max_message_bytes;
+        int code;
+    } cases[] = {
+        {"bad-opcode", 1 << 20, 1002},
+        {"bad-utf8", 1 << 20, 1007},
+        {nullptr, 1000, 1009},
+    };
+    for (const Case& c : cases) {
+        EchoServer server;
+        CHECK(server.start());
+        Received received;
+        WebSocket ws(received.on_message(), received.on_close());
+        WebSocketOptions options;
+        options.max_message_bytes = c.max_message_bytes;
+        CHECK(ws.connect(server.url("/"), options));
+        CHECK(ws.send_text(c.message ? c.message : std::string(2000, 'm')));
+        CHECK(received.wait_closed());
+        {
+            std::lock_guard<std::mutex> lock(received.mutex);
+            CHECK(received.close_code == c.code);
+        }
+        // The server is told why.
+        CHECK(server.log.wait_closed());
+        std::lock_guard<std::mutex> lock(server.log.mutex);
+        CHECK(server.log.close_code == c.code);
+    }
+}
+
+static void test_pings() {
+    EchoServer server;
+    CHECK(server.start());
+    Received received;
+    WebSocket ws(received.on_message(), received.on_close());
+    WebSocketOptions options;
+    options.ping_interval_ms = 50;
+    options.pong_timeout_ms = 200;
+    CHECK(ws.connect(server.url("/"), options));
+    CHECK(received.message(0).first == "hello");
+
+    // The server's ping is answered with its payload.
+    CHECK(ws.send_text("ping-me"));
+    CHECK(received.message(1).first == "pong abc");
+
+    // A quiet but answering server keeps the connection open.
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    CHECK(ws.is_open());
+
+    // One that stops answering is dropped after ping_interval_ms + pong_timeout_ms.
+    Clock::time_point start = Clock::now();
+    CHECK(ws.send_text("silent"));
+    CHECK(received.wait_closed());
+    double waited = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    CHECK(waited >= 200 && waited < 2000);
+    std::lock_guard<std::mutex> lock(received.mutex);
+    CHECK(received.close_code == 1006);
+    CHECK(received.close_reason == "ping timeout");
+}
+
+int main() {
+    test_deflate_encoder_matches_rfc_sample();
+    test_plain_echo();
+    test_compressed_echo();
+    test_fragmented_echo();
+    test_subprotocols();
+    test_failed_handshakes();
+    test_client_close();
+    test_destructor_closes();
+    test_server_close();
+    test_dropped_connection();
+    test_protocol_errors();
+    test_pings();
+    return test_result();
+}
@@ -0,0 +1,89 @@
+// Measures spell-checking throughput:
+//   SpellCheckerBench [words.tsv corpus.txt] [repeats]
+// Without arguments, the sample lexicon and corpus in bench/data are used.
+// The corpus is checked repeats times over; the misspellings it reports are
+// then looked up for corrections.
+
+#include "core/file_io.h"
+#include "core/spell_checker.h"
+#include "core/suggestion_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using bijoy::core::Misspelling;
+using bijoy::core::SpellChecker;
+using bijoy::core::SpellingSuggestion;
+using bijoy::core::WordFrequency;
+
+namespace {
+
+    template <typename Fn>
+    double Seconds(Fn fn) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::wstring Widen(const char* path) {
+        return std::filesystem::path(path).wstring();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::wstring wordsPath = argc > 2 ? Widen(argv[1]) : Widen(BIJOY_BENCH_DATA_DIR "/spelling_words.tsv");
+    const std::wstring corpusPath = argc > 2 ? Widen(argv[2]) : Widen(BIJOY_BENCH_DATA_DIR "/spelling_corpus.txt");
+    const int repeats = argc > 3 ? std::atoi(argv[3]) : argc == 2 ? std::atoi(argv[1]) : 2000;
+    const std::wstring indexPath = (std::filesystem::temp_directory_path() / "spell_checker_bench.bin").wstring();
+
+    std::vector<WordFrequency> words;
+    std::string bytes;
+    if (!bijoy::core::LoadWordFrequencyList(wordsPath, words) || !bijoy::core::ReadFileBytes(corpusPath, bytes)) {
+        std::fprintf(stderr, "cannot read the lexicon or corpus\n");
+        return 1;
+    }
+    const size_t lexiconSize = words.size();
+
+    bool built = false;
+    const double build = Seconds([&] { built = bijoy::core::WriteSpellingIndex(std::move(words), 2, indexPath); });
+    SpellChecker checker;
+    if (!built || !checker.open(indexPath)) {
+        std::fprintf(stderr, "cannot build the spelling index\n");
+        return 1;
+    }
+
+    const std::wstring corpus = bijoy::core::Utf8ToWide(bytes);
+    std::wstring text;
+    text.reserve(corpus.size() * static_cast<size_t>(repeats > 0 ? repeats : 1));
+    for (int i = 0; i < repeats; ++i) {
+        text += corpus;
+    }
+
+    std::vector<Misspelling> misspellings;
+    size_t checked = 0;
+    const double check = Seconds([&] { checked = checker.check(text, misspellings); });
+
+    // Corrections for one pass of the corpus; the rest repeat it.
+    const size_t perPass = repeats > 0 ? misspellings.size() / static_cast<size_t>(repeats) : 0;
+    std::vector<SpellingSuggestion> suggestions;
+    const double suggest = Seconds([&] {
+        for (size_t i = 0; i < perPass; ++i) {
+            const Misspelling& misspelling = misspellings[i];
+            suggestions.clear();
+            checker.suggest(std::wstring_view(text).substr(misspelling.offset, misspelling.length), 5, suggestions);
+        }
+    });
+    checker.close();
+    bijoy::core::RemoveFile(indexPath);
+
+    std::printf("index:   %zu words built in %.1f ms\n", lexiconSize, build * 1e3);
+    std::printf("check:   %zu words, %zu misspelled, %.2f M words/s\n", checked, misspellings.size(),
+                check > 0 ? checked / check / 1e6 : 0.0);
+    std::printf("suggest: %zu lookups, %.1f us each\n", perPass, perPass ? suggest / perPass * 1e6 : 0.0);
+    return 0;
+}
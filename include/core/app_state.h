@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/layout.h"
+#include <string>
 #include <vector>
 
 namespace bijoy::core {
@@ -16,4 +17,9 @@ Layout* GetCurrentLayout();
 Layout* GetLayoutByIndex(int index);
 int GetLayoutCount();
 
+// Reloads the given layout files: a layout already loaded from the same path
+// is replaced in place, other .xml files are appended. Returns how many were
+// loaded. Call on the UI thread, which also runs the keyboard hook.
+int ReloadLayoutFiles(const std::vector<std::wstring>& paths);
+
 } // namespace bijoy::core
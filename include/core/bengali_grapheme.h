@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace bijoy::core {
+
+// Incremental grapheme cluster segmenter for Bengali text. Follows the
+// extended grapheme cluster rules including the Indic conjunct rule (a
+// consonant after a virama joins the cluster), driven by a 128-entry class
+// table for the Bengali block and a 4x5 transition table.
+class BengaliGraphemeSegmenter {
+public:
+  // Returns true when a cluster boundary falls before ch.
+  bool feed(wchar_t ch);
+  void reset() { state_ = 0; }
+
+private:
+  uint8_t state_ = 0;
+};
+
+// Bengali letters and signs plus ZWNJ/ZWJ; Bengali digits are excluded.
+bool IsBengaliWordChar(wchar_t ch);
+
+// Length in UTF-16 units of the last cluster in text.
+size_t LastClusterLength(std::wstring_view text);
+
+} // namespace bijoy::core
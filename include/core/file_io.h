@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace bijoy::core {
+
+// fopen with a wide path on every platform.
+FILE* OpenStdioFile(const std::wstring& path, const wchar_t* mode);
+
+// Flushes the C runtime buffer and asks the OS to commit the file to disk.
+bool FlushToDisk(FILE* file);
+
+bool ReadFileBytes(const std::wstring& path, std::string& out);
+
+// Writes bytes to a sibling temporary file and renames it over path, so
+// readers (including other processes mapping the file) never observe a
+// partially written file.
+bool WriteFileAtomic(const std::wstring& path, std::string_view bytes);
+
+// Renames source over target, replacing it in one step.
+bool MoveFileReplacing(const std::wstring& source, const std::wstring& target);
+void RemoveFile(const std::wstring& path);
+
+// Creates path and any missing parent directories.
+bool EnsureDirectory(const std::wstring& path);
+
+std::wstring Utf8ToWide(std::string_view utf8);
+std::string WideToUtf8(std::wstring_view wide);
+
+} // namespace bijoy::core
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace bijoy::core {
+
+struct KeyMapping;
+
+// Plane index is (option ? 2 : 0) + (shift ? 1 : 0), so a keystroke resolves
+// with a single multiply-add into the entry array.
+enum class KeyPlane : uint8_t {
+  Normal = 0,
+  Shift = 1,
+  OptionNormal = 2,
+  OptionShift = 3,
+};
+
+enum class KeyAction : uint8_t {
+  PassThrough = 0,
+  Output,
+  OptionOneShot,
+  OptionLatch,
+};
+
+struct KeyDispatchEntry {
+  uint32_t offset = 0;
+  uint16_t length = 0;
+  KeyAction action = KeyAction::PassThrough;
+};
+
+// Dense per-layout lookup table compiled from Layout::key. Option planes are
+// pre-filled with the base plane wherever a key has no option mapping, so the
+// hook never needs a fallback lookup.
+class KeyDispatchTable {
+public:
+  static constexpr int kKeyCount = 256;
+  static constexpr int kPlaneCount = 4;
+
+  void clear();
+  void compile(const std::map<int, KeyMapping>& keys);
+
+  const KeyDispatchEntry& lookup(KeyPlane plane, int keyCode) const {
+    return entries_[static_cast<size_t>(plane) * kKeyCount + (static_cast<unsigned>(keyCode) & 0xFFu)];
+  }
+
+  std::wstring_view text(const KeyDispatchEntry& entry) const {
+    return std::wstring_view(pool_.data() + entry.offset, entry.length);
+  }
+
+  bool hasOptionLayer() const { return hasOptionLayer_; }
+
+private:
+  KeyDispatchEntry makeEntry(const std::wstring& value);
+
+  std::array<KeyDispatchEntry, kKeyCount * kPlaneCount> entries_{};
+  std::wstring pool_;
+  bool hasOptionLayer_ = false;
+};
+
+// Tracks whether the next keystroke (one-shot) or every keystroke (latched)
+// resolves on the option planes.
+class OptionLayerState {
+public:
+  KeyPlane resolve(bool shift) const {
+    const bool option = oneShot_ || latched_;
+    return static_cast<KeyPlane>((option ? 2 : 0) + (shift ? 1 : 0));
+  }
+
+  // Applies the looked-up entry and returns true when it was a layer switch
+  // that must be swallowed without output.
+  bool apply(KeyAction action);
+  void reset();
+
+  bool active() const { return oneShot_ || latched_; }
+
+private:
+  bool oneShot_ = false;
+  bool latched_ = false;
+};
+
+} // namespace bijoy::core
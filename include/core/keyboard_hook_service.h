@@ -7,5 +7,6 @@ namespace bijoy::core {
 bool InstallKeyboardHook(HINSTANCE hInstance);
 void UninstallKeyboardHook();
 void SetLayoutsReady(bool ready);
+void SetClusterBackspace(bool enabled);
 
 } // namespace bijoy::core
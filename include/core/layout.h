@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/key_dispatch_table.h"
+
 #include <map>
 #include <string>
 
@@ -24,9 +26,11 @@ struct Layout {
   std::wstring iconName;
   std::wstring path;
   int id = 0;
+  bool phonetic = false;
   LayoutShortcut shortcut;
   std::map<int, KeyMapping> key;
   std::map<std::wstring, std::wstring> juk;
+  KeyDispatchTable dispatch;
 
   void clear();
   bool loadFromFile(const wchar_t* filePath);
@@ -7,6 +7,12 @@
 namespace bijoy::core {
 
 bool FindLayouts(std::vector<Layout>& layouts, const std::wstring& appDir);
+// The first candidate directory holding layout XML files, or appDir's
+// Layouts folder when none does. Ends with a backslash.
+std::wstring FindLayoutDirectory(const std::wstring& appDir);
 std::wstring GetAppDirectory();
+// Per-user data directory (%LOCALAPPDATA%\OmorEkushe), created on demand.
+// Empty when it cannot be created.
+std::wstring GetUserDataDirectory();
 
 } // namespace bijoy::core
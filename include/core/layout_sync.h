@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/task_executor.h"
+
+namespace bijoy::core {
+
+// Brings the layout directory in line with a remote JSON manifest:
+//
+//   {"packs": [{"path": "Bijoy/Bijoy.xml", "sha256": "<hex>", "url": "...",
+//               "deltas": [{"from": "<hex>", "url": "..."}]}]}
+//
+// path is relative to the layout directory; url defaults to path and is
+// resolved against the manifest URL. Each optional delta, made with
+// --make-delta, rebuilds the pack from the local copy whose hash is "from".
+// Files the manifest does not list are left alone.
+struct LayoutSyncOptions {
+  std::string manifestUrl;
+  std::wstring layoutDirectory;   // with a trailing separator
+  // Keeps the manifest's ETag between runs, so an unchanged manifest costs
+  // one conditional request. Empty disables the cache.
+  std::wstring cacheDirectory;
+  int maxParallelDownloads = 4;
+  uint64_t maxBytesPerSecond = 0;   // shared by all downloads; 0 is unlimited
+  std::wstring priorityPath;        // fetched first, e.g. the active layout
+};
+
+struct LayoutSyncResult {
+  bool ok = false;
+  std::wstring error;
+  int packCount = 0;                  // packs listed in the manifest
+  // Files added or replaced. Normally empty when ok is false, but lists any
+  // file a failed install could not restore, which then needs reloading.
+  std::vector<std::wstring> installed;
+  uint64_t bytesDownloaded = 0;
+};
+
+// Invoked on the executor worker that ran a sync started with StartLayoutSync.
+using LayoutSyncCallback = std::function<void(const LayoutSyncResult& result)>;
+
+// Fetches the manifest, hashes the local copies of the packs it lists and
+// downloads the ones that differ through a NetClient::DownloadScheduler,
+// verifying each against its SHA-256.
+// Nothing is installed unless every download succeeds; each file is then
+// renamed over its old version, so readers never see a partial layout. The
+// old versions are kept in the staging area until every rename succeeds,
+// and a failed rename puts back the packs already replaced.
+// Cancelling token aborts the downloads and installs nothing; their partial
+// files are resumed by the next sync.
+LayoutSyncResult SyncLayouts(const LayoutSyncOptions& options,
+                             const CancellationToken& token = CancellationToken());
+
+// Runs SyncLayouts as a Background task on the shared executor. False while a
+// sync is running.
+bool StartLayoutSync(const LayoutSyncOptions& options, LayoutSyncCallback onDone);
+
+// Cancels the sync's task and waits for it. A running sync aborts its
+// downloads; one still queued never runs, nor calls its callback.
+void StopLayoutSync();
+
+} // namespace bijoy::core
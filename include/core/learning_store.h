@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace bijoy::core {
+
+// Upper bound on distinct learned words; past it the least used, oldest
+// words are forgotten and the remaining counts age.
+constexpr size_t kMaxLearnedWords = 4096;
+
+// Invoked on the learning thread with the path of a freshly compacted index.
+using LearnedIndexCallback = std::function<void(const std::wstring& indexPath)>;
+
+// Replays the word log in directory and starts the background thread that
+// appends to it and periodically merges the learned counts with the base
+// index into a new memory-mapped index.
+bool StartLearningStore(const std::wstring& directory, const std::wstring& baseIndexPath,
+                        LearnedIndexCallback onCompacted);
+void StopLearningStore();
+
+// Path of the last compacted index, or empty when none has been built yet.
+std::wstring GetLearnedIndexPath();
+
+// Called from the keyboard hook when a word is finished. Lock-free; words
+// are dropped if the background thread falls behind.
+void RecordLearnedWord(std::wstring_view word);
+
+} // namespace bijoy::core
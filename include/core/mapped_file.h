@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace bijoy::core {
+
+// Read-only view of a whole file. Pages are shared between every process
+// that maps the same file.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  bool open(const std::wstring& path);
+  void close();
+
+  const unsigned char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool isOpen() const { return data_ != nullptr; }
+
+private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+  void* mapping_ = nullptr;
+};
+
+} // namespace bijoy::core
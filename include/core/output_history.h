@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace bijoy::core {
+
+// The control text was injected into; the hook passes its HWND.
+using OutputTarget = const void*;
+
+// Records the cluster lengths of recently injected text per target so a
+// single Backspace can remove a whole conjunct.
+void RecordInjectedOutput(OutputTarget target, std::wstring_view output);
+
+// Pops the last recorded cluster of target and returns its length in UTF-16
+// units, or 0 when nothing is known about the text before the caret.
+size_t PopInjectedCluster(OutputTarget target);
+
+// Forgets target's history, e.g. after a key that may have moved the caret.
+void ClearInjectedOutput(OutputTarget target);
+
+// Forgets every target's history, e.g. after a mouse click, which may move
+// the caret of any window.
+void ClearAllInjectedOutput();
+
+} // namespace bijoy::core
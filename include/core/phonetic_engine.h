@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace bijoy::core {
+
+// Correction to apply to the target text: delete `backspaces` UTF-16 units
+// before the caret, then insert `text`.
+struct PhoneticEdit {
+  size_t backspaces = 0;
+  std::wstring text;
+};
+
+// Romanized-to-Bengali transliterator. Rules are compiled once into a dense
+// trie automaton and matched longest-first; each rule picks its output from
+// the class of the previous match (word start, consonant, vowel), so matching
+// never revisits input behind the current rule.
+class PhoneticEngine {
+public:
+  static constexpr size_t kMaxWordLength = 32;
+
+  // Appends ch to the current word and returns the edit that turns the text
+  // already emitted for the word into its new conversion. Returns false when
+  // ch is not phonetic input; the caller should commit() and pass it through.
+  bool feed(char ch, PhoneticEdit& edit);
+
+  // Removes the last romanized character of the current word. Returns false
+  // when the word is empty.
+  bool backspace(PhoneticEdit& edit);
+
+  // Ends the current word; later input starts a new one.
+  void commit();
+
+  bool empty() const { return word_.empty(); }
+
+private:
+  void reconvert(PhoneticEdit& edit);
+
+  std::string word_;
+  std::wstring emitted_;
+  std::wstring scratch_;
+};
+
+bool IsPhoneticInput(char ch);
+
+// Bulk conversion of a whole romanized document. Characters without a rule
+// are copied through unchanged.
+void TransliterateText(std::string_view roman, std::wstring& out);
+std::wstring TransliterateText(std::string_view roman);
+
+} // namespace bijoy::core
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core/mapped_file.h"
+#include "core/suggestion_index.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bijoy::core {
+
+// Words longer than this many grapheme clusters are neither indexed nor
+// corrected.
+constexpr size_t kMaxSpellingClusters = 48;
+
+struct SpellingSuggestion {
+  std::wstring word;
+  uint32_t frequency = 0;
+  uint32_t distance = 0;
+};
+
+struct Misspelling {
+  size_t offset = 0;
+  size_t length = 0;
+};
+
+struct SpellingWord;
+struct SpellingBucket;
+
+// Builds a symmetric-delete index: every word is stored under each variant
+// obtained by deleting up to maxDistance grapheme clusters, so a lookup only
+// has to generate the deletes of its own input. Written atomically to path.
+bool WriteSpellingIndex(std::vector<WordFrequency> words, uint32_t maxDistance, const std::wstring& path);
+
+// Read-only, memory-mapped view of an index written by WriteSpellingIndex.
+// Edits are counted in whole grapheme clusters, so a suggestion never
+// splits a conjunct or strands a vowel sign.
+class SpellChecker {
+public:
+  bool open(const std::wstring& path);
+  void close();
+  bool isOpen() const { return words_ != nullptr; }
+
+  uint32_t maxDistance() const { return maxDistance_; }
+
+  bool isCorrect(std::wstring_view word) const;
+
+  // Appends up to k corrections, closest first and then most frequent.
+  void suggest(std::wstring_view word, size_t k, std::vector<SpellingSuggestion>& out) const;
+
+  // Appends every Bengali word in text that is not in the lexicon and
+  // returns how many words were checked. Text in other scripts, and Bengali
+  // digits, are skipped.
+  size_t check(std::wstring_view text, std::vector<Misspelling>& out) const;
+
+private:
+  const SpellingBucket* findBucket(uint64_t hash) const;
+  std::wstring_view wordAt(uint32_t index) const;
+
+  MappedFile file_;
+  const SpellingWord* words_ = nullptr;
+  const SpellingBucket* buckets_ = nullptr;
+  const uint32_t* entries_ = nullptr;
+  const uint16_t* text_ = nullptr;
+  uint32_t bucketMask_ = 0;
+  uint32_t maxDistance_ = 0;
+};
+
+} // namespace bijoy::core
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <string>
+
 namespace bijoy::core {
 
+constexpr wchar_t kDefaultUpdateManifestUrl[] =
+    L"https://raw.githubusercontent.com/sabbir28/OmorEkushe/main/updates/layouts.json";
+
 struct StartupOptions {
   int defaultLayout = 0;
   int mainWindowLeft = 250;
@@ -9,6 +14,12 @@ struct StartupOptions {
   bool layoutActivationMode = false;
   bool trayMode = false;
   int applicationMode = 1;
+  bool clusterBackspace = false;
+  // Layout pack manifest checked by Update. Only read, so an administrator
+  // can point it elsewhere through the "UpdateManifestUrl" value.
+  std::wstring updateManifestUrl = kDefaultUpdateManifestUrl;
+  // Bandwidth cap for updates in KB/s ("UpdateRateLimit"); 0 is unlimited.
+  int updateRateLimit = 0;
 };
 
 StartupOptions LoadStartupOptions();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace bijoy::core {
+
+using TraceClock = std::chrono::steady_clock;
+
+// Begins recording spans into a fixed buffer for a later WriteStartupTrace to
+// outputPath. Until then every span is dropped after one relaxed load.
+void StartStartupTrace(const std::wstring& outputPath);
+bool IsStartupTraceEnabled();
+
+// Records a finished span on the calling thread. name must outlive the
+// trace; string literals are the intended use. Spans past the buffer's
+// capacity are dropped.
+void RecordTraceSpan(const char* name, TraceClock::time_point start,
+                     TraceClock::time_point end = TraceClock::now());
+
+// Stops recording and writes the spans as Chrome trace-event JSON, which
+// chrome://tracing and Perfetto open as a per-thread flame chart. Returns
+// false when tracing was never started or the file could not be written.
+bool WriteStartupTrace();
+
+// Times its own scope. Inert when tracing was off as it began.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name)
+      : name_(name), start_(IsStartupTraceEnabled() ? TraceClock::now() : TraceClock::time_point()) {}
+  ~TraceSpan() {
+    if (start_ != TraceClock::time_point()) {
+      RecordTraceSpan(name_, start_);
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+  const char* name_;
+  TraceClock::time_point start_;
+};
+
+} // namespace bijoy::core
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/mapped_file.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bijoy::core {
+
+struct WordFrequency {
+  std::wstring word;
+  uint32_t frequency = 0;
+};
+
+struct SuggestionNode;
+
+struct Suggestion {
+  std::wstring word;
+  uint32_t frequency = 0;
+};
+
+// Parses a UTF-8 "word<TAB>count" list, one entry per line.
+bool LoadWordFrequencyList(const std::wstring& path, std::vector<WordFrequency>& out);
+
+// Builds a path-compressed trie from words and writes it atomically to path.
+// Duplicate words have their frequencies summed.
+bool WriteSuggestionIndex(std::vector<WordFrequency> words, const std::wstring& path);
+
+// Read-only, memory-mapped view of an index written by WriteSuggestionIndex.
+// Nodes are stored breadth-first with contiguous, label-sorted children, and
+// each node carries the highest frequency in its subtree so top-k queries
+// visit only the branches that can still contribute.
+class SuggestionIndex {
+public:
+  struct Cursor {
+    uint32_t node = 0;
+    uint32_t edgeOffset = 0;
+  };
+
+  bool open(const std::wstring& path);
+  void close();
+  bool isOpen() const { return nodes_ != nullptr; }
+
+  Cursor root() const { return Cursor{}; }
+
+  // Extends the prefix under cursor by one UTF-16 unit. Returns false, leaving
+  // cursor unchanged, when no indexed word continues with ch.
+  bool advance(Cursor& cursor, wchar_t ch) const;
+
+  // Appends up to k completions of cursor's prefix, most frequent first.
+  void complete(const Cursor& cursor, size_t k, std::vector<Suggestion>& out) const;
+
+  // Frequency of the exact word, or 0 when it is not indexed.
+  uint32_t frequency(const std::wstring& word) const;
+
+  // Highest frequency of any indexed word.
+  uint32_t topFrequency() const;
+
+  // Appends every indexed word with its frequency.
+  void collect(std::vector<WordFrequency>& out) const;
+
+private:
+  std::wstring wordAt(uint32_t node) const;
+
+  MappedFile file_;
+  const SuggestionNode* nodes_ = nullptr;
+  const uint16_t* labels_ = nullptr;
+  uint32_t nodeCount_ = 0;
+};
+
+} // namespace bijoy::core
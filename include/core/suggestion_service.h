@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/suggestion_index.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bijoy::core {
+
+constexpr size_t kMaxSuggestionPrefix = 32;
+constexpr size_t kSuggestionCount = 5;
+
+struct SuggestionResults {
+  std::wstring prefix;
+  std::vector<Suggestion> items;
+};
+
+// Invoked on the worker thread whenever new results are available.
+using SuggestionsReadyCallback = std::function<void()>;
+
+// Maps the index and starts the background lookup thread.
+bool StartSuggestionService(const std::wstring& indexPath, SuggestionsReadyCallback onReady);
+void StopSuggestionService();
+bool IsSuggestionServiceRunning();
+
+// Asks the worker to switch to another index file. The current index stays
+// in use if the new one cannot be opened.
+void ReloadSuggestionIndex(const std::wstring& indexPath);
+
+// Called from the keyboard hook with the word being typed. Wait-free; words
+// longer than kMaxSuggestionPrefix clear the suggestions.
+void PublishSuggestionPrefix(std::wstring_view prefix);
+
+// Latest results, refreshed on each call. Must only be called from the thread
+// that owns the keyboard hook (the UI thread).
+const SuggestionResults& AcquireLatestSuggestions();
+
+} // namespace bijoy::core
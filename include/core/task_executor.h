@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace bijoy::core {
+
+// UiCritical work gates what the user sees, such as startup loading. Every
+// queued UiCritical task is taken before any Background one.
+enum class TaskPriority { UiCritical, Background };
+
+// Stop flag shared by every copy. A long task polls cancelled() and returns
+// early; a task cancelled before it starts never runs.
+class CancellationToken {
+public:
+  CancellationToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  void cancel() const { flag_->store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return flag_->load(std::memory_order_relaxed); }
+
+private:
+  std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+using Task = std::function<void(const CancellationToken& token)>;
+
+struct TaskState;
+
+// Tracks one submitted task. Copies refer to the same task.
+class TaskHandle {
+public:
+  TaskHandle() = default;
+  explicit TaskHandle(std::shared_ptr<TaskState> state) : state_(std::move(state)) {}
+
+  bool valid() const { return state_ != nullptr; }
+  // True once the task has returned, or was skipped after being cancelled.
+  bool isDone() const;
+  void cancel() const;
+  // Blocks until isDone(). On a worker thread it first runs queued tasks of
+  // the same or higher priority, this one included, so a task may wait for
+  // tasks it submitted; then it sleeps until the task finishes.
+  void wait() const;
+
+private:
+  std::shared_ptr<TaskState> state_;
+};
+
+// The process-wide executor: one worker per core beside the UI thread, each
+// with its own deque. A worker pops its newest task and, when it runs out,
+// steals the oldest from the others; idle workers park until work arrives.
+// It starts on the first submission, so threads are created once per run.
+// Long-lived loops such as the suggestion and learning workers keep their own
+// threads rather than holding a worker forever.
+void StartTaskExecutor();
+
+// Skips the tasks still queued, waits for the running ones and joins the
+// workers. Subsystems stop their own tasks first.
+void StopTaskExecutor();
+
+size_t GetTaskExecutorWorkerCount();
+
+TaskHandle SubmitTask(Task task, TaskPriority priority = TaskPriority::Background,
+                      CancellationToken token = CancellationToken());
+
+// Calls body(i) for every i below count across the workers and the calling
+// thread, and returns once all calls have. The calling thread runs only
+// these calls, never unrelated tasks.
+void ParallelFor(size_t count, const std::function<void(size_t index)>& body,
+                 TaskPriority priority = TaskPriority::UiCritical);
+
+} // namespace bijoy::core
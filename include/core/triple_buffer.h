@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace bijoy::core {
+
+// Wait-free single-producer/single-consumer hand-off of the latest value.
+// The producer fills back() and publishes; the consumer calls update() and
+// reads front(). Neither side ever waits for the other, and values the
+// consumer never saw are simply overwritten.
+template <typename T>
+class TripleBuffer {
+public:
+  T& back() { return slots_[back_]; }
+
+  void publish() {
+    back_ = static_cast<uint8_t>(middle_.exchange(static_cast<uint8_t>(back_ | kDirty), std::memory_order_acq_rel) & kIndexMask);
+  }
+
+  // Returns true when a newer value became front().
+  bool update() {
+    if ((middle_.load(std::memory_order_relaxed) & kDirty) == 0) {
+      return false;
+    }
+    front_ = static_cast<uint8_t>(middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask);
+    return true;
+  }
+
+  const T& front() const { return slots_[front_]; }
+
+private:
+  static constexpr uint8_t kDirty = 0x4;
+  static constexpr uint8_t kIndexMask = 0x3;
+
+  T slots_[3] = {};
+  std::atomic<uint8_t> middle_{1};
+  uint8_t back_ = 0;
+  uint8_t front_ = 2;
+};
+
+} // namespace bijoy::core
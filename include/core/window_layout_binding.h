@@ -13,5 +13,8 @@ struct WindowLayoutBinding {
 bool AddWindowLayoutBinding(HWND hwnd, Layout* layout);
 Layout* FindWindowLayoutBinding(HWND hwnd);
 bool RemoveWindowLayoutBinding(HWND hwnd);
+// Re-points bindings into layouts[0..count) at the same index of moved, for
+// when the layout storage is reallocated.
+void MoveWindowLayoutBindings(const Layout* layouts, size_t count, Layout* moved);
 
 } // namespace bijoy::core
@@ -6,5 +6,7 @@ namespace bijoy::platform::windows {
 
 HWND CreateMainWindow(HINSTANCE hInstance);
 void SetMainWindowInitialPosition(int left, int top);
+// Refills the layout combo and the tray menu from the loaded layouts.
+void RefreshLayoutControls();
 
 } // namespace bijoy::platform::windows
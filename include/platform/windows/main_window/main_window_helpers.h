@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <windows.h>
 
 namespace bijoy::core { struct Layout; }
@@ -12,7 +13,19 @@ std::wstring BuildPath(const std::wstring& base, const std::wstring& relative);
 HICON LoadIconFromPath(const std::wstring& path, int width, int height);
 HICON LoadAppIconFromData(int width, int height);
 HICON LoadLayoutIcon(const bijoy::core::Layout* layout);
-HBITMAP LoadPngAsBitmap(const std::wstring& path, int width, int height);
+
+// An image decoded to top-down BGRA rows with alpha premultiplied, as
+// AlphaBlend and UpdateLayeredWindow expect. Decoding touches no GDI state,
+// so it can run on a worker; the bitmap is then made on the UI thread.
+struct DecodedImage {
+  int width = 0;
+  int height = 0;
+  std::vector<unsigned char> pixels;
+};
+
+bool DecodeImageFile(const std::wstring& path, DecodedImage& image);
+// A width x height bitmap of image, scaled when the sizes differ.
+HBITMAP CreateImageBitmap(const DecodedImage& image, int width, int height);
 std::string WideToUtf8(const std::wstring& value);
 void SnapWindowToTop(HWND hwnd);
 
@@ -11,6 +11,8 @@ namespace bijoy::platform::windows {
 
 // Message IDs
 constexpr UINT kTrayIconMessage = WM_USER + 1;
+constexpr UINT kLayoutSyncMessage = WM_USER + 2;  // lParam: heap LayoutSyncResult*
+constexpr UINT kIconsDecodedMessage = WM_USER + 3;  // lParam: heap DecodedIcons*
 
 // Control IDs
 constexpr UINT_PTR IDC_LAYOUT_ICON = 101;
@@ -3,9 +3,19 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <string_view>
+
 namespace bijoy::platform::windows {
 
 void DoKeyboard(DWORD flags, int scanCode);
 void DoKeyboardVk(DWORD flags, WORD vk);
 
+// Tag placed in dwExtraInfo of every event sent by SendTextBatch so the
+// keyboard hook can recognise and skip its own input.
+constexpr ULONG_PTR kInjectedInputTag = 0x424A4F59;
+
+// Sends `backspaces` Backspace taps followed by `text` in a single SendInput
+// call, so the target window never observes a partial edit.
+void SendTextBatch(size_t backspaces, std::wstring_view text);
+
 } // namespace bijoy::platform::windows
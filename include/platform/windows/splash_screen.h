@@ -1,16 +1,27 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 #include <windows.h>
 
+#include "core/task_executor.h"
+
 namespace bijoy::platform::windows {
 
-using SplashInitTask = std::function<void()>;
 using SplashCompletedCallback = std::function<void()>;
 
+struct SplashOptions {
+  // Length of the fade in and of the fade out; 0 shows and hides at once.
+  int fadeMs = 200;
+};
+
+// Shows the splash until every task in readiness is done, then fades it out,
+// destroys it and calls onCompleted on the UI thread. The splash only paces
+// itself on those tasks; it never waits a fixed time.
 HWND ShowSplashScreen(HINSTANCE hInstance,
                       HWND owner,
-                      SplashInitTask initTask,
-                      SplashCompletedCallback onCompleted);
+                      std::vector<bijoy::core::TaskHandle> readiness,
+                      SplashCompletedCallback onCompleted,
+                      const SplashOptions& options = SplashOptions());
 
 } // namespace bijoy::platform::windows
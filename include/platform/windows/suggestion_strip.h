@@ -0,0 +1,14 @@
+#pragma once
+
+#include <windows.h>
+
+namespace bijoy::platform::windows {
+
+// Posted (from any thread) to make the strip pull the latest suggestions.
+constexpr UINT WM_SUGGESTIONS_READY = WM_APP + 1;
+
+// Creates the hidden, non-activating strip that lists word completions
+// beneath the owner window.
+HWND CreateSuggestionStrip(HINSTANCE hInstance, HWND owner);
+
+} // namespace bijoy::platform::windows
@@ -1,15 +1,263 @@
 #include "core/app_state.h"
+#include "core/file_io.h"
 #include "core/keyboard_hook_service.h"
 #include "core/layout_discovery.h"
+#include "core/layout_sync.h"
+#include "core/learning_store.h"
+#include "core/spell_checker.h"
 #include "core/startup_options.h"
+#include "core/startup_trace.h"
+#include "core/suggestion_index.h"
+#include "core/suggestion_service.h"
+#include "core/task_executor.h"
 #include "platform/windows/main_window.h"
 #include "platform/windows/registration_dialog.h"
 #include "platform/windows/splash_screen.h"
+#include "platform/windows/suggestion_strip.h"
 
+#include "NetClient.h"
+
+#include <chrono>
 #include <commctrl.h>
 #include <memory>
+#include <shellapi.h>
+#include <string>
+#include <vector>
 #include <windows.h>
 
+// -----------------------------------------------------------------------------
+// Spell-checks a UTF-8 text file and writes a report: a summary line with the
+// checking throughput, then one "offset<TAB>word<TAB>suggestions" line per
+// misspelling. Suggestions are looked up after the timed pass.
+// -----------------------------------------------------------------------------
+static bool CheckSpellingFile(const std::wstring& indexPath, const std::wstring& textPath,
+                              const std::wstring& reportPath) {
+    bijoy::core::SpellChecker checker;
+    std::string bytes;
+    if (!checker.open(indexPath) || !bijoy::core::ReadFileBytes(textPath, bytes)) {
+        return false;
+    }
+    const std::wstring text = bijoy::core::Utf8ToWide(bytes);
+
+    std::vector<bijoy::core::Misspelling> misspellings;
+    const auto start = std::chrono::steady_clock::now();
+    const size_t checked = checker.check(text, misspellings);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::wstring report = L"# " + std::to_wstring(checked) + L" words, " +
+                          std::to_wstring(misspellings.size()) + L" misspelled, " +
+                          std::to_wstring(static_cast<uint64_t>(seconds > 0 ? checked / seconds : 0)) +
+                          L" words/s\n";
+    std::vector<bijoy::core::SpellingSuggestion> suggestions;
+    for (const auto& misspelling : misspellings) {
+        const std::wstring_view word(text.data() + misspelling.offset, misspelling.length);
+        suggestions.clear();
+        checker.suggest(word, 5, suggestions);
+
+        report += std::to_wstring(misspelling.offset) + L'\t';
+        report += word;
+        report += L'\t';
+        for (size_t i = 0; i < suggestions.size(); ++i) {
+            if (i > 0) report += L' ';
+            report += suggestions[i].word;
+        }
+        report += L'\n';
+    }
+    return bijoy::core::WriteFileAtomic(reportPath, bijoy::core::WideToUtf8(report));
+}
+
+// -----------------------------------------------------------------------------
+// Offline tooling, run instead of the UI:
+//   --build-suggestions <words.tsv> <out.bin>   suggestion index
+//   --build-spelling <words.tsv> <out.bin>      spell-check index
+//   --check-spelling <index.bin> <in.txt> <report.tsv>
+//   --make-delta <old> <new> <out.delta>        update delta for a manifest
+// Word lists are UTF-8 "word<TAB>count" lines. Returns -1 when the command
+// line does not request a tool.
+// -----------------------------------------------------------------------------
+static int RunCommandLineTool() {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) {
+        return -1;
+    }
+
+    int result = -1;
+    if (argc == 4 && lstrcmpW(argv[1], L"--build-suggestions") == 0) {
+        std::vector<bijoy::core::WordFrequency> words;
+        result = bijoy::core::LoadWordFrequencyList(argv[2], words) &&
+                         bijoy::core::WriteSuggestionIndex(std::move(words), argv[3])
+                 ? 0
+                 : 1;
+    } else if (argc == 4 && lstrcmpW(argv[1], L"--build-spelling") == 0) {
+        std::vector<bijoy::core::WordFrequency> words;
+        result = bijoy::core::LoadWordFrequencyList(argv[2], words) &&
+                         bijoy::core::WriteSpellingIndex(std::move(words), 2, argv[3])
+                 ? 0
+                 : 1;
+    } else if (argc == 5 && lstrcmpW(argv[1], L"--check-spelling") == 0) {
+        result = CheckSpellingFile(argv[2], argv[3], argv[4]) ? 0 : 1;
+    } else if (argc == 5 && lstrcmpW(argv[1], L"--make-delta") == 0) {
+        result = NetClient::make_delta(bijoy::core::WideToUtf8(argv[2]), bijoy::core::WideToUtf8(argv[3]),
+                                       bijoy::core::WideToUtf8(argv[4]))
+                 ? 0
+                 : 1;
+    }
+    LocalFree(argv);
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+// True when the command line carries the given switch, e.g. --no-splash
+// -----------------------------------------------------------------------------
+static bool HasCommandLineSwitch(const wchar_t* name) {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) {
+        return false;
+    }
+
+    bool found = false;
+    for (int i = 1; i < argc && !found; ++i) {
+        found = lstrcmpiW(argv[i], name) == 0;
+    }
+    LocalFree(argv);
+    return found;
+}
+
+// -----------------------------------------------------------------------------
+// Returns the argument after the given switch, or an empty string
+// -----------------------------------------------------------------------------
+static std::wstring GetCommandLineValue(const wchar_t* name) {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) {
+        return {};
+    }
+
+    std::wstring value;
+    for (int i = 1; i + 1 < argc && value.empty(); ++i) {
+        if (lstrcmpiW(argv[i], name) == 0) {
+            value = argv[i + 1];
+        }
+    }
+    LocalFree(argv);
+    return value;
+}
+
+// -----------------------------------------------------------------------------
+// Records startup spans when launched with --trace-startup <file.json> or with
+// OMOR_EKUSHE_TRACE=<file.json> in the environment. The file opens in
+// chrome://tracing or Perfetto and belongs with every startup bug report.
+// -----------------------------------------------------------------------------
+static void ConfigureStartupTrace() {
+    std::wstring path = GetCommandLineValue(L"--trace-startup");
+    if (path.empty()) {
+        wchar_t buffer[MAX_PATH] = {};
+        const DWORD length = GetEnvironmentVariableW(L"OMOR_EKUSHE_TRACE", buffer, MAX_PATH);
+        if (length > 0 && length < MAX_PATH) {
+            path.assign(buffer, length);
+        }
+    }
+    if (!path.empty()) {
+        bijoy::core::StartStartupTrace(path);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Closes the startup span and writes the trace. Only the first call writes;
+// the guard below makes the last call on every way out of wWinMain.
+// -----------------------------------------------------------------------------
+static void EndStartupTrace(bijoy::core::TraceClock::time_point startupBegan) {
+    bijoy::core::RecordTraceSpan("Startup", startupBegan);
+    bijoy::core::WriteStartupTrace();
+}
+
+class StartupTraceGuard {
+public:
+    explicit StartupTraceGuard(bijoy::core::TraceClock::time_point startupBegan)
+            : startupBegan_(startupBegan) {}
+    ~StartupTraceGuard() { EndStartupTrace(startupBegan_); }
+
+    StartupTraceGuard(const StartupTraceGuard&) = delete;
+    StartupTraceGuard& operator=(const StartupTraceGuard&) = delete;
+
+private:
+    const bijoy::core::TraceClock::time_point startupBegan_;
+};
+
+// -----------------------------------------------------------------------------
+// Applies loaded startup options on the UI thread, then shows the main window
+// unless the startup mode keeps it in the tray
+// -----------------------------------------------------------------------------
+static void ApplyStartupOptions(HWND mainWindow, const bijoy::core::StartupOptions& options) {
+    bijoy::core::TraceSpan span("ApplyStartupOptions");
+    bijoy::core::SetClusterBackspace(options.clusterBackspace);
+
+    // Restore window position, keeping the bar pinned to the top edge.
+    bijoy::platform::windows::SetMainWindowInitialPosition(
+            options.mainWindowLeft,
+            options.mainWindowTop);
+
+    // Apply default keyboard layout if valid
+    if (options.defaultLayout >= 0 &&
+        options.defaultLayout < bijoy::core::GetLayoutCount()) {
+        bijoy::core::SetCurrentLayout(options.defaultLayout);
+    }
+
+    const bool shouldStartHidden =
+            options.applicationMode == 3 ||
+            (options.applicationMode != 2 && options.trayMode);
+
+    ShowWindow(mainWindow, shouldStartHidden ? SW_HIDE : SW_SHOW);
+}
+
+// -----------------------------------------------------------------------------
+// Starts word suggestions when a compiled index ships with the application.
+// Words the user types are learned and merged into a per-user copy of it.
+// -----------------------------------------------------------------------------
+static void StartWordSuggestions(HINSTANCE hInstance, HWND mainWindow, const std::wstring& appDir) {
+    const std::wstring candidates[] = {
+            appDir + L"data\\Suggestions.bin",
+            appDir + L"..\\data\\Suggestions.bin",
+    };
+
+    for (const auto& path : candidates) {
+        if (GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES) {
+            continue;
+        }
+
+        HWND strip = bijoy::platform::windows::CreateSuggestionStrip(hInstance, mainWindow);
+        if (!strip) {
+            return;
+        }
+
+        const std::wstring userDir = bijoy::core::GetUserDataDirectory();
+        if (!userDir.empty()) {
+            bijoy::core::StartLearningStore(userDir, path, [](const std::wstring& indexPath) {
+                bijoy::core::ReloadSuggestionIndex(indexPath);
+            });
+        }
+
+        const std::wstring learnedPath = bijoy::core::GetLearnedIndexPath();
+        const auto onReady = [strip]() {
+            PostMessageW(strip, bijoy::platform::windows::WM_SUGGESTIONS_READY, 0, 0);
+        };
+        if (learnedPath.empty() || !bijoy::core::StartSuggestionService(learnedPath, onReady)) {
+            bijoy::core::StartSuggestionService(path, onReady);
+        }
+        return;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Stops the learning thread before the service it reloads
+// -----------------------------------------------------------------------------
+static void StopWordSuggestions() {
+    bijoy::core::StopLearningStore();
+    bijoy::core::StopSuggestionService();
+}
+
 // -----------------------------------------------------------------------------
 // Unicode entry point forward declaration
 // Ensures consistent startup path regardless of subsystem configuration
@@ -51,12 +299,15 @@ int WINAPI wWinMain(
     (void)lpCmdLine;
     (void)nCmdShow;
 
-    // ---------------------------------------------------------------------------
-    // Initialize common Windows controls (buttons, dialogs, etc.)
-    // Required before creating any UI that relies on comctl32
-    // ---------------------------------------------------------------------------
-    INITCOMMONCONTROLSEX icc = {sizeof(icc), ICC_STANDARD_CLASSES};
-    InitCommonControlsEx(&icc);
+    const int toolResult = RunCommandLineTool();
+    if (toolResult >= 0) {
+        return toolResult;
+    }
+
+    ConfigureStartupTrace();
+    const auto startupBegan = bijoy::core::TraceClock::now();
+    // Early exits write what was traced so far, failures included
+    const StartupTraceGuard startupTrace(startupBegan);
 
     // ---------------------------------------------------------------------------
     // Discover application installation directory
@@ -64,21 +315,47 @@ int WINAPI wWinMain(
     // ---------------------------------------------------------------------------
     const std::wstring appDir = bijoy::core::GetAppDirectory();
 
-    // Load and validate keyboard layout definitions
-    if (!bijoy::core::FindLayouts(bijoy::core::g_layouts, appDir)) {
-        MessageBoxW(
-                nullptr,
-                L"No layout XML files found. Expected paths include data\\layout.",
-                L"Omor Ekushe",
-                MB_OK | MB_ICONERROR);
-        return 1;
+    // ---------------------------------------------------------------------------
+    // Startup options and layouts load on the executor while the hook and the
+    // main window are set up; the splash waits on both tasks
+    // ---------------------------------------------------------------------------
+    auto startupOptions = std::make_shared<bijoy::core::StartupOptions>();
+    const bijoy::core::TaskHandle optionsLoaded = bijoy::core::SubmitTask(
+            [startupOptions](const bijoy::core::CancellationToken&) {
+                bijoy::core::TraceSpan span("LoadStartupOptions");
+                *startupOptions = bijoy::core::LoadStartupOptions();
+            },
+            bijoy::core::TaskPriority::UiCritical);
+
+    // Loaded into a copy: g_layouts belongs to the UI thread and the hook
+    auto loadedLayouts = std::make_shared<std::vector<bijoy::core::Layout>>();
+    const bijoy::core::TaskHandle layoutsLoaded = bijoy::core::SubmitTask(
+            [loadedLayouts, appDir](const bijoy::core::CancellationToken&) {
+                bijoy::core::TraceSpan span("FindLayouts");
+                bijoy::core::FindLayouts(*loadedLayouts, appDir);
+            },
+            bijoy::core::TaskPriority::UiCritical);
+
+    // ---------------------------------------------------------------------------
+    // Initialize common Windows controls (buttons, dialogs, etc.)
+    // Required before creating any UI that relies on comctl32
+    // ---------------------------------------------------------------------------
+    {
+        bijoy::core::TraceSpan span("InitCommonControlsEx");
+        INITCOMMONCONTROLSEX icc = {sizeof(icc), ICC_STANDARD_CLASSES};
+        InitCommonControlsEx(&icc);
     }
 
     // ---------------------------------------------------------------------------
     // Install low-level keyboard hook
     // Critical for intercepting and remapping keystrokes
     // ---------------------------------------------------------------------------
-    if (!bijoy::core::InstallKeyboardHook(hInstance)) {
+    bool hookInstalled = false;
+    {
+        bijoy::core::TraceSpan span("InstallKeyboardHook");
+        hookInstalled = bijoy::core::InstallKeyboardHook(hInstance);
+    }
+    if (!hookInstalled) {
         MessageBoxW(
                 nullptr,
                 L"Failed to install keyboard hook.",
@@ -87,76 +364,83 @@ int WINAPI wWinMain(
         return 1;
     }
 
-    // Signal that layout data is fully initialized and safe to consume
-    bijoy::core::SetLayoutsReady(true);
-
     // ---------------------------------------------------------------------------
     // Create main application window
     // Window is initially hidden pending registration and startup logic
     // ---------------------------------------------------------------------------
-    HWND mainWindow = bijoy::platform::windows::CreateMainWindow(hInstance);
+    HWND mainWindow = nullptr;
+    {
+        bijoy::core::TraceSpan span("CreateMainWindow");
+        mainWindow = bijoy::platform::windows::CreateMainWindow(hInstance);
+    }
     if (!mainWindow) {
         return 1;
     }
     ShowWindow(mainWindow, SW_HIDE);
 
+    // Optional word completion strip, fed by a background lookup thread
+    {
+        bijoy::core::TraceSpan span("StartWordSuggestions");
+        StartWordSuggestions(hInstance, mainWindow, appDir);
+    }
+
     // ---------------------------------------------------------------------------
     // Registration / licensing gate
     // Application does not proceed unless registration succeeds
     // ---------------------------------------------------------------------------
     HWND splashWindow = nullptr;
+    const auto registrationBegan = bijoy::core::TraceClock::now();
     const int registrationResult =
             bijoy::platform::windows::ShowRegistrationDialog(mainWindow);
+    bijoy::core::RecordTraceSpan("RegistrationDialog", registrationBegan);
 
     // Registration cancelled or failed — clean shutdown
     if (registrationResult == 0) {
         DestroyWindow(mainWindow);
         bijoy::core::UninstallKeyboardHook();
+        StopWordSuggestions();
+        bijoy::core::StopTaskExecutor();
         return 0;
     }
 
     // ---------------------------------------------------------------------------
-    // Startup options are shared across splash callbacks
-    // Loaded asynchronously during splash screen display
+    // Splash stays up only until the options and layouts have loaded;
+    // --no-splash skips it, e.g. for a login autostart entry
     // ---------------------------------------------------------------------------
-    auto startupOptions = std::make_shared<bijoy::core::StartupOptions>();
-
-    splashWindow = bijoy::platform::windows::ShowSplashScreen(
-            hInstance,
-            mainWindow,
+    // The trace ends here, with the splash span covering its whole stay.
+    const auto splashBegan = bijoy::core::TraceClock::now();
+    const auto finishStartup = [mainWindow, startupOptions, loadedLayouts, startupBegan, splashBegan]() {
+        bijoy::core::RecordTraceSpan("Splash", splashBegan);
+        if (loadedLayouts->empty()) {
+            MessageBoxW(
+                    nullptr,
+                    L"No layout XML files found. Expected paths include data\\layout.",
+                    L"Omor Ekushe",
+                    MB_OK | MB_ICONERROR);
+            PostQuitMessage(1);
+        } else {
+            bijoy::core::g_layouts.swap(*loadedLayouts);
+            // Signal that layout data is fully initialized and safe to consume
+            bijoy::core::SetLayoutsReady(true);
+            ApplyStartupOptions(mainWindow, *startupOptions);
+            bijoy::platform::windows::RefreshLayoutControls();
+        }
+        EndStartupTrace(startupBegan);
+    };
 
-            // Phase 1: Load persisted startup configuration
-            [startupOptions]() {
-                *startupOptions = bijoy::core::LoadStartupOptions();
-
-                // Restore window position, keeping the bar pinned to the top edge.
-                bijoy::platform::windows::SetMainWindowInitialPosition(
-                        startupOptions->mainWindowLeft,
-                        startupOptions->mainWindowTop);
-
-                // Apply default keyboard layout if valid
-                if (startupOptions->defaultLayout >= 0 &&
-                    startupOptions->defaultLayout < bijoy::core::GetLayoutCount()) {
-                    bijoy::core::SetCurrentLayout(
-                            startupOptions->defaultLayout);
-                }
-            },
-
-            // Phase 2: Decide window visibility based on startup mode
-            [mainWindow, startupOptions]() {
-                const bool shouldStartHidden =
-                        startupOptions->applicationMode == 3 ||
-                        (startupOptions->applicationMode != 2 &&
-                         startupOptions->trayMode);
-
-                ShowWindow(
-                        mainWindow,
-                        shouldStartHidden ? SW_HIDE : SW_SHOW);
-            });
+    if (!HasCommandLineSwitch(L"--no-splash")) {
+        splashWindow = bijoy::platform::windows::ShowSplashScreen(
+                hInstance,
+                mainWindow,
+                {optionsLoaded, layoutsLoaded},
+                finishStartup);
+    }
 
-    // Fallback: if splash screen creation failed, show main window immediately
+    // Fallback: without a splash, finish startup as soon as both tasks are done
     if (!splashWindow) {
-        ShowWindow(mainWindow, SW_SHOW);
+        optionsLoaded.wait();
+        layoutsLoaded.wait();
+        finishStartup();
     }
 
     // ---------------------------------------------------------------------------
@@ -174,5 +458,8 @@ int WINAPI wWinMain(
     // Ensure keyboard hook is always removed
     // ---------------------------------------------------------------------------
     bijoy::core::UninstallKeyboardHook();
+    bijoy::core::StopLayoutSync();
+    StopWordSuggestions();
+    bijoy::core::StopTaskExecutor();
     return static_cast<int>(msg.wParam);
 }
\ No newline at end of file
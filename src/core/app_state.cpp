@@ -1,5 +1,10 @@
 #include "core/app_state.h"
 
+#include "core/window_layout_binding.h"
+
+#include <algorithm>
+#include <iterator>
+
 namespace bijoy::core {
 
     std::vector<Layout> g_layouts;
@@ -34,4 +39,43 @@ namespace bijoy::core {
         return static_cast<int>(g_layouts.size());
     }
 
+    int ReloadLayoutFiles(const std::vector<std::wstring>& paths) {
+        int loaded = 0;
+        std::vector<Layout> added;
+        for (const auto& path : paths) {
+            if (path.size() < 4 || path.compare(path.size() - 4, 4, L".xml") != 0) {
+                continue;
+            }
+
+            Layout layout;
+            if (!layout.loadFromFile(path.c_str())) {
+                continue;
+            }
+            ++loaded;
+
+            const auto existing = std::find_if(g_layouts.begin(), g_layouts.end(), [&](const Layout& current) {
+                return current.path == path;
+            });
+            if (existing != g_layouts.end()) {
+                layout.id = existing->id;
+                *existing = std::move(layout);
+            } else {
+                added.push_back(std::move(layout));
+            }
+        }
+
+        if (!added.empty()) {
+            std::vector<Layout> grown;
+            grown.reserve(g_layouts.size() + added.size());
+            std::move(g_layouts.begin(), g_layouts.end(), std::back_inserter(grown));
+            for (auto& layout : added) {
+                layout.id = static_cast<int>(grown.size());
+                grown.push_back(std::move(layout));
+            }
+            MoveWindowLayoutBindings(g_layouts.data(), g_layouts.size(), grown.data());
+            g_layouts.swap(grown);
+        }
+        return loaded;
+    }
+
 } // namespace bijoy::core
@@ -0,0 +1,113 @@
+#include "core/bengali_grapheme.h"
+
+#include <array>
+
+namespace bijoy::core {
+
+    namespace {
+
+        enum CharClass : uint8_t {
+            kOther = 0,
+            kConsonant = 1,
+            kExtend = 2,
+            kLinker = 3,
+            kTrail = 4,
+            kClassCount = 5
+        };
+
+        enum State : uint8_t {
+            kStart = 0,
+            kBase = 1,
+            kConsonantBase = 2,
+            kLinked = 3,
+            kStateCount = 4
+        };
+
+        constexpr wchar_t kBengaliFirst = 0x0980;
+        constexpr wchar_t kBengaliLast = 0x09FF;
+
+        constexpr std::array<uint8_t, 128> BuildBengaliClasses() {
+            std::array<uint8_t, 128> table{};
+            const auto set = [&table](wchar_t first, wchar_t last, uint8_t cls) {
+                for (wchar_t c = first; c <= last; ++c) {
+                    table[c - kBengaliFirst] = cls;
+                }
+            };
+
+            set(0x0995, 0x09B9, kConsonant);
+            set(0x09DC, 0x09DD, kConsonant);
+            set(0x09DF, 0x09DF, kConsonant);
+            set(0x09F0, 0x09F1, kConsonant);
+
+            set(0x0981, 0x0983, kExtend);
+            set(0x09BC, 0x09BC, kExtend);
+            set(0x09BE, 0x09C4, kExtend);
+            set(0x09C7, 0x09C8, kExtend);
+            set(0x09CB, 0x09CC, kExtend);
+            set(0x09D7, 0x09D7, kExtend);
+            set(0x09E2, 0x09E3, kExtend);
+            set(0x09FE, 0x09FE, kExtend);
+
+            set(0x09CD, 0x09CD, kLinker);
+
+            // Unassigned code points inside the consonant range.
+            table[0x09A9 - kBengaliFirst] = kOther;
+            table[0x09B1 - kBengaliFirst] = kOther;
+            table[0x09B3 - kBengaliFirst] = kOther;
+            table[0x09B4 - kBengaliFirst] = kOther;
+            table[0x09B5 - kBengaliFirst] = kOther;
+            return table;
+        }
+
+        constexpr std::array<uint8_t, 128> kBengaliClasses = BuildBengaliClasses();
+
+        // Low bit: join with the previous cluster. Upper bits: next state.
+        constexpr uint8_t Join(State next) { return static_cast<uint8_t>((next << 1) | 1); }
+        constexpr uint8_t Break(State next) { return static_cast<uint8_t>(next << 1); }
+
+        constexpr uint8_t kTransitions[kStateCount][kClassCount] = {
+                // Other        Consonant              Extend                Linker             Trail
+                {Break(kBase), Break(kConsonantBase), Break(kBase),         Break(kBase),      Break(kBase)},          // Start
+                {Break(kBase), Break(kConsonantBase), Join(kBase),          Join(kBase),       Join(kBase)},           // Base
+                {Break(kBase), Break(kConsonantBase), Join(kConsonantBase), Join(kLinked),     Join(kConsonantBase)},  // ConsonantBase
+                {Break(kBase), Join(kConsonantBase),  Join(kLinked),        Join(kLinked),     Join(kLinked)},         // Linked
+        };
+
+        uint8_t Classify(wchar_t ch) {
+            if (ch >= kBengaliFirst && ch <= kBengaliLast) {
+                return kBengaliClasses[ch - kBengaliFirst];
+            }
+            if (ch == 0x200C || ch == 0x200D) {
+                return kExtend;
+            }
+            if (ch >= 0xDC00 && ch <= 0xDFFF) {
+                return kTrail;
+            }
+            return kOther;
+        }
+
+    } // namespace
+
+    bool BengaliGraphemeSegmenter::feed(wchar_t ch) {
+        const uint8_t transition = kTransitions[state_][Classify(ch)];
+        state_ = static_cast<uint8_t>(transition >> 1);
+        return (transition & 1) == 0;
+    }
+
+    bool IsBengaliWordChar(wchar_t ch) {
+        const bool digit = ch >= 0x09E6 && ch <= 0x09EF;
+        return (ch >= kBengaliFirst && ch <= kBengaliLast && !digit) || ch == 0x200C || ch == 0x200D;
+    }
+
+    size_t LastClusterLength(std::wstring_view text) {
+        BengaliGraphemeSegmenter segmenter;
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (segmenter.feed(text[i])) {
+                start = i;
+            }
+        }
+        return text.size() - start;
+    }
+
+} // namespace bijoy::core
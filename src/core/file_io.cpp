@@ -0,0 +1,183 @@
+#include "core/file_io.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bijoy::core {
+
+#ifdef _WIN32
+    bool MoveFileReplacing(const std::wstring& source, const std::wstring& target) {
+        return MoveFileExW(source.c_str(), target.c_str(),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    }
+
+    void RemoveFile(const std::wstring& path) {
+        _wremove(path.c_str());
+    }
+
+    bool EnsureDirectory(const std::wstring& path) {
+        if (CreateDirectoryW(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS) {
+            return true;
+        }
+        const size_t parent = path.find_last_of(L"\\/", path.size() - 2);
+        if (GetLastError() != ERROR_PATH_NOT_FOUND || parent == std::wstring::npos ||
+            !EnsureDirectory(path.substr(0, parent + 1))) {
+            return false;
+        }
+        return CreateDirectoryW(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+    }
+
+    FILE* OpenStdioFile(const std::wstring& path, const wchar_t* mode) {
+        return _wfopen(path.c_str(), mode);
+    }
+
+    bool FlushToDisk(FILE* file) {
+        return fflush(file) == 0 &&
+               FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)))) != 0;
+    }
+#else
+    bool MoveFileReplacing(const std::wstring& source, const std::wstring& target) {
+        return rename(WideToUtf8(source).c_str(), WideToUtf8(target).c_str()) == 0;
+    }
+
+    void RemoveFile(const std::wstring& path) {
+        std::remove(WideToUtf8(path).c_str());
+    }
+
+    bool EnsureDirectory(const std::wstring& path) {
+        const std::string narrow = WideToUtf8(path);
+        if (mkdir(narrow.c_str(), 0755) == 0 || errno == EEXIST) {
+            return true;
+        }
+        const size_t parent = path.find_last_of(L'/', path.size() - 2);
+        if (errno != ENOENT || parent == std::wstring::npos || !EnsureDirectory(path.substr(0, parent + 1))) {
+            return false;
+        }
+        return mkdir(narrow.c_str(), 0755) == 0 || errno == EEXIST;
+    }
+
+    FILE* OpenStdioFile(const std::wstring& path, const wchar_t* mode) {
+        return fopen(WideToUtf8(path).c_str(), WideToUtf8(mode).c_str());
+    }
+
+    bool FlushToDisk(FILE* file) {
+        return fflush(file) == 0 && fsync(fileno(file)) == 0;
+    }
+#endif
+
+    bool ReadFileBytes(const std::wstring& path, std::string& out) {
+        FILE* file = OpenStdioFile(path, L"rb");
+        if (!file) {
+            return false;
+        }
+
+        out.clear();
+        char buffer[64 * 1024];
+        size_t read = 0;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            out.append(buffer, read);
+        }
+        const bool ok = ferror(file) == 0;
+        fclose(file);
+        return ok;
+    }
+
+    bool WriteFileAtomic(const std::wstring& path, std::string_view bytes) {
+        const std::wstring tempPath = path + L".tmp";
+        FILE* file = OpenStdioFile(tempPath, L"wb");
+        if (!file) {
+            return false;
+        }
+
+        bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        ok = FlushToDisk(file) && ok;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || !MoveFileReplacing(tempPath, path)) {
+            RemoveFile(tempPath);
+            return false;
+        }
+        return true;
+    }
+
+    std::wstring Utf8ToWide(std::string_view utf8) {
+        std::wstring out;
+        out.reserve(utf8.size());
+        for (size_t i = 0; i < utf8.size();) {
+            const auto byte = static_cast<unsigned char>(utf8[i]);
+            uint32_t cp = 0xFFFD;
+            size_t extra = 0;
+            if (byte < 0x80) {
+                cp = byte;
+            } else if ((byte & 0xE0) == 0xC0) {
+                cp = byte & 0x1F;
+                extra = 1;
+            } else if ((byte & 0xF0) == 0xE0) {
+                cp = byte & 0x0F;
+                extra = 2;
+            } else if ((byte & 0xF8) == 0xF0) {
+                cp = byte & 0x07;
+                extra = 3;
+            }
+
+            if (i + extra >= utf8.size() && extra > 0) {
+                out.push_back(static_cast<wchar_t>(0xFFFD));
+                break;
+            }
+            for (size_t k = 1; k <= extra; ++k) {
+                cp = (cp << 6) | (static_cast<unsigned char>(utf8[i + k]) & 0x3F);
+            }
+            i += extra + 1;
+
+            if (cp >= 0x10000 && sizeof(wchar_t) == 2) {
+                cp -= 0x10000;
+                out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+                out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+            } else {
+                out.push_back(static_cast<wchar_t>(cp));
+            }
+        }
+        return out;
+    }
+
+    std::string WideToUtf8(std::wstring_view wide) {
+        std::string out;
+        out.reserve(wide.size() * 3);
+        for (size_t i = 0; i < wide.size(); ++i) {
+            uint32_t cp = static_cast<uint32_t>(wide[i]);
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < wide.size()) {
+                const auto low = static_cast<uint32_t>(wide[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+
+            if (cp < 0x80) {
+                out.push_back(static_cast<char>(cp));
+            } else if (cp < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else if (cp < 0x10000) {
+                out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+        }
+        return out;
+    }
+
+} // namespace bijoy::core
@@ -0,0 +1,116 @@
+#include "core/key_dispatch_table.h"
+
+#include "core/layout.h"
+
+namespace bijoy::core {
+
+    namespace {
+
+        constexpr wchar_t kOneShotDirective[] = L"Option";
+        constexpr wchar_t kLatchDirective[] = L"OptionLock";
+
+        // Reordering hints shipped with the Bijoy Unicode layout. They describe
+        // cluster behaviour rather than option-layer text, so they never become
+        // option-plane output.
+        constexpr const wchar_t* kReorderHints[] = {
+                L"Delay", L"DeInc1", L"DeInc2", L"MoveL", L"Xtra"
+        };
+
+        bool IsReorderHint(const std::wstring& value) {
+            for (const wchar_t* hint : kReorderHints) {
+                if (value == hint) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t Index(KeyPlane plane, int keyCode) {
+            return static_cast<size_t>(plane) * KeyDispatchTable::kKeyCount +
+                   (static_cast<unsigned>(keyCode) & 0xFFu);
+        }
+
+    } // namespace
+
+    void KeyDispatchTable::clear() {
+        entries_.fill(KeyDispatchEntry{});
+        pool_.clear();
+        hasOptionLayer_ = false;
+    }
+
+    KeyDispatchEntry KeyDispatchTable::makeEntry(const std::wstring& value) {
+        KeyDispatchEntry entry;
+        if (value.empty()) {
+            return entry;
+        }
+
+        // Identical outputs share one pool slice.
+        const size_t existing = pool_.find(value);
+        entry.offset = static_cast<uint32_t>(existing != std::wstring::npos ? existing : pool_.size());
+        entry.length = static_cast<uint16_t>(value.size());
+        entry.action = KeyAction::Output;
+        if (existing == std::wstring::npos) {
+            pool_ += value;
+        }
+        return entry;
+    }
+
+    void KeyDispatchTable::compile(const std::map<int, KeyMapping>& keys) {
+        clear();
+
+        for (const auto& [keyCode, mapping] : keys) {
+            if (keyCode < 0 || keyCode >= kKeyCount) {
+                continue;
+            }
+
+            const KeyDispatchEntry normal = makeEntry(mapping.normal);
+            const KeyDispatchEntry shift = makeEntry(mapping.shift);
+            entries_[Index(KeyPlane::Normal, keyCode)] = normal;
+            entries_[Index(KeyPlane::Shift, keyCode)] = shift;
+
+            const auto compileOption = [&](const std::wstring& option,
+                                           KeyPlane basePlane,
+                                           KeyPlane optionPlane,
+                                           const KeyDispatchEntry& base) {
+                KeyDispatchEntry entry = base;
+                if (option == kOneShotDirective || option == kLatchDirective) {
+                    entry = KeyDispatchEntry{};
+                    entry.action = option == kOneShotDirective ? KeyAction::OptionOneShot : KeyAction::OptionLatch;
+                    // The switch key behaves the same on both layers so that a
+                    // second press cancels the one-shot or releases the latch.
+                    entries_[Index(basePlane, keyCode)] = entry;
+                    hasOptionLayer_ = true;
+                } else if (!option.empty() && !IsReorderHint(option)) {
+                    entry = makeEntry(option);
+                    hasOptionLayer_ = true;
+                }
+                entries_[Index(optionPlane, keyCode)] = entry;
+            };
+
+            compileOption(mapping.normalOption, KeyPlane::Normal, KeyPlane::OptionNormal, normal);
+            compileOption(mapping.shiftOption, KeyPlane::Shift, KeyPlane::OptionShift, shift);
+        }
+    }
+
+    bool OptionLayerState::apply(KeyAction action) {
+        switch (action) {
+            case KeyAction::OptionOneShot:
+                oneShot_ = !oneShot_;
+                return true;
+            case KeyAction::OptionLatch:
+                latched_ = !latched_;
+                oneShot_ = false;
+                return true;
+            default:
+                // Any other keystroke consumes a pending one-shot.
+                oneShot_ = false;
+                return false;
+        }
+    }
+
+    void OptionLayerState::reset() {
+        oneShot_ = false;
+        latched_ = false;
+    }
+
+} // namespace bijoy::core
@@ -1,9 +1,15 @@
 #include "core/keyboard_hook_service.h"
 
 #include "core/app_state.h"
+#include "core/bengali_grapheme.h"
+#include "core/output_history.h"
+#include "core/learning_store.h"
+#include "core/phonetic_engine.h"
+#include "core/suggestion_service.h"
 #include "core/window_layout_binding.h"
 #include "platform/windows/native_input.h"
 
+#include <algorithm>
 #include <string>
 #include <windows.h>
 
@@ -20,13 +26,161 @@ namespace bijoy::core {
         };
 
         HHOOK g_hook = nullptr;
+        HHOOK g_mouseHook = nullptr;
         bool g_layoutsReady = false;
+        OptionLayerState g_optionLayer;
+        bool g_clusterBackspace = false;
+        PhoneticEngine g_phonetic;
+        PhoneticEdit g_phoneticEdit;
+        HWND g_phoneticWindow = nullptr;
+        HWND g_historyFocus = nullptr;
+        std::wstring g_word;
 
         bool IsKeyPressed(int vk) {
             return (GetAsyncKeyState(vk) & 0x8000) != 0;
         }
 
+        // Keys that neither map to output nor consume a pending option one-shot.
+        bool IsTransparentKey(DWORD vk) {
+            switch (vk) {
+                case VK_SHIFT: case VK_LSHIFT: case VK_RSHIFT:
+                case VK_CONTROL: case VK_LCONTROL: case VK_RCONTROL:
+                case VK_MENU: case VK_LMENU: case VK_RMENU:
+                case VK_LWIN: case VK_RWIN: case VK_CAPITAL:
+                case VK_PACKET:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Mirrors an edit applied to the focused window onto the word being
+        // typed, which feeds the suggestion service.
+        void TrackWordEdit(size_t backspaces, std::wstring_view text) {
+            g_word.erase(g_word.size() - std::min(backspaces, g_word.size()));
+            for (wchar_t c : text) {
+                if (IsBengaliWordChar(c)) {
+                    g_word.push_back(c);
+                } else {
+                    RecordLearnedWord(g_word);
+                    g_word.clear();
+                }
+            }
+            PublishSuggestionPrefix(g_word);
+        }
+
+        void ResetWord() {
+            if (!g_word.empty()) {
+                RecordLearnedWord(g_word);
+                g_word.clear();
+                PublishSuggestionPrefix(g_word);
+            }
+        }
+
+        // Cluster history assumes the caret sits right after the injected text,
+        // which only the mouse hook can vouch for; without it clicks go unseen.
+        bool ClusterBackspaceActive() {
+            return g_clusterBackspace && g_mouseHook != nullptr;
+        }
+
+        // The control holding the caret, which injected text and Backspace act
+        // on; falls back to the foreground window.
+        HWND FocusedControl(HWND foregroundWindow) {
+            GUITHREADINFO info = {};
+            info.cbSize = sizeof(info);
+            if (GetGUIThreadInfo(GetWindowThreadProcessId(foregroundWindow, nullptr), &info) && info.hwndFocus) {
+                return info.hwndFocus;
+            }
+            return foregroundWindow;
+        }
+
+        // A control's history is dropped when focus returns to it, since its
+        // caret may have moved in the meantime.
+        void TrackHistoryFocus(HWND focus) {
+            if (focus != g_historyFocus) {
+                ClearInjectedOutput(focus);
+                g_historyFocus = focus;
+            }
+        }
+
+        // A click may move the caret of any window, so nothing typed before it
+        // can be edited by position any more.
+        void ForgetCaretContext() {
+            g_phonetic.commit();
+            ResetWord();
+            ClearAllInjectedOutput();
+            g_historyFocus = nullptr;
+        }
+
+        // Ctrl+1..Ctrl+5 completes the current word with the matching suggestion.
+        bool AcceptSuggestion(DWORD vk, HWND focus) {
+            if (g_word.empty() || vk < '1' || vk >= '1' + kSuggestionCount) {
+                return false;
+            }
+
+            const SuggestionResults& results = AcquireLatestSuggestions();
+            const size_t choice = vk - '1';
+            if (results.prefix != g_word || choice >= results.items.size()) {
+                return false;
+            }
+
+            const std::wstring_view suffix = std::wstring_view(results.items[choice].word).substr(g_word.size());
+            bijoy::platform::windows::SendTextBatch(0, suffix);
+            if (ClusterBackspaceActive()) {
+                RecordInjectedOutput(focus, suffix);
+            }
+            g_phonetic.commit();
+            TrackWordEdit(0, suffix);
+            return true;
+        }
+
+        char PhoneticCharFromKey(DWORD vk, bool shift) {
+            if (vk >= 'A' && vk <= 'Z') {
+                return static_cast<char>(shift ? vk : vk - 'A' + 'a');
+            }
+            if (vk >= '0' && vk <= '9') {
+                if (!shift) return static_cast<char>(vk);
+                if (vk == '4') return '$';
+                if (vk == '6') return '^';
+                return 0;
+            }
+            switch (vk) {
+                case VK_OEM_PERIOD: return shift ? 0 : '.';
+                case VK_OEM_1: return shift ? ':' : 0;
+                case VK_OEM_3: return shift ? 0 : '`';
+                default: return 0;
+            }
+        }
+
+        bool ProcessPhoneticKey(DWORD vk, bool shift, HWND focus) {
+            if (focus != g_phoneticWindow) {
+                g_phonetic.commit();
+                g_phoneticWindow = focus;
+            }
+
+            const bool handled = vk == VK_BACK
+                                 ? g_phonetic.backspace(g_phoneticEdit)
+                                 : g_phonetic.feed(PhoneticCharFromKey(vk, shift), g_phoneticEdit);
+            if (!handled) {
+                g_phonetic.commit();
+                if (vk == VK_BACK) {
+                    TrackWordEdit(1, {});
+                } else {
+                    ResetWord();
+                }
+                return false;
+            }
+
+            bijoy::platform::windows::SendTextBatch(g_phoneticEdit.backspaces, g_phoneticEdit.text);
+            TrackWordEdit(g_phoneticEdit.backspaces, g_phoneticEdit.text);
+            return true;
+        }
+
         bool ProcessHookedEvent(const KBDLLHOOKSTRUCT_LOCAL* hs) {
+            if (hs->dwExtraInfo == bijoy::platform::windows::kInjectedInputTag) {
+                return false;
+            }
+
             const bool ctrl = IsKeyPressed(VK_CONTROL);
             const bool alt = IsKeyPressed(VK_MENU);
             const bool shift = IsKeyPressed(VK_SHIFT);
@@ -40,6 +194,9 @@ namespace bijoy::core {
                 if (ctrl == layout->shortcut.ctrl && alt == layout->shortcut.alt &&
                     shift == layout->shortcut.shift && static_cast<DWORD>(layout->shortcut.keyCode) == hs->vkCode) {
                     const HWND foregroundWindow = GetForegroundWindow();
+                    g_optionLayer.reset();
+                    g_phonetic.commit();
+                    ResetWord();
                     if (g_comLayoutSelectedIndex == i + 1) {
                         RemoveWindowLayoutBinding(foregroundWindow);
                         SetCurrentLayout(-1);
@@ -52,24 +209,63 @@ namespace bijoy::core {
             }
 
             Layout* activeLayout = GetCurrentLayout();
+            const HWND focus = activeLayout ? FocusedControl(GetForegroundWindow()) : nullptr;
+            if (focus && ClusterBackspaceActive()) {
+                TrackHistoryFocus(focus);
+            }
+
+            if (ctrl && !alt && !shift && activeLayout &&
+                AcceptSuggestion(hs->vkCode, focus)) {
+                return true;
+            }
+
+            if (IsTransparentKey(hs->vkCode)) {
+                return false;
+            }
+
             if (!ctrl && !alt && activeLayout) {
-                auto it = activeLayout->key.find(static_cast<int>(hs->vkCode));
-                if (it != activeLayout->key.end()) {
-                    const std::wstring& output = shift ? it->second.shift : it->second.normal;
-                    if (!output.empty()) {
-                        for (wchar_t c : output) {
-                            bijoy::platform::windows::DoKeyboard(
-                                    KEYEVENTF_UNICODE,
-                                    static_cast<int>(c));
-                            bijoy::platform::windows::DoKeyboard(
-                                    KEYEVENTF_KEYUP | KEYEVENTF_UNICODE,
-                                    static_cast<int>(c));
-                        }
+                if (activeLayout->phonetic) {
+                    return ProcessPhoneticKey(hs->vkCode, shift, focus);
+                }
+
+                if (ClusterBackspaceActive() && hs->vkCode == VK_BACK) {
+                    // A single-unit cluster is removed by the original keystroke.
+                    const size_t clusterLength = PopInjectedCluster(focus);
+                    if (clusterLength > 1) {
+                        bijoy::platform::windows::SendTextBatch(clusterLength, {});
+                        TrackWordEdit(clusterLength, {});
                         return true;
                     }
+                    TrackWordEdit(1, {});
+                    return false;
+                }
+
+                const KeyDispatchTable& table = activeLayout->dispatch;
+                const KeyDispatchEntry& entry = table.lookup(g_optionLayer.resolve(shift), static_cast<int>(hs->vkCode));
+                if (g_optionLayer.apply(entry.action)) {
+                    return true;
+                }
+
+                if (entry.action == KeyAction::Output) {
+                    const std::wstring_view output = table.text(entry);
+                    bijoy::platform::windows::SendTextBatch(0, output);
+                    if (ClusterBackspaceActive()) {
+                        RecordInjectedOutput(focus, output);
+                    }
+                    TrackWordEdit(0, output);
+                    return true;
+                }
+
+                if (ClusterBackspaceActive()) {
+                    ClearInjectedOutput(focus);
+                }
+                if (hs->vkCode == VK_BACK) {
+                    TrackWordEdit(1, {});
+                    return false;
                 }
             }
 
+            ResetWord();
             return false;
         }
 
@@ -83,14 +279,39 @@ namespace bijoy::core {
             return CallNextHookEx(g_hook, nCode, wParam, lParam);
         }
 
+        LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
+            if (nCode == HC_ACTION && g_layoutsReady) {
+                switch (wParam) {
+                    case WM_LBUTTONDOWN:
+                    case WM_RBUTTONDOWN:
+                    case WM_MBUTTONDOWN:
+                    case WM_XBUTTONDOWN:
+                        ForgetCaretContext();
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return CallNextHookEx(g_mouseHook, nCode, wParam, lParam);
+        }
+
     } // namespace
 
     bool InstallKeyboardHook(HINSTANCE hInstance) {
         g_hook = SetWindowsHookExW(13, LowLevelKeyboardProc, hInstance, 0);
-        return g_hook != nullptr;
+        if (!g_hook) {
+            return false;
+        }
+        // Optional: without it cluster Backspace stays off.
+        g_mouseHook = SetWindowsHookExW(14, LowLevelMouseProc, hInstance, 0);
+        return true;
     }
 
     void UninstallKeyboardHook() {
+        if (g_mouseHook) {
+            UnhookWindowsHookEx(g_mouseHook);
+            g_mouseHook = nullptr;
+        }
         if (g_hook) {
             UnhookWindowsHookEx(g_hook);
             g_hook = nullptr;
@@ -101,4 +322,8 @@ namespace bijoy::core {
         g_layoutsReady = ready;
     }
 
+    void SetClusterBackspace(bool enabled) {
+        g_clusterBackspace = enabled;
+    }
+
 } // namespace bijoy::core
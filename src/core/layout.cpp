@@ -50,10 +50,12 @@ namespace bijoy::core {
     void Layout::clear() {
         key.clear();
         juk.clear();
+        dispatch.clear();
     }
 
     bool Layout::loadFromFile(const wchar_t* filePath) {
         path = filePath;
+        phonetic = false;
         clear();
 
         FILE* file = _wfopen(filePath, L"r, ccs=UTF-8");
@@ -91,6 +93,8 @@ namespace bijoy::core {
                 }
             } else if (line.find(L"<IconName>") != std::wstring::npos) {
                 iconName = GetTagContent(line, L"IconName");
+            } else if (line.find(L"<Engine>") != std::wstring::npos) {
+                phonetic = GetTagContent(line, L"Engine") == L"Phonetic";
             } else if (line.find(L"<Key ") != std::wstring::npos) {
                 int keyCode = 0;
                 std::wstring normalOpt;
@@ -133,6 +137,7 @@ namespace bijoy::core {
         }
 
         fclose(file);
+        dispatch.compile(key);
         return !name.empty();
     }
 
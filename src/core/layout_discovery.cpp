@@ -1,6 +1,9 @@
 #include "core/layout_discovery.h"
+#include "core/startup_trace.h"
+#include "core/task_executor.h"
 #include "utils/system_utils.h"
 
+#include <shlobj.h>
 #include <shlwapi.h>
 #include <windows.h>
 
@@ -19,6 +22,19 @@ namespace bijoy::core {
         return bijoy::utils::EnsureTrailingBackslash(path);
     }
 
+    std::wstring GetUserDataDirectory() {
+        wchar_t localAppData[MAX_PATH] = {};
+        if (FAILED(SHGetFolderPathW(nullptr, CSIDL_LOCAL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, localAppData))) {
+            return {};
+        }
+
+        std::wstring directory = std::wstring(localAppData) + L"\\OmorEkushe";
+        if (!CreateDirectoryW(directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) {
+            return {};
+        }
+        return directory;
+    }
+
     namespace {
 
         void FindXmlRecursive(const std::wstring& dir, std::vector<std::wstring>& out) {
@@ -31,7 +47,8 @@ namespace bijoy::core {
 
             do {
                 if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0U) {
-                    if (wcscmp(findData.cFileName, L".") != 0 && wcscmp(findData.cFileName, L"..") != 0) {
+                    // Skips ".", ".." and hidden folders such as the layout sync staging area.
+                    if (findData.cFileName[0] != L'.') {
                         FindXmlRecursive(dir + findData.cFileName + L"\\", out);
                     }
                 } else if (wcsstr(findData.cFileName, L".xml") != nullptr) {
@@ -42,33 +59,51 @@ namespace bijoy::core {
             FindClose(handle);
         }
 
+        std::wstring FindLayoutFiles(const std::wstring& appDir, std::vector<std::wstring>& files) {
+            const std::wstring layoutDirs[] = {
+                    appDir + L"Layouts\\",
+                    appDir + L"..\\data\\layout\\",
+                    appDir + L"..\\data\\Layouts\\"
+            };
+
+            for (const auto& layoutDir : layoutDirs) {
+                FindXmlRecursive(layoutDir, files);
+                if (!files.empty()) {
+                    return layoutDir;
+                }
+            }
+            return layoutDirs[0];
+        }
+
     } // namespace
 
-    bool FindLayouts(std::vector<Layout>& layouts, const std::wstring& appDir) {
-        const std::wstring layoutDirs[] = {
-                appDir + L"Layouts\\",
-                appDir + L"..\\data\\layout\\",
-                appDir + L"..\\data\\Layouts\\"
-        };
+    std::wstring FindLayoutDirectory(const std::wstring& appDir) {
+        std::vector<std::wstring> files;
+        return FindLayoutFiles(appDir, files);
+    }
 
+    bool FindLayouts(std::vector<Layout>& layouts, const std::wstring& appDir) {
         std::vector<std::wstring> files;
-        for (const auto& layoutDir : layoutDirs) {
-            FindXmlRecursive(layoutDir, files);
-            if (!files.empty()) {
-                break;
-            }
-        }
+        FindLayoutFiles(appDir, files);
 
         if (files.empty()) {
             return false;
         }
 
+        // Files parse independently, so they load in parallel and are then
+        // kept in discovery order.
+        std::vector<Layout> loaded(files.size());
+        std::vector<char> ok(files.size(), 0);
+        ParallelFor(files.size(), [&](size_t i) {
+            TraceSpan span("LoadLayout");
+            ok[i] = loaded[i].loadFromFile(files[i].c_str()) ? 1 : 0;
+        });
+
         layouts.clear();
         for (size_t i = 0; i < files.size(); ++i) {
-            Layout layout;
-            if (layout.loadFromFile(files[i].c_str())) {
-                layout.id = static_cast<int>(i);
-                layouts.push_back(std::move(layout));
+            if (ok[i]) {
+                loaded[i].id = static_cast<int>(i);
+                layouts.push_back(std::move(loaded[i]));
             }
         }
         return !layouts.empty();
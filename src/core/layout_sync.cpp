@@ -0,0 +1,375 @@
+#include "core/layout_sync.h"
+
+#include "core/file_io.h"
+#include "core/task_executor.h"
+
+#include "NetClient.h"
+#include "NetClientJson.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace bijoy::core {
+
+    namespace {
+
+#ifdef _WIN32
+        constexpr wchar_t kSeparator = L'\\';
+#else
+        constexpr wchar_t kSeparator = L'/';
+#endif
+
+        // Downloads land here first. It lives inside the layout directory so
+        // installing is a rename on the same volume.
+        constexpr wchar_t kStagingDirectory[] = L".sync";
+        // Appended to a staged path to keep the version it replaces.
+        constexpr wchar_t kBackupSuffix[] = L".bak";
+
+        struct Pack {
+            std::wstring relativePath;  // native separators
+            std::string url;
+            std::string sha256;         // lowercase hex
+            std::vector<std::pair<std::string, std::string>> deltas;   // base sha256, url
+        };
+
+        struct ChangedPack {
+            const Pack* pack;
+            std::string localSha256;    // empty when there is no local copy
+        };
+
+        struct SyncTask {
+            std::mutex mutex;
+            TaskHandle task;
+        };
+
+        SyncTask g_sync;
+
+        bool IsSha256(std::string_view hex) {
+            return hex.size() == 64 && std::all_of(hex.begin(), hex.end(), [](char c) {
+                return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+            });
+        }
+
+        std::string ToLower(std::string_view text) {
+            std::string out(text);
+            for (char& c : out) {
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+            }
+            return out;
+        }
+
+        // Accepts only plain relative paths, so a manifest can never write
+        // outside the layout directory or into the staging area.
+        bool ToLocalPath(std::string_view path, std::wstring& out) {
+            out.clear();
+            size_t start = 0;
+            while (start <= path.size()) {
+                size_t end = path.find_first_of("/\\", start);
+                if (end == std::string_view::npos) end = path.size();
+                const std::string_view part = path.substr(start, end - start);
+                if (part.empty() || part == "." || part == ".." || part.find(':') != std::string_view::npos) {
+                    return false;
+                }
+                if (out.empty() && Utf8ToWide(part) == kStagingDirectory) {
+                    return false;
+                }
+                if (!out.empty()) out += kSeparator;
+                out += Utf8ToWide(part);
+                start = end + 1;
+            }
+            return !out.empty();
+        }
+
+        // Resolves a pack URL the way a browser resolves a link on the
+        // manifest's page: absolute, host-relative or directory-relative.
+        std::string ResolveUrl(const std::string& base, std::string_view ref) {
+            const size_t scheme = base.find("://");
+            if (ref.find("://") != std::string_view::npos || scheme == std::string::npos) {
+                return std::string(ref);
+            }
+            const size_t pathStart = base.find('/', scheme + 3);
+            if (!ref.empty() && ref[0] == '/') {
+                return base.substr(0, pathStart) + std::string(ref);
+            }
+            if (pathStart == std::string::npos) {
+                return base + "/" + std::string(ref);
+            }
+            std::string directory = base.substr(0, base.find_first_of("?#"));
+            directory.erase(directory.rfind('/') + 1);
+            for (;;) {
+                if (ref.substr(0, 2) == "./") {
+                    ref.remove_prefix(2);
+                } else if (ref.substr(0, 3) == "../") {
+                    ref.remove_prefix(3);
+                    if (directory.size() > pathStart + 1) {
+                        directory.erase(directory.rfind('/', directory.size() - 2) + 1);
+                    }
+                } else {
+                    break;
+                }
+            }
+            return directory + std::string(ref);
+        }
+
+        std::wstring ParentOf(const std::wstring& path) {
+            return path.substr(0, path.rfind(kSeparator) + 1);
+        }
+
+        bool ParseManifest(const std::string& text, const std::string& manifestUrl, std::vector<Pack>& packs,
+                           std::wstring& error) {
+            NetClient::json::Document doc(text);
+            const NetClient::json::Value list = doc.root()["packs"];
+            bool valid = list.type() == NetClient::json::Type::Array;
+            if (valid) {
+                list.for_each([&](NetClient::json::Value entry) {
+                    Pack pack;
+                    std::string_view path;
+                    std::string_view sha256;
+                    if (!entry["path"].get(path) || !ToLocalPath(path, pack.relativePath) ||
+                        !entry["sha256"].get(sha256) || !IsSha256(sha256)) {
+                        valid = false;
+                        return false;
+                    }
+                    pack.url = ResolveUrl(manifestUrl, entry["url"].as_string(path));
+                    pack.sha256 = ToLower(sha256);
+                    entry["deltas"].for_each([&](NetClient::json::Value delta) {
+                        std::string_view from;
+                        std::string_view url;
+                        if (!delta["from"].get(from) || !IsSha256(from) || !delta["url"].get(url)) {
+                            valid = false;
+                            return false;
+                        }
+                        pack.deltas.emplace_back(ToLower(from), ResolveUrl(manifestUrl, url));
+                        return true;
+                    });
+                    if (!valid) {
+                        return false;
+                    }
+                    packs.push_back(std::move(pack));
+                    return true;
+                });
+            }
+            if (!valid || !doc.error().empty()) {
+                error = L"The update manifest is malformed";
+                if (!doc.error().empty()) error += L" (" + Utf8ToWide(doc.error()) + L")";
+                error += L".";
+                return false;
+            }
+            return true;
+        }
+
+        // A pack renamed into the layout directory by the install step.
+        struct InstalledPack {
+            std::wstring target;
+            std::wstring staged;
+            std::wstring backup;        // the replaced version; empty for a new pack
+        };
+
+        // Puts the previous versions back after a failed install, newest
+        // first, and returns the verified downloads to the staging area for
+        // the next sync. Packs that cannot be undone are added to stuck.
+        void RollBack(const std::vector<InstalledPack>& done, std::vector<std::wstring>& stuck) {
+            for (auto step = done.rbegin(); step != done.rend(); ++step) {
+                if (!MoveFileReplacing(step->target, step->staged)) {
+                    stuck.push_back(step->target);
+                    continue;
+                }
+                if (!step->backup.empty() && !MoveFileReplacing(step->backup, step->target)) {
+                    // Better the new version than no file at all.
+                    if (MoveFileReplacing(step->staged, step->target)) stuck.push_back(step->target);
+                }
+            }
+        }
+
+        std::wstring DescribeFailure(const NetClient::Response& response) {
+            if (response.status_code == 0) {
+                return Utf8ToWide(response.error);
+            }
+            if (!response.error.empty()) {
+                return Utf8ToWide(response.error);
+            }
+            return L"HTTP " + std::to_wstring(response.status_code);
+        }
+
+    } // namespace
+
+    LayoutSyncResult SyncLayouts(const LayoutSyncOptions& options, const CancellationToken& token) {
+        LayoutSyncResult result;
+
+        NetClient::SessionOptions config;
+        config.max_connections_per_host = std::max(1, options.maxParallelDownloads);
+        config.cache = !options.cacheDirectory.empty();
+        config.cache_directory = WideToUtf8(options.cacheDirectory);
+        config.retry.max_attempts = 3;
+        NetClient::Session session(config);
+
+        const NetClient::Response manifest = session.get(options.manifestUrl);
+        result.bytesDownloaded += manifest.bytes_received;
+        if (!manifest.ok()) {
+            result.error = L"Could not fetch the update manifest (" + DescribeFailure(manifest) + L").";
+            return result;
+        }
+
+        std::vector<Pack> packs;
+        if (!ParseManifest(manifest.text, options.manifestUrl, packs, result.error)) {
+            return result;
+        }
+        result.packCount = static_cast<int>(packs.size());
+
+        std::vector<ChangedPack> changed;
+        for (const Pack& pack : packs) {
+            std::string localSha256 = NetClient::file_sha256(WideToUtf8(options.layoutDirectory + pack.relativePath));
+            if (localSha256 != pack.sha256) {
+                changed.push_back({&pack, std::move(localSha256)});
+            }
+        }
+        if (changed.empty()) {
+            result.ok = true;
+            return result;
+        }
+        if (token.cancelled()) {
+            result.error = L"The update was cancelled.";
+            return result;
+        }
+
+        const std::wstring staging = options.layoutDirectory + kStagingDirectory + kSeparator;
+        std::mutex resultMutex;
+        bool failed = false;
+
+        NetClient::SchedulerOptions schedulerOptions;
+        schedulerOptions.max_active = std::max(1, options.maxParallelDownloads);
+        schedulerOptions.max_per_host = schedulerOptions.max_active;
+        schedulerOptions.max_bytes_per_second = options.maxBytesPerSecond;
+
+        // The first failure or a cancellation stops the rest.
+        NetClient::DownloadScheduler* scheduler = nullptr;
+        NetClient::DownloadScheduler downloads(session, schedulerOptions, [&](const NetClient::DownloadEvent& event) {
+            if (event.result) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                result.bytesDownloaded += event.result->response.bytes_received;
+                if (event.state == NetClient::DownloadState::Failed && !failed && !token.cancelled()) {
+                    failed = true;
+                    result.error = L"Could not download " + Utf8ToWide(event.download->path).substr(staging.size()) +
+                                   L" (" + DescribeFailure(event.result->response) + L").";
+                }
+            }
+            if (token.cancelled() || event.state == NetClient::DownloadState::Failed) {
+                scheduler->cancel_all();
+            }
+        });
+        scheduler = &downloads;
+
+        for (const ChangedPack& entry : changed) {
+            const Pack& pack = *entry.pack;
+            const std::wstring staged = staging + pack.relativePath;
+
+            NetClient::ScheduledDownload download;
+            download.url = pack.url;
+            download.path = WideToUtf8(staged);
+            // A pack verified by an interrupted sync is not fetched again.
+            if (NetClient::file_sha256(download.path) == pack.sha256) {
+                continue;
+            }
+            if (!EnsureDirectory(ParentOf(staged))) {
+                result.error = L"Could not create a folder for " + pack.relativePath + L".";
+                downloads.cancel_all();
+                return result;
+            }
+
+            download.priority = options.layoutDirectory + pack.relativePath == options.priorityPath ? 1 : 0;
+            download.options.expected_sha256 = pack.sha256;
+            download.options.on_progress = [token](uint64_t, uint64_t) { return !token.cancelled(); };
+
+            // A delta against the local copy costs about as much as the
+            // change; the full pack is the fallback.
+            const auto delta = std::find_if(pack.deltas.begin(), pack.deltas.end(), [&](const auto& candidate) {
+                return candidate.first == entry.localSha256;
+            });
+            if (delta != pack.deltas.end()) {
+                download.delta_url = delta->second;
+                download.base_path = WideToUtf8(options.layoutDirectory + pack.relativePath);
+            }
+            downloads.add(download);
+        }
+        downloads.wait();
+
+        // Verified downloads stay staged for the next attempt.
+        if (token.cancelled()) {
+            result.error = L"The update was cancelled.";
+            return result;
+        }
+        if (failed) {
+            return result;
+        }
+
+        std::vector<InstalledPack> done;
+        for (const ChangedPack& entry : changed) {
+            const Pack* pack = entry.pack;
+            InstalledPack step{options.layoutDirectory + pack->relativePath, staging + pack->relativePath, {}};
+            if (!EnsureDirectory(ParentOf(step.target))) {
+                result.error = L"Could not install " + pack->relativePath + L".";
+                break;
+            }
+            // The old version waits in the staging area until every pack is
+            // in place. A pack with no local copy has nothing to keep.
+            step.backup = step.staged + kBackupSuffix;
+            if (!MoveFileReplacing(step.target, step.backup)) {
+                if (!entry.localSha256.empty()) {
+                    result.error = L"Could not install " + pack->relativePath + L".";
+                    break;
+                }
+                step.backup.clear();
+            }
+            if (!MoveFileReplacing(step.staged, step.target)) {
+                if (!step.backup.empty()) MoveFileReplacing(step.backup, step.target);
+                result.error = L"Could not install " + pack->relativePath + L".";
+                break;
+            }
+            done.push_back(std::move(step));
+        }
+
+        if (!result.error.empty()) {
+            RollBack(done, result.installed);
+            if (!result.installed.empty()) {
+                result.error += L" Some files could not be restored and keep their new version.";
+            }
+            return result;
+        }
+        for (const InstalledPack& step : done) {
+            if (!step.backup.empty()) RemoveFile(step.backup);
+            result.installed.push_back(step.target);
+        }
+        result.ok = true;
+        return result;
+    }
+
+    bool StartLayoutSync(const LayoutSyncOptions& options, LayoutSyncCallback onDone) {
+        std::lock_guard<std::mutex> lock(g_sync.mutex);
+        if (!g_sync.task.isDone()) {
+            return false;
+        }
+
+        // Mostly waits on the network, so it queues behind anything the user
+        // is waiting for.
+        g_sync.task = SubmitTask(
+                [options, onDone = std::move(onDone)](const CancellationToken& token) {
+                    const LayoutSyncResult result = SyncLayouts(options, token);
+                    if (onDone) {
+                        onDone(result);
+                    }
+                },
+                TaskPriority::Background);
+        return true;
+    }
+
+    void StopLayoutSync() {
+        TaskHandle task;
+        {
+            std::lock_guard<std::mutex> lock(g_sync.mutex);
+            task = g_sync.task;
+        }
+        task.cancel();
+        task.wait();
+    }
+
+} // namespace bijoy::core
@@ -0,0 +1,388 @@
+#include "core/learning_store.h"
+
+#include "core/file_io.h"
+#include "core/spsc_ring.h"
+#include "core/suggestion_index.h"
+#include "core/suggestion_service.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bijoy::core {
+
+    namespace {
+
+        constexpr char kMagic[4] = {'O', 'E', 'L', 'G'};
+        constexpr uint32_t kVersion = 1;
+        constexpr uint32_t kNoSlot = UINT32_MAX;
+
+        // Queued words reach the log within this interval.
+        constexpr auto kFlushInterval = std::chrono::seconds(2);
+        // Learned words trigger a rebuild of the merged index this often.
+        constexpr size_t kCompactAfter = 200;
+        // A word used this many times ranks with the base index's most
+        // frequent word.
+        constexpr uint32_t kLearnedBoostDivisor = 256;
+        // While the store is full, surviving counts keep this fraction (in
+        // sixteenths) per compaction, so stale favourites slowly give way.
+        constexpr uint64_t kAgingSixteenths = 15;
+
+#ifdef _WIN32
+        constexpr wchar_t kSeparator = L'\\';
+#else
+        constexpr wchar_t kSeparator = L'/';
+#endif
+
+        struct LogHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t activeSlot;
+            uint32_t reserved;
+        };
+
+        static_assert(sizeof(LogHeader) == 16, "log header layout");
+
+        struct WordSlot {
+            std::array<wchar_t, kMaxSuggestionPrefix> text;
+            size_t length;
+        };
+
+        struct LearnedCount {
+            uint32_t count = 0;
+            // Position of the word's latest record; the log is kept in this
+            // order, so replaying it restores recency.
+            uint64_t lastSeen = 0;
+        };
+
+        using WordCounts = std::unordered_map<std::wstring, LearnedCount>;
+
+        struct StoreState {
+            std::wstring logPath;
+            std::wstring slotPaths[2];
+            std::wstring baseIndexPath;
+            LearnedIndexCallback onCompacted;
+
+            // Owned by the worker once it starts.
+            WordCounts counts;
+            uint64_t clock = 0;
+            uint32_t activeSlot = kNoSlot;
+            size_t sinceCompaction = 0;
+            bool needsCompaction = false;
+            FILE* log = nullptr;
+
+            SpscRing<WordSlot, 256> queue;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::atomic<bool> stopping{false};
+            std::wstring learnedIndexPath;
+            std::thread worker;
+        };
+
+        std::unique_ptr<StoreState> g_store;
+
+        uint32_t Checksum(const char* data, size_t size) {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+            }
+            return hash;
+        }
+
+        template <typename T>
+        void AppendPod(std::string& out, const T& value) {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        // Record: u16 length, length UTF-16 units, u32 count, u32 checksum of
+        // the preceding record bytes.
+        void AppendRecord(std::string& out, std::wstring_view word, uint32_t count) {
+            const size_t start = out.size();
+            AppendPod(out, static_cast<uint16_t>(word.size()));
+            for (wchar_t ch : word) {
+                AppendPod(out, static_cast<uint16_t>(ch));
+            }
+            AppendPod(out, count);
+            AppendPod(out, Checksum(out.data() + start, out.size() - start));
+        }
+
+        // Replays records up to the first torn or corrupt one, which can only
+        // be the tail of an interrupted append. Returns the record count.
+        size_t ReplayLog(const std::string& bytes, WordCounts& counts, uint64_t& clock, uint32_t& activeSlot) {
+            LogHeader header = {};
+            if (bytes.size() < sizeof(header)) {
+                return 0;
+            }
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+                return 0;
+            }
+            activeSlot = header.activeSlot <= 1 ? header.activeSlot : kNoSlot;
+
+            size_t records = 0;
+            size_t offset = sizeof(header);
+            while (offset + sizeof(uint16_t) <= bytes.size()) {
+                uint16_t length = 0;
+                std::memcpy(&length, bytes.data() + offset, sizeof(length));
+                const size_t recordSize = sizeof(uint16_t) * (1 + length) + sizeof(uint32_t) * 2;
+                if (length == 0 || offset + recordSize > bytes.size()) {
+                    break;
+                }
+
+                uint32_t count = 0;
+                uint32_t checksum = 0;
+                const char* tail = bytes.data() + offset + sizeof(uint16_t) * (1 + length);
+                std::memcpy(&count, tail, sizeof(count));
+                std::memcpy(&checksum, tail + sizeof(count), sizeof(checksum));
+                if (checksum != Checksum(bytes.data() + offset, recordSize - sizeof(checksum))) {
+                    break;
+                }
+
+                std::wstring word(length, L'\0');
+                for (uint16_t i = 0; i < length; ++i) {
+                    uint16_t unit = 0;
+                    std::memcpy(&unit, bytes.data() + offset + sizeof(uint16_t) * (1 + i), sizeof(unit));
+                    word[i] = static_cast<wchar_t>(unit);
+                }
+                LearnedCount& entry = counts[word];
+                entry.count = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(entry.count) + count, UINT32_MAX));
+                entry.lastSeen = ++clock;
+
+                offset += recordSize;
+                ++records;
+            }
+            return records;
+        }
+
+        // Forgets only the overflow, least used first and oldest among equal
+        // counts, then ages the survivors without letting any reach zero.
+        void Decay(WordCounts& counts) {
+            if (counts.size() <= kMaxLearnedWords) {
+                return;
+            }
+
+            std::vector<WordCounts::iterator> entries;
+            entries.reserve(counts.size());
+            for (auto it = counts.begin(); it != counts.end(); ++it) {
+                entries.push_back(it);
+            }
+            const size_t overflow = counts.size() - kMaxLearnedWords;
+            std::nth_element(entries.begin(), entries.begin() + overflow, entries.end(),
+                             [](WordCounts::iterator a, WordCounts::iterator b) {
+                                 if (a->second.count != b->second.count) {
+                                     return a->second.count < b->second.count;
+                                 }
+                                 return a->second.lastSeen < b->second.lastSeen;
+                             });
+            for (size_t i = 0; i < overflow; ++i) {
+                counts.erase(entries[i]);
+            }
+
+            for (auto& [word, entry] : counts) {
+                entry.count = static_cast<uint32_t>((entry.count * kAgingSixteenths + 15) / 16);
+            }
+        }
+
+        bool FileExists(const std::wstring& path) {
+            FILE* file = OpenStdioFile(path, L"rb");
+            if (!file) {
+                return false;
+            }
+            fclose(file);
+            return true;
+        }
+
+        // Atomically replaces the log with one record per word, which also
+        // drops any torn tail, and reopens it for appending.
+        bool RewriteLog(StoreState& state, uint32_t activeSlot) {
+            if (state.log) {
+                fclose(state.log);
+                state.log = nullptr;
+            }
+
+            LogHeader header = {};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.activeSlot = activeSlot;
+
+            std::vector<const WordCounts::value_type*> entries;
+            entries.reserve(state.counts.size());
+            for (const auto& entry : state.counts) {
+                entries.push_back(&entry);
+            }
+            std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+                return a->second.lastSeen < b->second.lastSeen;
+            });
+
+            std::string bytes;
+            AppendPod(bytes, header);
+            for (const auto* entry : entries) {
+                AppendRecord(bytes, entry->first, entry->second.count);
+            }
+
+            const bool written = WriteFileAtomic(state.logPath, bytes);
+            state.log = OpenStdioFile(state.logPath, L"ab");
+            return written && state.log != nullptr;
+        }
+
+        void DrainQueue(StoreState& state) {
+            std::string bytes;
+            WordSlot slot = {};
+            while (state.queue.tryPop(slot)) {
+                const std::wstring_view word(slot.text.data(), slot.length);
+                AppendRecord(bytes, word, 1);
+                LearnedCount& entry = state.counts[std::wstring(word)];
+                entry.count = entry.count < UINT32_MAX ? entry.count + 1 : entry.count;
+                entry.lastSeen = ++state.clock;
+                ++state.sinceCompaction;
+            }
+
+            if (!bytes.empty() && state.log) {
+                fwrite(bytes.data(), 1, bytes.size(), state.log);
+                fflush(state.log);
+            }
+        }
+
+        void Compact(StoreState& state) {
+            // A failed rebuild waits for the next batch of words to retry.
+            state.sinceCompaction = 0;
+            state.needsCompaction = false;
+            Decay(state.counts);
+
+            std::vector<WordFrequency> words;
+            uint32_t boost = 1;
+            SuggestionIndex base;
+            if (base.open(state.baseIndexPath)) {
+                base.collect(words);
+                boost = std::max<uint32_t>(1, base.topFrequency() / kLearnedBoostDivisor);
+                base.close();
+            }
+            for (const auto& [word, entry] : state.counts) {
+                const uint64_t weighted = static_cast<uint64_t>(entry.count) * boost;
+                words.push_back({word, static_cast<uint32_t>(std::min<uint64_t>(weighted, UINT32_MAX))});
+            }
+
+            // The previous index may still be mapped, so alternate between two
+            // files rather than replacing the one in use.
+            const uint32_t slot = state.activeSlot == 0 ? 1 : 0;
+            if (!WriteSuggestionIndex(std::move(words), state.slotPaths[slot]) || !RewriteLog(state, slot)) {
+                return;
+            }
+
+            state.activeSlot = slot;
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.learnedIndexPath = state.slotPaths[slot];
+            }
+            if (state.onCompacted) {
+                state.onCompacted(state.slotPaths[slot]);
+            }
+        }
+
+        void RunWorker(StoreState& state) {
+            while (true) {
+                // Words replayed at startup are merged without waiting.
+                if (!state.needsCompaction) {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.wake.wait_for(lock, kFlushInterval, [&state] { return state.stopping.load(); });
+                }
+
+                DrainQueue(state);
+                if (state.stopping.load()) {
+                    return;
+                }
+                if (state.needsCompaction || state.sinceCompaction >= kCompactAfter) {
+                    Compact(state);
+                }
+            }
+        }
+
+    } // namespace
+
+    bool StartLearningStore(const std::wstring& directory, const std::wstring& baseIndexPath,
+                            LearnedIndexCallback onCompacted) {
+        StopLearningStore();
+
+        std::wstring prefix = directory;
+        if (!prefix.empty() && prefix.back() != kSeparator) {
+            prefix += kSeparator;
+        }
+
+        auto state = std::make_unique<StoreState>();
+        state->logPath = prefix + L"Learned.log";
+        state->slotPaths[0] = prefix + L"Learned.0.bin";
+        state->slotPaths[1] = prefix + L"Learned.1.bin";
+        state->baseIndexPath = baseIndexPath;
+        state->onCompacted = std::move(onCompacted);
+
+        std::string bytes;
+        size_t records = 0;
+        if (ReadFileBytes(state->logPath, bytes)) {
+            records = ReplayLog(bytes, state->counts, state->clock, state->activeSlot);
+        }
+        if (state->activeSlot != kNoSlot && !FileExists(state->slotPaths[state->activeSlot])) {
+            state->activeSlot = kNoSlot;
+        }
+
+        // Appended increments, or words without a built index, are merged on
+        // the worker's first pass.
+        state->needsCompaction = records > state->counts.size() ||
+                                 (state->activeSlot == kNoSlot && !state->counts.empty());
+        Decay(state->counts);
+        if (!RewriteLog(*state, state->activeSlot)) {
+            if (state->log) {
+                fclose(state->log);
+            }
+            return false;
+        }
+
+        if (state->activeSlot != kNoSlot) {
+            state->learnedIndexPath = state->slotPaths[state->activeSlot];
+        }
+        state->worker = std::thread(RunWorker, std::ref(*state));
+        g_store = std::move(state);
+        return true;
+    }
+
+    void StopLearningStore() {
+        if (!g_store) {
+            return;
+        }
+        g_store->stopping.store(true);
+        g_store->wake.notify_one();
+        g_store->worker.join();
+        if (g_store->log) {
+            FlushToDisk(g_store->log);
+            fclose(g_store->log);
+        }
+        g_store.reset();
+    }
+
+    std::wstring GetLearnedIndexPath() {
+        if (!g_store) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(g_store->mutex);
+        return g_store->learnedIndexPath;
+    }
+
+    void RecordLearnedWord(std::wstring_view word) {
+        if (!g_store || word.empty() || word.size() > kMaxSuggestionPrefix) {
+            return;
+        }
+
+        WordSlot slot;
+        word.copy(slot.text.data(), word.size());
+        slot.length = word.size();
+        g_store->queue.tryPush(slot);
+    }
+
+} // namespace bijoy::core
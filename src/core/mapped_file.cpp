@@ -0,0 +1,117 @@
+#include "core/mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bijoy::core {
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            mapping_ = std::exchange(other.mapping_, nullptr);
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const std::wstring& path) {
+        close();
+
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize = {};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        // The mapping keeps the file referenced; the file handle is not needed.
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = static_cast<size_t>(fileSize.QuadPart);
+        mapping_ = mapping;
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(static_cast<HANDLE>(mapping_));
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mapping_ = nullptr;
+    }
+#else
+    bool MappedFile::open(const std::wstring& path) {
+        close();
+
+        const std::string narrowPath(path.begin(), path.end());
+        const int fd = ::open(narrowPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (data_) {
+            munmap(const_cast<unsigned char*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mapping_ = nullptr;
+    }
+#endif
+
+} // namespace bijoy::core
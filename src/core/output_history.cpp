@@ -0,0 +1,105 @@
+#include "core/output_history.h"
+
+#include "core/bengali_grapheme.h"
+
+#include <array>
+#include <cstdint>
+
+namespace bijoy::core {
+
+    namespace {
+
+        constexpr size_t kWindowSlots = 8;
+        constexpr size_t kClusterCapacity = 32;
+
+        struct WindowHistory {
+            OutputTarget target = nullptr;
+            uint32_t lastUse = 0;
+            uint8_t head = 0;
+            uint8_t count = 0;
+            std::array<uint8_t, kClusterCapacity> lengths{};
+            BengaliGraphemeSegmenter segmenter;
+
+            void clear() {
+                head = 0;
+                count = 0;
+                segmenter.reset();
+            }
+        };
+
+        std::array<WindowHistory, kWindowSlots> g_histories;
+        uint32_t g_useClock = 0;
+
+        WindowHistory* FindHistory(OutputTarget target) {
+            for (auto& history : g_histories) {
+                if (history.target == target) {
+                    history.lastUse = ++g_useClock;
+                    return &history;
+                }
+            }
+            return nullptr;
+        }
+
+        WindowHistory& AcquireHistory(OutputTarget target) {
+            if (WindowHistory* existing = FindHistory(target)) {
+                return *existing;
+            }
+
+            WindowHistory* victim = &g_histories[0];
+            for (auto& history : g_histories) {
+                if (history.lastUse < victim->lastUse) {
+                    victim = &history;
+                }
+            }
+            victim->clear();
+            victim->target = target;
+            victim->lastUse = ++g_useClock;
+            return *victim;
+        }
+
+    } // namespace
+
+    void RecordInjectedOutput(OutputTarget target, std::wstring_view output) {
+        WindowHistory& history = AcquireHistory(target);
+        for (wchar_t c : output) {
+            const bool boundary = history.segmenter.feed(c);
+            if (boundary || history.count == 0) {
+                history.head = static_cast<uint8_t>((history.head + 1) % kClusterCapacity);
+                history.lengths[history.head] = 1;
+                if (history.count < kClusterCapacity) {
+                    ++history.count;
+                }
+            } else if (history.lengths[history.head] < UINT8_MAX) {
+                ++history.lengths[history.head];
+            }
+        }
+    }
+
+    size_t PopInjectedCluster(OutputTarget target) {
+        WindowHistory* history = FindHistory(target);
+        if (!history || history->count == 0) {
+            return 0;
+        }
+
+        const size_t length = history->lengths[history->head];
+        history->head = static_cast<uint8_t>((history->head + kClusterCapacity - 1) % kClusterCapacity);
+        --history->count;
+        // The state at the end of the previous cluster is not kept, so the next
+        // keystroke always opens a fresh cluster.
+        history->segmenter.reset();
+        return length;
+    }
+
+    void ClearInjectedOutput(OutputTarget target) {
+        if (WindowHistory* history = FindHistory(target)) {
+            history->clear();
+        }
+    }
+
+    void ClearAllInjectedOutput() {
+        for (auto& history : g_histories) {
+            history.clear();
+        }
+    }
+
+} // namespace bijoy::core
@@ -0,0 +1,256 @@
+#include "core/phonetic_engine.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace bijoy::core {
+
+    namespace {
+
+        enum class Context : uint8_t {
+            WordStart,
+            Consonant,
+            Vowel,
+            Sign
+        };
+
+        struct PhoneticRule {
+            const char* pattern;
+            const wchar_t* output;
+            Context kind;
+            // Output and class used directly after a consonant, e.g. vowel
+            // signs and phala forms. Null means the standalone form applies.
+            const wchar_t* afterConsonant = nullptr;
+            Context afterConsonantKind = Context::Consonant;
+        };
+
+        constexpr Context V = Context::Vowel;
+        constexpr Context C = Context::Consonant;
+        constexpr Context S = Context::Sign;
+        constexpr Context P = Context::WordStart;
+
+        const PhoneticRule kRules[] = {
+                {"o", L"অ", V, L"", V},
+                {"a", L"আ", V, L"া", V},
+                {"A", L"আ", V, L"া", V},
+                {"i", L"ই", V, L"ি", V},
+                {"I", L"ঈ", V, L"ী", V},
+                {"ee", L"ঈ", V, L"ী", V},
+                {"u", L"উ", V, L"ু", V},
+                {"U", L"ঊ", V, L"ূ", V},
+                {"oo", L"উ", V, L"ু", V},
+                {"rri", L"ঋ", V, L"ৃ", V},
+                {"e", L"এ", V, L"ে", V},
+                {"oi", L"ঐ", V, L"ৈ", V},
+                {"OI", L"ঐ", V, L"ৈ", V},
+                {"O", L"ও", V, L"ো", V},
+                {"ou", L"ঔ", V, L"ৌ", V},
+                {"OU", L"ঔ", V, L"ৌ", V},
+                {"w", L"ও", V, L"্ব", C},
+
+                {"k", L"ক", C}, {"kh", L"খ", C}, {"g", L"গ", C}, {"gh", L"ঘ", C},
+                {"Ng", L"ঙ", C}, {"c", L"চ", C}, {"ch", L"ছ", C}, {"j", L"জ", C},
+                {"jh", L"ঝ", C}, {"NG", L"ঞ", C}, {"T", L"ট", C}, {"Th", L"ঠ", C},
+                {"D", L"ড", C}, {"Dh", L"ঢ", C}, {"N", L"ণ", C}, {"t", L"ত", C},
+                {"th", L"থ", C}, {"d", L"দ", C}, {"dh", L"ধ", C}, {"n", L"ন", C},
+                {"p", L"প", C}, {"ph", L"ফ", C}, {"f", L"ফ", C}, {"b", L"ব", C},
+                {"bh", L"ভ", C}, {"v", L"ভ", C}, {"m", L"ম", C}, {"z", L"য", C},
+                {"l", L"ল", C}, {"sh", L"শ", C}, {"S", L"শ", C}, {"Sh", L"ষ", C},
+                {"s", L"স", C}, {"h", L"হ", C}, {"R", L"ড়", C}, {"Rh", L"ঢ়", C},
+                {"Y", L"য়", C}, {"x", L"ক্স", C}, {"q", L"ক", C},
+                {"r", L"র", C, L"্র", C},
+                {"y", L"য়", C, L"্য", C},
+
+                {"kk", L"ক্ক", C}, {"kkh", L"ক্ষ", C}, {"kSh", L"ক্ষ", C}, {"gg", L"জ্ঞ", C},
+                {"ngk", L"ঙ্ক", C}, {"ngg", L"ঙ্গ", C}, {"cch", L"চ্ছ", C}, {"tt", L"ত্ত", C},
+                {"nt", L"ন্ত", C}, {"nth", L"ন্থ", C}, {"nd", L"ন্দ", C}, {"ndh", L"ন্ধ", C},
+                {"ll", L"ল্ল", C}, {"mm", L"ম্ম", C}, {"nn", L"ন্ন", C}, {"pp", L"প্প", C},
+                {"ss", L"স্স", C}, {"st", L"স্ত", C}, {"sk", L"স্ক", C},
+
+                {"ng", L"ং", S}, {":", L"ঃ", S}, {"^", L"ঁ", S}, {"t`", L"ৎ", S},
+
+                {".", L"।", P}, {"$", L"৳", P},
+                {"0", L"০", P}, {"1", L"১", P}, {"2", L"২", P}, {"3", L"৩", P}, {"4", L"৪", P},
+                {"5", L"৫", P}, {"6", L"৬", P}, {"7", L"৭", P}, {"8", L"৮", P}, {"9", L"৯", P},
+        };
+
+        constexpr int kFirstSymbol = 0x20;
+        constexpr int kSymbolCount = 0x7F - kFirstSymbol;
+
+        // Dense trie: one row of kSymbolCount transitions per node.
+        class PhoneticAutomaton {
+        public:
+            PhoneticAutomaton() {
+                addNode();
+                for (size_t i = 0; i < std::size(kRules); ++i) {
+                    int node = 0;
+                    for (const char* p = kRules[i].pattern; *p; ++p) {
+                        const size_t slot = static_cast<size_t>(node) * kSymbolCount + (*p - kFirstSymbol);
+                        if (transitions_[slot] == 0) {
+                            const int created = addNode();
+                            transitions_[slot] = created;
+                        }
+                        node = transitions_[slot];
+                    }
+                    accept_[node] = static_cast<int16_t>(i);
+                    longestPattern_ = std::max(longestPattern_, std::strlen(kRules[i].pattern));
+                }
+            }
+
+            // Longest rule matching at the start of input; returns its length
+            // and sets rule, or returns 0 when no rule applies.
+            size_t match(std::string_view input, const PhoneticRule*& rule) const {
+                int node = 0;
+                size_t matched = 0;
+                for (size_t i = 0; i < input.size(); ++i) {
+                    const int symbol = static_cast<unsigned char>(input[i]) - kFirstSymbol;
+                    if (symbol < 0 || symbol >= kSymbolCount) {
+                        break;
+                    }
+                    node = transitions_[node * kSymbolCount + symbol];
+                    if (node == 0) {
+                        break;
+                    }
+                    if (accept_[node] >= 0) {
+                        rule = &kRules[accept_[node]];
+                        matched = i + 1;
+                    }
+                }
+                return matched;
+            }
+
+            bool hasSymbol(char ch) const {
+                return step(0, ch) != 0;
+            }
+
+            // True when ch carries on a rule still open at the end of word,
+            // such as the '`' of "t`", which never starts a rule itself.
+            bool continues(std::string_view word, char ch) const {
+                const size_t lookback = std::min(word.size(), longestPattern_ - 1);
+                for (size_t start = word.size() - lookback; start < word.size(); ++start) {
+                    int node = 0;
+                    size_t i = start;
+                    while (i < word.size() && (node = step(node, word[i])) != 0) {
+                        ++i;
+                    }
+                    if (i == word.size() && step(node, ch) != 0) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        private:
+            int step(int node, char ch) const {
+                const int symbol = static_cast<unsigned char>(ch) - kFirstSymbol;
+                if (symbol < 0 || symbol >= kSymbolCount) {
+                    return 0;
+                }
+                return transitions_[static_cast<size_t>(node) * kSymbolCount + symbol];
+            }
+
+            int addNode() {
+                transitions_.resize(transitions_.size() + kSymbolCount, 0);
+                accept_.push_back(-1);
+                return static_cast<int>(accept_.size()) - 1;
+            }
+
+            std::vector<int32_t> transitions_;
+            std::vector<int16_t> accept_;
+            size_t longestPattern_ = 1;
+        };
+
+        const PhoneticAutomaton& Automaton() {
+            static const PhoneticAutomaton automaton;
+            return automaton;
+        }
+
+        void Convert(std::string_view roman, std::wstring& out) {
+            const PhoneticAutomaton& automaton = Automaton();
+            Context context = Context::WordStart;
+            size_t pos = 0;
+            while (pos < roman.size()) {
+                const PhoneticRule* rule = nullptr;
+                const size_t length = automaton.match(roman.substr(pos), rule);
+                if (length == 0) {
+                    out.push_back(static_cast<wchar_t>(static_cast<unsigned char>(roman[pos])));
+                    context = Context::WordStart;
+                    ++pos;
+                    continue;
+                }
+
+                if (context == Context::Consonant && rule->afterConsonant) {
+                    out += rule->afterConsonant;
+                    context = rule->afterConsonantKind;
+                } else {
+                    out += rule->output;
+                    context = rule->kind;
+                }
+                pos += length;
+            }
+        }
+
+    } // namespace
+
+    bool IsPhoneticInput(char ch) {
+        return Automaton().hasSymbol(ch);
+    }
+
+    bool PhoneticEngine::feed(char ch, PhoneticEdit& edit) {
+        if (!IsPhoneticInput(ch) && !Automaton().continues(word_, ch)) {
+            return false;
+        }
+
+        // Keeps lookback bounded: an overlong word is frozen as typed.
+        if (word_.size() >= kMaxWordLength) {
+            commit();
+        }
+
+        word_.push_back(ch);
+        reconvert(edit);
+        return true;
+    }
+
+    bool PhoneticEngine::backspace(PhoneticEdit& edit) {
+        if (word_.empty()) {
+            return false;
+        }
+
+        word_.pop_back();
+        reconvert(edit);
+        return true;
+    }
+
+    void PhoneticEngine::commit() {
+        word_.clear();
+        emitted_.clear();
+    }
+
+    void PhoneticEngine::reconvert(PhoneticEdit& edit) {
+        scratch_.clear();
+        Convert(word_, scratch_);
+
+        const auto mismatch = std::mismatch(
+                emitted_.begin(), emitted_.end(), scratch_.begin(), scratch_.end());
+        const size_t common = static_cast<size_t>(mismatch.first - emitted_.begin());
+
+        edit.backspaces = emitted_.size() - common;
+        edit.text.assign(scratch_, common, std::wstring::npos);
+        emitted_.swap(scratch_);
+    }
+
+    void TransliterateText(std::string_view roman, std::wstring& out) {
+        out.reserve(out.size() + roman.size());
+        Convert(roman, out);
+    }
+
+    std::wstring TransliterateText(std::string_view roman) {
+        std::wstring out;
+        TransliterateText(roman, out);
+        return out;
+    }
+
+} // namespace bijoy::core
@@ -0,0 +1,429 @@
+#include "core/spell_checker.h"
+
+#include "core/bengali_grapheme.h"
+#include "core/file_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+
+namespace bijoy::core {
+
+    struct SpellingWord {
+        uint32_t textOffset;
+        uint16_t length;
+        uint16_t clusterCount;
+        uint32_t frequency;
+    };
+
+    // Hash of one delete variant; the words sharing it are entries
+    // [first, first + (count & ~kExactWord)). Hash 0 marks an empty slot.
+    struct SpellingBucket {
+        uint64_t hash;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    namespace {
+
+        constexpr char kMagic[4] = {'O', 'E', 'S', 'P'};
+        constexpr uint32_t kVersion = 1;
+        constexpr uint32_t kMaxDistanceLimit = 3;
+
+        // Set in a bucket's count when a lexicon word hashes to the bucket
+        // undeleted, which lets isCorrect answer from the bucket alone.
+        constexpr uint32_t kExactWord = 0x80000000u;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t maxDistance;
+            uint32_t wordCount;
+            uint32_t bucketCount;
+            uint32_t entryCount;
+            uint32_t textLength;
+            uint32_t reserved;
+        };
+
+        static_assert(sizeof(FileHeader) == 32, "spelling header layout");
+        static_assert(sizeof(SpellingWord) == 12, "spelling word layout");
+        static_assert(sizeof(SpellingBucket) == 16, "spelling bucket layout");
+
+        // Cluster boundaries of a word: cluster i spans [ends[i - 1], ends[i]).
+        struct Clusters {
+            std::array<uint16_t, kMaxSpellingClusters + 1> ends;
+            size_t count = 0;
+
+            size_t begin(size_t i) const { return i == 0 ? 0 : ends[i - 1]; }
+        };
+
+        bool SplitClusters(std::wstring_view word, Clusters& out) {
+            BengaliGraphemeSegmenter segmenter;
+            out.count = 0;
+            for (size_t i = 0; i < word.size(); ++i) {
+                if (segmenter.feed(word[i]) && i > 0) {
+                    if (out.count == kMaxSpellingClusters) {
+                        return false;
+                    }
+                    out.ends[out.count++] = static_cast<uint16_t>(i);
+                }
+            }
+            if (word.empty() || out.count == kMaxSpellingClusters) {
+                return false;
+            }
+            out.ends[out.count++] = static_cast<uint16_t>(word.size());
+            return true;
+        }
+
+        constexpr uint64_t kHashSeed = 14695981039346656037ull;
+
+        uint64_t HashUnits(uint64_t hash, std::wstring_view units) {
+            for (wchar_t ch : units) {
+                hash = (hash ^ static_cast<uint16_t>(ch)) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        uint64_t FinishHash(uint64_t hash) {
+            return hash == 0 ? 1 : hash;
+        }
+
+        // Calls visit with the hash of every variant of word missing at most
+        // maxDeletes clusters, starting with the word itself. Variants can
+        // repeat when neighbouring clusters are equal.
+        template <typename Visit>
+        void ForEachDelete(std::wstring_view word, const Clusters& clusters, uint32_t maxDeletes, Visit&& visit) {
+            std::array<size_t, kMaxDistanceLimit> removed{};
+
+            const auto hashVariant = [&](size_t removedCount) {
+                uint64_t hash = kHashSeed;
+                size_t next = 0;
+                for (size_t i = 0; i < clusters.count; ++i) {
+                    if (next < removedCount && removed[next] == i) {
+                        ++next;
+                        continue;
+                    }
+                    hash = HashUnits(hash, word.substr(clusters.begin(i), clusters.ends[i] - clusters.begin(i)));
+                }
+                return FinishHash(hash);
+            };
+
+            const auto recurse = [&](auto&& self, size_t depth, size_t start) -> void {
+                visit(hashVariant(depth));
+                // Deleting every cluster leaves nothing worth matching.
+                if (depth == maxDeletes || depth + 1 >= clusters.count) {
+                    return;
+                }
+                for (size_t i = start; i < clusters.count; ++i) {
+                    removed[depth] = i;
+                    self(self, depth + 1, i + 1);
+                }
+            };
+            recurse(recurse, 0, 0);
+        }
+
+        bool ClusterEquals(std::wstring_view a, const Clusters& ca, size_t i,
+                           std::wstring_view b, const Clusters& cb, size_t j) {
+            return a.substr(ca.begin(i), ca.ends[i] - ca.begin(i)) == b.substr(cb.begin(j), cb.ends[j] - cb.begin(j));
+        }
+
+        // Optimal string alignment distance over clusters, or limit + 1 once
+        // every path exceeds limit.
+        uint32_t ClusterDistance(std::wstring_view a, const Clusters& ca, std::wstring_view b, const Clusters& cb,
+                                 uint32_t limit) {
+            constexpr size_t kWidth = kMaxSpellingClusters + 1;
+            uint32_t rows[3][kWidth];
+            uint32_t* previous2 = rows[0];
+            uint32_t* previous = rows[1];
+            uint32_t* current = rows[2];
+
+            for (size_t j = 0; j <= cb.count; ++j) {
+                previous[j] = static_cast<uint32_t>(j);
+            }
+            for (size_t i = 1; i <= ca.count; ++i) {
+                current[0] = static_cast<uint32_t>(i);
+                uint32_t rowMin = current[0];
+                for (size_t j = 1; j <= cb.count; ++j) {
+                    const uint32_t cost = ClusterEquals(a, ca, i - 1, b, cb, j - 1) ? 0 : 1;
+                    uint32_t value = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+                    if (i > 1 && j > 1 && cost == 1 && ClusterEquals(a, ca, i - 1, b, cb, j - 2) &&
+                        ClusterEquals(a, ca, i - 2, b, cb, j - 1)) {
+                        value = std::min(value, previous2[j - 2] + 1);
+                    }
+                    current[j] = value;
+                    rowMin = std::min(rowMin, value);
+                }
+                if (rowMin > limit) {
+                    return limit + 1;
+                }
+                std::swap(previous2, previous);
+                std::swap(previous, current);
+            }
+            return previous[cb.count];
+        }
+
+    } // namespace
+
+    bool WriteSpellingIndex(std::vector<WordFrequency> words, uint32_t maxDistance, const std::wstring& path) {
+        if (maxDistance == 0 || maxDistance > kMaxDistanceLimit) {
+            return false;
+        }
+
+        std::map<std::wstring, uint32_t> lexicon;
+        for (auto& entry : words) {
+            if (!entry.word.empty() && entry.frequency > 0) {
+                uint32_t& frequency = lexicon[std::move(entry.word)];
+                frequency = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(frequency) + entry.frequency, UINT32_MAX));
+            }
+        }
+        words.clear();
+        words.shrink_to_fit();
+
+        std::vector<SpellingWord> table;
+        std::vector<uint16_t> text;
+        std::vector<std::pair<uint64_t, uint32_t>> deletes;
+        std::vector<uint64_t> exact;
+        Clusters clusters;
+        for (const auto& [word, frequency] : lexicon) {
+            if (word.size() > UINT16_MAX || !SplitClusters(word, clusters)) {
+                continue;
+            }
+
+            const auto index = static_cast<uint32_t>(table.size());
+            table.push_back({static_cast<uint32_t>(text.size()), static_cast<uint16_t>(word.size()),
+                             static_cast<uint16_t>(clusters.count), frequency});
+            for (wchar_t ch : word) {
+                text.push_back(static_cast<uint16_t>(ch));
+            }
+            ForEachDelete(word, clusters, maxDistance, [&deletes, index](uint64_t hash) {
+                deletes.emplace_back(hash, index);
+            });
+            exact.push_back(FinishHash(HashUnits(kHashSeed, word)));
+        }
+        std::sort(exact.begin(), exact.end());
+
+        std::sort(deletes.begin(), deletes.end());
+        deletes.erase(std::unique(deletes.begin(), deletes.end()), deletes.end());
+
+        size_t distinct = 0;
+        for (size_t i = 0; i < deletes.size(); ++i) {
+            distinct += (i == 0 || deletes[i].first != deletes[i - 1].first) ? 1 : 0;
+        }
+
+        // Power-of-two table at most half full keeps linear probes short.
+        uint32_t bucketCount = 16;
+        while (bucketCount < distinct * 2) {
+            bucketCount *= 2;
+        }
+        std::vector<SpellingBucket> buckets(bucketCount, SpellingBucket{0, 0, 0});
+        std::vector<uint32_t> entries;
+        entries.reserve(deletes.size());
+        for (size_t i = 0; i < deletes.size();) {
+            const uint64_t hash = deletes[i].first;
+            SpellingBucket bucket = {hash, static_cast<uint32_t>(entries.size()), 0};
+            for (; i < deletes.size() && deletes[i].first == hash; ++i) {
+                entries.push_back(deletes[i].second);
+                ++bucket.count;
+            }
+            if (std::binary_search(exact.begin(), exact.end(), hash)) {
+                bucket.count |= kExactWord;
+            }
+
+            uint32_t slot = static_cast<uint32_t>(hash) & (bucketCount - 1);
+            while (buckets[slot].hash != 0) {
+                slot = (slot + 1) & (bucketCount - 1);
+            }
+            buckets[slot] = bucket;
+        }
+
+        FileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.maxDistance = maxDistance;
+        header.wordCount = static_cast<uint32_t>(table.size());
+        header.bucketCount = bucketCount;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.textLength = static_cast<uint32_t>(text.size());
+
+        std::string bytes;
+        bytes.reserve(sizeof(header) + table.size() * sizeof(SpellingWord) + buckets.size() * sizeof(SpellingBucket) +
+                      entries.size() * sizeof(uint32_t) + text.size() * sizeof(uint16_t));
+        bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        bytes.append(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(SpellingBucket));
+        bytes.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SpellingWord));
+        bytes.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint32_t));
+        bytes.append(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(uint16_t));
+        return WriteFileAtomic(path, bytes);
+    }
+
+    bool SpellChecker::open(const std::wstring& path) {
+        close();
+        if (!file_.open(path) || file_.size() < sizeof(FileHeader)) {
+            file_.close();
+            return false;
+        }
+
+        FileHeader header = {};
+        std::memcpy(&header, file_.data(), sizeof(header));
+        const uint64_t expected = sizeof(FileHeader) +
+                                  static_cast<uint64_t>(header.bucketCount) * sizeof(SpellingBucket) +
+                                  static_cast<uint64_t>(header.wordCount) * sizeof(SpellingWord) +
+                                  static_cast<uint64_t>(header.entryCount) * sizeof(uint32_t) +
+                                  static_cast<uint64_t>(header.textLength) * sizeof(uint16_t);
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            header.maxDistance == 0 || header.maxDistance > kMaxDistanceLimit || header.bucketCount == 0 ||
+            (header.bucketCount & (header.bucketCount - 1)) != 0 || expected != file_.size()) {
+            file_.close();
+            return false;
+        }
+
+        const unsigned char* cursor = file_.data() + sizeof(FileHeader);
+        const auto* buckets = reinterpret_cast<const SpellingBucket*>(cursor);
+        cursor += header.bucketCount * sizeof(SpellingBucket);
+        const auto* words = reinterpret_cast<const SpellingWord*>(cursor);
+        cursor += header.wordCount * sizeof(SpellingWord);
+        const auto* entries = reinterpret_cast<const uint32_t*>(cursor);
+        cursor += header.entryCount * sizeof(uint32_t);
+        const auto* text = reinterpret_cast<const uint16_t*>(cursor);
+
+        // Validate once so lookups can index without bounds checks.
+        bool valid = true;
+        for (uint32_t i = 0; valid && i < header.bucketCount; ++i) {
+            valid = static_cast<uint64_t>(buckets[i].first) + (buckets[i].count & ~kExactWord) <= header.entryCount;
+        }
+        for (uint32_t i = 0; valid && i < header.wordCount; ++i) {
+            valid = static_cast<uint64_t>(words[i].textOffset) + words[i].length <= header.textLength &&
+                    words[i].clusterCount <= kMaxSpellingClusters;
+        }
+        for (uint32_t i = 0; valid && i < header.entryCount; ++i) {
+            valid = entries[i] < header.wordCount;
+        }
+        if (!valid) {
+            file_.close();
+            return false;
+        }
+
+        words_ = words;
+        buckets_ = buckets;
+        entries_ = entries;
+        text_ = text;
+        bucketMask_ = header.bucketCount - 1;
+        maxDistance_ = header.maxDistance;
+        return true;
+    }
+
+    void SpellChecker::close() {
+        words_ = nullptr;
+        buckets_ = nullptr;
+        entries_ = nullptr;
+        text_ = nullptr;
+        bucketMask_ = 0;
+        maxDistance_ = 0;
+        file_.close();
+    }
+
+    const SpellingBucket* SpellChecker::findBucket(uint64_t hash) const {
+        // The writer leaves at least half the slots empty, so probing ends.
+        for (uint32_t slot = static_cast<uint32_t>(hash) & bucketMask_;; slot = (slot + 1) & bucketMask_) {
+            const SpellingBucket& bucket = buckets_[slot];
+            if (bucket.hash == hash) {
+                return &bucket;
+            }
+            if (bucket.hash == 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    std::wstring_view SpellChecker::wordAt(uint32_t index) const {
+        if constexpr (sizeof(wchar_t) == sizeof(uint16_t)) {
+            const SpellingWord& word = words_[index];
+            return std::wstring_view(reinterpret_cast<const wchar_t*>(text_ + word.textOffset), word.length);
+        } else {
+            // Wide strings are UTF-32 off Windows; widen into a per-thread buffer.
+            thread_local std::wstring widened;
+            const SpellingWord& word = words_[index];
+            widened.assign(text_ + word.textOffset, text_ + word.textOffset + word.length);
+            return widened;
+        }
+    }
+
+    bool SpellChecker::isCorrect(std::wstring_view word) const {
+        if (!words_ || word.empty()) {
+            return false;
+        }
+
+        // The undeleted variant hashes the whole word, so one probe answers.
+        // A 64-bit hash collision between a typo and a lexicon word is
+        // accepted as vanishingly unlikely.
+        const SpellingBucket* bucket = findBucket(FinishHash(HashUnits(kHashSeed, word)));
+        return bucket && (bucket->count & kExactWord) != 0;
+    }
+
+    void SpellChecker::suggest(std::wstring_view word, size_t k, std::vector<SpellingSuggestion>& out) const {
+        Clusters clusters;
+        if (!words_ || k == 0 || !SplitClusters(word, clusters)) {
+            return;
+        }
+
+        std::vector<uint32_t> candidates;
+        ForEachDelete(word, clusters, maxDistance_, [this, &candidates](uint64_t hash) {
+            if (const SpellingBucket* bucket = findBucket(hash)) {
+                const uint32_t* first = entries_ + bucket->first;
+                candidates.insert(candidates.end(), first, first + (bucket->count & ~kExactWord));
+            }
+        });
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        const size_t start = out.size();
+        Clusters candidateClusters;
+        for (uint32_t index : candidates) {
+            const SpellingWord& entry = words_[index];
+            const size_t gap = entry.clusterCount > clusters.count ? entry.clusterCount - clusters.count
+                                                                    : clusters.count - entry.clusterCount;
+            if (gap > maxDistance_) {
+                continue;
+            }
+
+            const std::wstring_view candidate = wordAt(index);
+            if (!SplitClusters(candidate, candidateClusters)) {
+                continue;
+            }
+            const uint32_t distance = ClusterDistance(word, clusters, candidate, candidateClusters, maxDistance_);
+            if (distance <= maxDistance_) {
+                out.push_back({std::wstring(candidate), entry.frequency, distance});
+            }
+        }
+
+        std::sort(out.begin() + static_cast<std::ptrdiff_t>(start), out.end(),
+                  [](const SpellingSuggestion& a, const SpellingSuggestion& b) {
+                      return a.distance != b.distance ? a.distance < b.distance : a.frequency > b.frequency;
+                  });
+        if (out.size() - start > k) {
+            out.resize(start + k);
+        }
+    }
+
+    size_t SpellChecker::check(std::wstring_view text, std::vector<Misspelling>& out) const {
+        size_t checked = 0;
+        size_t i = 0;
+        while (i < text.size()) {
+            if (!IsBengaliWordChar(text[i])) {
+                ++i;
+                continue;
+            }
+            const size_t start = i;
+            while (i < text.size() && IsBengaliWordChar(text[i])) {
+                ++i;
+            }
+            ++checked;
+            if (!isCorrect(text.substr(start, i - start))) {
+                out.push_back({start, i - start});
+            }
+        }
+        return checked;
+    }
+
+} // namespace bijoy::core
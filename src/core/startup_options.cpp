@@ -18,6 +18,20 @@ namespace bijoy::core {
             return static_cast<int>(data);
         }
 
+        std::wstring ReadStringValue(HKEY key, const wchar_t* valueName, const std::wstring& fallback) {
+            DWORD dataSize = 0;
+            if (RegGetValueW(key, nullptr, valueName, RRF_RT_REG_SZ, nullptr, nullptr, &dataSize) != ERROR_SUCCESS ||
+                dataSize < sizeof(wchar_t)) {
+                return fallback;
+            }
+            std::wstring data(dataSize / sizeof(wchar_t), L'\0');
+            if (RegGetValueW(key, nullptr, valueName, RRF_RT_REG_SZ, nullptr, data.data(), &dataSize) != ERROR_SUCCESS) {
+                return fallback;
+            }
+            data.resize(wcsnlen(data.c_str(), data.size()));
+            return data.empty() ? fallback : data;
+        }
+
         bool ReadBoolValue(HKEY key, const wchar_t* valueName, bool fallback) {
             return ReadDwordValue(key, valueName, fallback ? 1 : 0) != 0;
         }
@@ -39,6 +53,9 @@ namespace bijoy::core {
         options.layoutActivationMode = ReadBoolValue(key, L"LAM", options.layoutActivationMode);
         options.trayMode = ReadBoolValue(key, L"TrayMode", options.trayMode);
         options.applicationMode = ReadDwordValue(key, L"ApplicationMode", options.applicationMode);
+        options.clusterBackspace = ReadBoolValue(key, L"ClusterBackspace", options.clusterBackspace);
+        options.updateManifestUrl = ReadStringValue(key, L"UpdateManifestUrl", options.updateManifestUrl);
+        options.updateRateLimit = ReadDwordValue(key, L"UpdateRateLimit", options.updateRateLimit);
 
         RegCloseKey(key);
         return options;
@@ -79,7 +96,8 @@ namespace bijoy::core {
                 writeDword(L"Top", static_cast<DWORD>(options.mainWindowTop)) &&
                 writeDword(L"LAM", options.layoutActivationMode ? 1U : 0U) &&
                 writeDword(L"TrayMode", options.trayMode ? 1U : 0U) &&
-                writeDword(L"ApplicationMode", static_cast<DWORD>(options.applicationMode));
+                writeDword(L"ApplicationMode", static_cast<DWORD>(options.applicationMode)) &&
+                writeDword(L"ClusterBackspace", options.clusterBackspace ? 1U : 0U);
 
         RegCloseKey(key);
         return success;
@@ -0,0 +1,144 @@
+#include "core/startup_trace.h"
+
+#include "core/file_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace bijoy::core {
+
+    namespace {
+
+        // Startup records a few hundred spans; the rest of the buffer is slack.
+        constexpr size_t kCapacity = 8192;
+
+        struct TraceEvent {
+            const char* name;
+            int64_t startUs;
+            int64_t durationUs;
+            uint64_t threadId;
+            std::atomic<bool> ready{false};
+        };
+
+        // A writer claims a slot with one fetch_add and publishes it through
+        // its ready flag, so recording never takes a lock.
+        struct TraceBuffer {
+            std::wstring outputPath;
+            TraceClock::time_point origin;
+            std::unique_ptr<TraceEvent[]> events{new TraceEvent[kCapacity]};
+            std::atomic<size_t> next{0};
+        };
+
+        std::atomic<bool> g_enabled{false};
+        // Kept once started: a span racing WriteStartupTrace may still land
+        // in it, and it is never read again.
+        std::atomic<TraceBuffer*> g_buffer{nullptr};
+
+        uint64_t CurrentThreadId() {
+#ifdef _WIN32
+            return GetCurrentThreadId();
+#else
+            return std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffffffffu;
+#endif
+        }
+
+        uint64_t CurrentProcessId() {
+#ifdef _WIN32
+            return GetCurrentProcessId();
+#else
+            return static_cast<uint64_t>(getpid());
+#endif
+        }
+
+        int64_t MicrosecondsBetween(TraceClock::time_point from, TraceClock::time_point to) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+        }
+
+        void AppendJsonString(std::string& out, const char* text) {
+            out += '"';
+            for (const char* c = text; *c; ++c) {
+                if (*c == '"' || *c == '\\') {
+                    out += '\\';
+                    out += *c;
+                } else if (static_cast<unsigned char>(*c) >= 0x20) {
+                    out += *c;
+                }
+            }
+            out += '"';
+        }
+
+    } // namespace
+
+    void StartStartupTrace(const std::wstring& outputPath) {
+        if (g_buffer.load()) {
+            return;
+        }
+        auto* buffer = new TraceBuffer();
+        buffer->outputPath = outputPath;
+        buffer->origin = TraceClock::now();
+        g_buffer.store(buffer, std::memory_order_release);
+        g_enabled.store(true, std::memory_order_release);
+    }
+
+    bool IsStartupTraceEnabled() {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    void RecordTraceSpan(const char* name, TraceClock::time_point start, TraceClock::time_point end) {
+        if (!g_enabled.load(std::memory_order_acquire)) {
+            return;
+        }
+        TraceBuffer* buffer = g_buffer.load(std::memory_order_acquire);
+        const size_t slot = buffer->next.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= kCapacity) {
+            return;
+        }
+
+        TraceEvent& event = buffer->events[slot];
+        event.name = name;
+        event.startUs = MicrosecondsBetween(buffer->origin, start);
+        event.durationUs = MicrosecondsBetween(start, end);
+        event.threadId = CurrentThreadId();
+        event.ready.store(true, std::memory_order_release);
+    }
+
+    bool WriteStartupTrace() {
+        if (!g_enabled.exchange(false)) {
+            return false;
+        }
+        TraceBuffer* buffer = g_buffer.load(std::memory_order_acquire);
+        const size_t count = std::min<size_t>(buffer->next.load(), kCapacity);
+        const std::string pid = std::to_string(CurrentProcessId());
+
+        // Slots still being filled by a span that raced the stop are skipped.
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (size_t i = 0; i < count; ++i) {
+            const TraceEvent& event = buffer->events[i];
+            if (!event.ready.load(std::memory_order_acquire)) {
+                continue;
+            }
+            json += first ? "\n" : ",\n";
+            first = false;
+            json += "{\"name\":";
+            AppendJsonString(json, event.name);
+            json += ",\"ph\":\"X\",\"ts\":" + std::to_string(event.startUs) +
+                    ",\"dur\":" + std::to_string(event.durationUs) +
+                    ",\"pid\":" + pid +
+                    ",\"tid\":" + std::to_string(event.threadId) + "}";
+        }
+        json += "\n]}\n";
+        return WriteFileAtomic(buffer->outputPath, json);
+    }
+
+} // namespace bijoy::core
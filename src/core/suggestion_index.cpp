@@ -0,0 +1,309 @@
+#include "core/suggestion_index.h"
+
+#include "core/file_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <queue>
+
+namespace bijoy::core {
+
+    struct SuggestionNode {
+        uint32_t labelOffset;
+        uint32_t parent;
+        uint32_t firstChild;
+        uint32_t frequency;
+        uint32_t best;
+        uint16_t labelLength;
+        uint16_t childCount;
+    };
+
+    namespace {
+
+        constexpr char kMagic[4] = {'O', 'E', 'S', 'G'};
+        constexpr uint32_t kVersion = 1;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t nodeCount;
+            uint32_t labelCount;
+        };
+
+        static_assert(sizeof(FileHeader) == 16, "index header layout");
+
+        struct BuildNode {
+            std::map<uint16_t, uint32_t> children;
+            uint32_t frequency = 0;
+        };
+
+        template <typename T>
+        void AppendPod(std::string& out, const T& value) {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+    } // namespace
+
+    bool LoadWordFrequencyList(const std::wstring& path, std::vector<WordFrequency>& out) {
+        std::string bytes;
+        if (!ReadFileBytes(path, bytes)) {
+            return false;
+        }
+
+        size_t start = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+        while (start < bytes.size()) {
+            size_t end = bytes.find('\n', start);
+            if (end == std::string::npos) end = bytes.size();
+
+            std::string_view line(bytes.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            const size_t tab = line.find('\t');
+            if (tab != std::string_view::npos && tab > 0) {
+                WordFrequency entry;
+                entry.word = Utf8ToWide(line.substr(0, tab));
+                entry.frequency = static_cast<uint32_t>(strtoul(std::string(line.substr(tab + 1)).c_str(), nullptr, 10));
+                if (entry.frequency > 0) {
+                    out.push_back(std::move(entry));
+                }
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+
+    bool WriteSuggestionIndex(std::vector<WordFrequency> words, const std::wstring& path) {
+        std::vector<BuildNode> trie(1);
+        for (const auto& entry : words) {
+            if (entry.word.empty() || entry.frequency == 0) {
+                continue;
+            }
+            uint32_t node = 0;
+            for (wchar_t ch : entry.word) {
+                const auto label = static_cast<uint16_t>(ch);
+                auto it = trie[node].children.find(label);
+                if (it == trie[node].children.end()) {
+                    trie.emplace_back();
+                    it = trie[node].children.emplace(label, static_cast<uint32_t>(trie.size() - 1)).first;
+                }
+                node = it->second;
+            }
+            const uint64_t sum = static_cast<uint64_t>(trie[node].frequency) + entry.frequency;
+            trie[node].frequency = static_cast<uint32_t>(std::min<uint64_t>(sum, UINT32_MAX));
+        }
+        words.clear();
+        words.shrink_to_fit();
+
+        std::vector<SuggestionNode> nodes;
+        std::vector<uint16_t> labels;
+        std::vector<uint32_t> sources;
+
+        nodes.push_back({0, 0, 0, trie[0].frequency, 0, 0, 0});
+        sources.push_back(0);
+
+        // Breadth-first emission keeps each node's children contiguous. Chains
+        // of single-child, non-word nodes collapse into one labelled edge.
+        for (size_t index = 0; index < nodes.size(); ++index) {
+            const BuildNode& source = trie[sources[index]];
+            nodes[index].firstChild = static_cast<uint32_t>(nodes.size());
+            nodes[index].childCount = static_cast<uint16_t>(source.children.size());
+
+            for (const auto& [label, childIndex] : source.children) {
+                SuggestionNode child = {};
+                child.labelOffset = static_cast<uint32_t>(labels.size());
+                child.parent = static_cast<uint32_t>(index);
+                labels.push_back(label);
+
+                uint32_t current = childIndex;
+                while (trie[current].frequency == 0 && trie[current].children.size() == 1 &&
+                       labels.size() - child.labelOffset < UINT16_MAX) {
+                    const auto& only = *trie[current].children.begin();
+                    labels.push_back(only.first);
+                    current = only.second;
+                }
+
+                child.labelLength = static_cast<uint16_t>(labels.size() - child.labelOffset);
+                child.frequency = trie[current].frequency;
+                nodes.push_back(child);
+                sources.push_back(current);
+            }
+        }
+
+        for (size_t index = nodes.size(); index-- > 0;) {
+            auto& node = nodes[index];
+            node.best = std::max(node.best, node.frequency);
+            if (index > 0) {
+                auto& parent = nodes[node.parent];
+                parent.best = std::max(parent.best, node.best);
+            }
+        }
+
+        FileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        header.labelCount = static_cast<uint32_t>(labels.size());
+
+        std::string bytes;
+        bytes.reserve(sizeof(header) + nodes.size() * sizeof(SuggestionNode) + labels.size() * 2);
+        AppendPod(bytes, header);
+        bytes.append(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(SuggestionNode));
+        bytes.append(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(uint16_t));
+        return WriteFileAtomic(path, bytes);
+    }
+
+    bool SuggestionIndex::open(const std::wstring& path) {
+        close();
+        if (!file_.open(path) || file_.size() < sizeof(FileHeader)) {
+            file_.close();
+            return false;
+        }
+
+        FileHeader header = {};
+        std::memcpy(&header, file_.data(), sizeof(header));
+        const uint64_t expected = sizeof(FileHeader) +
+                                  static_cast<uint64_t>(header.nodeCount) * sizeof(SuggestionNode) +
+                                  static_cast<uint64_t>(header.labelCount) * sizeof(uint16_t);
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            header.nodeCount == 0 || expected != file_.size()) {
+            file_.close();
+            return false;
+        }
+
+        const auto* nodes = reinterpret_cast<const SuggestionNode*>(file_.data() + sizeof(FileHeader));
+        const auto* labels = reinterpret_cast<const uint16_t*>(
+                file_.data() + sizeof(FileHeader) + header.nodeCount * sizeof(SuggestionNode));
+
+        // Validate once so lookups can index without bounds checks. Every
+        // child needs a label: child search reads its first unit.
+        for (uint32_t i = 0; i < header.nodeCount; ++i) {
+            const SuggestionNode& node = nodes[i];
+            if (static_cast<uint64_t>(node.labelOffset) + node.labelLength > header.labelCount ||
+                (i > 0 && node.labelLength == 0) ||
+                (node.childCount > 0 &&
+                 (node.firstChild <= i ||
+                  static_cast<uint64_t>(node.firstChild) + node.childCount > header.nodeCount)) ||
+                (i > 0 && node.parent >= i)) {
+                file_.close();
+                return false;
+            }
+        }
+
+        nodes_ = nodes;
+        labels_ = labels;
+        nodeCount_ = header.nodeCount;
+        return true;
+    }
+
+    void SuggestionIndex::close() {
+        nodes_ = nullptr;
+        labels_ = nullptr;
+        nodeCount_ = 0;
+        file_.close();
+    }
+
+    bool SuggestionIndex::advance(Cursor& cursor, wchar_t ch) const {
+        if (!nodes_) {
+            return false;
+        }
+
+        const auto label = static_cast<uint16_t>(ch);
+        const SuggestionNode& node = nodes_[cursor.node];
+        if (cursor.edgeOffset < node.labelLength) {
+            if (labels_[node.labelOffset + cursor.edgeOffset] != label) {
+                return false;
+            }
+            ++cursor.edgeOffset;
+            return true;
+        }
+
+        const SuggestionNode* first = nodes_ + node.firstChild;
+        const SuggestionNode* last = first + node.childCount;
+        const SuggestionNode* child = std::lower_bound(first, last, label, [this](const SuggestionNode& candidate, uint16_t value) {
+            return labels_[candidate.labelOffset] < value;
+        });
+        if (child == last || labels_[child->labelOffset] != label) {
+            return false;
+        }
+
+        cursor.node = static_cast<uint32_t>(child - nodes_);
+        cursor.edgeOffset = 1;
+        return true;
+    }
+
+    void SuggestionIndex::complete(const Cursor& cursor, size_t k, std::vector<Suggestion>& out) const {
+        if (!nodes_ || k == 0) {
+            return;
+        }
+
+        struct Candidate {
+            uint32_t score;
+            uint32_t node;
+            bool word;
+            bool operator<(const Candidate& other) const { return score < other.score; }
+        };
+
+        std::priority_queue<Candidate> frontier;
+        frontier.push({nodes_[cursor.node].best, cursor.node, false});
+
+        size_t found = 0;
+        while (!frontier.empty() && found < k) {
+            const Candidate top = frontier.top();
+            frontier.pop();
+
+            if (top.word) {
+                out.push_back({wordAt(top.node), top.score});
+                ++found;
+                continue;
+            }
+
+            const SuggestionNode& node = nodes_[top.node];
+            if (node.frequency > 0) {
+                frontier.push({node.frequency, top.node, true});
+            }
+            for (uint32_t i = 0; i < node.childCount; ++i) {
+                const uint32_t child = node.firstChild + i;
+                frontier.push({nodes_[child].best, child, false});
+            }
+        }
+    }
+
+    uint32_t SuggestionIndex::frequency(const std::wstring& word) const {
+        Cursor cursor = root();
+        for (wchar_t ch : word) {
+            if (!advance(cursor, ch)) {
+                return 0;
+            }
+        }
+        if (!nodes_ || cursor.edgeOffset != nodes_[cursor.node].labelLength) {
+            return 0;
+        }
+        return nodes_[cursor.node].frequency;
+    }
+
+    uint32_t SuggestionIndex::topFrequency() const {
+        return nodes_ ? nodes_[0].best : 0;
+    }
+
+    void SuggestionIndex::collect(std::vector<WordFrequency>& out) const {
+        for (uint32_t i = 1; i < nodeCount_; ++i) {
+            if (nodes_[i].frequency > 0) {
+                out.push_back({wordAt(i), nodes_[i].frequency});
+            }
+        }
+    }
+
+    std::wstring SuggestionIndex::wordAt(uint32_t index) const {
+        std::wstring word;
+        for (uint32_t current = index; current != 0; current = nodes_[current].parent) {
+            const SuggestionNode& node = nodes_[current];
+            for (uint32_t i = node.labelLength; i-- > 0;) {
+                word.push_back(static_cast<wchar_t>(labels_[node.labelOffset + i]));
+            }
+        }
+        std::reverse(word.begin(), word.end());
+        return word;
+    }
+
+} // namespace bijoy::core
@@ -0,0 +1,213 @@
+#include "core/suggestion_service.h"
+
+#include "core/triple_buffer.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <semaphore.h>
+#endif
+
+namespace bijoy::core {
+
+    namespace {
+
+        // Wakes the worker without taking a lock on the signalling side. A
+        // signal sent before the worker blocks is kept, so none can be lost.
+        class WakeSignal {
+        public:
+#ifdef _WIN32
+            WakeSignal() : event_(CreateEventW(nullptr, FALSE, FALSE, nullptr)) {}
+            ~WakeSignal() { CloseHandle(event_); }
+            void signal() { SetEvent(event_); }
+            void wait() { WaitForSingleObject(event_, INFINITE); }
+#else
+            WakeSignal() { sem_init(&semaphore_, 0, 0); }
+            ~WakeSignal() { sem_destroy(&semaphore_); }
+            void signal() { sem_post(&semaphore_); }
+            void wait() {
+                while (sem_wait(&semaphore_) != 0) {
+                }
+            }
+#endif
+
+            WakeSignal(const WakeSignal&) = delete;
+            WakeSignal& operator=(const WakeSignal&) = delete;
+
+        private:
+#ifdef _WIN32
+            HANDLE event_;
+#else
+            sem_t semaphore_;
+#endif
+        };
+
+        struct PrefixSlot {
+            std::array<wchar_t, kMaxSuggestionPrefix> text{};
+            size_t length = 0;
+        };
+
+        struct ServiceState {
+            SuggestionIndex index;
+            TripleBuffer<PrefixSlot> prefixes;
+            TripleBuffer<SuggestionResults> results;
+            SuggestionsReadyCallback onReady;
+
+            WakeSignal wake;
+            std::atomic<bool> pending{false};
+            std::atomic<bool> stopping{false};
+            std::mutex reloadMutex;
+            std::wstring reloadPath;
+            std::thread worker;
+
+            // Only the first request since the worker last woke signals, so
+            // a burst of keystrokes costs one kernel call.
+            void requestWake() {
+                if (!pending.exchange(true)) {
+                    wake.signal();
+                }
+            }
+        };
+
+        std::unique_ptr<ServiceState> g_service;
+
+        bool ReloadIfRequested(ServiceState& state) {
+            std::wstring path;
+            {
+                std::lock_guard<std::mutex> lock(state.reloadMutex);
+                path.swap(state.reloadPath);
+            }
+
+            SuggestionIndex next;
+            if (path.empty() || !next.open(path)) {
+                return false;
+            }
+            state.index = std::move(next);
+            return true;
+        }
+
+        void RunWorker(ServiceState& state) {
+            std::wstring current;
+            SuggestionIndex::Cursor cursor = state.index.root();
+            bool matched = true;
+
+            while (true) {
+                state.wake.wait();
+                if (state.stopping.load()) {
+                    return;
+                }
+                // Cleared before reading the prefix: anything published after
+                // this point signals again.
+                state.pending.store(false);
+                const bool reloaded = ReloadIfRequested(state);
+                if (reloaded) {
+                    current.clear();
+                    cursor = state.index.root();
+                    matched = true;
+                }
+                if (!state.prefixes.update() && !reloaded) {
+                    continue;
+                }
+
+                const PrefixSlot& slot = state.prefixes.front();
+                const std::wstring_view next(slot.text.data(), slot.length);
+                if (next == current) {
+                    continue;
+                }
+
+                // Typing usually extends the previous prefix, so only the new
+                // units are walked; anything else restarts from the root.
+                size_t walked = current.size();
+                if (next.substr(0, current.size()) != current) {
+                    cursor = state.index.root();
+                    matched = true;
+                    walked = 0;
+                }
+                for (size_t i = walked; matched && i < next.size(); ++i) {
+                    matched = state.index.advance(cursor, next[i]);
+                }
+                current.assign(next);
+
+                SuggestionResults& out = state.results.back();
+                out.prefix = current;
+                out.items.clear();
+                if (matched && !current.empty()) {
+                    state.index.complete(cursor, kSuggestionCount, out.items);
+                }
+                state.results.publish();
+
+                if (state.onReady) {
+                    state.onReady();
+                }
+            }
+        }
+
+    } // namespace
+
+    bool StartSuggestionService(const std::wstring& indexPath, SuggestionsReadyCallback onReady) {
+        StopSuggestionService();
+
+        auto state = std::make_unique<ServiceState>();
+        if (!state->index.open(indexPath)) {
+            return false;
+        }
+        state->onReady = std::move(onReady);
+        state->worker = std::thread(RunWorker, std::ref(*state));
+        g_service = std::move(state);
+        return true;
+    }
+
+    void StopSuggestionService() {
+        if (!g_service) {
+            return;
+        }
+        g_service->stopping.store(true);
+        g_service->wake.signal();
+        g_service->worker.join();
+        g_service.reset();
+    }
+
+    bool IsSuggestionServiceRunning() {
+        return g_service != nullptr;
+    }
+
+    void ReloadSuggestionIndex(const std::wstring& indexPath) {
+        if (!g_service) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(g_service->reloadMutex);
+            g_service->reloadPath = indexPath;
+        }
+        g_service->requestWake();
+    }
+
+    void PublishSuggestionPrefix(std::wstring_view prefix) {
+        if (!g_service) {
+            return;
+        }
+
+        PrefixSlot& slot = g_service->prefixes.back();
+        // An overlong word cannot be completed; publish it as empty.
+        slot.length = prefix.size() <= kMaxSuggestionPrefix ? prefix.size() : 0;
+        prefix.copy(slot.text.data(), slot.length);
+        g_service->prefixes.publish();
+        g_service->requestWake();
+    }
+
+    const SuggestionResults& AcquireLatestSuggestions() {
+        static const SuggestionResults kEmpty;
+        if (!g_service) {
+            return kEmpty;
+        }
+        g_service->results.update();
+        return g_service->results.front();
+    }
+
+} // namespace bijoy::core
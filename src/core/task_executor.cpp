@@ -0,0 +1,299 @@
+#include "core/task_executor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bijoy::core {
+
+    struct TaskState {
+        Task task;
+        CancellationToken token;
+        TaskPriority priority = TaskPriority::Background;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::atomic<bool> done{false};
+    };
+
+    namespace {
+
+        constexpr int kPriorityCount = 2;
+        constexpr size_t kNoWorker = static_cast<size_t>(-1);
+
+        using TaskPtr = std::shared_ptr<TaskState>;
+
+        // The owner pushes and pops at the back, continuing with its newest,
+        // cache-warm task; thieves take the oldest from the front.
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<TaskPtr> tasks[kPriorityCount];
+        };
+
+        struct Executor {
+            // Reached at exit when StopTaskExecutor was never called, as on
+            // an early return from startup.
+            ~Executor() { shutdown(); }
+
+            void shutdown() {
+                {
+                    std::lock_guard<std::mutex> lock(parkMutex);
+                    stopping.store(true);
+                }
+                wake.notify_all();
+                for (auto& worker : workers) {
+                    if (worker.joinable()) {
+                        worker.join();
+                    }
+                }
+            }
+
+            std::vector<std::unique_ptr<WorkerQueue>> queues;
+            WorkerQueue injected;   // submissions from threads outside the pool
+            std::vector<std::thread> workers;
+
+            std::atomic<size_t> queued{0};
+            std::atomic<size_t> parked{0};
+            std::atomic<bool> stopping{false};
+            std::mutex parkMutex;
+            std::condition_variable wake;
+        };
+
+        std::mutex g_lifecycle;
+        std::shared_ptr<Executor> g_executor;
+
+        thread_local Executor* t_executor = nullptr;
+        thread_local size_t t_worker = kNoWorker;
+
+        TaskPtr PopBack(WorkerQueue& queue, int priority) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            auto& tasks = queue.tasks[priority];
+            if (tasks.empty()) {
+                return nullptr;
+            }
+            TaskPtr task = std::move(tasks.back());
+            tasks.pop_back();
+            return task;
+        }
+
+        TaskPtr PopFront(WorkerQueue& queue, int priority) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            auto& tasks = queue.tasks[priority];
+            if (tasks.empty()) {
+                return nullptr;
+            }
+            TaskPtr task = std::move(tasks.front());
+            tasks.pop_front();
+            return task;
+        }
+
+        // Own deque first, then outside submissions, then the other workers,
+        // for each priority in turn down to lowest. self is kNoWorker off the
+        // pool.
+        TaskPtr TakeTask(Executor& executor, size_t self, int lowest) {
+            const size_t count = executor.queues.size();
+            for (int priority = 0; priority <= lowest; ++priority) {
+                TaskPtr task;
+                if (self != kNoWorker) {
+                    task = PopBack(*executor.queues[self], priority);
+                }
+                if (!task) {
+                    task = PopFront(executor.injected, priority);
+                }
+                const size_t start = self == kNoWorker ? 0 : self + 1;
+                for (size_t i = 0; !task && i < count; ++i) {
+                    const size_t victim = (start + i) % count;
+                    if (victim != self) {
+                        task = PopFront(*executor.queues[victim], priority);
+                    }
+                }
+                if (task) {
+                    executor.queued.fetch_sub(1);
+                    return task;
+                }
+            }
+            return nullptr;
+        }
+
+        void Finish(TaskState& state) {
+            state.task = nullptr;   // releases whatever the task captured
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.done.store(true);
+            }
+            state.finished.notify_all();
+        }
+
+        bool RunOne(Executor& executor, size_t self, int lowest = kPriorityCount - 1) {
+            TaskPtr task = TakeTask(executor, self, lowest);
+            if (!task) {
+                return false;
+            }
+            if (!executor.stopping.load() && !task->token.cancelled()) {
+                task->task(task->token);
+            }
+            Finish(*task);
+            return true;
+        }
+
+        void RunWorker(Executor& executor, size_t index) {
+            t_executor = &executor;
+            t_worker = index;
+            while (true) {
+                if (RunOne(executor, index)) {
+                    continue;
+                }
+                // A submitter bumps queued before it checks parked, and a
+                // worker bumps parked before it checks queued, so one of them
+                // always sees the other and no wake-up is lost.
+                std::unique_lock<std::mutex> lock(executor.parkMutex);
+                executor.parked.fetch_add(1);
+                executor.wake.wait(lock, [&executor] {
+                    return executor.queued.load() > 0 || executor.stopping.load();
+                });
+                executor.parked.fetch_sub(1);
+                if (executor.stopping.load() && executor.queued.load() == 0) {
+                    return;
+                }
+            }
+        }
+
+        std::shared_ptr<Executor> AcquireExecutor() {
+            std::lock_guard<std::mutex> lock(g_lifecycle);
+            if (g_executor) {
+                return g_executor;
+            }
+
+            // The UI thread keeps a core of its own.
+            const unsigned cores = std::thread::hardware_concurrency();
+            const size_t count = std::max<size_t>(2, cores > 1 ? cores - 1 : 1);
+
+            auto executor = std::make_shared<Executor>();
+            for (size_t i = 0; i < count; ++i) {
+                executor->queues.push_back(std::make_unique<WorkerQueue>());
+            }
+            for (size_t i = 0; i < count; ++i) {
+                executor->workers.emplace_back(RunWorker, std::ref(*executor), i);
+            }
+            g_executor = executor;
+            return executor;
+        }
+
+    } // namespace
+
+    bool TaskHandle::isDone() const {
+        return !state_ || state_->done.load();
+    }
+
+    void TaskHandle::cancel() const {
+        if (state_) {
+            state_->token.cancel();
+        }
+    }
+
+    void TaskHandle::wait() const {
+        if (!state_) {
+            return;
+        }
+        // A worker helps only with tasks as urgent as the awaited one, which
+        // is among them while still queued; a less urgent task could hold it
+        // long after the awaited one is done. Once none is left the awaited
+        // task is running elsewhere, so the worker sleeps until it finishes.
+        Executor* executor = t_executor;
+        const int lowest = static_cast<int>(state_->priority);
+        while (executor && !state_->done.load() && RunOne(*executor, t_worker, lowest)) {
+        }
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->finished.wait(lock, [this] { return state_->done.load(); });
+    }
+
+    void StartTaskExecutor() {
+        AcquireExecutor();
+    }
+
+    void StopTaskExecutor() {
+        std::shared_ptr<Executor> executor;
+        {
+            std::lock_guard<std::mutex> lock(g_lifecycle);
+            executor.swap(g_executor);
+        }
+        if (executor) {
+            executor->shutdown();
+        }
+    }
+
+    size_t GetTaskExecutorWorkerCount() {
+        std::lock_guard<std::mutex> lock(g_lifecycle);
+        return g_executor ? g_executor->workers.size() : 0;
+    }
+
+    TaskHandle SubmitTask(Task task, TaskPriority priority, CancellationToken token) {
+        auto state = std::make_shared<TaskState>();
+        state->task = std::move(task);
+        state->token = std::move(token);
+        state->priority = priority;
+
+        // A worker keeps what it submits in its own deque, on the executor
+        // it belongs to even while that one is stopping.
+        std::shared_ptr<Executor> owner;
+        Executor* executor = t_executor;
+        if (!executor) {
+            owner = AcquireExecutor();
+            executor = owner.get();
+        }
+        WorkerQueue& queue = t_worker != kNoWorker ? *executor->queues[t_worker] : executor->injected;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks[static_cast<int>(priority)].push_back(state);
+        }
+        executor->queued.fetch_add(1);
+        if (executor->parked.load() > 0) {
+            std::lock_guard<std::mutex> lock(executor->parkMutex);
+            executor->wake.notify_one();
+        }
+        return TaskHandle(std::move(state));
+    }
+
+    void ParallelFor(size_t count, const std::function<void(size_t index)>& body, TaskPriority priority) {
+        if (count == 0) {
+            return;
+        }
+
+        struct Shared {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> completed{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto shared = std::make_shared<Shared>();
+
+        // Claims indices until none are left. Helpers that start late find
+        // nothing to do and return at once.
+        auto drain = [shared, &body, count]() {
+            size_t index;
+            while ((index = shared->next.fetch_add(1)) < count) {
+                body(index);
+                if (shared->completed.fetch_add(1) + 1 == count) {
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    shared->finished.notify_all();
+                }
+            }
+        };
+
+        if (count > 1) {
+            StartTaskExecutor();
+            const size_t helpers = std::min(count - 1, GetTaskExecutorWorkerCount());
+            for (size_t i = 0; i < helpers; ++i) {
+                SubmitTask([drain](const CancellationToken&) { drain(); }, priority);
+            }
+        }
+        drain();
+
+        // body stays borrowed until every claimed call has returned.
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->finished.wait(lock, [&shared, count] { return shared->completed.load() == count; });
+    }
+
+} // namespace bijoy::core
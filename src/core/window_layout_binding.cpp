@@ -51,4 +51,12 @@ namespace bijoy::core {
         return false;
     }
 
+    void MoveWindowLayoutBindings(const Layout* layouts, size_t count, Layout* moved) {
+        for (auto& entry : g_bindings) {
+            if (entry.status >= layouts && entry.status < layouts + count) {
+                entry.status = moved + (entry.status - layouts);
+            }
+        }
+    }
+
 } // namespace bijoy::core
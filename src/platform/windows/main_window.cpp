@@ -7,14 +7,18 @@
 #include "platform/windows/options_overlay.h"
 
 #include "core/app_state.h"
+#include "core/file_io.h"
 #include "core/layout_discovery.h"
+#include "core/layout_sync.h"
 #include "core/startup_options.h"
+#include "core/task_executor.h"
 #include "core/window_layout_binding.h"
 #include "platform/windows/resource.h"
 
 #include <algorithm>
 #include <commctrl.h>
 #include <cstring>
+#include <memory>
 #include <shellapi.h>
 #include <string>
 #include <vector>
@@ -42,6 +46,12 @@ namespace bijoy::platform::windows {
         HBITMAP g_optionsBitmap = nullptr;
         HBITMAP g_layoutEditorBitmap = nullptr;
 
+        // The button icons, decoded on a worker and posted to the window.
+        struct DecodedIcons {
+            DecodedImage options;
+            DecodedImage layoutEditor;
+        };
+
         HICON g_windowClassIconLarge = nullptr;
         HICON g_windowClassIconSmall = nullptr;
         bool g_ownsDefaultIcon = false;
@@ -161,6 +171,18 @@ namespace bijoy::platform::windows {
             return DefSubclassProc(hwnd, msg, wParam, lParam);
         }
 
+        // Draws icon on an owner-drawn button; the button keeps plain
+        // drawing if the icon failed to load.
+        void AttachIcon(HWND button, HBITMAP icon) {
+            if (!button || !icon) {
+                return;
+            }
+            ButtonState* state = new ButtonState();
+            state->icon = icon;
+            SetWindowSubclass(button, IconButtonSubclassProc, 1, reinterpret_cast<DWORD_PTR>(state));
+            InvalidateRect(button, nullptr, TRUE);
+        }
+
         LRESULT CALLBACK MainWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             switch (msg) {
                 case WM_CREATE: {
@@ -201,42 +223,31 @@ namespace bijoy::platform::windows {
                             nullptr);
 
                     const std::wstring appDir = bijoy::core::GetAppDirectory();
-
-                    const std::wstring optionsCandidates[] = {
-                            BuildPath(appDir, L"data\\Options.png"),
-                            BuildPath(appDir, L"..\\data\\Options.png"),
-                            BuildPath(appDir, L"Options.png"),
-                            BuildPath(appDir, L"..\\Options.png")
-                    };
-                    for (const auto& path : optionsCandidates) {
-                        g_optionsBitmap = LoadPngAsBitmap(path, 20, 20);
-                        if (g_optionsBitmap) break;
-                    }
-
-                    if (!g_optionsBitmap) {
-                        // Diagnostic fallback or logging could go here
-                        // MessageBoxW(hwnd, L"Failed to load Options.png", L"Omor Ekushe Debug", MB_OK);
-                    }
-
-                    const std::wstring editorCandidates[] = {
-                            BuildPath(appDir, L"data\\LayoutEditor.png"),
-                            BuildPath(appDir, L"..\\data\\LayoutEditor.png"),
-                            BuildPath(appDir, L"LayoutEditor.png"),
-                            BuildPath(appDir, L"..\\LayoutEditor.png")
-                    };
-                    for (const auto& path : editorCandidates) {
-                        g_layoutEditorBitmap = LoadPngAsBitmap(path, 20, 20);
-                        if (g_layoutEditorBitmap) break;
-                    }
-
-                    if (!g_layoutEditorBitmap) {
-                        // Diagnostic fallback or logging could go here
-                        // MessageBoxW(hwnd, L"Failed to load LayoutEditor.png", L"Omor Ekushe Debug", MB_OK);
-                    }
-
-                    if (!g_optionsBitmap && !g_layoutEditorBitmap) {
-                        MessageBoxW(hwnd, L"Warning: Main window icons could not be loaded. Please check if 'data' folder exists with PNG files.", L"Omor Ekushe", MB_OK | MB_ICONWARNING);
-                    }
+                    bijoy::core::SubmitTask([hwnd, appDir](const bijoy::core::CancellationToken&) {
+                        const std::wstring optionsCandidates[] = {
+                                BuildPath(appDir, L"data\\Options.png"),
+                                BuildPath(appDir, L"..\\data\\Options.png"),
+                                BuildPath(appDir, L"Options.png"),
+                                BuildPath(appDir, L"..\\Options.png")
+                        };
+                        const std::wstring editorCandidates[] = {
+                                BuildPath(appDir, L"data\\LayoutEditor.png"),
+                                BuildPath(appDir, L"..\\data\\LayoutEditor.png"),
+                                BuildPath(appDir, L"LayoutEditor.png"),
+                                BuildPath(appDir, L"..\\LayoutEditor.png")
+                        };
+
+                        auto* icons = new DecodedIcons();
+                        for (const auto& path : optionsCandidates) {
+                            if (DecodeImageFile(path, icons->options)) break;
+                        }
+                        for (const auto& path : editorCandidates) {
+                            if (DecodeImageFile(path, icons->layoutEditor)) break;
+                        }
+                        if (!PostMessageW(hwnd, kIconsDecodedMessage, 0, reinterpret_cast<LPARAM>(icons))) {
+                            delete icons;
+                        }
+                    }, bijoy::core::TaskPriority::UiCritical);
 
                     g_optionsButton = CreateWindowExW(
                             0,
@@ -251,11 +262,6 @@ namespace bijoy::platform::windows {
                             reinterpret_cast<HMENU>(IDC_OPTIONS_BUTTON),
                             nullptr,
                             nullptr);
-                    if (g_optionsBitmap) {
-                        ButtonState* state = new ButtonState();
-                        state->icon = g_optionsBitmap;
-                        SetWindowSubclass(g_optionsButton, IconButtonSubclassProc, 1, reinterpret_cast<DWORD_PTR>(state));
-                    }
 
                     g_layoutEditorButton = CreateWindowExW(
                             0,
@@ -270,11 +276,6 @@ namespace bijoy::platform::windows {
                             reinterpret_cast<HMENU>(IDC_LAYOUT_EDITOR_BUTTON),
                             nullptr,
                             nullptr);
-                    if (g_layoutEditorBitmap) {
-                        ButtonState* state = new ButtonState();
-                        state->icon = g_layoutEditorBitmap;
-                        SetWindowSubclass(g_layoutEditorButton, IconButtonSubclassProc, 1, reinterpret_cast<DWORD_PTR>(state));
-                    }
 
                     g_minimizeButton = CreateWindowExW(
                             0,
@@ -417,32 +418,70 @@ namespace bijoy::platform::windows {
                         return 0;
                     }
 
-                    if (controlId == IDM_UPDATE)
-                    {
-                        std::wstring app_dir = bijoy::core::GetAppDirectory();
+                    if (controlId == IDM_UPDATE) {
+                        const std::wstring userDir = bijoy::core::GetUserDataDirectory();
+                        const bijoy::core::StartupOptions startupOptions = bijoy::core::LoadStartupOptions();
+
+                        bijoy::core::LayoutSyncOptions options;
+                        options.manifestUrl = bijoy::core::WideToUtf8(startupOptions.updateManifestUrl);
+                        options.layoutDirectory = bijoy::core::FindLayoutDirectory(bijoy::core::GetAppDirectory());
+                        options.cacheDirectory = userDir.empty() ? std::wstring() : userDir + L"\\http-cache";
+                        options.maxBytesPerSecond = static_cast<uint64_t>(std::max<int>(0, startupOptions.updateRateLimit)) * 1024;
+                        if (const auto* layout = bijoy::core::GetCurrentLayout()) {
+                            options.priorityPath = layout->path;
+                        }
 
-                        if (!app_dir.empty() && app_dir.back() != L'\\') {
-                            app_dir += L'\\';
+                        // The result is handed back to this thread, which owns the layouts.
+                        const bool started = bijoy::core::StartLayoutSync(options, [hwnd](const bijoy::core::LayoutSyncResult& result) {
+                            auto* copy = new bijoy::core::LayoutSyncResult(result);
+                            if (!PostMessageW(hwnd, kLayoutSyncMessage, 0, reinterpret_cast<LPARAM>(copy))) {
+                                delete copy;
+                            }
+                        });
+                        if (!started) {
+                            MessageBoxW(hwnd, L"An update is already in progress.", L"Omor Ekushe", MB_OK | MB_ICONINFORMATION);
                         }
+                        return 0;
+                    }
 
-                        std::wstring dll_path = app_dir + L"libNetClient.dll";
+                    break;
+                }
 
-                        HMODULE module = LoadLibraryW(dll_path.c_str());
-                        if (module == nullptr) {
-                            DWORD error = GetLastError();
+                case kLayoutSyncMessage: {
+                    const std::unique_ptr<bijoy::core::LayoutSyncResult> result(
+                            reinterpret_cast<bijoy::core::LayoutSyncResult*>(lParam));
+                    // A failed install may still have left new files behind.
+                    if (!result->installed.empty()) {
+                        bijoy::core::ReloadLayoutFiles(result->installed);
+                        PopulateLayoutCombo();
+                        BuildTrayMenu();
+                    }
+                    if (!result->ok) {
+                        MessageBoxW(hwnd, result->error.c_str(), L"Omor Ekushe", MB_OK | MB_ICONERROR);
+                        return 0;
+                    }
+                    if (result->installed.empty()) {
+                        MessageBoxW(hwnd, L"Layouts are up to date.", L"Omor Ekushe", MB_OK | MB_ICONINFORMATION);
+                        return 0;
+                    }
 
-                            MessageBoxW(
-                                    hwnd,
-                                    L"Failed to open libNetClient.dll!",
-                                    L"Omor Ekushe",
-                                    MB_OK | MB_ICONERROR
-                            );
+                    const std::wstring message = std::to_wstring(result->installed.size()) +
+                                                 (result->installed.size() == 1 ? L" file" : L" files") +
+                                                 L" updated.";
+                    MessageBoxW(hwnd, message.c_str(), L"Omor Ekushe", MB_OK | MB_ICONINFORMATION);
+                    return 0;
+                }
 
-                            return 1;
-                        }
+                case kIconsDecodedMessage: {
+                    const std::unique_ptr<DecodedIcons> icons(reinterpret_cast<DecodedIcons*>(lParam));
+                    g_optionsBitmap = CreateImageBitmap(icons->options, 20, 20);
+                    g_layoutEditorBitmap = CreateImageBitmap(icons->layoutEditor, 20, 20);
+                    AttachIcon(g_optionsButton, g_optionsBitmap);
+                    AttachIcon(g_layoutEditorButton, g_layoutEditorBitmap);
+                    if (!g_optionsBitmap && !g_layoutEditorBitmap) {
+                        MessageBoxW(hwnd, L"Warning: Main window icons could not be loaded. Please check if 'data' folder exists with PNG files.", L"Omor Ekushe", MB_OK | MB_ICONWARNING);
                     }
-
-                    break;
+                    return 0;
                 }
 
                 case kTrayIconMessage:
@@ -614,4 +653,9 @@ namespace bijoy::platform::windows {
         }
     }
 
+    void RefreshLayoutControls() {
+        BuildTrayMenu();
+        PopulateLayoutCombo();
+    }
+
 } // namespace bijoy::platform::windows
@@ -2,6 +2,7 @@
 #include "platform/windows/main_window/main_window_helpers.h"
 #include "platform/windows/main_window/main_window_types.h"
 #include "core/layout_discovery.h"
+#include "core/startup_trace.h"
 #include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -46,6 +47,7 @@ namespace bijoy::platform::windows {
             return;
         }
 
+        bijoy::core::TraceSpan span("LoadBackgroundBitmap");
         ReleaseBackgroundBitmap();
 
         RECT clientRect = {};
@@ -2,9 +2,11 @@
 #include "platform/windows/main_window/main_window_types.h"
 #include "core/layout.h"
 #include "core/layout_discovery.h"
+#include "core/startup_trace.h"
 #include "lib/stb_image.h"
 
 #include <algorithm>
+#include <cstring>
 
 namespace bijoy::platform::windows {
 
@@ -91,15 +93,37 @@ namespace bijoy::platform::windows {
         return utf8;
     }
 
-    HBITMAP LoadPngAsBitmap(const std::wstring& path, int width, int height) {
+    bool DecodeImageFile(const std::wstring& path, DecodedImage& image) {
+        bijoy::core::TraceSpan span("DecodeImageFile");
         const std::string pathUtf8 = WideToUtf8(path);
         if (pathUtf8.empty()) {
-            return nullptr;
+            return false;
+        }
+
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* data = stbi_load(pathUtf8.c_str(), &width, &height, &channels, 4);
+        if (!data || width <= 0 || height <= 0) {
+            stbi_image_free(data);
+            return false;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+        for (size_t i = 0; i < image.pixels.size(); i += 4) {
+            const unsigned char a = data[i + 3];
+            // RGBA to BGRA, pre-multiplying alpha
+            image.pixels[i + 0] = static_cast<unsigned char>((data[i + 2] * a) / 255);
+            image.pixels[i + 1] = static_cast<unsigned char>((data[i + 1] * a) / 255);
+            image.pixels[i + 2] = static_cast<unsigned char>((data[i + 0] * a) / 255);
+            image.pixels[i + 3] = a;
         }
+        stbi_image_free(data);
+        return true;
+    }
 
-        int srcWidth = 0, srcHeight = 0, srcChannels = 0;
-        stbi_uc* data = stbi_load(pathUtf8.c_str(), &srcWidth, &srcHeight, &srcChannels, 4);
-        if (!data) {
+    HBITMAP CreateImageBitmap(const DecodedImage& image, int width, int height) {
+        if (image.pixels.empty()) {
             return nullptr;
         }
 
@@ -115,43 +139,28 @@ namespace bijoy::platform::windows {
         HDC screenDc = GetDC(nullptr);
         HBITMAP hBitmap = CreateDIBSection(screenDc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
 
-        if (hBitmap && bits) {
+        if (hBitmap && bits && width == image.width && height == image.height) {
+            std::memcpy(bits, image.pixels.data(), image.pixels.size());
+        } else if (hBitmap && bits) {
             HDC srcDc = CreateCompatibleDC(screenDc);
             HDC dstDc = CreateCompatibleDC(screenDc);
 
-            BITMAPINFO srcBmi = {};
-            srcBmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-            srcBmi.bmiHeader.biWidth = srcWidth;
-            srcBmi.bmiHeader.biHeight = -srcHeight;
-            srcBmi.bmiHeader.biPlanes = 1;
-            srcBmi.bmiHeader.biBitCount = 32;
-            srcBmi.bmiHeader.biCompression = BI_RGB;
+            BITMAPINFO srcBmi = bmi;
+            srcBmi.bmiHeader.biWidth = image.width;
+            srcBmi.bmiHeader.biHeight = -image.height;
 
             void* srcBits = nullptr;
             HBITMAP hSrcBitmap = CreateDIBSection(screenDc, &srcBmi, DIB_RGB_COLORS, &srcBits, nullptr, 0);
 
             if (hSrcBitmap && srcBits) {
-                // Convert RGBA to BGRA and Pre-multiply Alpha for the source
-                auto* srcPixels = static_cast<unsigned char*>(srcBits);
-                for (int i = 0; i < srcWidth * srcHeight; ++i) {
-                    unsigned char r = data[i * 4 + 0];
-                    unsigned char g = data[i * 4 + 1];
-                    unsigned char b = data[i * 4 + 2];
-                    unsigned char a = data[i * 4 + 3];
-
-                    // BGRA order for DIB section and pre-multiplying alpha
-                    srcPixels[i * 4 + 0] = static_cast<unsigned char>((b * a) / 255);
-                    srcPixels[i * 4 + 1] = static_cast<unsigned char>((g * a) / 255);
-                    srcPixels[i * 4 + 2] = static_cast<unsigned char>((r * a) / 255);
-                    srcPixels[i * 4 + 3] = a;
-                }
+                std::memcpy(srcBits, image.pixels.data(), image.pixels.size());
 
                 const HGDIOBJ oldSrc = SelectObject(srcDc, hSrcBitmap);
                 const HGDIOBJ oldDst = SelectObject(dstDc, hBitmap);
 
                 // Use AlphaBlend for resizing to properly handle pre-multiplied alpha channel
                 BLENDFUNCTION bf = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
-                AlphaBlend(dstDc, 0, 0, width, height, srcDc, 0, 0, srcWidth, srcHeight, bf);
+                AlphaBlend(dstDc, 0, 0, width, height, srcDc, 0, 0, image.width, image.height, bf);
 
                 SelectObject(srcDc, oldSrc);
                 SelectObject(dstDc, oldDst);
@@ -163,7 +172,6 @@ namespace bijoy::platform::windows {
         }
 
         ReleaseDC(nullptr, screenDc);
-        stbi_image_free(data);
         return hBitmap;
     }
 
@@ -1,5 +1,7 @@
 #include "platform/windows/native_input.h"
 
+#include <vector>
+
 namespace bijoy::platform::windows {
 
     void DoKeyboard(DWORD flags, int scanCode) {
@@ -20,4 +22,34 @@ namespace bijoy::platform::windows {
         ::SendInput(1, &input, sizeof(INPUT));
     }
 
+    void SendTextBatch(size_t backspaces, std::wstring_view text) {
+        // Reused across keystrokes; only the hook thread injects.
+        static std::vector<INPUT> inputs;
+        inputs.clear();
+        inputs.reserve(2 * (backspaces + text.size()));
+
+        const auto push = [](WORD vk, WORD scan, DWORD flags) {
+            INPUT input = {};
+            input.type = INPUT_KEYBOARD;
+            input.ki.wVk = vk;
+            input.ki.wScan = scan;
+            input.ki.dwFlags = flags;
+            input.ki.dwExtraInfo = kInjectedInputTag;
+            inputs.push_back(input);
+        };
+
+        for (size_t i = 0; i < backspaces; ++i) {
+            push(VK_BACK, 0, 0);
+            push(VK_BACK, 0, KEYEVENTF_KEYUP);
+        }
+        for (wchar_t c : text) {
+            push(0, static_cast<WORD>(c), KEYEVENTF_UNICODE);
+            push(0, static_cast<WORD>(c), KEYEVENTF_UNICODE | KEYEVENTF_KEYUP);
+        }
+
+        if (!inputs.empty()) {
+            ::SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
+        }
+    }
+
 } // namespace bijoy::platform::windows
@@ -2,13 +2,13 @@
 
 #include <algorithm>
 #include <chrono>
-#include <future>
+#include <memory>
 #include <string>
 #include <windows.h>
 #include <vector>
 
 #include "core/layout_discovery.h"
-#include "lib/stb_image.h"
+#include "platform/windows/main_window/main_window_helpers.h"
 
 
 namespace bijoy::platform::windows {
@@ -16,19 +16,22 @@ namespace bijoy::platform::windows {
 
         constexpr wchar_t kSplashClassName[] = L"OmorEkusheSplash";
         constexpr UINT_PTR kSplashTimerId = 1;
-        constexpr int kTickMs = 10;
-        constexpr BYTE kFadeStepAlpha = 6;
-        constexpr int kMinVisibleMs = 5000;
+        // The timer only runs while a fade is in progress.
+        constexpr int kFrameMs = 16;
+        constexpr UINT kReadyMessage = WM_APP + 1;
+        constexpr UINT kImageMessage = WM_APP + 2;  // lParam: heap DecodedImage*
 
         constexpr int kWindowWidth = 350;
         constexpr int kWindowHeight = 450;
 
         class SplashScreenController {
         public:
-            SplashScreenController(SplashInitTask initTask,
-                                   SplashCompletedCallback onCompleted)
-                    : initTask_(std::move(initTask)),
-                      onCompleted_(std::move(onCompleted)) {}
+            SplashScreenController(std::vector<bijoy::core::TaskHandle> readiness,
+                                   SplashCompletedCallback onCompleted,
+                                   const SplashOptions& options)
+                    : readiness_(std::move(readiness)),
+                      onCompleted_(std::move(onCompleted)),
+                      fadeMs_(std::max<int>(0, options.fadeMs)) {}
 
             HWND Create(HINSTANCE instance, HWND owner) {
                 RegisterWindowClass(instance);
@@ -85,6 +88,10 @@ namespace bijoy::platform::windows {
                 switch (msg) {
                     case WM_CREATE:   return self->OnCreate();
                     case WM_TIMER:    self->OnTimer(); return 0;
+                    case kReadyMessage: self->OnReady(); return 0;
+                    case kImageMessage:
+                        self->OnImage(std::unique_ptr<DecodedImage>(reinterpret_cast<DecodedImage*>(lParam)));
+                        return 0;
                     case WM_PAINT:    self->OnPaint(); return 0;
                     case WM_DESTROY:  KillTimer(hwnd, kSplashTimerId); return 0;
                     case WM_NCDESTROY:
@@ -100,44 +107,75 @@ namespace bijoy::platform::windows {
             }
 
             LRESULT OnCreate() {
-                alpha_ = 0;
-                LoadBackgroundImage();
-                UpdateWindowAlpha(0);
                 CenterOnScreen();
+                StartFade(0, 255);
+
+                // The image is decoded on a worker; the window stays clear
+                // until it arrives, and the fade picks it up from there.
+                const HWND hwnd = hwnd_;
+                bijoy::core::SubmitTask(
+                        [hwnd](const bijoy::core::CancellationToken&) {
+                            auto image = std::make_unique<DecodedImage>();
+                            if (!DecodeBackgroundImage(*image)) {
+                                return;
+                            }
+                            if (PostMessageW(hwnd, kImageMessage, 0, reinterpret_cast<LPARAM>(image.get()))) {
+                                image.release();
+                            }
+                        },
+                        bijoy::core::TaskPriority::UiCritical);
+
+                // One helper waits for every readiness task and posts back,
+                // so the UI thread sleeps in its message loop meanwhile. A
+                // post after the splash is gone fails harmlessly.
+                bijoy::core::SubmitTask(
+                        [hwnd, readiness = std::move(readiness_)](const bijoy::core::CancellationToken&) {
+                            for (const auto& task : readiness) {
+                                task.wait();
+                            }
+                            PostMessageW(hwnd, kReadyMessage, 0, 0);
+                        },
+                        bijoy::core::TaskPriority::UiCritical);
 
-                startTime_ = std::chrono::steady_clock::now();
-
-                if (initTask_) {
-                    initFuture_ = std::async(std::launch::async, initTask_);
-                } else {
-                    initCompleted_ = true;
-                }
-
-                SetTimer(hwnd_, kSplashTimerId, kTickMs, nullptr);
                 ShowWindow(hwnd_, SW_SHOW);
                 UpdateWindow(hwnd_);
                 return 0;
             }
 
-            void OnTimer() {
-                if (!initCompleted_ &&
-                    initFuture_.valid() &&
-                    initFuture_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                    initFuture_.get();
-                    initCompleted_ = true;
-                }
+            void OnReady() {
+                ready_ = true;
+                // Fading in reverses from wherever it has got to.
+                StartFade(alpha_, 0);
+            }
 
-                if (alpha_ < 255) {
-                    alpha_ = static_cast<BYTE>(std::min(255, alpha_ + kFadeStepAlpha));
-                    UpdateWindowAlpha(alpha_);
+            void StartFade(BYTE from, BYTE to) {
+                fadeFrom_ = from;
+                fadeTo_ = to;
+                fadeStart_ = std::chrono::steady_clock::now();
+                if (fadeMs_ == 0) {
+                    FinishFade();
                     return;
                 }
+                SetTimer(hwnd_, kSplashTimerId, kFrameMs, nullptr);
+                UpdateWindowAlpha(fadeFrom_);
+            }
 
+            void OnTimer() {
                 const auto elapsedMs =
                         std::chrono::duration_cast<std::chrono::milliseconds>(
-                                std::chrono::steady_clock::now() - startTime_).count();
+                                std::chrono::steady_clock::now() - fadeStart_).count();
+                if (elapsedMs >= fadeMs_) {
+                    FinishFade();
+                    return;
+                }
+                const int span = static_cast<int>(fadeTo_) - static_cast<int>(fadeFrom_);
+                UpdateWindowAlpha(static_cast<BYTE>(fadeFrom_ + span * elapsedMs / fadeMs_));
+            }
 
-                if (initCompleted_ && elapsedMs >= kMinVisibleMs) {
+            void FinishFade() {
+                KillTimer(hwnd_, kSplashTimerId);
+                UpdateWindowAlpha(fadeTo_);
+                if (ready_ && fadeTo_ == 0) {
                     DestroyWindow(hwnd_);
                 }
             }
@@ -148,7 +186,7 @@ namespace bijoy::platform::windows {
                 EndPaint(hwnd_, &ps);
             }
 
-            void LoadBackgroundImage() {
+            static bool DecodeBackgroundImage(DecodedImage& image) {
                 const std::wstring appDir = bijoy::core::GetAppDirectory();
                 const std::wstring candidates[] = {
                         appDir + L"data\\splash.png",
@@ -156,53 +194,22 @@ namespace bijoy::platform::windows {
                         appDir + L"splash.png"
                 };
 
-                std::wstring resolvedPath;
                 for (const auto& candidate : candidates) {
                     if (GetFileAttributesW(candidate.c_str()) != INVALID_FILE_ATTRIBUTES) {
-                        resolvedPath = candidate;
-                        break;
+                        return DecodeImageFile(candidate, image);
                     }
                 }
+                return false;
+            }
 
-                if (resolvedPath.empty()) return;
-
-                // Convert wstring path to string for stb_image
-                int len = WideCharToMultiByte(CP_UTF8, 0, resolvedPath.c_str(), -1, nullptr, 0, nullptr, nullptr);
-                if (len <= 0) return;
-                std::string pathUtf8(len - 1, '\0');
-                WideCharToMultiByte(CP_UTF8, 0, resolvedPath.c_str(), -1, &pathUtf8[0], len, nullptr, nullptr);
-
-                int width, height, channels;
-                stbi_uc* data = stbi_load(pathUtf8.c_str(), &width, &height, &channels, 4);
-                if (!data) return;
-
-                BITMAPINFO bmi = {};
-                bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-                bmi.bmiHeader.biWidth = width;
-                bmi.bmiHeader.biHeight = -height; // Top-down
-                bmi.bmiHeader.biPlanes = 1;
-                bmi.bmiHeader.biBitCount = 32;
-                bmi.bmiHeader.biCompression = BI_RGB;
-
-                HDC screenDc = GetDC(nullptr);
-                void* bits = nullptr;
-                backgroundBitmap_ = CreateDIBSection(screenDc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
-                if (backgroundBitmap_ && bits) {
-                    // Convert RGBA to BGRA and Pre-multiply Alpha
-                    auto* pixels = static_cast<unsigned char*>(bits);
-                    for (int i = 0; i < width * height; ++i) {
-                        unsigned char a = data[i * 4 + 3];
-                        pixels[i * 4 + 0] = (data[i * 4 + 2] * a) / 255; // B
-                        pixels[i * 4 + 1] = (data[i * 4 + 1] * a) / 255; // G
-                        pixels[i * 4 + 2] = (data[i * 4 + 0] * a) / 255; // R
-                        pixels[i * 4 + 3] = a;                           // A
-                    }
-                }
-                ReleaseDC(nullptr, screenDc);
-                stbi_image_free(data);
+            void OnImage(std::unique_ptr<DecodedImage> image) {
+                if (backgroundBitmap_) return;
+                backgroundBitmap_ = CreateImageBitmap(*image, image->width, image->height);
+                UpdateWindowAlpha(alpha_);
             }
 
             void UpdateWindowAlpha(BYTE alpha) {
+                alpha_ = alpha;
                 if (!backgroundBitmap_) return;
 
                 RECT rect;
@@ -239,23 +246,26 @@ namespace bijoy::platform::windows {
         private:
             HWND hwnd_ = nullptr;
             BYTE alpha_ = 0;
-            bool initCompleted_ = false;
+            bool ready_ = false;
             HBITMAP backgroundBitmap_ = nullptr;
 
-            SplashInitTask initTask_;
+            std::vector<bijoy::core::TaskHandle> readiness_;
             SplashCompletedCallback onCompleted_;
-            std::future<void> initFuture_;
-            std::chrono::steady_clock::time_point startTime_;
+            const int fadeMs_;
+            BYTE fadeFrom_ = 0;
+            BYTE fadeTo_ = 0;
+            std::chrono::steady_clock::time_point fadeStart_;
         };
 
     } // namespace
 
     HWND ShowSplashScreen(HINSTANCE hInstance,
                           HWND owner,
-                          SplashInitTask initTask,
-                          SplashCompletedCallback onCompleted) {
-        auto* controller =
-                new SplashScreenController(std::move(initTask), std::move(onCompleted));
+                          std::vector<bijoy::core::TaskHandle> readiness,
+                          SplashCompletedCallback onCompleted,
+                          const SplashOptions& options) {
+        auto* controller = new SplashScreenController(
+                std::move(readiness), std::move(onCompleted), options);
         return controller->Create(hInstance, owner);
     }
 
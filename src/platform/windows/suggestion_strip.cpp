@@ -0,0 +1,122 @@
+#include "platform/windows/suggestion_strip.h"
+
+#include "core/suggestion_service.h"
+
+#include <string>
+
+namespace bijoy::platform::windows {
+
+    namespace {
+
+        constexpr wchar_t kClassName[] = L"OmorEkusheSuggestionStrip";
+        constexpr int kPadding = 8;
+        constexpr int kHeight = 30;
+
+        HFONT g_font = nullptr;
+        std::wstring g_text;
+
+        void Refresh(HWND hwnd) {
+            const bijoy::core::SuggestionResults& results = bijoy::core::AcquireLatestSuggestions();
+            if (results.items.empty()) {
+                ShowWindow(hwnd, SW_HIDE);
+                return;
+            }
+
+            g_text.clear();
+            for (size_t i = 0; i < results.items.size(); ++i) {
+                if (i > 0) g_text += L"   ";
+                g_text += static_cast<wchar_t>(L'1' + i);
+                g_text += L' ';
+                g_text += results.items[i].word;
+            }
+
+            HDC hdc = GetDC(hwnd);
+            HGDIOBJ oldFont = SelectObject(hdc, g_font ? g_font : GetStockObject(DEFAULT_GUI_FONT));
+            SIZE extent = {};
+            GetTextExtentPoint32W(hdc, g_text.c_str(), static_cast<int>(g_text.size()), &extent);
+            SelectObject(hdc, oldFont);
+            ReleaseDC(hwnd, hdc);
+
+            RECT ownerRect = {};
+            GetWindowRect(GetWindow(hwnd, GW_OWNER), &ownerRect);
+            SetWindowPos(hwnd, HWND_TOPMOST, ownerRect.left, ownerRect.bottom,
+                         extent.cx + kPadding * 2, kHeight, SWP_NOACTIVATE);
+            InvalidateRect(hwnd, nullptr, FALSE);
+            ShowWindow(hwnd, SW_SHOWNOACTIVATE);
+        }
+
+        LRESULT CALLBACK SuggestionStripProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+            switch (msg) {
+                case WM_SUGGESTIONS_READY:
+                    Refresh(hwnd);
+                    return 0;
+                case WM_MOUSEACTIVATE:
+                    return MA_NOACTIVATE;
+                case WM_PAINT: {
+                    PAINTSTRUCT ps;
+                    HDC hdc = BeginPaint(hwnd, &ps);
+                    RECT clientRect;
+                    GetClientRect(hwnd, &clientRect);
+
+                    HBRUSH background = CreateSolidBrush(RGB(30, 30, 30));
+                    FillRect(hdc, &clientRect, background);
+                    DeleteObject(background);
+
+                    HGDIOBJ oldFont = SelectObject(hdc, g_font ? g_font : GetStockObject(DEFAULT_GUI_FONT));
+                    SetBkMode(hdc, TRANSPARENT);
+                    SetTextColor(hdc, RGB(230, 230, 230));
+                    RECT textRect = clientRect;
+                    textRect.left += kPadding;
+                    DrawTextW(hdc, g_text.c_str(), static_cast<int>(g_text.size()), &textRect,
+                              DT_SINGLELINE | DT_VCENTER | DT_NOPREFIX);
+                    SelectObject(hdc, oldFont);
+
+                    HBRUSH borderBrush = CreateSolidBrush(RGB(100, 100, 100));
+                    FrameRect(hdc, &clientRect, borderBrush);
+                    DeleteObject(borderBrush);
+                    EndPaint(hwnd, &ps);
+                    return 0;
+                }
+                case WM_DESTROY:
+                    if (g_font) {
+                        DeleteObject(g_font);
+                        g_font = nullptr;
+                    }
+                    return 0;
+                default:
+                    return DefWindowProcW(hwnd, msg, wParam, lParam);
+            }
+        }
+
+    } // namespace
+
+    HWND CreateSuggestionStrip(HINSTANCE hInstance, HWND owner) {
+        static bool registered = false;
+        if (!registered) {
+            WNDCLASSEXW wc = {};
+            wc.cbSize = sizeof(WNDCLASSEXW);
+            wc.lpfnWndProc = SuggestionStripProc;
+            wc.hInstance = hInstance;
+            wc.lpszClassName = kClassName;
+            wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+            if (!RegisterClassExW(&wc)) {
+                return nullptr;
+            }
+            registered = true;
+        }
+
+        if (!g_font) {
+            g_font = CreateFontW(-18, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                                 OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+                                 DEFAULT_PITCH | FF_DONTCARE, L"Nirmala UI");
+        }
+
+        return CreateWindowExW(
+                WS_EX_TOPMOST | WS_EX_NOACTIVATE | WS_EX_TOOLWINDOW,
+                kClassName, nullptr,
+                WS_POPUP,
+                0, 0, 0, 0,
+                owner, nullptr, hInstance, nullptr);
+    }
+
+} // namespace bijoy::platform::windows
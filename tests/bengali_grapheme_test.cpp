@@ -0,0 +1,115 @@
+#include "core/bengali_grapheme.h"
+#include "test_check.h"
+
+#include <string>
+#include <vector>
+
+using bijoy::core::BengaliGraphemeSegmenter;
+using bijoy::core::IsBengaliWordChar;
+using bijoy::core::LastClusterLength;
+
+namespace {
+
+    // Cluster lengths of text in UTF-16 units. Literals spell out code units
+    // so surrogates stay separate where wchar_t is 32 bits wide.
+    std::vector<size_t> Clusters(std::wstring_view text) {
+        BengaliGraphemeSegmenter segmenter;
+        std::vector<size_t> lengths;
+        for (wchar_t c : text) {
+            if (segmenter.feed(c) || lengths.empty()) {
+                lengths.push_back(1);
+            } else {
+                ++lengths.back();
+            }
+        }
+        return lengths;
+    }
+
+    using Lengths = std::vector<size_t>;
+
+    void TestSimpleLetters() {
+        // ক া ম: consonant plus vowel sign, then a bare consonant.
+        CHECK(Clusters(L"\x0995\x09BE\x09AE") == (Lengths{2, 1}));
+        // অ ং: independent vowel with anusvara.
+        CHECK(Clusters(L"\x0985\x0982") == (Lengths{2}));
+        // কো written as one precomposed sign.
+        CHECK(Clusters(L"\x0995\x09CB") == (Lengths{2}));
+        CHECK(Clusters(L"ab") == (Lengths{1, 1}));
+        // Bengali digits do not combine.
+        CHECK(Clusters(L"\x09E7\x09E8") == (Lengths{1, 1}));
+    }
+
+    void TestConjuncts() {
+        // ক্ষ and ক্ষা.
+        CHECK(Clusters(L"\x0995\x09CD\x09B7") == (Lengths{3}));
+        CHECK(Clusters(L"\x0995\x09CD\x09B7\x09BE") == (Lengths{4}));
+        // ন্ত্র: three consonants chained by two viramas.
+        CHECK(Clusters(L"\x09A8\x09CD\x09A4\x09CD\x09B0") == (Lengths{5}));
+        // স্ত্রী followed by a new consonant.
+        CHECK(Clusters(L"\x09B8\x09CD\x09A4\x09CD\x09B0\x09C0\x0995") == (Lengths{6, 1}));
+        // A trailing virama stays with its consonant.
+        CHECK(Clusters(L"\x0995\x09CD") == (Lengths{2}));
+        // A virama does not link across a non-consonant.
+        CHECK(Clusters(L"\x0985\x09CD\x0995") == (Lengths{2, 1}));
+    }
+
+    void TestReph() {
+        // র্ক: reph over ক.
+        CHECK(Clusters(L"\x09B0\x09CD\x0995") == (Lengths{3}));
+        // কর্ম: ক, then reph over ম.
+        CHECK(Clusters(L"\x0995\x09B0\x09CD\x09AE") == (Lengths{1, 3}));
+        // র্যা with a vowel sign on the conjunct.
+        CHECK(Clusters(L"\x09B0\x09CD\x09AF\x09BE") == (Lengths{4}));
+    }
+
+    void TestJoiners() {
+        // র‍্য: ZWJ before the virama forces the ya-phala form.
+        CHECK(Clusters(L"\x09B0\x200D\x09CD\x09AF") == (Lengths{4}));
+        // ZWJ and ZWNJ extend the cluster they follow.
+        CHECK(Clusters(L"\x0995\x09CD\x200C") == (Lengths{3}));
+        CHECK(Clusters(L"\x0995\x200D") == (Lengths{2}));
+        // A joiner on its own still starts a cluster.
+        CHECK(Clusters(L"\x200C\x0995") == (Lengths{1, 1}));
+        CHECK(IsBengaliWordChar(0x200C));
+        CHECK(IsBengaliWordChar(0x200D));
+        CHECK(IsBengaliWordChar(0x0995));
+        CHECK(!IsBengaliWordChar(0x09E7));
+        CHECK(!IsBengaliWordChar(L'a'));
+    }
+
+    void TestSurrogates() {
+        // U+1F600 as a pair, before and after Bengali text.
+        CHECK(Clusters(L"\xD83D\xDE00") == (Lengths{2}));
+        CHECK(Clusters(L"\x0995\xD83D\xDE00\x0995") == (Lengths{1, 2, 1}));
+        CHECK(Clusters(L"\xD83D\xDE00\xD83D\xDE00") == (Lengths{2, 2}));
+        CHECK(LastClusterLength(L"\x0995\xD83D\xDE00") == 2);
+    }
+
+    void TestLastClusterLength() {
+        CHECK(LastClusterLength(L"") == 0);
+        CHECK(LastClusterLength(L"\x0995") == 1);
+        CHECK(LastClusterLength(L"\x0995\x09BE\x0995\x09CD\x09B7") == 3);
+        CHECK(LastClusterLength(L"\x09B0\x09CD\x0995") == 3);
+    }
+
+    void TestResetStartsFreshCluster() {
+        BengaliGraphemeSegmenter segmenter;
+        CHECK(segmenter.feed(0x0995));
+        CHECK(!segmenter.feed(0x09CD));
+        segmenter.reset();
+        // Without the reset, ষ would join the conjunct.
+        CHECK(segmenter.feed(0x09B7));
+    }
+
+} // namespace
+
+int main() {
+    TestSimpleLetters();
+    TestConjuncts();
+    TestReph();
+    TestJoiners();
+    TestSurrogates();
+    TestLastClusterLength();
+    TestResetStartsFreshCluster();
+    return TestResult();
+}
@@ -0,0 +1,286 @@
+#include "core/file_io.h"
+#include "core/learning_store.h"
+#include "core/suggestion_index.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using bijoy::core::SuggestionIndex;
+using bijoy::core::WordFrequency;
+
+namespace {
+
+    // Log layout, mirrored from learning_store.cpp.
+    constexpr char kMagic[4] = {'O', 'E', 'L', 'G'};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    using Records = std::vector<std::pair<std::wstring, uint32_t>>;
+
+    std::filesystem::path g_directory;
+
+    std::wstring StorePath(const wchar_t* name) {
+        return (g_directory / name).wstring();
+    }
+
+    void ResetDirectory() {
+        std::filesystem::remove_all(g_directory);
+        std::filesystem::create_directories(g_directory);
+    }
+
+    uint32_t Checksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    void AppendPod(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    std::string LogHeader(uint32_t activeSlot) {
+        std::string out(kMagic, sizeof(kMagic));
+        AppendPod(out, kVersion);
+        AppendPod(out, activeSlot);
+        AppendPod(out, uint32_t{0});
+        return out;
+    }
+
+    void AppendRecord(std::string& out, std::wstring_view word, uint32_t count) {
+        const size_t start = out.size();
+        AppendPod(out, static_cast<uint16_t>(word.size()));
+        for (wchar_t ch : word) {
+            AppendPod(out, static_cast<uint16_t>(ch));
+        }
+        AppendPod(out, count);
+        AppendPod(out, Checksum(out.data() + start, out.size() - start));
+    }
+
+    // Parses a log the store wrote; every record must be intact.
+    Records ReadLog(uint32_t* activeSlot) {
+        std::string bytes;
+        CHECK(bijoy::core::ReadFileBytes(StorePath(L"Learned.log"), bytes));
+        Records records;
+        if (bytes.size() < 16 || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+            CHECK(false);
+            return records;
+        }
+        std::memcpy(activeSlot, bytes.data() + 8, sizeof(*activeSlot));
+
+        size_t offset = 16;
+        while (offset < bytes.size()) {
+            uint16_t length = 0;
+            std::memcpy(&length, bytes.data() + offset, sizeof(length));
+            const size_t recordSize = sizeof(uint16_t) * (1 + length) + sizeof(uint32_t) * 2;
+            CHECK(offset + recordSize <= bytes.size());
+            if (offset + recordSize > bytes.size()) {
+                break;
+            }
+            std::wstring word(length, L'\0');
+            for (uint16_t i = 0; i < length; ++i) {
+                uint16_t unit = 0;
+                std::memcpy(&unit, bytes.data() + offset + sizeof(uint16_t) * (1 + i), sizeof(unit));
+                word[i] = static_cast<wchar_t>(unit);
+            }
+            uint32_t count = 0;
+            uint32_t checksum = 0;
+            const char* tail = bytes.data() + offset + sizeof(uint16_t) * (1 + length);
+            std::memcpy(&count, tail, sizeof(count));
+            std::memcpy(&checksum, tail + sizeof(count), sizeof(checksum));
+            CHECK(checksum == Checksum(bytes.data() + offset, recordSize - sizeof(checksum)));
+            records.emplace_back(std::move(word), count);
+            offset += recordSize;
+        }
+        return records;
+    }
+
+    // Collects compaction callbacks from the learning thread.
+    struct Compactions {
+        std::mutex mutex;
+        std::vector<std::wstring> paths;
+
+        bijoy::core::LearnedIndexCallback callback() {
+            return [this](const std::wstring& path) {
+                std::lock_guard<std::mutex> lock(mutex);
+                paths.push_back(path);
+            };
+        }
+
+        bool waitFor(size_t count) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (std::chrono::steady_clock::now() < deadline) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (paths.size() >= count) {
+                        return true;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return false;
+        }
+    };
+
+    bool Start(const std::wstring& baseIndexPath, Compactions* compactions) {
+        return bijoy::core::StartLearningStore(g_directory.wstring(), baseIndexPath,
+                                               compactions ? compactions->callback() : nullptr);
+    }
+
+    void TestRecordedWordsReachLogAndIndex() {
+        ResetDirectory();
+        CHECK(Start(StorePath(L"missing.bin"), nullptr));
+        bijoy::core::RecordLearnedWord(L"আমি");
+        bijoy::core::RecordLearnedWord(L"বই");
+        bijoy::core::RecordLearnedWord(L"আমি");
+        bijoy::core::RecordLearnedWord(std::wstring(64, L'ক'));
+        bijoy::core::StopLearningStore();
+
+        // Appended one increment per use; the overlong word is ignored.
+        uint32_t slot = 0;
+        CHECK(ReadLog(&slot) == (Records{{L"আমি", 1}, {L"বই", 1}, {L"আমি", 1}}));
+        CHECK(slot == kNoSlot);
+
+        // Restarting merges the increments and builds the first index.
+        Compactions compactions;
+        CHECK(Start(StorePath(L"missing.bin"), &compactions));
+        CHECK(compactions.waitFor(1));
+        CHECK(bijoy::core::GetLearnedIndexPath() == StorePath(L"Learned.0.bin"));
+        bijoy::core::StopLearningStore();
+
+        CHECK(ReadLog(&slot) == (Records{{L"বই", 1}, {L"আমি", 2}}));
+        CHECK(slot == 0);
+        SuggestionIndex index;
+        CHECK(index.open(StorePath(L"Learned.0.bin")));
+        CHECK(index.frequency(L"আমি") == 2);
+        CHECK(index.frequency(L"বই") == 1);
+    }
+
+    void TestTornTailIsDropped() {
+        ResetDirectory();
+        std::string log = LogHeader(kNoSlot);
+        AppendRecord(log, L"আমি", 3);
+        AppendRecord(log, L"বই", 1);
+        std::string torn;
+        AppendRecord(torn, L"আমরা", 5);
+        log.append(torn, 0, torn.size() - 3);
+        CHECK(bijoy::core::WriteFileAtomic(StorePath(L"Learned.log"), log));
+
+        CHECK(Start(StorePath(L"missing.bin"), nullptr));
+        bijoy::core::StopLearningStore();
+        uint32_t slot = 0;
+        CHECK(ReadLog(&slot) == (Records{{L"আমি", 3}, {L"বই", 1}}));
+    }
+
+    void TestCorruptRecordEndsReplay() {
+        ResetDirectory();
+        std::string log = LogHeader(kNoSlot);
+        AppendRecord(log, L"আমি", 3);
+        const size_t corrupt = log.size() + 2;
+        AppendRecord(log, L"বই", 1);
+        AppendRecord(log, L"আমরা", 2);
+        log[corrupt] ^= 0x01;
+        CHECK(bijoy::core::WriteFileAtomic(StorePath(L"Learned.log"), log));
+
+        CHECK(Start(StorePath(L"missing.bin"), nullptr));
+        bijoy::core::StopLearningStore();
+        uint32_t slot = 0;
+        CHECK(ReadLog(&slot) == (Records{{L"আমি", 3}}));
+    }
+
+    void TestCompactionMergesBaseAndAlternatesSlots() {
+        ResetDirectory();
+        const std::wstring basePath = StorePath(L"base.bin");
+        CHECK(bijoy::core::WriteSuggestionIndex({{L"আমি", 2560}, {L"বই", 100}}, basePath));
+        // Slot 0 is live, so the rebuild must go to slot 1.
+        CHECK(bijoy::core::WriteSuggestionIndex({{L"বই", 1}}, StorePath(L"Learned.0.bin")));
+        std::string log = LogHeader(0);
+        AppendRecord(log, L"নতুন", 1);
+        AppendRecord(log, L"নতুন", 1);
+        AppendRecord(log, L"বই", 1);
+        CHECK(bijoy::core::WriteFileAtomic(StorePath(L"Learned.log"), log));
+
+        Compactions compactions;
+        CHECK(Start(basePath, &compactions));
+        CHECK(bijoy::core::GetLearnedIndexPath() == StorePath(L"Learned.0.bin"));
+        CHECK(compactions.waitFor(1));
+        bijoy::core::StopLearningStore();
+        CHECK(compactions.paths.size() == 1 && compactions.paths[0] == StorePath(L"Learned.1.bin"));
+
+        uint32_t slot = 0;
+        CHECK(ReadLog(&slot) == (Records{{L"নতুন", 2}, {L"বই", 1}}));
+        CHECK(slot == 1);
+
+        // Learned counts are boosted by the base's top frequency / 256.
+        SuggestionIndex index;
+        CHECK(index.open(StorePath(L"Learned.1.bin")));
+        CHECK(index.frequency(L"আমি") == 2560);
+        CHECK(index.frequency(L"নতুন") == 20);
+        CHECK(index.frequency(L"বই") == 110);
+    }
+
+    std::wstring NumberedWord(const wchar_t* stem, size_t i) {
+        return stem + std::to_wstring(i);
+    }
+
+    void TestDecayEvictsOnlyOverflow() {
+        ResetDirectory();
+        constexpr size_t kNewWords = 50;
+        std::string log = LogHeader(kNoSlot);
+        for (size_t i = 0; i < bijoy::core::kMaxLearnedWords; ++i) {
+            AppendRecord(log, NumberedWord(L"old", i), 1);
+        }
+        AppendRecord(log, L"frequent", 100);
+        for (size_t i = 0; i < kNewWords; ++i) {
+            AppendRecord(log, NumberedWord(L"new", i), 1);
+        }
+        CHECK(bijoy::core::WriteFileAtomic(StorePath(L"Learned.log"), log));
+
+        CHECK(Start(StorePath(L"missing.bin"), nullptr));
+        bijoy::core::StopLearningStore();
+        uint32_t slot = 0;
+        const Records kept = ReadLog(&slot);
+        CHECK(kept.size() == bijoy::core::kMaxLearnedWords);
+
+        // The 51 oldest single-use words made room; everything else survives,
+        // in recency order, and the frequent word is aged rather than halved.
+        const size_t evicted = kNewWords + 1;
+        CHECK(!kept.empty() && kept.front() == (std::pair<std::wstring, uint32_t>{NumberedWord(L"old", evicted), 1}));
+        CHECK(kept.size() > kNewWords && kept[kept.size() - kNewWords - 1] ==
+                                                 (std::pair<std::wstring, uint32_t>{L"frequent", 94}));
+        CHECK(kept.back() == (std::pair<std::wstring, uint32_t>{NumberedWord(L"new", kNewWords - 1), 1}));
+        for (const auto& [word, count] : kept) {
+            CHECK(count >= 1);
+            CHECK(word.rfind(L"old", 0) != 0 || std::stoul(word.substr(3)) >= evicted);
+        }
+
+        // A store at its bound is stable across restarts.
+        CHECK(Start(StorePath(L"missing.bin"), nullptr));
+        bijoy::core::StopLearningStore();
+        CHECK(ReadLog(&slot) == kept);
+    }
+
+} // namespace
+
+int main() {
+    g_directory = std::filesystem::temp_directory_path() / "bijoy_learning_store_test";
+
+    TestRecordedWordsReachLogAndIndex();
+    TestTornTailIsDropped();
+    TestCorruptRecordEndsReplay();
+    TestCompactionMergesBaseAndAlternatesSlots();
+    TestDecayEvictsOnlyOverflow();
+
+    std::filesystem::remove_all(g_directory);
+    return TestResult();
+}
@@ -0,0 +1,123 @@
+#include "core/output_history.h"
+#include "test_check.h"
+
+#include <string>
+
+using bijoy::core::ClearAllInjectedOutput;
+using bijoy::core::ClearInjectedOutput;
+using bijoy::core::OutputTarget;
+using bijoy::core::PopInjectedCluster;
+using bijoy::core::RecordInjectedOutput;
+
+namespace {
+
+    // Distinct fake window handles; the history only compares them.
+    int g_windows[16];
+
+    OutputTarget Window(int i) {
+        return &g_windows[i];
+    }
+
+    void TestPopsWholeClusters() {
+        ClearAllInjectedOutput();
+        // কক্ষা: ক, then the conjunct with its vowel sign.
+        RecordInjectedOutput(Window(0), L"\x0995\x0995\x09CD\x09B7\x09BE");
+        CHECK(PopInjectedCluster(Window(0)) == 4);
+        CHECK(PopInjectedCluster(Window(0)) == 1);
+        CHECK(PopInjectedCluster(Window(0)) == 0);
+    }
+
+    void TestClusterSpansKeystrokes() {
+        ClearAllInjectedOutput();
+        // Each key of a fixed layout injects one unit; র, ্ and ক still form
+        // one reph cluster.
+        RecordInjectedOutput(Window(0), L"\x09B0");
+        RecordInjectedOutput(Window(0), L"\x09CD");
+        RecordInjectedOutput(Window(0), L"\x0995");
+        CHECK(PopInjectedCluster(Window(0)) == 3);
+        CHECK(PopInjectedCluster(Window(0)) == 0);
+    }
+
+    void TestJoinersAndSurrogates() {
+        ClearAllInjectedOutput();
+        RecordInjectedOutput(Window(0), L"\x09B0\x200D\x09CD\x09AF");
+        RecordInjectedOutput(Window(0), L"\xD83D\xDE00");
+        CHECK(PopInjectedCluster(Window(0)) == 2);
+        CHECK(PopInjectedCluster(Window(0)) == 4);
+    }
+
+    void TestPopStartsFreshCluster() {
+        ClearAllInjectedOutput();
+        RecordInjectedOutput(Window(0), L"\x0995\x0995\x09CD");
+        CHECK(PopInjectedCluster(Window(0)) == 2);
+        // The next consonant must not count the deleted virama as a link.
+        RecordInjectedOutput(Window(0), L"\x09B7");
+        CHECK(PopInjectedCluster(Window(0)) == 1);
+        CHECK(PopInjectedCluster(Window(0)) == 1);
+    }
+
+    void TestRingOverflow() {
+        ClearAllInjectedOutput();
+        // 40 conjuncts into a 32-entry ring: the oldest 8 are forgotten.
+        for (int i = 0; i < 40; ++i) {
+            RecordInjectedOutput(Window(0), L"\x0995\x09CD\x09B7");
+        }
+        int popped = 0;
+        while (PopInjectedCluster(Window(0)) == 3) {
+            ++popped;
+        }
+        CHECK(popped == 32);
+        CHECK(PopInjectedCluster(Window(0)) == 0);
+    }
+
+    void TestWindowsAreSeparate() {
+        ClearAllInjectedOutput();
+        RecordInjectedOutput(Window(0), L"\x0995\x09CD\x09B7");
+        RecordInjectedOutput(Window(1), L"\x0995\x09BE");
+        CHECK(PopInjectedCluster(Window(1)) == 2);
+        CHECK(PopInjectedCluster(Window(0)) == 3);
+        CHECK(PopInjectedCluster(Window(2)) == 0);
+    }
+
+    void TestClear() {
+        ClearAllInjectedOutput();
+        RecordInjectedOutput(Window(0), L"\x0995\x09CD\x09B7");
+        RecordInjectedOutput(Window(1), L"\x0995\x09CD\x09B7");
+        ClearInjectedOutput(Window(0));
+        CHECK(PopInjectedCluster(Window(0)) == 0);
+        CHECK(PopInjectedCluster(Window(1)) == 3);
+
+        RecordInjectedOutput(Window(0), L"\x0995\x09CD\x09B7");
+        RecordInjectedOutput(Window(1), L"\x0995\x09CD\x09B7");
+        ClearAllInjectedOutput();
+        CHECK(PopInjectedCluster(Window(0)) == 0);
+        CHECK(PopInjectedCluster(Window(1)) == 0);
+    }
+
+    void TestLeastRecentlyUsedWindowIsEvicted() {
+        ClearAllInjectedOutput();
+        for (int i = 0; i < 8; ++i) {
+            RecordInjectedOutput(Window(i), L"\x0995\x09BE");
+        }
+        // Touch window 0 so window 1 becomes the oldest, then add a ninth.
+        RecordInjectedOutput(Window(0), L"\x0995\x09BE");
+        RecordInjectedOutput(Window(8), L"\x0995\x09BE");
+        CHECK(PopInjectedCluster(Window(1)) == 0);
+        CHECK(PopInjectedCluster(Window(0)) == 2);
+        CHECK(PopInjectedCluster(Window(8)) == 2);
+        CHECK(PopInjectedCluster(Window(7)) == 2);
+    }
+
+} // namespace
+
+int main() {
+    TestPopsWholeClusters();
+    TestClusterSpansKeystrokes();
+    TestJoinersAndSurrogates();
+    TestPopStartsFreshCluster();
+    TestRingOverflow();
+    TestWindowsAreSeparate();
+    TestClear();
+    TestLeastRecentlyUsedWindowIsEvicted();
+    return TestResult();
+}
@@ -0,0 +1,66 @@
+#include "core/phonetic_engine.h"
+#include "test_check.h"
+
+#include <string>
+
+using bijoy::core::PhoneticEdit;
+using bijoy::core::PhoneticEngine;
+
+namespace {
+
+    // Types roman one key at a time and applies each edit the way the hook
+    // does, returning the text left in the target, or stops at the first key
+    // the engine refuses.
+    std::wstring TypeLive(const char* roman, bool* allAccepted) {
+        PhoneticEngine engine;
+        PhoneticEdit edit;
+        std::wstring text;
+        *allAccepted = true;
+        for (const char* c = roman; *c; ++c) {
+            if (!engine.feed(*c, edit)) {
+                *allAccepted = false;
+                break;
+            }
+            CHECK(edit.backspaces <= text.size());
+            text.resize(text.size() - edit.backspaces);
+            text += edit.text;
+        }
+        return text;
+    }
+
+    void TestKhandaTa() {
+        bool accepted = false;
+        CHECK(TypeLive("t`", &accepted) == L"ৎ");
+        CHECK(accepted);
+        CHECK(TypeLive("hot`", &accepted) == L"হৎ");
+        CHECK(accepted);
+    }
+
+    void TestContinuationOnlyKeys() {
+        PhoneticEngine engine;
+        PhoneticEdit edit;
+        // '`' starts no rule, so it is not input at a word start or after a
+        // letter that no rule continues with it.
+        CHECK(!bijoy::core::IsPhoneticInput('`'));
+        CHECK(!engine.feed('`', edit));
+        CHECK(engine.feed('k', edit));
+        CHECK(!engine.feed('`', edit));
+    }
+
+    void TestLiveMatchesBulk() {
+        const char* const words[] = {"amar", "bangla", "kkhoma", "shot`", "ami", "rri"};
+        for (const char* word : words) {
+            bool accepted = false;
+            CHECK(TypeLive(word, &accepted) == bijoy::core::TransliterateText(word));
+            CHECK(accepted);
+        }
+    }
+
+} // namespace
+
+int main() {
+    TestKhandaTa();
+    TestContinuationOnlyKeys();
+    TestLiveMatchesBulk();
+    return TestResult();
+}
@@ -0,0 +1,170 @@
+#include "core/file_io.h"
+#include "core/spell_checker.h"
+#include "test_check.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using bijoy::core::Misspelling;
+using bijoy::core::SpellChecker;
+using bijoy::core::SpellingSuggestion;
+using bijoy::core::WordFrequency;
+
+namespace {
+
+    std::wstring TempPath(const wchar_t* name) {
+        return (std::filesystem::temp_directory_path() / name).wstring();
+    }
+
+    std::vector<WordFrequency> Lexicon() {
+        return {{L"আমি", 50},    {L"আমার", 40},  {L"বাংলা", 30},  {L"ভাষা", 25},  {L"ভাষার", 10},
+                {L"পরীক্ষা", 20}, {L"শিক্ষক", 15}, {L"কাজ", 80},    {L"কাল", 50},   {L"বই", 5},
+                {L"বই", 5},      {L"স্বাস্থ্য", 8}, {L"কর্ম", 12},   {L"ধর্ম", 6},   {L"সকাল", 9}};
+    }
+
+    std::vector<std::wstring> Suggest(const SpellChecker& checker, std::wstring_view word, size_t k = 5) {
+        std::vector<SpellingSuggestion> out;
+        checker.suggest(word, k, out);
+        std::vector<std::wstring> words;
+        for (const auto& suggestion : out) {
+            words.push_back(suggestion.word);
+        }
+        return words;
+    }
+
+    std::wstring FirstSuggestion(const SpellChecker& checker, std::wstring_view word) {
+        const std::vector<std::wstring> words = Suggest(checker, word, 1);
+        return words.empty() ? std::wstring() : words[0];
+    }
+
+    void TestBuildRejectsBadDistance(const std::wstring& path) {
+        CHECK(!bijoy::core::WriteSpellingIndex(Lexicon(), 0, path));
+        CHECK(!bijoy::core::WriteSpellingIndex(Lexicon(), 4, path));
+    }
+
+    void TestIsCorrect(const SpellChecker& checker) {
+        CHECK(checker.maxDistance() == 2);
+        for (const auto& entry : Lexicon()) {
+            CHECK(checker.isCorrect(entry.word));
+        }
+        CHECK(!checker.isCorrect(L""));
+        CHECK(!checker.isCorrect(L"ভাসা"));
+        // Prefixes and deletes of lexicon words are not words themselves.
+        CHECK(!checker.isCorrect(L"বাং"));
+        CHECK(!checker.isCorrect(L"পরীক্ষ"));
+    }
+
+    void TestSuggestByClusterEdits(const SpellChecker& checker) {
+        // Substituted cluster: সা for ষা.
+        CHECK(FirstSuggestion(checker, L"ভাসা") == L"ভাষা");
+        // Deleted and inserted clusters.
+        CHECK(FirstSuggestion(checker, L"বাংলাক") == L"বাংলা");
+        CHECK(FirstSuggestion(checker, L"আমিই") == L"আমি");
+        // Swapped clusters: বাং and লা.
+        CHECK(FirstSuggestion(checker, L"লাবাং") == L"বাংলা");
+        // A missing vowel sign changes only the conjunct's cluster.
+        CHECK(FirstSuggestion(checker, L"পরীক্ষ") == L"পরীক্ষা");
+        // বাংল is one edit from both বাংলা and কাল; the more frequent wins.
+        CHECK(Suggest(checker, L"বাংল") == (std::vector<std::wstring>{L"কাল", L"বাংলা", L"সকাল"}));
+        // Dropping the reph cluster র্ম from কর্ম is one edit, not three.
+        std::vector<SpellingSuggestion> out;
+        checker.suggest(L"কম", 5, out);
+        bool foundKarma = false;
+        for (const auto& suggestion : out) {
+            if (suggestion.word == L"কর্ম") {
+                foundKarma = true;
+                CHECK(suggestion.distance == 1);
+            }
+        }
+        CHECK(foundKarma);
+    }
+
+    void TestSuggestOrder(const SpellChecker& checker) {
+        // কাজ and কাল are both one edit from কাথ; কাজ is more frequent.
+        std::vector<SpellingSuggestion> out;
+        checker.suggest(L"কাথ", 5, out);
+        CHECK(out.size() >= 2);
+        CHECK(out.size() >= 2 && out[0].word == L"কাজ" && out[1].word == L"কাল");
+        for (size_t i = 1; i < out.size(); ++i) {
+            CHECK(out[i - 1].distance <= out[i].distance);
+        }
+        // Duplicate lexicon entries are summed.
+        checker.suggest(L"বউ", 5, out);
+        bool foundBoi = false;
+        for (const auto& suggestion : out) {
+            foundBoi = foundBoi || (suggestion.word == L"বই" && suggestion.frequency == 10);
+        }
+        CHECK(foundBoi);
+
+        CHECK(Suggest(checker, L"কাথ", 1).size() == 1);
+        CHECK(Suggest(checker, L"কাথ", 0).empty());
+        // Appends after whatever the caller already holds.
+        out.assign(1, SpellingSuggestion{L"x", 1, 0});
+        checker.suggest(L"কাথ", 1, out);
+        CHECK(out.size() == 2 && out[0].word == L"x" && out[1].word == L"কাজ");
+    }
+
+    void TestSuggestLimits(const SpellChecker& checker) {
+        // Three cluster edits away from anything.
+        CHECK(Suggest(checker, L"ঝঞটঠ").empty());
+        CHECK(Suggest(checker, L"").empty());
+        // Too many clusters to correct.
+        CHECK(Suggest(checker, std::wstring(bijoy::core::kMaxSpellingClusters + 1, L'ক')).empty());
+    }
+
+    void TestCheckText(const SpellChecker& checker) {
+        const std::wstring text = L"আমি বাংলা ভাসা লিখি। English ১২৩ আমার বই!";
+        std::vector<Misspelling> out;
+        CHECK(checker.check(text, out) == 6);
+        CHECK(out.size() == 2);
+        CHECK(out.size() == 2 && text.substr(out[0].offset, out[0].length) == L"ভাসা");
+        CHECK(out.size() == 2 && text.substr(out[1].offset, out[1].length) == L"লিখি");
+        out.clear();
+        CHECK(checker.check(L"", out) == 0);
+        CHECK(checker.check(L"abc ১২৩", out) == 0);
+        CHECK(out.empty());
+    }
+
+    void TestRejectsDamagedFiles(const std::wstring& good, const std::wstring& bad) {
+        std::string bytes;
+        CHECK(bijoy::core::ReadFileBytes(good, bytes));
+        SpellChecker checker;
+
+        CHECK(bijoy::core::WriteFileAtomic(bad, std::string_view(bytes).substr(0, bytes.size() - 2)));
+        CHECK(!checker.open(bad));
+        CHECK(!checker.isOpen());
+
+        std::string wrongMagic = bytes;
+        wrongMagic[0] = 'X';
+        CHECK(bijoy::core::WriteFileAtomic(bad, wrongMagic));
+        CHECK(!checker.open(bad));
+
+        CHECK(bijoy::core::WriteFileAtomic(bad, std::string_view(bytes).substr(0, 16)));
+        CHECK(!checker.open(bad));
+        CHECK(!checker.isCorrect(L"আমি"));
+        CHECK(Suggest(checker, L"আমি").empty());
+    }
+
+} // namespace
+
+int main() {
+    const std::wstring path = TempPath(L"spell_checker_test.bin");
+    const std::wstring badPath = TempPath(L"spell_checker_test_bad.bin");
+
+    TestBuildRejectsBadDistance(path);
+    CHECK(bijoy::core::WriteSpellingIndex(Lexicon(), 2, path));
+    SpellChecker checker;
+    CHECK(checker.open(path));
+    TestIsCorrect(checker);
+    TestSuggestByClusterEdits(checker);
+    TestSuggestOrder(checker);
+    TestSuggestLimits(checker);
+    TestCheckText(checker);
+    checker.close();
+    TestRejectsDamagedFiles(path, badPath);
+
+    bijoy::core::RemoveFile(path);
+    bijoy::core::RemoveFile(badPath);
+    return TestResult();
+}
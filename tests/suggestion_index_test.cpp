@@ -0,0 +1,85 @@
+#include "core/file_io.h"
+#include "core/suggestion_index.h"
+#include "test_check.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using bijoy::core::Suggestion;
+using bijoy::core::SuggestionIndex;
+using bijoy::core::WordFrequency;
+
+namespace {
+
+    // On-disk layout, mirrored from suggestion_index.cpp.
+    constexpr size_t kHeaderSize = 16;
+    constexpr size_t kNodeSize = 24;
+    constexpr size_t kLabelLengthOffset = 20;
+
+    std::wstring TempPath(const wchar_t* name) {
+        return (std::filesystem::temp_directory_path() / name).wstring();
+    }
+
+    std::string BuildIndexBytes(const std::wstring& path) {
+        std::vector<WordFrequency> words = {
+                {L"আমি", 50}, {L"আমার", 40}, {L"আমরা", 30}, {L"বাংলা", 20}, {L"বই", 10}};
+        CHECK(bijoy::core::WriteSuggestionIndex(words, path));
+        std::string bytes;
+        CHECK(bijoy::core::ReadFileBytes(path, bytes));
+        return bytes;
+    }
+
+    void TestOpenAndComplete(const std::wstring& path) {
+        SuggestionIndex index;
+        CHECK(index.open(path));
+
+        SuggestionIndex::Cursor cursor = index.root();
+        CHECK(index.advance(cursor, L'আ'));
+        CHECK(index.advance(cursor, L'ম'));
+        std::vector<Suggestion> out;
+        index.complete(cursor, 2, out);
+        CHECK(out.size() == 2);
+        CHECK(!out.empty() && out[0].word == L"আমি");
+        CHECK(index.frequency(L"বই") == 10);
+        CHECK(!index.advance(cursor, L'x'));
+    }
+
+    void TestRejectsEmptyChildLabel(const std::string& good, const std::wstring& path) {
+        uint32_t nodeCount = 0;
+        std::memcpy(&nodeCount, good.data() + 8, sizeof(nodeCount));
+        CHECK(nodeCount > 1);
+
+        // Any child with an empty label must fail to open.
+        for (uint32_t i = 1; i < nodeCount; ++i) {
+            std::string bytes = good;
+            const uint16_t zero = 0;
+            std::memcpy(&bytes[kHeaderSize + i * kNodeSize + kLabelLengthOffset], &zero, sizeof(zero));
+            CHECK(bijoy::core::WriteFileAtomic(path, bytes));
+            SuggestionIndex index;
+            CHECK(!index.open(path));
+        }
+    }
+
+    void TestRejectsTruncated(const std::string& good, const std::wstring& path) {
+        CHECK(bijoy::core::WriteFileAtomic(path, std::string_view(good).substr(0, good.size() - 2)));
+        SuggestionIndex index;
+        CHECK(!index.open(path));
+    }
+
+} // namespace
+
+int main() {
+    const std::wstring goodPath = TempPath(L"suggestion_index_test.bin");
+    const std::wstring badPath = TempPath(L"suggestion_index_test_bad.bin");
+
+    const std::string good = BuildIndexBytes(goodPath);
+    TestOpenAndComplete(goodPath);
+    TestRejectsEmptyChildLabel(good, badPath);
+    TestRejectsTruncated(good, badPath);
+
+    bijoy::core::RemoveFile(goodPath);
+    bijoy::core::RemoveFile(badPath);
+    return TestResult();
+}
@@ -0,0 +1,115 @@
+#include "core/suggestion_index.h"
+#include "core/suggestion_service.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using bijoy::core::AcquireLatestSuggestions;
+using bijoy::core::PublishSuggestionPrefix;
+using bijoy::core::SuggestionResults;
+using bijoy::core::WordFrequency;
+
+namespace {
+
+    std::atomic<int> g_ready{0};
+
+    std::wstring TempPath(const wchar_t* name) {
+        return (std::filesystem::temp_directory_path() / name).wstring();
+    }
+
+    // Waits for the results of prefix; every wake-up must arrive promptly,
+    // well inside the deadline.
+    bool WaitForPrefix(const std::wstring& prefix) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (AcquireLatestSuggestions().prefix == prefix) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    void TestCompletes(const std::wstring& path) {
+        CHECK(bijoy::core::StartSuggestionService(path, [] { ++g_ready; }));
+        PublishSuggestionPrefix(L"আম");
+        CHECK(WaitForPrefix(L"আম"));
+        const SuggestionResults& results = AcquireLatestSuggestions();
+        CHECK(results.items.size() == 3);
+        CHECK(!results.items.empty() && results.items[0].word == L"আমি");
+        CHECK(g_ready.load() > 0);
+
+        // Longer than kMaxSuggestionPrefix: published as empty.
+        PublishSuggestionPrefix(std::wstring(bijoy::core::kMaxSuggestionPrefix + 1, L'আ'));
+        CHECK(WaitForPrefix(L""));
+        CHECK(AcquireLatestSuggestions().items.empty());
+        bijoy::core::StopSuggestionService();
+    }
+
+    // Alternating prefixes make every publish produce new results, so a lost
+    // wake-up shows up as a missed deadline.
+    void TestNoLostWakeups(const std::wstring& path) {
+        CHECK(bijoy::core::StartSuggestionService(path, nullptr));
+        const std::wstring prefixes[] = {L"আম", L"বা"};
+        int missed = 0;
+        for (int i = 0; i < 2000; ++i) {
+            PublishSuggestionPrefix(prefixes[i % 2]);
+            if (!WaitForPrefix(prefixes[i % 2])) {
+                ++missed;
+            }
+        }
+        CHECK(missed == 0);
+        bijoy::core::StopSuggestionService();
+        CHECK(!bijoy::core::IsSuggestionServiceRunning());
+    }
+
+    void TestBurstSettlesOnLastPrefix(const std::wstring& path) {
+        CHECK(bijoy::core::StartSuggestionService(path, nullptr));
+        const std::wstring word = L"বাংলা";
+        for (size_t i = 1; i <= word.size(); ++i) {
+            PublishSuggestionPrefix(std::wstring_view(word).substr(0, i));
+        }
+        CHECK(WaitForPrefix(word));
+        CHECK(AcquireLatestSuggestions().items.size() == 1);
+        bijoy::core::StopSuggestionService();
+    }
+
+    void TestReload(const std::wstring& path, const std::wstring& otherPath) {
+        CHECK(bijoy::core::StartSuggestionService(path, nullptr));
+        bijoy::core::ReloadSuggestionIndex(otherPath);
+        PublishSuggestionPrefix(L"বই");
+        CHECK(WaitForPrefix(L"বই"));
+        // Only the reloaded index knows বইটি.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+        while (AcquireLatestSuggestions().items.size() < 2 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        CHECK(AcquireLatestSuggestions().items.size() == 2);
+        bijoy::core::StopSuggestionService();
+    }
+
+} // namespace
+
+int main() {
+    const std::wstring path = TempPath(L"bijoy_suggestion_service_test.idx");
+    const std::wstring otherPath = TempPath(L"bijoy_suggestion_service_test_2.idx");
+    std::vector<WordFrequency> words = {
+            {L"আমি", 50}, {L"আমার", 40}, {L"আমরা", 30}, {L"বাংলা", 20}, {L"বই", 10}};
+    CHECK(bijoy::core::WriteSuggestionIndex(words, path));
+    words.push_back({L"বইটি", 5});
+    CHECK(bijoy::core::WriteSuggestionIndex(words, otherPath));
+
+    TestCompletes(path);
+    TestNoLostWakeups(path);
+    TestBurstSettlesOnLastPrefix(path);
+    TestReload(path, otherPath);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(otherPath);
+    return TestResult();
+}
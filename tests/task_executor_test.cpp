@@ -0,0 +1,267 @@
+#include "core/task_executor.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using bijoy::core::CancellationToken;
+using bijoy::core::SubmitTask;
+using bijoy::core::TaskHandle;
+using bijoy::core::TaskPriority;
+
+namespace {
+
+    // Holds the tasks that wait on it until opened, and counts them in.
+    class Gate {
+    public:
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++arrived_;
+            changed_.notify_all();
+            changed_.wait(lock, [this] { return open_; });
+        }
+
+        bool WaitArrived(int count) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return changed_.wait_for(lock, std::chrono::seconds(5), [&] { return arrived_ >= count; });
+        }
+
+        void Open() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+            changed_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        int arrived_ = 0;
+        bool open_ = false;
+    };
+
+    // Occupies count workers until the gate opens.
+    std::vector<TaskHandle> Occupy(Gate& gate, size_t count) {
+        std::vector<TaskHandle> handles;
+        for (size_t i = 0; i < count; ++i) {
+            handles.push_back(SubmitTask([&gate](const CancellationToken&) { gate.Wait(); }));
+        }
+        CHECK(gate.WaitArrived(static_cast<int>(count)));
+        return handles;
+    }
+
+    void TestRunsAndWaits() {
+        TaskHandle empty;
+        CHECK(!empty.valid() && empty.isDone());
+        empty.wait();
+
+        std::atomic<int> sum{0};
+        std::vector<TaskHandle> handles;
+        for (int i = 1; i <= 100; ++i) {
+            handles.push_back(SubmitTask([&sum, i](const CancellationToken&) { sum += i; }));
+        }
+        for (const TaskHandle& handle : handles) {
+            handle.wait();
+            CHECK(handle.valid() && handle.isDone());
+        }
+        CHECK(sum.load() == 5050);
+        CHECK(bijoy::core::GetTaskExecutorWorkerCount() >= 2);
+    }
+
+    void TestCancellation() {
+        const size_t workers = bijoy::core::GetTaskExecutorWorkerCount();
+        Gate gate;
+        std::vector<TaskHandle> busy = Occupy(gate, workers);
+
+        // Cancelled while queued: never runs, yet counts as done.
+        std::atomic<bool> ran{false};
+        CancellationToken token;
+        TaskHandle skipped = SubmitTask([&ran](const CancellationToken&) { ran = true; },
+                                        TaskPriority::Background, token);
+        token.cancel();
+
+        // Cancelled while running: sees the flag and returns.
+        Gate started;
+        std::atomic<bool> stopped{false};
+        TaskHandle running = SubmitTask([&](const CancellationToken& own) {
+            started.Wait();
+            while (!own.cancelled()) {
+                std::this_thread::yield();
+            }
+            stopped = true;
+        });
+
+        gate.Open();
+        for (const TaskHandle& handle : busy) {
+            handle.wait();
+        }
+        started.Open();
+        CHECK(started.WaitArrived(1));
+        running.cancel();
+        running.wait();
+        skipped.wait();
+        CHECK(stopped.load());
+        CHECK(skipped.isDone() && !ran.load());
+    }
+
+    void TestUiCriticalFirst() {
+        const size_t workers = bijoy::core::GetTaskExecutorWorkerCount();
+        Gate gate;
+        std::vector<TaskHandle> busy = Occupy(gate, workers);
+
+        // Queued behind the gate: Background first, UiCritical after.
+        constexpr int kEach = 40;
+        std::atomic<int> next{0};
+        std::vector<int> backgroundStarts(kEach), criticalStarts(kEach);
+        std::vector<TaskHandle> handles;
+        for (int i = 0; i < kEach; ++i) {
+            handles.push_back(SubmitTask([&, i](const CancellationToken&) { backgroundStarts[i] = next++; },
+                                         TaskPriority::Background));
+        }
+        for (int i = 0; i < kEach; ++i) {
+            handles.push_back(SubmitTask([&, i](const CancellationToken&) { criticalStarts[i] = next++; },
+                                         TaskPriority::UiCritical));
+        }
+        gate.Open();
+        for (const TaskHandle& handle : busy) {
+            handle.wait();
+        }
+        for (const TaskHandle& handle : handles) {
+            handle.wait();
+        }
+
+        // Every UiCritical task is taken before any Background one. A
+        // worker may record its start a moment after another took a later
+        // task, hence the slack of one per worker.
+        for (int start : criticalStarts) {
+            CHECK(start < kEach + static_cast<int>(workers));
+        }
+        for (int start : backgroundStarts) {
+            CHECK(start >= kEach - static_cast<int>(workers));
+        }
+    }
+
+    // A task submits more tasks and waits for them, on every worker at once;
+    // the waits run the subtasks rather than deadlock.
+    void TestNestedWaits() {
+        const size_t workers = bijoy::core::GetTaskExecutorWorkerCount();
+        std::atomic<int> leaves{0};
+        std::vector<TaskHandle> outer;
+        for (size_t i = 0; i < workers * 2; ++i) {
+            outer.push_back(SubmitTask([&leaves](const CancellationToken&) {
+                std::vector<TaskHandle> inner;
+                for (int j = 0; j < 8; ++j) {
+                    inner.push_back(SubmitTask([&leaves](const CancellationToken&) { ++leaves; },
+                                               TaskPriority::UiCritical));
+                }
+                for (const TaskHandle& handle : inner) {
+                    handle.wait();
+                }
+            }, TaskPriority::UiCritical));
+        }
+        for (const TaskHandle& handle : outer) {
+            handle.wait();
+        }
+        CHECK(leaves.load() == static_cast<int>(workers * 2 * 8));
+    }
+
+    // A worker waiting for a UiCritical task that another worker is running
+    // must not pick up a queued Background task meanwhile.
+    void TestWaitSkipsLessUrgentWork() {
+        const size_t workers = bijoy::core::GetTaskExecutorWorkerCount();
+        Gate gate;
+        std::vector<TaskHandle> busy = Occupy(gate, workers - 2);
+
+        Gate awaitedGate;
+        TaskHandle awaited = SubmitTask([&](const CancellationToken&) { awaitedGate.Wait(); },
+                                        TaskPriority::UiCritical);
+        CHECK(awaitedGate.WaitArrived(1));
+
+        // The last free worker runs the waiter.
+        std::atomic<bool> waiting{false};
+        std::atomic<bool> backgroundDuringWait{false};
+        std::thread::id waiterThread;
+        TaskHandle background;
+        TaskHandle waiter = SubmitTask([&](const CancellationToken&) {
+            waiterThread = std::this_thread::get_id();
+            background = SubmitTask([&](const CancellationToken&) {
+                if (waiting.load() && std::this_thread::get_id() == waiterThread) {
+                    backgroundDuringWait = true;
+                }
+            });
+            waiting = true;
+            awaited.wait();
+            waiting = false;
+        }, TaskPriority::UiCritical);
+        while (!waiting.load()) {
+            std::this_thread::yield();
+        }
+
+        // Long enough for a polling wait to have taken the Background task.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        awaitedGate.Open();
+        waiter.wait();
+        gate.Open();
+        for (const TaskHandle& handle : busy) {
+            handle.wait();
+        }
+        background.wait();
+        CHECK(!backgroundDuringWait.load());
+    }
+
+    void TestParallelFor() {
+        std::vector<std::atomic<int>> hits(1000);
+        bijoy::core::ParallelFor(hits.size(), [&hits](size_t i) { ++hits[i]; });
+        bool once = true;
+        for (const auto& hit : hits) {
+            once = once && hit.load() == 1;
+        }
+        CHECK(once);
+
+        int calls = 0;
+        bijoy::core::ParallelFor(0, [&calls](size_t) { ++calls; });
+        bijoy::core::ParallelFor(1, [&calls](size_t) { ++calls; });
+        CHECK(calls == 1);
+    }
+
+    void TestStopAndRestart() {
+        const size_t workers = bijoy::core::GetTaskExecutorWorkerCount();
+        Gate gate;
+        std::vector<TaskHandle> busy = Occupy(gate, workers);
+        std::atomic<bool> ran{false};
+        TaskHandle queued = SubmitTask([&ran](const CancellationToken&) { ran = true; });
+
+        // Stop waits for the running tasks, so open the gate from outside.
+        std::thread opener([&gate] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            gate.Open();
+        });
+        bijoy::core::StopTaskExecutor();
+        opener.join();
+        CHECK(bijoy::core::GetTaskExecutorWorkerCount() == 0);
+        CHECK(queued.isDone() && !ran.load());
+
+        // The next submission starts a fresh executor.
+        TaskHandle again = SubmitTask([&ran](const CancellationToken&) { ran = true; });
+        again.wait();
+        CHECK(ran.load());
+        CHECK(bijoy::core::GetTaskExecutorWorkerCount() == workers);
+    }
+
+} // namespace
+
+int main() {
+    bijoy::core::StartTaskExecutor();
+    TestRunsAndWaits();
+    TestCancellation();
+    TestUiCriticalFirst();
+    TestNestedWaits();
+    TestWaitSkipsLessUrgentWork();
+    TestParallelFor();
+    TestStopAndRestart();
+    bijoy::core::StopTaskExecutor();
+    return TestResult();
+}
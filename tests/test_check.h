@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertion helpers: a failed CHECK reports and carries on, and the
+// test's main returns TestResult() so CTest sees the failure.
+inline int& TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                   #condition);                                            \
+      ++TestFailures();                                                    \
+    }                                                                      \
+  } while (0)
+
+inline int TestResult() {
+  if (TestFailures() > 0) {
+    std::fprintf(stderr, "%d check(s) failed\n", TestFailures());
+    return 1;
+  }
+  return 0;
+}